@@ -0,0 +1,502 @@
+/*******************************************
+ * **** DESCRIPTION ****
+ * This program runs timed, warmed-up iterations of the performance relevant parts
+ * of the volume rendering pipeline and reports median / p95 times and throughput as JSON.
+ *
+ * No external data sets are needed: a phantom volume is generated procedurally and
+ * written to temporary files to measure the importers.
+ *
+ * Benchmarks:
+ * 1) phantom generation
+ * 2) Importer::load3DData (slice files) and Importer::loadRaw (single raw file)
+ * 3) CPU ray casting (MIP only and MIP + MinIP + average) and CPU shear-warp along a fixed camera path, MPR slice extraction,
+ *    sliding slab MIP (full rebuild vs. incremental step)
+ * 4) loadTo3DTexture upload bandwidth
+ * 5) uniform updates of a ShaderProgram
+ * 6) GPU ray casting frames into an offscreen FrameBufferObject along a fixed camera path,
+ *    MIP only and MIP + MinIP + average in one traversal, recoloring of a cached traversal result, fused ray casting of two volumes from separate textures and from one packed texture
+ *
+ * USAGE
+ * benchmarks [--size N] [--iterations N] [--warmup N] [--output file.json] [--temp directory] [--no-gl]
+ ****************************************/
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+#include <Rendering/GLTools.h>
+#include <Rendering/VertexArrayObjects.h>
+#include <Rendering/RenderPass.h>
+
+#include <Core/Benchmark.h>
+#include <Core/ThreadPool.h>
+#include <Importing/PhantomGenerator.h>
+#include <Processing/CPURaycaster.h>
+#include <Processing/ShearWarp.h>
+#include <Processing/MPR.h>
+#include <Processing/SlabMIP.h>
+#include <Processing/VolumeFusion.h>
+#include <Processing/Gradients.h>
+#include <Processing/Bricks.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+
+////////////////////// PARAMETERS /////////////////////////////
+static unsigned int s_volumeSize = 256;  // resolution of the phantom in every dimension
+static int s_iterations = 10;            // timed iterations per benchmark
+static int s_warmup = 2;                 // untimed iterations per benchmark
+static std::string s_outputPath = "benchmarks.json";
+static std::string s_tempPath = ".";     // directory for temporary volume files
+static bool s_runGL = true;              // run benchmarks which need an OpenGL context
+
+static const int s_numCameraPositions = 8; // camera path: positions on a circle around the volume
+static const glm::vec2 s_imageResolution = glm::vec2(512.0f, 512.0f);
+
+/**
+ * @brief view matrix of a camera position on the benchmark camera path
+ */
+glm::mat4 cameraPathView(int i)
+{
+	float angle = 2.0f * glm::pi<float>() * (float) (i % s_numCameraPositions) / (float) s_numCameraPositions;
+	glm::vec3 eye( 2.5f * std::sin(angle), 0.5f, 2.5f * std::cos(angle) );
+	return glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+void parseArguments(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = (i + 1 < argc);
+		if      (arg == "--size"       && hasValue) { s_volumeSize = (unsigned int) std::atoi(argv[++i]); }
+		else if (arg == "--iterations" && hasValue) { s_iterations = std::max(1, std::atoi(argv[++i])); }
+		else if (arg == "--warmup"     && hasValue) { s_warmup = std::max(0, std::atoi(argv[++i])); }
+		else if (arg == "--output"     && hasValue) { s_outputPath = argv[++i]; }
+		else if (arg == "--temp"       && hasValue) { s_tempPath = argv[++i]; }
+		else if (arg == "--no-gl")                  { s_runGL = false; }
+		else
+		{
+			DEBUGLOG_WARNING("unknown argument " + arg);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+///////////////////////////////// MAIN ///////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+	DEBUGLOG->setAutoPrint(true);
+	parseArguments(argc, argv);
+
+	Benchmark benchmark;
+	benchmark.addConfig("volume_size", (double) s_volumeSize);
+	benchmark.addConfig("iterations", (double) s_iterations);
+	benchmark.addConfig("warmup", (double) s_warmup);
+	benchmark.addConfig("threads", (double) THREADPOOL->getNumThreads());
+
+	//////////////////////////////////////////////////////////////////////////////
+	/////////////////////// VOLUME DATA GENERATION ///////////////////////////////
+	//////////////////////////////////////////////////////////////////////////////
+	PhantomGenerator::PhantomParameters phantomParams(PhantomGenerator::VESSEL_TREE, s_volumeSize, 1);
+	double numVoxels = (double) s_volumeSize * s_volumeSize * s_volumeSize;
+	double volumeBytes = numVoxels * sizeof(short);
+
+	VolumeData<short> volumeData;
+	benchmark.run("phantom generation", 0, std::max(1, s_iterations / 4), [&]()
+	{
+		volumeData = PhantomGenerator::generate<short>(phantomParams);
+	}, numVoxels, "voxels");
+
+	//////////////////////////////////////////////////////////////////////////////
+	/////////////////////// IMPORT ///////////////////////////////////////////////
+	//////////////////////////////////////////////////////////////////////////////
+	DEBUGLOG->log("Writing temporary volume files to " + s_tempPath); DEBUGLOG->indent();
+
+	// slice files as expected by load3DData: big endian, 2 bytes per value
+	std::string slicePrefix = s_tempPath + "/benchmark_phantom";
+	size_t sliceSize = (size_t) volumeData.size_x * volumeData.size_y;
+	for (unsigned int z = 0; z < volumeData.size_z; z++)
+	{
+		std::vector<char> slice(sliceSize * 2);
+		for (size_t i = 0; i < sliceSize; i++)
+		{
+			short value = volumeData.data[ z * sliceSize + i ];
+			slice[2 * i]     = (char) ( (value >> 8) & 0xFF );
+			slice[2 * i + 1] = (char) ( value & 0xFF );
+		}
+		std::ofstream file( (slicePrefix + "." + std::to_string(z + 1)).c_str(), std::ofstream::binary );
+		file.write( &slice[0], slice.size() );
+	}
+
+	// single raw file as expected by loadRaw: native byte order
+	std::string rawPath = s_tempPath + "/benchmark_phantom.raw";
+	{
+		std::ofstream file( rawPath.c_str(), std::ofstream::binary );
+		file.write( reinterpret_cast<const char*>( &volumeData.data[0] ), volumeData.data.size() * sizeof(short) );
+	}
+	DEBUGLOG->outdent();
+
+	benchmark.run("Importer::load3DData", 1, s_iterations, [&]()
+	{
+		VolumeData<short> loaded = Importer::load3DData<short>(slicePrefix, volumeData.size_x, volumeData.size_y, volumeData.size_z, 2);
+	}, volumeBytes, "bytes");
+
+	benchmark.run("Importer::loadRaw", 1, s_iterations, [&]()
+	{
+		VolumeData<short> loaded = Importer::loadRaw<short>(rawPath, volumeData.size_x, volumeData.size_y, volumeData.size_z);
+	}, volumeBytes, "bytes");
+
+	for (unsigned int z = 0; z < volumeData.size_z; z++)
+	{
+		std::remove( (slicePrefix + "." + std::to_string(z + 1)).c_str() );
+	}
+	std::remove( rawPath.c_str() );
+
+	//////////////////////////////////////////////////////////////////////////////
+	/////////////////////// CPU RENDERING ////////////////////////////////////////
+	//////////////////////////////////////////////////////////////////////////////
+	glm::mat4 model(1.0f);
+	glm::mat4 projection = glm::ortho(-2.0f, 2.0f, -2.0f, 2.0f, -1.0f, 6.0f);
+	glm::vec3 proxySize(1.0f);
+	glm::ivec3 volumeSize(volumeData.size_x, volumeData.size_y, volumeData.size_z);
+
+	MIPImage image;
+	image.resize( (int) s_imageResolution.x, (int) s_imageResolution.y );
+
+	CPURaycaster cpuRaycaster(0.5f);
+	ShearWarp shearWarp(ShearWarp::BILINEAR);
+
+	// samples per frame depend on the camera position, so time every frame and average the samples
+	auto runCPUEngine = [&](const std::string& name, std::function<void(const glm::mat4&)> renderFrame, std::function<const CPURenderStats&()> stats)
+	{
+		DEBUGLOG->log("Benchmark: " + name);
+		for (int i = 0; i < s_warmup; i++)
+		{
+			renderFrame( CPURendering::computeVoxelToPixel(volumeSize, proxySize, projection * cameraPathView(i) * model, image.width, image.height) );
+		}
+
+		std::vector<double> milliseconds;
+		double samples = 0.0;
+		for (int i = 0; i < s_iterations; i++)
+		{
+			renderFrame( CPURendering::computeVoxelToPixel(volumeSize, proxySize, projection * cameraPathView(i) * model, image.width, image.height) );
+			milliseconds.push_back( stats().milliseconds );
+			samples += stats().samples;
+		}
+		benchmark.addResult(name, milliseconds, samples / (double) s_iterations, "samples");
+	};
+
+	runCPUEngine("CPU ray casting",
+		[&](const glm::mat4& voxelToPixel){ cpuRaycaster.render(volumeData, voxelToPixel, image); },
+		[&]() -> const CPURenderStats& { return cpuRaycaster.getStats(); });
+
+	MIPImage minImage, averageImage, maxDepthImage;
+	runCPUEngine("CPU ray casting multi-projection",
+		[&](const glm::mat4& voxelToPixel){ cpuRaycaster.render(volumeData, voxelToPixel, image, minImage, averageImage, maxDepthImage); },
+		[&]() -> const CPURenderStats& { return cpuRaycaster.getStats(); });
+
+	runCPUEngine("CPU shear-warp",
+		[&](const glm::mat4& voxelToPixel){ shearWarp.render(volumeData, voxelToPixel, image); },
+		[&]() -> const CPURenderStats& { return shearWarp.getStats(); });
+
+	/////////////////////// MULTI-PLANAR RECONSTRUCTION ///////////////////////
+	MPR mpr;
+	MIPImage sliceImage;
+	glm::vec3 volumeCenter = glm::vec3(volumeSize - glm::ivec3(1)) * 0.5f;
+
+	SlicePlane axialPlane = MPR::createPlane(volumeData, MPR::AXIAL, 0.5f);
+	SlicePlane sagittalPlane = MPR::createPlane(volumeData, MPR::SAGITTAL, 0.5f);
+	SlicePlane obliquePlane = MPR::createObliquePlane(volumeData, volumeCenter, glm::vec3(1.0f, 1.0f, 1.0f), (int) s_volumeSize);
+
+	mpr.setSlabThickness(1.0f);
+	benchmark.run("MPR axial", s_warmup, s_iterations, [&]()
+	{
+		mpr.extract(volumeData, axialPlane, sliceImage);
+	}, (double) axialPlane.width * axialPlane.height, "samples");
+
+	benchmark.run("MPR sagittal", s_warmup, s_iterations, [&]()
+	{
+		mpr.extract(volumeData, sagittalPlane, sliceImage);
+	}, (double) sagittalPlane.width * sagittalPlane.height, "samples");
+
+	benchmark.run("MPR oblique", s_warmup, s_iterations, [&]()
+	{
+		mpr.extract(volumeData, obliquePlane, sliceImage);
+	}, (double) obliquePlane.width * obliquePlane.height, "samples");
+
+	mpr.setSlabThickness(15.0f);
+	benchmark.run("MPR oblique slab 15", s_warmup, s_iterations, [&]()
+	{
+		mpr.extract(volumeData, obliquePlane, sliceImage);
+	}, (double) obliquePlane.width * obliquePlane.height * 15.0, "samples");
+
+	/////////////////////// SLIDING SLAB MIP /////////////////////////////////
+	SlabMIP slabMIP;
+	int slabThickness = 15;
+	int maxFirstSlice = (int) volumeData.size_z - slabThickness;
+	benchmark.run("slab MIP rebuild 15", s_warmup, s_iterations, [&]()
+	{
+		slabMIP.invalidate();
+		slabMIP.render(volumeData, MPR::AXIAL, maxFirstSlice / 2, slabThickness, sliceImage);
+	}, (double) axialPlane.width * axialPlane.height * (double) slabThickness, "samples");
+
+	int slabFirstSlice = 0;
+	benchmark.run("slab MIP step 15", s_warmup, s_iterations, [&]()
+	{
+		slabFirstSlice = (slabFirstSlice + 1) % (maxFirstSlice + 1); // rebuilds once when wrapping around
+		slabMIP.render(volumeData, MPR::AXIAL, slabFirstSlice, slabThickness, sliceImage);
+	}, (double) axialPlane.width * axialPlane.height, "samples");
+
+	//////////////////////////////////////////////////////////////////////////////
+	/////////////////////// GPU //////////////////////////////////////////////////
+	//////////////////////////////////////////////////////////////////////////////
+	if (s_runGL)
+	{
+		// invisible window, only used for its context
+		auto window = generateWindow( (int) s_imageResolution.x, (int) s_imageResolution.y, 100, 100, false );
+		benchmark.addConfig("gl_renderer", std::string( (const char*) glGetString(GL_RENDERER) ) );
+
+		/////////////////////// TEXTURE UPLOAD ///////////////////////////////////
+		benchmark.run("loadTo3DTexture", s_warmup, s_iterations, [&]()
+		{
+			GLuint texture = loadTo3DTexture<short>(volumeData);
+			glFinish();
+			glDeleteTextures(1, &texture);
+		}, volumeBytes, "bytes");
+
+		GLuint volumeTexture = loadTo3DTexture<short>(volumeData);
+
+		// every sampler of volume.frag needs a texture of its type on its own unit, even if unused (uShading, uBrickSize 0)
+		GradientVolume gradients;
+		Gradients::compute(volumeData, Gradients::SOBEL, gradients);
+		GLuint gradientTexture = loadGradientsTo3DTexture(gradients.data, gradients.size_x, gradients.size_y, gradients.size_z);
+		MinMaxBricks bricks;
+		Bricks::computeMinMax(volumeData, 8, bricks);
+		GLuint brickTexture = loadTo3DTexturePacked<short>(bricks.min, bricks.max);
+
+		/////////////////////// RAY CASTING SETUP ////////////////////////////////
+		Volume volume(proxySize.x, proxySize.y, proxySize.z);
+
+		ShaderProgram uvwShaderProgram("/modelSpace/volumeMVP.vert", "/modelSpace/volumeUVW.frag");
+		uvwShaderProgram.update("model", model);
+		uvwShaderProgram.update("projection", projection);
+
+		FrameBufferObject uvwFBO( (int) s_imageResolution.x, (int) s_imageResolution.y );
+		uvwFBO.addColorAttachments(2);
+
+		RenderPass uvwRenderPass(&uvwShaderProgram, &uvwFBO);
+		uvwRenderPass.addClearBit(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+		uvwRenderPass.addDisable(GL_DEPTH_TEST);
+		uvwRenderPass.addEnable(GL_BLEND);
+		uvwRenderPass.addRenderable(&volume);
+
+		ShaderProgram shaderProgram("/modelSpace/volumeMVP.vert", "/modelSpace/volume.frag");
+		shaderProgram.update("model", model);
+		shaderProgram.update("projection", projection);
+		shaderProgram.update("volume_texture", 0);
+		shaderProgram.update("volume_texture_next", 0); // static volume, uTimeMix 0
+		shaderProgram.update("gradient_texture", 8);
+		shaderProgram.update("brick_texture", 9);
+		shaderProgram.update("back_uvw_map",  1);
+		shaderProgram.update("front_uvw_map", 2);
+		shaderProgram.update("uGradientMaxMagnitude", gradients.maxMagnitude);
+
+		FrameBufferObject::s_internalFormat = GL_RGBA32F; // traversal result: max value, depths, relative distance
+		FrameBufferObject::s_format = GL_RGBA;
+		FrameBufferObject::s_type = GL_FLOAT;
+		FrameBufferObject raycastFBO( (int) s_imageResolution.x, (int) s_imageResolution.y );
+		raycastFBO.addColorAttachments(2); // MIP result, other projections
+		FrameBufferObject::s_internalFormat = GL_RGBA; // restore default
+		FrameBufferObject::s_type = GL_UNSIGNED_BYTE;
+
+		RenderPass renderPass(&shaderProgram, &raycastFBO);
+		renderPass.setClearColor(MIPImage::BACKGROUND, 0.0f, 0.0f, 0.0f);
+		renderPass.addClearBit(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+		renderPass.addRenderable(&volume);
+		renderPass.addEnable(GL_DEPTH_TEST);
+		renderPass.addDisable(GL_BLEND);
+
+		ShaderProgram recolorShader("/screenSpace/fullscreen.vert", "/screenSpace/mipRecolor.frag");
+		recolorShader.addTexture("traversal_map", raycastFBO.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT0));
+		recolorShader.addTexture("projection_map", raycastFBO.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT1));
+
+		FrameBufferObject recolorFBO( (int) s_imageResolution.x, (int) s_imageResolution.y );
+		recolorFBO.addColorAttachments(1);
+
+		Quad quad;
+		RenderPass recolorPass(&recolorShader, &recolorFBO);
+		recolorPass.addClearBit(GL_COLOR_BUFFER_BIT);
+		recolorPass.addDisable(GL_DEPTH_TEST);
+		recolorPass.addDisable(GL_BLEND);
+		recolorPass.addRenderable(&quad);
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_3D, volumeTexture);
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, uvwFBO.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT0));
+		glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_2D, uvwFBO.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT1));
+		glActiveTexture(GL_TEXTURE8);
+		glBindTexture(GL_TEXTURE_3D, gradientTexture);
+		glActiveTexture(GL_TEXTURE9);
+		glBindTexture(GL_TEXTURE_3D, brickTexture);
+		glActiveTexture(GL_TEXTURE0);
+
+		/////////////////////// UNIFORM UPDATES //////////////////////////////////
+		// the uniforms updated by interactive_MIP every frame, split into traversal and color mapping
+		const int numUniformUpdates = 16;
+		const int numFramesPerIteration = 100;
+		benchmark.run("ShaderProgram::update", s_warmup, s_iterations, [&]()
+		{
+			for (int i = 0; i < numFramesPerIteration; i++)
+			{
+				shaderProgram.update("view", cameraPathView(i));
+				shaderProgram.update("model", model);
+				shaderProgram.update("uRayParamStart", 0.0f);
+				shaderProgram.update("uRayParamEnd", 1.0f);
+				shaderProgram.update("uStepSize", 1.0f / (2.0f * volumeData.size_x));
+				recolorShader.update("uWindowingMinVal", (float) volumeData.min);
+				recolorShader.update("uWindowingMaxVal", (float) volumeData.max);
+				recolorShader.update("uWindowingRange", (float) (volumeData.max - volumeData.min));
+				recolorShader.update("uMaxDistColor", glm::vec4(1.0f));
+				recolorShader.update("uMinDistColor", glm::vec4(1.0f));
+				recolorShader.update("uMixMode", 2);
+				recolorShader.update("uColorEffectInfl", 1.0f);
+				recolorShader.update("uContrastEffectInfl", 0.5f);
+				shaderProgram.update("uThresholdLMIP", (float) volumeData.max);
+				shaderProgram.update("uMinStepsLMIP", 3);
+				recolorShader.update("uMinDepthRange", 0.0f);
+			}
+			glFinish();
+		}, (double) (numUniformUpdates * numFramesPerIteration), "updates");
+
+		recolorShader.update("uMaxDepthRange", 1.0f);
+		shaderProgram.update("uMinValThreshold", (int) volumeData.min);
+		shaderProgram.update("uMaxValThreshold", (int) volumeData.max);
+
+		/////////////////////// RAY CASTING FRAMES ///////////////////////////////
+		int frame = 0;
+		const char* raycastBenchmarkNames[] = {"GPU ray casting", "GPU ray casting multi-projection"};
+		for (int multiProjection = 0; multiProjection < 2; multiProjection++)
+		{
+			shaderProgram.update("uMultiProjection", multiProjection);
+			recolorShader.update("uProjection", multiProjection * 2); // average needs all samples
+
+			frame = 0;
+			benchmark.run(raycastBenchmarkNames[multiProjection], s_warmup, s_iterations, [&]()
+			{
+				glm::mat4 view = cameraPathView(frame++);
+				uvwShaderProgram.update("view", view);
+				shaderProgram.update("view", view);
+
+				glDisable(GL_BLEND);
+				glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+				uvwRenderPass.render();
+				renderPass.render();
+				recolorPass.render();
+				glFinish();
+			}, (double) (s_imageResolution.x * s_imageResolution.y), "rays");
+		}
+
+		// color mapping changes only, e.g. while dragging the windowing: no ray traversal
+		int recolorFrame = 0;
+		benchmark.run("GPU recolor", s_warmup, s_iterations, [&]()
+		{
+			recolorShader.update("uWindowingMaxVal", (float) volumeData.max - (float) (recolorFrame++ % 100));
+			recolorPass.render();
+			glFinish();
+		}, (double) (s_imageResolution.x * s_imageResolution.y), "pixels");
+
+		/////////////////////// FUSED RAY CASTING ////////////////////////////////
+		// second volume on the same grid, registered with a small rotation
+		VolumeData<short> secondVolumeData = PhantomGenerator::generate<short>( PhantomGenerator::PhantomParameters(PhantomGenerator::NOISE, s_volumeSize, 2) );
+		glm::mat4 registration = VolumeFusion::computeRegistration(glm::vec3(0.02f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(1.0f));
+		VolumeData<short> resampledVolumeData;
+		benchmark.run("fusion resample", 0, std::max(1, s_iterations / 4), [&]()
+		{
+			VolumeFusion::resample(secondVolumeData, registration, volumeData, resampledVolumeData);
+		}, numVoxels, "voxels");
+
+		GLuint secondVolumeTexture = loadTo3DTexture<short>(secondVolumeData);
+		GLuint packedVolumeTexture = loadTo3DTexturePacked<short>(volumeData, resampledVolumeData);
+
+		ShaderProgram fusionShaderProgram("/modelSpace/volumeMVP.vert", "/modelSpace/volumeFusion.frag");
+		fusionShaderProgram.update("model", model);
+		fusionShaderProgram.update("projection", projection);
+		fusionShaderProgram.update("back_uvw_map",  1);
+		fusionShaderProgram.update("front_uvw_map", 2);
+		fusionShaderProgram.update("volume_a", 0);
+		fusionShaderProgram.update("volume_b", 3);
+		fusionShaderProgram.update("packed_volumes", 4);
+		fusionShaderProgram.update("uRayParamStart", 0.0f);
+		fusionShaderProgram.update("uRayParamEnd", 1.0f);
+		fusionShaderProgram.update("uStepSize", 1.0f / (2.0f * volumeData.size_x));
+		fusionShaderProgram.update("uRegistrationA", glm::mat4(1.0f));
+		fusionShaderProgram.update("uRegistrationB", registration);
+		fusionShaderProgram.update("uWindowingMinValA", (float) volumeData.min);
+		fusionShaderProgram.update("uWindowingRangeA",  (float) (volumeData.max - volumeData.min));
+		fusionShaderProgram.update("uWindowingMinValB", (float) secondVolumeData.min);
+		fusionShaderProgram.update("uWindowingRangeB",  (float) (secondVolumeData.max - secondVolumeData.min));
+		fusionShaderProgram.update("uWeightA", 1.0f);
+		fusionShaderProgram.update("uWeightB", 1.0f);
+		fusionShaderProgram.update("uColorA", glm::vec4(1.0f, 0.85f, 0.7f, 1.0f));
+		fusionShaderProgram.update("uColorB", glm::vec4(0.3f, 0.7f, 1.0f, 1.0f));
+
+		RenderPass fusionRenderPass(&fusionShaderProgram, &raycastFBO);
+		fusionRenderPass.addClearBit(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+		fusionRenderPass.addRenderable(&volume);
+		fusionRenderPass.addEnable(GL_DEPTH_TEST);
+		fusionRenderPass.addDisable(GL_BLEND);
+
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_3D, secondVolumeTexture);
+		glActiveTexture(GL_TEXTURE4);
+		glBindTexture(GL_TEXTURE_3D, packedVolumeTexture);
+		glActiveTexture(GL_TEXTURE0);
+
+		const char* fusionBenchmarkNames[] = {"GPU fused ray casting (separate)", "GPU fused ray casting (packed)"};
+		for (int packed = 0; packed < 2; packed++)
+		{
+			fusionShaderProgram.update("uPacked", packed);
+			benchmark.run(fusionBenchmarkNames[packed], s_warmup, s_iterations, [&]()
+			{
+				glm::mat4 view = cameraPathView(frame++);
+				uvwShaderProgram.update("view", view);
+				fusionShaderProgram.update("view", view);
+
+				glDisable(GL_BLEND);
+				glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+				uvwRenderPass.render();
+				fusionRenderPass.render();
+				glFinish();
+			}, (double) (s_imageResolution.x * s_imageResolution.y), "rays");
+		}
+
+		glDeleteTextures(1, &secondVolumeTexture);
+		glDeleteTextures(1, &packedVolumeTexture);
+
+		DEBUGLOG->log("OpenGL error state after benchmarks: ");
+		DEBUGLOG->indent(); checkGLError(true); DEBUGLOG->outdent();
+
+		glDeleteTextures(1, &gradientTexture);
+		glDeleteTextures(1, &brickTexture);
+		glDeleteTextures(1, &volumeTexture);
+		destroyWindow(window);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////
+	/////////////////////// REPORT ///////////////////////////////////////////////
+	//////////////////////////////////////////////////////////////////////////////
+	benchmark.print();
+	if ( benchmark.writeJSON(s_outputPath) )
+	{
+		DEBUGLOG->log("Benchmark results written to " + s_outputPath);
+	}
+
+	return 0;
+}
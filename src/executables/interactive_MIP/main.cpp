@@ -14,19 +14,55 @@
  * 1) The displayed grayscale value range (contrast) decreases with the distance.
  * 2) The displayed color is shifted towards colors specified for min/max distance.
  * 
+ * As an alternative to GPU ray-casting, the MIP can be computed on the CPU, either by
+ * ray-casting or by the shear-warp factorization (orthographic projection only).
+ * Both CPU engines report their throughput in the "Render Engine" section.
+ * 
+ * Axial, coronal, sagittal and oblique slices (optionally as thick slab) are shown
+ * in the "Slice View" window next to the 3D view.
+ * 
  * Two data sets are provided: 
  * 1) the Stanford CTHead Volume Dataset
  * 2) a private MRT data set of a family member 
+ * Both data sets can be fused into a single image: one ray traversal samples the CT and
+ * the registered MRT, optionally from a single two channel texture (MRT resampled to the CT grid).
+ * The volume is only rendered again if one of its parameters changed; while nothing changes
+ * and no animation is running, the program sleeps until the next input event.
+ * The ray traversal writes the maximum value and its depth; the color effects are applied
+ * in a separate screen space pass, so changing them does not traverse the volume again.
+ * Minimum and average intensity projections can be accumulated in the same traversal.
+ * The MIP can be shaded by the gradient at the maximum, derived on the fly or fetched from a
+ * gradient volume precomputed on the CPU (central differences or Sobel, packed as RGB10A2).
+ * Alternatively, the first hit of an isosurface is rendered, skipping bricks which can't contain
+ * the iso value; the CPU ray caster provides the same mode.
+ * Additionally, a procedural 4D phantom is played back as cine loop; its time points
+ * are streamed through a small ring of 3D textures and interpolated in the shader.
+ * A right click picks the voxel the ray through the cursor selected (maximum or first hit): the GPU
+ * result is read back asynchronously, the CPU ray caster serves as reference and for the CPU engines.
+ * Screenshots and frame sequences (e.g. a full turntable revolution) are exported as PNG, or for
+ * GPU ray casting as 16 bit PGM / raw float MIP values, without stalling the render loop.
+ * In server mode ("Streaming" section, or --stream), the rendered frames are streamed as tile deltas to a
+ * stream_client, which sends camera and parameter changes back; the streamed resolution follows the client's latency budget.
+ * A session (camera path, parameters and every uniform update per frame) can be recorded into a timeline file
+ * ("Timeline" section, or --record) and replayed frame by frame, also without a visible window (--headless);
+ * a replay writes per frame CPU/GPU times (<report>.csv) and their statistics (<report>.json) to compare builds and GPUs.
+ * An uncompressed DICOM series (--dicom) replaces the CT data set; its slices are sorted by position and decoded in parallel.
+ *
+ * USAGE
+ * interactive_MIP [--dicom directory] [--stream port] [--stream-unix path] [--stream-remote]
+ *                 [--record timeline] [--replay timeline [--headless] [--report prefix]]
  * 
- * CODE LINES OF INTEREST 
- * Line 90 ; change used data set location
- * Line 92 : switch to MRT data set
- * Line 133: flip y-axis if data set is upside down
+ * CODE OF INTEREST (in main())
+ * file, Importer::load3DData : location and resolution of the CT data set
+ * s_activeModel              : data set shown at startup (0 MRT, 1 CT, 2 4D phantom)
+ * volumeProxySize            : proportions of the volume proxy, if the data set carries no voxel spacing
  * 
  * Additionally, there are some changes that may be applied to the volume ray-casting fragment shader, located in volume.frag
  ****************************************/
 
 #include <iostream>
+#include <cstring>
+#include <cstdio>
 
 #include <Rendering/GLTools.h>
 #include <Rendering/VertexArrayObjects.h>
@@ -36,6 +72,21 @@
 #include <UI/imguiTools.h>
 #include <UI/Turntable.h>
 
+#include <Processing/CPURaycaster.h>
+#include <Processing/ShearWarp.h>
+#include <Processing/MPR.h>
+#include <Processing/SlabMIP.h>
+#include <Processing/VolumeFusion.h>
+#include <Processing/Gradients.h>
+#include <Processing/Bricks.h>
+#include <Rendering/VolumeStreamer.h>
+#include <Rendering/VoxelPicker.h>
+#include <Rendering/FrameExporter.h>
+#include <Rendering/FrameStreamServer.h>
+#include <Rendering/FrameTimer.h>
+#include <Core/Timeline.h>
+#include <Core/Benchmark.h>
+
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
@@ -44,6 +95,7 @@ static float s_minValue = INT_MIN; // minimal value in data set; to be overwitte
 static float s_maxValue = INT_MAX;  // maximal value in data set; to be overwitten after import
 
 static bool  s_isRotating = false; 	// initial state for rotating animation
+static bool  s_renderOnDemand = true; // only render the volume if a parameter changed, sleep while idle
 static float s_rayStepSize = 0.1f;  // ray sampling step size; to be overwritten after volume data import
 
 static float s_rayParamEnd  = 1.0f; // parameter of uvw ray start in volume
@@ -58,7 +110,24 @@ static const char* s_mixModeLabels[] = {"Multiply", "Add", "Subtract (experiment
 
 static int 		 s_activeModel = 1;
 static int 	     s_lastTimeModel = 1;
-static const char* s_models[] = {"MRT Brain", "CT Head"};
+static const char* s_models[] = {"MRT Brain", "CT Head", "4D Phantom (streamed)"};
+
+static bool  s_timeSeriesPlaying = true;
+static float s_timeSeriesSpeed = 10.0f;     // playback speed in time points per second
+static float s_timeSeriesPosition = 0.0f;   // playback position in time points
+static bool  s_timeSeriesInterpolate = true; // interpolate between consecutive time points
+
+static bool  s_fusionEnabled = false; // GPU ray casting of CT and MRT in one traversal
+static bool  s_fusionPacked = false;  // MRT resampled onto the CT grid, both fetched from one RG16I texture
+static glm::vec3 s_fusionTranslation = glm::vec3(0.0f); // registration of the MRT onto the CT, uvw units
+static glm::vec3 s_fusionRotation = glm::vec3(0.0f);    // registration of the MRT onto the CT, degrees
+static float s_fusionScale = 1.0f;
+static glm::vec2 s_fusionWindowCT;  // windowing range of the CT; to be overwritten after import
+static glm::vec2 s_fusionWindowMRT; // windowing range of the MRT; to be overwritten after import
+static float s_fusionWeightCT  = 1.0f;
+static float s_fusionWeightMRT = 1.0f;
+static glm::vec4 s_fusionColorCT  = glm::vec4(1.0f, 0.85f, 0.7f, 1.0f); // CT: warm
+static glm::vec4 s_fusionColorMRT = glm::vec4(0.3f, 0.7f, 1.0f, 1.0f);  // MRT: cold
 
 static float s_LMIP_threshold = FLT_MAX; // LMIP threshold 
 static bool  s_LMIP_isEnabled = false;
@@ -74,6 +143,63 @@ static float s_windowingRange = FLT_MAX;
 static float s_minDepthRange = 0.0f;
 static float s_maxDepthRange = 1.0f;
 
+static int 	 s_projection = 0; // displayed projection
+static const char* s_projectionLabels[] = {"MIP", "MinIP", "Average"};
+static bool  s_multiProjection = false; // accumulate all projections in every traversal, so switching between them is instant
+
+static int 	 s_shading = 0; // gradient source for shading the MIP
+static const char* s_shadingLabels[] = {"Off", "On the fly (central differences)", "Precomputed (RGB10A2)"};
+static int 	 s_gradientOperator = Gradients::SOBEL; // operator of the precomputed gradients
+static const char* s_gradientOperatorLabels[] = {"Central difference", "Sobel"};
+static float s_shadingInfluence = 0.7f;
+static double s_shadingMilliseconds[3] = {0.0, 0.0, 0.0}; // GPU time per traversal of each gradient source, see "compare gradient sources"
+
+static int 	 s_renderMode = 0; // what a ray computes
+static const char* s_renderModeLabels[] = {"Projection", "Isosurface (first hit)"};
+static float s_isoValue = 0.0f; // to be overwritten after volume data import
+static int 	 s_isoRefinementSteps = 5; // bisection steps refining a hit
+static glm::vec4 s_isoColor = glm::vec4(0.95f, 0.9f, 0.8f, 1.0f);
+static bool  s_brickSkipping = true; // skip bricks which can't contain the iso value
+static int 	 s_brickSize = 8; // edge length of a brick in voxels
+static double s_brickSkippingMilliseconds[2] = {0.0, 0.0}; // GPU time per isosurface traversal without and with brick skipping
+
+static int 		 s_renderEngine = 0; // active rendering engine
+static const char* s_renderEngineLabels[] = {"GPU ray casting", "CPU ray casting", "CPU shear-warp"};
+static bool  s_cpuPicking = false; // pick with the CPU ray caster even if the GPU traversal result is available
+
+static int 	 s_exportFormat = 0; // FrameExporter::Format; MIP values are only available for GPU ray casting
+static const char* s_exportFormatLabels[] = {"PNG (color)", "PGM 16 bit (MIP values)", "Raw float (MIP values)"};
+static char  s_exportPrefix[64] = "frame"; // file name prefix, files are written to the working directory
+static bool  s_recording = false;      // capture every rendered frame
+static float s_recordFrameRate = 30.0f; // turntable recording: rotation per recorded frame in seconds of auto-rotation
+static bool  s_streaming = false;      // serve frames to a stream_client
+static int 	 s_streamPort = 4000;
+static bool  s_streamUnix = false;     // listen on a Unix domain socket instead of TCP
+static char  s_streamUnixPath[128] = "/tmp/interactive_MIP.sock";
+static bool  s_streamRemote = false;   // accept TCP clients on all interfaces, not only loopback; there is no authentication
+static char  s_timelinePath[128] = "session.vrtl"; // recorded session: camera path and parameters per frame
+static char  s_dicomDirectory[256] = ""; // DICOM series to load instead of the CT data set
+static bool  s_recordTimeline = false; // record from the first frame on, saved at exit
+static bool  s_replayTimeline = false; // replay from the first frame on
+static bool  s_headless = false;       // invisible window, quit once the replay ended
+static char  s_reportPrefix[128] = "replay"; // timings of a replay: <prefix>.csv per frame, <prefix>.json statistics
+static float s_cpuResolutionScale = 0.5f; // resolution of CPU rendered image relative to window resolution
+static bool  s_shearWarpBilinear = true;  // shear-warp slice resampling: bilinear or nearest
+
+static bool  s_showSliceView = true;  // show multi-planar reconstruction window
+static int 	 s_sliceOrientation = 0;
+static const char* s_sliceOrientationLabels[] = {"Axial", "Coronal", "Sagittal", "Oblique"};
+static float s_slicePosition = 0.5f;  // relative position of axis aligned slices
+static float s_sliceYaw   = 0.0f;     // oblique slice normal, degrees
+static float s_slicePitch = 45.0f;    // oblique slice normal, degrees
+static bool  s_sliceFollowView = false; // oblique slice perpendicular to the viewing direction
+static float s_slabThickness = 1.0f;  // slab thickness in voxels
+static int 	 s_slabMode = 0;
+static const char* s_slabModeLabels[] = {"MIP", "MinIP", "Average"};
+static bool  s_incrementalSlab = true; // axis aligned slab MIP: update incrementally while scrolling
+static int 	 s_slabEngine = 0;
+static const char* s_slabEngineLabels[] = {"CPU", "GPU (compute shader)"};
+
 
 
 //////////////////////////////////////////////////////////////////////////////
@@ -102,13 +228,34 @@ void activateVolume(VolumeData<T>& volumeData ) // set static variables
 	s_windowingRange = s_windowingMaxValue - s_windowingMinValue;
 	s_minValThreshold = volumeData.min;
 	s_maxValThreshold = volumeData.max;
+	s_isoValue = volumeData.min + 0.4f * (volumeData.max - volumeData.min);
+}
 
-
+void parseArguments(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = (i + 1 < argc);
+		if      (arg == "--dicom"       && hasValue) { std::snprintf(s_dicomDirectory, sizeof(s_dicomDirectory), "%s", argv[++i]); }
+		else if (arg == "--stream"      && hasValue) { s_streaming = true; s_streamPort = std::atoi(argv[++i]); }
+		else if (arg == "--stream-unix" && hasValue) { s_streaming = true; s_streamUnix = true; std::snprintf(s_streamUnixPath, sizeof(s_streamUnixPath), "%s", argv[++i]); }
+		else if (arg == "--stream-remote")           { s_streamRemote = true; }
+		else if (arg == "--record" && hasValue)      { s_recordTimeline = true; std::snprintf(s_timelinePath, sizeof(s_timelinePath), "%s", argv[++i]); }
+		else if (arg == "--replay" && hasValue)      { s_replayTimeline = true; std::snprintf(s_timelinePath, sizeof(s_timelinePath), "%s", argv[++i]); }
+		else if (arg == "--headless")                { s_headless = true; }
+		else if (arg == "--report" && hasValue)      { std::snprintf(s_reportPrefix, sizeof(s_reportPrefix), "%s", argv[++i]); }
+		else
+		{
+			DEBUGLOG->log("unknown argument: " + arg);
+		}
+	}
 }
 
-int main()
+int main(int argc, char** argv)
 {
 	DEBUGLOG->setAutoPrint(true);
+	parseArguments(argc, argv);
 
 	//////////////////////////////////////////////////////////////////////////////
 	/////////////////////// VOLUME DATA LOADING //////////////////////////////////
@@ -119,15 +266,36 @@ int main()
 
 	// load data set: CT of a Head
 	VolumeData<short> volumeDataCTHead = Importer::load3DData<short>(file, 256, 256, 113, 2);
+	glm::vec3 volumeProxySize(1.0f, 1.0f, 1.26315f); // sizes of the Volume renderable, the raw CT head carries no spacing
+	if ( s_dicomDirectory[0] != '\0' )
+	{
+		// alternatively a DICOM series, e.g. exported from a PACS
+		VolumeData<short> volumeDataDicom = Importer::loadDicomSeries(std::string(s_dicomDirectory));
+		if ( volumeDataDicom.size_z > 0 )
+		{
+			volumeDataCTHead = std::move(volumeDataDicom);
+
+			// physical extent, normalized to a width of 1 like the CT head proxy
+			glm::vec3 extent(
+				volumeDataCTHead.size_x * volumeDataCTHead.real_size_x,
+				volumeDataCTHead.size_y * volumeDataCTHead.real_size_y,
+				volumeDataCTHead.size_z * volumeDataCTHead.real_size_z);
+			volumeProxySize = extent / extent.x;
+			DEBUGLOG->log("volume proxy size: ", volumeProxySize);
+		}
+	}
 	// alternative data set: MRT of a brain; comment this line in and the above out to use 
 	VolumeData<short> volumeDataMRTBrain = Importer::loadBruder();
 
 	activateVolume<short>(volumeDataCTHead);
 
+	s_fusionWindowCT  = glm::vec2(volumeDataCTHead.min,   volumeDataCTHead.max);
+	s_fusionWindowMRT = glm::vec2(volumeDataMRTBrain.min, volumeDataMRTBrain.max);
+
 	DEBUGLOG->log("Initial ray sampling step size: ", s_rayStepSize);
 
 	// create window and opengl context
-	auto window = generateWindow(800,800);
+	auto window = generateWindow(800,800, 100, 100, !s_headless);
 
 	// load into 3d texture
 	DEBUGLOG->log("Loading Volume Data to 3D-Texture.");
@@ -137,6 +305,58 @@ int main()
 
 	GLuint volumeTexture = volumeTextureCT; // startup volume data
 
+	// precomputed gradients of the static volumes, built the first time shading needs them; the streamed 4D series is derived on the fly
+	GradientVolume gradientsCT, gradientsMRT;
+	GLuint gradientTextureCT = 0;
+	GLuint gradientTextureMRT = 0;
+	int gradientTexturesOperator = -1; // s_gradientOperator the textures were computed with, -1 if not yet
+	auto updateGradients = [&]()
+	{
+		gradientTexturesOperator = s_gradientOperator;
+		if (gradientTextureCT != 0)  { glDeleteTextures(1, &gradientTextureCT); }
+		if (gradientTextureMRT != 0) { glDeleteTextures(1, &gradientTextureMRT); }
+		Gradients::compute(volumeDataCTHead,   (Gradients::Operator) s_gradientOperator, gradientsCT);
+		Gradients::compute(volumeDataMRTBrain, (Gradients::Operator) s_gradientOperator, gradientsMRT);
+		gradientTextureCT  = loadGradientsTo3DTexture(gradientsCT.data,  gradientsCT.size_x,  gradientsCT.size_y,  gradientsCT.size_z);
+		gradientTextureMRT = loadGradientsTo3DTexture(gradientsMRT.data, gradientsMRT.size_x, gradientsMRT.size_y, gradientsMRT.size_z);
+	};
+
+	// value ranges of the bricks of the static volumes, packed into RG16I textures (min, max), built the first time brick skipping needs them
+	MinMaxBricks bricksCT, bricksMRT;
+	GLuint brickTextureCT = 0;
+	GLuint brickTextureMRT = 0;
+	int brickTexturesSize = 0; // s_brickSize the textures were computed with, 0 if not yet
+	auto updateBricks = [&]()
+	{
+		brickTexturesSize = s_brickSize;
+		if (brickTextureCT != 0)  { glDeleteTextures(1, &brickTextureCT); }
+		if (brickTextureMRT != 0) { glDeleteTextures(1, &brickTextureMRT); }
+		Bricks::computeMinMax(volumeDataCTHead,   s_brickSize, bricksCT);
+		Bricks::computeMinMax(volumeDataMRTBrain, s_brickSize, bricksMRT);
+		brickTextureCT  = loadTo3DTexturePacked<short>(bricksCT.min,  bricksCT.max);
+		brickTextureMRT = loadTo3DTexturePacked<short>(bricksMRT.min, bricksMRT.max);
+	};
+
+	// (re)build the textures if the current parameters need them; called once per frame and before measurements
+	auto updateLazyTextures = [&](bool gradients, bool bricks)
+	{
+		if (gradients && s_gradientOperator != gradientTexturesOperator) { updateGradients(); }
+		if (bricks && s_brickSize != brickTexturesSize) { updateBricks(); }
+	};
+
+	// 4D data set: periodic phantom, time points are decoded and uploaded on demand
+	PhantomGenerator::PhantomParameters timeSeriesParams(PhantomGenerator::VESSEL_TREE, 192, 1);
+	timeSeriesParams.size_z = 242; // aspect ratio of the volume proxy
+	VolumeTimeSeries timeSeries = TimeSeries::fromPhantom(timeSeriesParams, 32);
+	VolumeStreamer volumeStreamer(timeSeries, 4, 2);
+	s_timeSeriesSpeed = timeSeries.timePointsPerSecond;
+
+	// CPU engines and the slice view use the first time point
+	VolumeData<short> volumeDataTimeSeries;
+	timeSeries.decodeTimePoint(0, volumeDataTimeSeries);
+	volumeDataTimeSeries.min = timeSeries.min;
+	volumeDataTimeSeries.max = timeSeries.max;
+
 	DEBUGLOG->log("OpenGL error state after 3D-Texture creation: ");
 	DEBUGLOG->indent(); checkGLError(true); DEBUGLOG->outdent();
 
@@ -157,7 +377,7 @@ int main()
 	// glm::mat4 perspective = glm::perspective(glm::radians(45.f), getRatio(window), 1.0f, 10.f);
 
 	// create Volume
-	Volume volume(1.0f, 1.0f, 1.26315f);
+	Volume volume(volumeProxySize.x, volumeProxySize.y, volumeProxySize.z);
 
 	///////////////////////     UVW Map Renderpass     ///////////////////////////
 	DEBUGLOG->log("Shader Compilation: volume uvw coords"); DEBUGLOG->indent();
@@ -196,16 +416,461 @@ int main()
 	glActiveTexture(GL_TEXTURE0);
 	
 	shaderProgram.update("volume_texture", 0); // volume texture
+	shaderProgram.update("volume_texture_next", 4); // next time point of a 4D series
+	shaderProgram.update("gradient_texture", 8); // precomputed gradients of the active volume
+	shaderProgram.update("brick_texture", 9);    // value ranges of the bricks of the active volume
 	shaderProgram.update("back_uvw_map",  1);
 	shaderProgram.update("front_uvw_map", 2);
 
+	// the traversal result (max value, front depth, back depth, relative distance) is colored in a separate pass
+	DEBUGLOG->log("FrameBufferObject Creation: ray traversal result"); DEBUGLOG->indent();
+	std::vector<FrameBufferObject::AttachmentFormat> traversalFormats;
+	FrameBufferObject::AttachmentFormat unquantized = { GL_RGBA32F, GL_RGBA, GL_FLOAT }; // values, depths and sums
+	FrameBufferObject::AttachmentFormat shading     = { GL_RG16F,   GL_RG,   GL_FLOAT }; // diffuse term, gradient magnitude
+	FrameBufferObject::AttachmentFormat pick        = { GL_RGBA16F, GL_RGBA, GL_FLOAT }; // uvw and value, read for a single pixel only
+	traversalFormats.push_back(unquantized); // MIP result
+	traversalFormats.push_back(unquantized); // other projections (min, sum, count)
+	traversalFormats.push_back(shading);
+	traversalFormats.push_back(pick);
+	FrameBufferObject traversalFBO(getResolution(window).x, getResolution(window).y);
+	traversalFBO.addColorAttachments(traversalFormats);
+	DEBUGLOG->outdent();
+
 	// ray casting render pass
-	RenderPass renderPass(&shaderProgram);
+	RenderPass renderPass(&shaderProgram, &traversalFBO);
+	renderPass.setClearColor(MIPImage::BACKGROUND, 0.0f, 0.0f, 0.0f); // marks pixels not covered by the volume
 	renderPass.addClearBit(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 	renderPass.addRenderable(&volume);
 	renderPass.addEnable(GL_DEPTH_TEST);
 	renderPass.addDisable(GL_BLEND);
 
+	// the rendered volume is cached and only rendered again if a parameter changed
+	DEBUGLOG->log("FrameBufferObject Creation: scene"); DEBUGLOG->indent();
+	FrameBufferObject sceneFBO(getResolution(window).x, getResolution(window).y);
+	sceneFBO.addColorAttachments(1); DEBUGLOG->outdent();
+
+	///////////////////////   Recolor Renderpass     ///////////////////////////////
+	DEBUGLOG->log("Shader Compilation: MIP recolor shader"); DEBUGLOG->indent();
+	ShaderProgram recolorShader("/screenSpace/fullscreen.vert", "/screenSpace/mipRecolor.frag"); DEBUGLOG->outdent();
+	recolorShader.addTexture("traversal_map", traversalFBO.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT0));
+	recolorShader.addTexture("projection_map", traversalFBO.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT1));
+	recolorShader.addTexture("shading_map", traversalFBO.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT2));
+
+	// color mapping only: windowing and depth effects are applied without traversing the volume again
+	Quad quad;
+	RenderPass recolorPass(&recolorShader, &sceneFBO);
+	recolorPass.addClearBit(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+	recolorPass.addDisable(GL_DEPTH_TEST);
+	recolorPass.addDisable(GL_BLEND);
+	recolorPass.addRenderable(&quad);
+
+	///////////////////////   Fusion Renderpass     ///////////////////////////////
+	DEBUGLOG->log("Shader Compilation: fused ray casting shader"); DEBUGLOG->indent();
+	ShaderProgram fusionShaderProgram("/modelSpace/volumeMVP.vert", "/modelSpace/volumeFusion.frag"); DEBUGLOG->outdent();
+	fusionShaderProgram.update("model", model);
+	fusionShaderProgram.update("view", view);
+	fusionShaderProgram.update("projection", perspective);
+
+	// fusion uses its own texture units: CT, MRT, packed CT + MRT
+	glActiveTexture(GL_TEXTURE5);
+	glBindTexture(GL_TEXTURE_3D, volumeTextureCT);
+	glActiveTexture(GL_TEXTURE6);
+	glBindTexture(GL_TEXTURE_3D, volumeTextureMRT);
+	glActiveTexture(GL_TEXTURE0);
+
+	fusionShaderProgram.update("back_uvw_map",  1);
+	fusionShaderProgram.update("front_uvw_map", 2);
+	fusionShaderProgram.update("volume_a", 5);
+	fusionShaderProgram.update("volume_b", 6);
+	fusionShaderProgram.update("packed_volumes", 7);
+	fusionShaderProgram.update("uRegistrationA", glm::mat4(1.0f)); // CT defines the fused space
+
+	GLuint packedVolumeTexture = 0;
+	glm::mat4 packedRegistration(0.0f); // registration the packed MRT was resampled with
+	VolumeData<short> resampledMRT;
+
+	RenderPass fusionRenderPass(&fusionShaderProgram, &sceneFBO);
+	fusionRenderPass.addClearBit(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+	fusionRenderPass.addRenderable(&volume);
+	fusionRenderPass.addEnable(GL_DEPTH_TEST);
+	fusionRenderPass.addDisable(GL_BLEND);
+
+	///////////////////////   CPU Rendering Engines     //////////////////////////
+	VolumeData<short>* activeVolumeData = &volumeDataCTHead;
+
+	CPURaycaster cpuRaycaster;
+	ShearWarp shearWarp;
+	MIPImage cpuImage;
+	cpuImage.width = 0;
+	cpuImage.height = 0;
+	MIPImage cpuMinImage;     // CPU ray casting: further projections of the same traversal
+	MIPImage cpuAverageImage;
+	MIPImage cpuMaxDepthImage;
+	cpuMinImage.width = cpuAverageImage.width = cpuMaxDepthImage.width = 0;
+	cpuMinImage.height = cpuAverageImage.height = cpuMaxDepthImage.height = 0;
+
+	///////////////////////   Picking     //////////////////////////
+	VoxelPicker voxelPicker;   // reads back the pick attachment of the traversal
+	VoxelPick lastPick;
+	glm::ivec2 pickPixel(0);   // framebuffer coordinates, origin in the lower left corner
+	bool pickRequested = false;
+	int pickFrame = 0;         // frame of the last pick request
+	int pickLatency = 0;       // frames until the result of the last pick was available
+	bool pickFromGPU = false;  // source of lastPick
+
+	///////////////////////   Frame Export     //////////////////////////
+	FrameExporter frameExporter;
+	bool screenshotRequested = false;
+	int turntableFramesLeft = 0;      // frames of the turntable recording still to be captured
+	bool lastCaptureRefused = false;  // turntable recording: hold the animation until the frame was captured
+
+	///////////////////////   Frame Streaming     //////////////////////////
+	FrameStreamServer streamServer;
+	streamServer.setOnReceive( []() { invalidateFrame(); } ); // client messages arrive on the network thread
+	int streamedSceneRender = -1;     // last scene render which was streamed
+	int streamStateConnections = 0;   // connections the state was sent to
+	FrameStream::StateMessage lastStreamState = FrameStream::StateMessage();
+	auto updateStreamServer = [&]()
+	{
+		streamServer.close();
+		if (s_streaming)
+		{
+			s_streaming = s_streamUnix ? streamServer.listenUnix(s_streamUnixPath) : streamServer.listen(s_streamPort, s_streamRemote);
+		}
+	};
+	updateStreamServer();
+
+	///////////////////////   Timeline     //////////////////////////
+	Timeline timeline;       // recorded session, see trackTimeline
+	FrameTimer replayTimer;  // per frame timings of the replay
+	ShaderProgram::s_timeline = &timeline; // every uniform update of a frame is recorded or replayed
+	std::string replaySummary;
+	auto finishReplay = [&]()
+	{
+		replayTimer.finish();
+		Benchmark report;
+		report.addConfig("timeline", std::string(s_timelinePath));
+		report.addConfig("frames", (double) replayTimer.getFrames().size());
+		report.addConfig("gl_renderer", std::string( (const char*) glGetString(GL_RENDERER) ));
+		replayTimer.addResults(report, "frame");
+		report.print();
+		replayTimer.writeCSV(std::string(s_reportPrefix) + ".csv");
+		report.writeJSON(std::string(s_reportPrefix) + ".json");
+
+		const std::vector<BenchmarkResult>& results = report.getResults();
+		char summary[128];
+		std::snprintf(summary, sizeof(summary), "median cpu %.2f ms, gpu %.2f ms; p95 cpu %.2f ms, gpu %.2f ms",
+			results[0].medianMilliseconds, results[1].medianMilliseconds, results[0].p95Milliseconds, results[1].p95Milliseconds);
+		replaySummary = summary;
+	};
+
+	GLuint cpuImageTexture;
+	glGenTextures(1, &cpuImageTexture);
+	glBindTexture(GL_TEXTURE_2D, cpuImageTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	DEBUGLOG->log("Shader Compilation: windowing shader"); DEBUGLOG->indent();
+	ShaderProgram windowingShader("/screenSpace/fullscreen.vert", "/screenSpace/windowing.frag"); DEBUGLOG->outdent();
+	windowingShader.addTexture("tex", cpuImageTexture);
+
+	RenderPass cpuRenderPass(&windowingShader, &sceneFBO);
+	cpuRenderPass.addClearBit(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+	cpuRenderPass.addDisable(GL_DEPTH_TEST);
+	cpuRenderPass.addDisable(GL_BLEND);
+	cpuRenderPass.addRenderable(&quad);
+
+	/////////////////////// Multi-Planar Reconstruction ////////////////////////
+	MPR mpr;
+	MIPImage sliceImage;
+	sliceImage.width = 0;
+	sliceImage.height = 0;
+	std::vector<unsigned char> sliceRGBA;
+
+	GLuint sliceTexture;
+	glGenTextures(1, &sliceTexture);
+	glBindTexture(GL_TEXTURE_2D, sliceTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	/////////////////////// Incremental Slab MIP //////////////////////////////
+	SlabMIP slabMIP;
+	GLuint sliceDisplayTexture = sliceTexture; // texture shown in the slice view
+
+	DEBUGLOG->log("Shader Compilation: slab MIP compute shader"); DEBUGLOG->indent();
+	ShaderProgram slabMIPShader("/compute/slabMIP.comp"); DEBUGLOG->outdent();
+
+	GLuint slabMIPBuffers[2]; // deque entries, deque states
+	glGenBuffers(2, slabMIPBuffers);
+	GLuint slabMIPTextures[2]; // slab maximum (R32F), windowed (RGBA8)
+	glGenTextures(2, slabMIPTextures);
+
+	// state of the deques on the GPU
+	int slabGPUOrientation = -1;
+	int slabGPUThickness = 0;
+	int slabGPUFirstSlice = 0;
+	int slabGPUDirection = 1;
+	glm::ivec2 slabGPUImageSize(0);
+	GLuint slabGPUVolumeTexture = 0;
+
+	// moves the slab on the GPU; rebuilds if the deques can't be reused
+	auto updateSlabMIPGPU = [&](int orientation, int firstSlice, int thickness, glm::ivec2 imageSize, GLuint volumeTex)
+	{
+		bool sizeChanged = (imageSize != slabGPUImageSize || thickness != slabGPUThickness);
+		if (sizeChanged)
+		{
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, slabMIPBuffers[0]);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, (size_t) imageSize.x * imageSize.y * thickness * sizeof(glm::ivec2), NULL, GL_DYNAMIC_COPY);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, slabMIPBuffers[1]);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, (size_t) imageSize.x * imageSize.y * sizeof(glm::ivec2), NULL, GL_DYNAMIC_COPY);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+			GLenum internalFormats[2] = {GL_R32F, GL_RGBA8};
+			GLenum formats[2] = {GL_RED, GL_RGBA};
+			for (int i = 0; i < 2; i++)
+			{
+				glBindTexture(GL_TEXTURE_2D, slabMIPTextures[i]);
+				glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[i], imageSize.x, imageSize.y, 0, formats[i], GL_UNSIGNED_BYTE, NULL);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			}
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, slabMIPBuffers[0]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, slabMIPBuffers[1]);
+		glBindImageTexture(0, slabMIPTextures[0], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glBindImageTexture(1, slabMIPTextures[1], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_3D, volumeTex);
+		glActiveTexture(GL_TEXTURE0);
+
+		slabMIPShader.update("volume_texture", 3);
+		slabMIPShader.update("uOrientation", orientation);
+		slabMIPShader.update("uImageSize", imageSize);
+		slabMIPShader.update("uThickness", thickness);
+		slabMIPShader.update("uWindowingMinVal", s_windowingMinValue);
+		slabMIPShader.update("uWindowingRange", s_windowingMaxValue - s_windowingMinValue);
+
+		GLuint numGroupsX = (imageSize.x + 7) / 8;
+		GLuint numGroupsY = (imageSize.y + 7) / 8;
+
+		int delta = firstSlice - slabGPUFirstSlice;
+		int direction = (delta >= 0) ? 1 : -1;
+		bool rebuild = sizeChanged || orientation != slabGPUOrientation || volumeTex != slabGPUVolumeTexture
+			|| std::abs(delta) >= thickness || (delta != 0 && direction != slabGPUDirection);
+
+		if (rebuild)
+		{
+			slabMIPShader.update("uRebuild", 1);
+			slabMIPShader.update("uDirection", direction);
+			slabMIPShader.update("uFirstSlice", firstSlice);
+			slabMIPShader.dispatch(numGroupsX, numGroupsY);
+			slabGPUDirection = direction;
+		}
+		else
+		{
+			slabMIPShader.update("uRebuild", 0);
+			slabMIPShader.update("uIncomingSlice", -1); // only refresh the windowed image if the slab did not move
+			for (int i = 0; i < std::max(1, std::abs(delta)); i++)
+			{
+				if (delta != 0)
+				{
+					int first = slabGPUFirstSlice + (i + 1) * direction;
+					slabMIPShader.update("uFirstSlice", first);
+					slabMIPShader.update("uIncomingSlice", (direction > 0) ? first + thickness - 1 : first);
+				}
+				slabMIPShader.dispatch(numGroupsX, numGroupsY);
+				glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+			}
+		}
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+		slabGPUOrientation = orientation;
+		slabGPUThickness = thickness;
+		slabGPUFirstSlice = firstSlice;
+		slabGPUImageSize = imageSize;
+		slabGPUVolumeTexture = volumeTex;
+	};
+
+	// extracts the configured slice and uploads it as windowed grayscale texture
+	auto updateSliceView = [&](const glm::mat4& modelViewProjection)
+	{
+		// axis aligned slab MIP: move the slab incrementally
+		if (s_incrementalSlab && s_sliceOrientation != MPR::OBLIQUE && s_slabMode == MPR::SLAB_MIP)
+		{
+			int numSlices[3] = { (int) activeVolumeData->size_z, (int) activeVolumeData->size_y, (int) activeVolumeData->size_x }; // axial, coronal, sagittal
+			int thickness = std::max( 1, std::min( (int) (s_slabThickness + 0.5f), numSlices[s_sliceOrientation] ) );
+			int firstSlice = (int) (s_slicePosition * (float) (numSlices[s_sliceOrientation] - 1) + 0.5f) - thickness / 2;
+			firstSlice = std::max( 0, std::min(firstSlice, numSlices[s_sliceOrientation] - thickness) );
+
+			if (s_slabEngine == 0)
+			{
+				slabMIP.render(*activeVolumeData, (MPR::Orientation) s_sliceOrientation, firstSlice, thickness, sliceImage);
+				CPURendering::windowToRGBA8(sliceImage, s_windowingMinValue, s_windowingMaxValue, sliceRGBA);
+
+				glBindTexture(GL_TEXTURE_2D, sliceTexture);
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, sliceImage.width, sliceImage.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &sliceRGBA[0]);
+				glBindTexture(GL_TEXTURE_2D, 0);
+				sliceDisplayTexture = sliceTexture;
+			}
+			else
+			{
+				SlicePlane plane = MPR::createPlane(*activeVolumeData, (MPR::Orientation) s_sliceOrientation, 0.0f);
+				sliceImage.width = plane.width; // only used for the displayed aspect ratio
+				sliceImage.height = plane.height;
+				updateSlabMIPGPU(s_sliceOrientation, firstSlice, thickness, glm::ivec2(plane.width, plane.height), volumeTexture);
+				sliceDisplayTexture = slabMIPTextures[1];
+			}
+			return;
+		}
+
+		SlicePlane plane;
+		if (s_sliceOrientation == MPR::OBLIQUE)
+		{
+			glm::vec3 normal;
+			if (s_sliceFollowView)
+			{
+				glm::ivec3 volumeSize(activeVolumeData->size_x, activeVolumeData->size_y, activeVolumeData->size_z);
+				glm::mat4 voxelToPixel = CPURendering::computeVoxelToPixel(volumeSize, volumeProxySize, modelViewProjection, 1, 1);
+				normal = glm::transpose( glm::mat3(voxelToPixel) ) * glm::vec3(0.0f, 0.0f, 1.0f); // gradient of the depth: normal of the screen plane in voxel coordinates
+			}
+			else
+			{
+				float yaw = glm::radians(s_sliceYaw);
+				float pitch = glm::radians(s_slicePitch);
+				normal = glm::vec3( std::cos(pitch) * std::cos(yaw), std::cos(pitch) * std::sin(yaw), std::sin(pitch) );
+			}
+			glm::vec3 center = glm::vec3(activeVolumeData->size_x - 1, activeVolumeData->size_y - 1, activeVolumeData->size_z - 1) * 0.5f;
+			int resolution = (int) std::max(activeVolumeData->size_x, std::max(activeVolumeData->size_y, activeVolumeData->size_z));
+			plane = MPR::createObliquePlane(*activeVolumeData, center, normal, resolution);
+		}
+		else
+		{
+			plane = MPR::createPlane(*activeVolumeData, (MPR::Orientation) s_sliceOrientation, s_slicePosition);
+		}
+
+		mpr.setSlabThickness(s_slabThickness);
+		mpr.setSlabMode( (MPR::SlabMode) s_slabMode );
+		mpr.extract(*activeVolumeData, plane, sliceImage);
+		CPURendering::windowToRGBA8(sliceImage, s_windowingMinValue, s_windowingMaxValue, sliceRGBA);
+
+		glBindTexture(GL_TEXTURE_2D, sliceTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, sliceImage.width, sliceImage.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &sliceRGBA[0]);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		sliceDisplayTexture = sliceTexture;
+	};
+
+	// MIP only, unless another projection is displayed or all are requested
+	auto isAccumulatingProjections = [&]()
+	{
+		return s_multiProjection || s_projection != 0;
+	};
+
+	// gradients of the active volume, 0 if there are none (yet)
+	auto getGradients = [&]() -> const GradientVolume*
+	{
+		if (gradientTexturesOperator < 0) { return 0; }
+		if (s_activeModel == 0) { return &gradientsMRT; }
+		if (s_activeModel == 1) { return &gradientsCT; }
+		return 0;
+	};
+	auto getGradientTexture = [&]()
+	{
+		if (s_activeModel == 0) { return gradientTextureMRT; }
+		if (s_activeModel == 1) { return gradientTextureCT; }
+		return (GLuint) 0;
+	};
+
+	// brick value ranges of the active volume, 0 if there are none (yet)
+	auto getBricks = [&]() -> const MinMaxBricks*
+	{
+		if (brickTexturesSize == 0) { return 0; }
+		if (s_activeModel == 0) { return &bricksMRT; }
+		if (s_activeModel == 1) { return &bricksCT; }
+		return 0;
+	};
+	auto getBrickTexture = [&]()
+	{
+		if (s_activeModel == 0) { return brickTextureMRT; }
+		if (s_activeModel == 1) { return brickTextureCT; }
+		return (GLuint) 0;
+	};
+	auto getBrickSize = [&]()
+	{
+		return (s_brickSkipping && getBrickTexture() != 0) ? s_brickSize : 0;
+	};
+
+	// precomputed gradients fall back to central differences if the volume has none
+	auto getShadingMode = [&]()
+	{
+		return (s_shading == 2 && getGradientTexture() == 0) ? 1 : s_shading;
+	};
+
+	// uploads the displayed projection of the last CPU frame to the texture; shear-warp only provides the MIP
+	auto uploadCPUImage = [&]()
+	{
+		const MIPImage* image = &cpuImage;
+		if (s_renderEngine == 1 && cpuMinImage.width == cpuImage.width && cpuMinImage.height == cpuImage.height)
+		{
+			if (s_projection == 1) { image = &cpuMinImage; }
+			if (s_projection == 2) { image = &cpuAverageImage; }
+		}
+
+		glBindTexture(GL_TEXTURE_2D, cpuImageTexture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, image->width, image->height, 0, GL_RED, GL_FLOAT, &image->value[0]);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	};
+
+	// renders a frame with the CPU engine and uploads it to the texture
+	auto renderCPU = [&](int engine, const glm::mat4& modelViewProjection)
+	{
+		glm::vec2 resolution = getResolution(window);
+		int width  = std::max(1, (int) (resolution.x * s_cpuResolutionScale));
+		int height = std::max(1, (int) (resolution.y * s_cpuResolutionScale));
+		if (cpuImage.width != width || cpuImage.height != height)
+		{
+			cpuImage.resize(width, height);
+		}
+
+		glm::ivec3 volumeSize(activeVolumeData->size_x, activeVolumeData->size_y, activeVolumeData->size_z);
+		glm::mat4 voxelToPixel = CPURendering::computeVoxelToPixel(volumeSize, volumeProxySize, modelViewProjection, width, height);
+
+		if (engine == 1)
+		{
+			cpuRaycaster.setStepSize( s_rayStepSize * (float) activeVolumeData->size_x ); // uvw step size to voxels
+			if ( s_renderMode == 1 )
+			{
+				cpuRaycaster.setIsoRefinementSteps(s_isoRefinementSteps);
+				cpuRaycaster.renderIsosurface(*activeVolumeData, voxelToPixel, s_isoValue, s_brickSkipping ? getBricks() : 0, cpuImage);
+				cpuMinImage.width = 0; // stale
+			}
+			else if ( isAccumulatingProjections() )
+			{
+				cpuRaycaster.render(*activeVolumeData, voxelToPixel, cpuImage, cpuMinImage, cpuAverageImage, cpuMaxDepthImage);
+			}
+			else
+			{
+				cpuRaycaster.render(*activeVolumeData, voxelToPixel, cpuImage);
+				cpuMinImage.width = 0; // stale
+			}
+		}
+		else
+		{
+			shearWarp.setInterpolation( s_shearWarpBilinear ? ShearWarp::BILINEAR : ShearWarp::NEAREST );
+			shearWarp.render(*activeVolumeData, voxelToPixel, cpuImage);
+		}
+
+		uploadCPUImage();
+	};
+
 	//////////////////////////////////////////////////////////////////////////////
 	///////////////////////    GUI / USER INPUT   ////////////////////////////////
 	//////////////////////////////////////////////////////////////////////////////
@@ -247,6 +912,17 @@ int main()
 		{
 			turntable.setDragActive(false);
 		}
+		if (b == GLFW_MOUSE_BUTTON_RIGHT && a == GLFW_PRESS && !ImGui::GetIO().WantCaptureMouse)
+		{
+			// window coordinates to framebuffer pixels; picked after the next traversal
+			int windowWidth, windowHeight;
+			glfwGetWindowSize(window, &windowWidth, &windowHeight);
+			glm::vec2 resolution = getResolution(window);
+			pickPixel.x = (int) (old_x * resolution.x / windowWidth);
+			pickPixel.y = (int) resolution.y - 1 - (int) (old_y * resolution.y / windowHeight);
+			pickPixel = glm::clamp( pickPixel, glm::ivec2(0), glm::ivec2(resolution) - 1 );
+			pickRequested = true;
+		}
 
 		ImGui_ImplGlfwGL3_MouseButtonCallback(window, b, a, m);
 	};
@@ -287,10 +963,222 @@ int main()
 	//////////////////////////////// RENDER LOOP /////////////////////////////////
 	//////////////////////////////////////////////////////////////////////////////
 
+	// snapshots of all parameters affecting the rendered volume and the slice view: only re-rendered if changed
+	auto pushState = [](std::vector<float>& state, const float* values, int count) { state.insert(state.end(), values, values + count); };
+	auto captureTraversalState = [&](GLuint nextVolumeTexture, float timeMix)
+	{
+		std::vector<float> state;
+		glm::mat4 modelMatrix = turntable.getRotationMatrix() * model;
+		pushState(state, glm::value_ptr(view), 16);
+		pushState(state, glm::value_ptr(modelMatrix), 16);
+		pushState(state, glm::value_ptr(s_fusionTranslation), 3);
+		pushState(state, glm::value_ptr(s_fusionRotation), 3);
+		pushState(state, glm::value_ptr(s_fusionWindowCT), 2);
+		pushState(state, glm::value_ptr(s_fusionWindowMRT), 2);
+		pushState(state, glm::value_ptr(s_fusionColorCT), 4);
+		pushState(state, glm::value_ptr(s_fusionColorMRT), 4);
+		float values[] = {
+			(float) s_renderEngine, s_cpuResolutionScale, (float) s_shearWarpBilinear, (float) s_activeModel,
+			(float) volumeTexture, (float) nextVolumeTexture, timeMix,
+			s_rayParamStart, s_rayParamEnd, s_rayStepSize, (float) isAccumulatingProjections(),
+			s_LMIP_threshold, (float) s_LMIP_minStepsToLocalMaximum,
+			(float) s_minValThreshold, (float) s_maxValThreshold,
+			(float) s_fusionEnabled, (float) s_fusionPacked, (float) packedVolumeTexture, s_fusionScale, s_fusionWeightCT, s_fusionWeightMRT,
+			(float) getShadingMode(), (float) getGradientTexture(),
+			(float) s_renderMode, s_isoValue, (float) s_isoRefinementSteps, (float) getBrickSize(), (float) getBrickTexture() };
+		pushState(state, values, sizeof(values) / sizeof(float));
+		return state;
+	};
+	auto captureColorState = [&]()
+	{
+		std::vector<float> state;
+		pushState(state, glm::value_ptr(s_maxDistColor), 4);
+		pushState(state, glm::value_ptr(s_minDistColor), 4);
+		float values[] = {
+			s_windowingMinValue, s_windowingMaxValue, (float) s_projection,
+			(float) s_mixMode, s_colorEffectInfluence, s_contrastEffectInfluence,
+			s_minDepthRange, s_maxDepthRange, (float) getShadingMode(), s_shadingInfluence };
+		pushState(state, glm::value_ptr(s_isoColor), 4);
+		pushState(state, values, sizeof(values) / sizeof(float));
+		return state;
+	};
+	auto captureSliceState = [&](const glm::mat4& modelViewProjection)
+	{
+		std::vector<float> state;
+		if (s_sliceFollowView)
+		{
+			pushState(state, glm::value_ptr(modelViewProjection), 16);
+		}
+		float values[] = {
+			(float) s_sliceOrientation, s_slicePosition, s_sliceYaw, s_slicePitch, (float) s_sliceFollowView,
+			s_slabThickness, (float) s_slabMode, (float) s_incrementalSlab, (float) s_slabEngine,
+			s_windowingMinValue, s_windowingMaxValue, (float) s_activeModel, (float) volumeTexture };
+		pushState(state, values, sizeof(values) / sizeof(float));
+		return state;
+	};
+	std::vector<float> lastTraversalState;
+	std::vector<float> lastColorState;
+	std::vector<float> lastSliceState;
+	int numFrames = 0;
+	int numTraversals = 0;
+	int numSceneRenders = 0;
+
+	// GPU time of a ray traversal with the current uniforms, averaged over a few traversals; stalls until the result is available
+	auto measureTraversal = [&]()
+	{
+		const int numTraversals = 10;
+		GLuint query;
+		glGenQueries(1, &query);
+		glActiveTexture(GL_TEXTURE8);
+		glBindTexture(GL_TEXTURE_3D, getGradientTexture());
+		glActiveTexture(GL_TEXTURE9);
+		glBindTexture(GL_TEXTURE_3D, getBrickTexture());
+		glActiveTexture(GL_TEXTURE0);
+
+		glBeginQuery(GL_TIME_ELAPSED, query);
+		for (int i = 0; i < numTraversals; i++)
+		{
+			renderPass.render();
+		}
+		glEndQuery(GL_TIME_ELAPSED);
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+		glDeleteQueries(1, &query);
+
+		lastTraversalState.clear(); // traversal result was overwritten
+		return (double) nanoseconds / 1.0e6 / numTraversals;
+	};
+
+	auto activateModel = [&]()
+	{
+    	if (s_lastTimeModel != s_activeModel)
+    	{
+    		if ( s_activeModel == 0) //MRT
+    		{
+				activateVolume(volumeDataMRTBrain);
+				activeVolumeData = &volumeDataMRTBrain;
+				volumeTexture = volumeTextureMRT;
+				s_lastTimeModel = 0;
+    		}
+    		else if ( s_activeModel == 1) //CT
+    		{
+    			activateVolume(volumeDataCTHead);
+				activeVolumeData = &volumeDataCTHead;
+				volumeTexture = volumeTextureCT;
+				s_lastTimeModel = 1;
+    		}
+    		else // 4D phantom, texture is set by the streamer
+    		{
+    			activateVolume(volumeDataTimeSeries);
+				activeVolumeData = &volumeDataTimeSeries;
+				s_lastTimeModel = 2;
+    		}
+    	}
+	};
+
+	// everything the rendering of a frame depends on: recorded, or overwritten by the replayed values.
+	// Called after GUI and client input were applied, so a replay can't be disturbed by them.
+	auto trackTimeline = [&]()
+	{
+		if ( !timeline.isActive() ) { return; }
+
+		// switching the model resets the parameters below to its value range
+		timeline.track("s_activeModel", s_activeModel);
+		activateModel();
+
+		// camera
+		glm::mat4 rotation = turntable.getRotationMatrix();
+		timeline.track("eye", eye); timeline.track("center", center); timeline.track("model", model); timeline.track("turntable", rotation);
+		turntable.setRotationMatrix(rotation);
+		timeline.track("s_isRotating", s_isRotating);
+
+		// ray casting
+		timeline.track("s_renderEngine", s_renderEngine); timeline.track("s_cpuResolutionScale", s_cpuResolutionScale); timeline.track("s_shearWarpBilinear", s_shearWarpBilinear);
+		timeline.track("s_rayStepSize", s_rayStepSize); timeline.track("s_rayParamStart", s_rayParamStart); timeline.track("s_rayParamEnd", s_rayParamEnd);
+		timeline.track("s_LMIP_threshold", s_LMIP_threshold); timeline.track("s_LMIP_isEnabled", s_LMIP_isEnabled); timeline.track("s_LMIP_minStepsToLocalMaximum", s_LMIP_minStepsToLocalMaximum);
+		timeline.track("s_minValThreshold", s_minValThreshold); timeline.track("s_maxValThreshold", s_maxValThreshold);
+		timeline.track("s_projection", s_projection); timeline.track("s_multiProjection", s_multiProjection);
+		timeline.track("s_shading", s_shading); timeline.track("s_gradientOperator", s_gradientOperator); timeline.track("s_shadingInfluence", s_shadingInfluence);
+		timeline.track("s_renderMode", s_renderMode); timeline.track("s_isoValue", s_isoValue); timeline.track("s_isoRefinementSteps", s_isoRefinementSteps); timeline.track("s_isoColor", s_isoColor);
+		timeline.track("s_brickSkipping", s_brickSkipping); timeline.track("s_brickSize", s_brickSize);
+
+		// color mapping
+		timeline.track("s_windowingMinValue", s_windowingMinValue); timeline.track("s_windowingMaxValue", s_windowingMaxValue);
+		timeline.track("s_maxDistColor", s_maxDistColor); timeline.track("s_minDistColor", s_minDistColor); timeline.track("s_mixMode", s_mixMode);
+		timeline.track("s_colorEffectInfluence", s_colorEffectInfluence); timeline.track("s_contrastEffectInfluence", s_contrastEffectInfluence);
+		timeline.track("s_minDepthRange", s_minDepthRange); timeline.track("s_maxDepthRange", s_maxDepthRange);
+
+		// time series and fusion
+		timeline.track("s_timeSeriesPlaying", s_timeSeriesPlaying); timeline.track("s_timeSeriesSpeed", s_timeSeriesSpeed);
+		timeline.track("s_timeSeriesPosition", s_timeSeriesPosition); timeline.track("s_timeSeriesInterpolate", s_timeSeriesInterpolate);
+		timeline.track("s_fusionEnabled", s_fusionEnabled); timeline.track("s_fusionPacked", s_fusionPacked);
+		timeline.track("s_fusionTranslation", s_fusionTranslation); timeline.track("s_fusionRotation", s_fusionRotation); timeline.track("s_fusionScale", s_fusionScale);
+		timeline.track("s_fusionWindowCT", s_fusionWindowCT); timeline.track("s_fusionWindowMRT", s_fusionWindowMRT);
+		timeline.track("s_fusionWeightCT", s_fusionWeightCT); timeline.track("s_fusionWeightMRT", s_fusionWeightMRT);
+		timeline.track("s_fusionColorCT", s_fusionColorCT); timeline.track("s_fusionColorMRT", s_fusionColorMRT);
+
+		// slice view
+		timeline.track("s_showSliceView", s_showSliceView); timeline.track("s_sliceOrientation", s_sliceOrientation); timeline.track("s_slicePosition", s_slicePosition);
+		timeline.track("s_sliceYaw", s_sliceYaw); timeline.track("s_slicePitch", s_slicePitch); timeline.track("s_sliceFollowView", s_sliceFollowView);
+		timeline.track("s_slabThickness", s_slabThickness); timeline.track("s_slabMode", s_slabMode); timeline.track("s_incrementalSlab", s_incrementalSlab); timeline.track("s_slabEngine", s_slabEngine);
+	};
+
+	// start recording or replaying with a full render of the first frame
+	auto startTimeline = [&](bool replay)
+	{
+		if ( replay )
+		{
+			if ( !timeline.load(s_timelinePath) || !timeline.replay() ) { return false; }
+			replayTimer.clear();
+			replaySummary.clear();
+		}
+		else
+		{
+			timeline.record();
+		}
+		lastTraversalState.clear();
+		lastColorState.clear();
+		lastSliceState.clear();
+		return true;
+	};
+	if ( s_replayTimeline && !startTimeline(true) && s_headless )
+	{
+		DEBUGLOG_ERROR("nothing to replay");
+		destroyWindow(window);
+		return 1;
+	}
+	else if ( s_recordTimeline && !s_replayTimeline )
+	{
+		startTimeline(false);
+	}
+
 	double elapsedTime = 0.0;
-	render(window, [&](double dt)
+	renderOnDemand(window, [&](double dt)
 	{
+		// timeline: a replay renders every frame, with the recorded time steps
+		bool replaying = timeline.isReplaying();
+		timeline.beginFrame();
+		if ( replaying && !timeline.isReplaying() )
+		{
+			finishReplay(); // ended with the last frame
+			if ( s_headless ) { glfwSetWindowShouldClose(window, GL_TRUE); }
+		}
+		if ( timeline.isReplaying() )
+		{
+			replayTimer.begin();
+			invalidateFrame();
+		}
+		timeline.track("dt", dt);
+
 		elapsedTime += dt;
+		numFrames++;
+
+		// animations keep rendering, everything else waits for input
+		if ( !s_renderOnDemand || s_isRotating || s_recording || turntableFramesLeft > 0 || frameExporter.getNumInFlight() > 0 || streamServer.isReading() || (s_activeModel == 2 && (s_timeSeriesPlaying || volumeStreamer.getCurrentTimePoint() != (int) s_timeSeriesPosition)) )
+		{
+			invalidateFrame();
+		}
+
 		std::string window_header = "Volume Renderer - " + std::to_string( 1.0 / dt ) + " FPS";
 		glfwSetWindowTitle(window, window_header.c_str() );
 
@@ -322,6 +1210,8 @@ int main()
             ImGui::DragFloatRange2("windowing range", &s_windowingMinValue, &s_windowingMaxValue, 5.0f, (float) s_minValue, (float) s_maxValue); // grayscale ramp boundaries
 	        ImGui::DragFloatRange2("ray range",   &s_rayParamStart, &s_rayParamEnd,  0.001f, 0.0f, 1.0f);
         	ImGui::SliderFloat("ray step size",   &s_rayStepSize,  0.0001f, 0.1f, "%.5f", 2.0f);
+			ImGui::Combo("projection", &s_projection, s_projectionLabels, IM_ARRAYSIZE(s_projectionLabels)); // shear-warp: MIP only
+			ImGui::Checkbox("accumulate all projections", &s_multiProjection); // one traversal for all projections, disables LMIP
         	
 			if ( ImGui::TreeNode("experimental") )
 			{
@@ -332,6 +1222,189 @@ int main()
 			}
 
         }
+		if (ImGui::CollapsingHeader("Shading"))
+		{
+			ImGui::Combo("gradients", &s_shading, s_shadingLabels, IM_ARRAYSIZE(s_shadingLabels)); // GPU ray casting, MIP only
+			ImGui::SliderFloat("shading influence", &s_shadingInfluence, 0.0f, 1.0f);
+			ImGui::Combo("operator", &s_gradientOperator, s_gradientOperatorLabels, IM_ARRAYSIZE(s_gradientOperatorLabels)); // gradients are rebuilt once needed
+
+			const GradientVolume* gradients = getGradients();
+			if (gradients)
+			{
+				float volumeMB = (float) (activeVolumeData->data.size() * sizeof(short)) / (1024.0f * 1024.0f);
+				ImGui::Text("gradient volume: %.1f MB (volume %.1f MB), computed in %.1f ms", (float) gradients->getBytes() / (1024.0f * 1024.0f), volumeMB, gradients->milliseconds);
+			}
+			else
+			{
+				ImGui::Text(s_activeModel == 2 ? "no gradient volume: derived on the fly" : "no gradient volume: computed once precomputed gradients are selected");
+			}
+			ImGui::Text("ms per traversal: off %.2f, on the fly %.2f, precomputed %.2f", s_shadingMilliseconds[0], s_shadingMilliseconds[1], s_shadingMilliseconds[2]);
+			if (ImGui::Button("compare gradient sources") && s_renderEngine == 0 && !s_fusionEnabled)
+			{
+				DEBUGLOG->log("Gradient source comparison, ms per traversal"); DEBUGLOG->indent();
+				updateLazyTextures(true, false);
+				for (int mode = 0; mode < 3; mode++)
+				{
+					if (mode == 2 && getGradientTexture() == 0)
+					{
+						continue;
+					}
+					shaderProgram.update("uShading", mode);
+					s_shadingMilliseconds[mode] = measureTraversal();
+					DEBUGLOG->log(std::string(s_shadingLabels[mode]) + ": ", (float) s_shadingMilliseconds[mode]);
+				}
+				DEBUGLOG->outdent();
+			}
+		}
+		if (ImGui::CollapsingHeader("Isosurface"))
+		{
+			ImGui::Combo("render mode", &s_renderMode, s_renderModeLabels, IM_ARRAYSIZE(s_renderModeLabels)); // GPU and CPU ray casting
+			ImGui::DragFloat("iso value", &s_isoValue, 5.0f, s_minValue, s_maxValue);
+			ImGui::SliderInt("refinement steps", &s_isoRefinementSteps, 0, 10);
+			ImGui::ColorEdit4("surface color", glm::value_ptr(s_isoColor));
+			ImGui::Checkbox("skip bricks", &s_brickSkipping);
+			ImGui::SliderInt("brick size", &s_brickSize, 2, 32); // bricks are rebuilt once needed
+			if (getBricks())
+			{
+				ImGui::Text("%d bricks, %.1f KB", (int) getBricks()->min.data.size(), (float) (getBricks()->min.data.size() * 2 * sizeof(short)) / 1024.0f);
+			}
+			ImGui::Text("ms per traversal: all steps %.2f, skipping bricks %.2f", s_brickSkippingMilliseconds[0], s_brickSkippingMilliseconds[1]);
+			if (ImGui::Button("compare brick skipping") && s_renderEngine == 0 && !s_fusionEnabled && s_activeModel != 2) // the 4D series has no bricks
+			{
+				updateLazyTextures(false, true);
+				shaderProgram.update("uRenderMode", 1);
+				shaderProgram.update("uIsoValue", s_isoValue);
+				shaderProgram.update("uIsoRefinementSteps", s_isoRefinementSteps);
+				for (int skipping = 0; skipping < 2; skipping++)
+				{
+					shaderProgram.update("uBrickSize", skipping ? s_brickSize : 0);
+					s_brickSkippingMilliseconds[skipping] = measureTraversal();
+				}
+				DEBUGLOG->log("Isosurface ms per traversal, all steps    : ", (float) s_brickSkippingMilliseconds[0]);
+				DEBUGLOG->log("Isosurface ms per traversal, brick skipping: ", (float) s_brickSkippingMilliseconds[1]);
+			}
+		}
+		if (ImGui::CollapsingHeader("Render Engine"))
+		{
+			ImGui::ListBox("engine", &s_renderEngine, s_renderEngineLabels, IM_ARRAYSIZE(s_renderEngineLabels), 3);
+			ImGui::SliderFloat("CPU resolution", &s_cpuResolutionScale, 0.1f, 1.0f);
+			ImGui::Checkbox("bilinear shear-warp", &s_shearWarpBilinear);
+			ImGui::Text("CPU ray casting: %.2f ms, %.1f MSamples/s", cpuRaycaster.getStats().milliseconds, cpuRaycaster.getStats().getSamplesPerSecond() / 1.0e6);
+			ImGui::Text("CPU shear-warp : %.2f ms, %.1f MSamples/s", shearWarp.getStats().milliseconds, shearWarp.getStats().getSamplesPerSecond() / 1.0e6);
+			if (ImGui::Button("compare CPU engines"))
+			{
+				glm::mat4 modelViewProjection = perspective * view * turntable.getRotationMatrix() * model;
+				renderCPU(1, modelViewProjection);
+				renderCPU(2, modelViewProjection);
+				DEBUGLOG->log("CPU engine comparison at resolution ", glm::vec3(cpuImage.width, cpuImage.height, 0.0f)); DEBUGLOG->indent();
+					DEBUGLOG->log("ray casting ms        : ", cpuRaycaster.getStats().milliseconds);
+					DEBUGLOG->log("ray casting samples/s : ", cpuRaycaster.getStats().getSamplesPerSecond());
+					DEBUGLOG->log("shear-warp ms         : ", shearWarp.getStats().milliseconds);
+					DEBUGLOG->log("shear-warp samples/s  : ", shearWarp.getStats().getSamplesPerSecond());
+				DEBUGLOG->outdent();
+			}
+		}
+		if (ImGui::CollapsingHeader("Picking"))
+		{
+			ImGui::Checkbox("CPU picking", &s_cpuPicking);
+			ImGui::Text("right click to pick (%d requests)", voxelPicker.getNumRequests());
+			if ( lastPick.hit )
+			{
+				ImGui::Text("voxel (%d, %d, %d), value %.1f", lastPick.voxel.x, lastPick.voxel.y, lastPick.voxel.z, lastPick.value);
+			}
+			else
+			{
+				ImGui::Text("nothing picked");
+			}
+			ImGui::Text("source: %s, latency %d frames", pickFromGPU ? "GPU readback" : "CPU ray casting", pickLatency);
+		}
+		if (ImGui::CollapsingHeader("Export"))
+		{
+			ImGui::Combo("format", &s_exportFormat, s_exportFormatLabels, IM_ARRAYSIZE(s_exportFormatLabels));
+			ImGui::InputText("prefix", s_exportPrefix, IM_ARRAYSIZE(s_exportPrefix));
+			if (ImGui::Button("screenshot"))
+			{
+				frameExporter.setOutput(".", s_exportPrefix);
+				screenshotRequested = true;
+			}
+			ImGui::SameLine();
+			if (ImGui::Checkbox("record", &s_recording) && s_recording)
+			{
+				frameExporter.setOutput(".", std::string(s_exportPrefix) + "_sequence");
+			}
+			ImGui::SliderFloat("frame rate", &s_recordFrameRate, 10.0f, 60.0f);
+			if (ImGui::Button("record turntable") && turntableFramesLeft == 0)
+			{
+				// one revolution at the auto-rotation speed of 1 radian per second
+				frameExporter.setOutput(".", std::string(s_exportPrefix) + "_turntable");
+				turntableFramesLeft = (int) std::ceil( 2.0f * glm::pi<float>() * s_recordFrameRate );
+				lastCaptureRefused = true; // the first frame is captured unrotated
+			}
+			ImGui::Text("%d captured, %d written, %d refused (%d in flight)", frameExporter.getNumCaptured(), frameExporter.getNumWritten(), frameExporter.getNumRefused(), frameExporter.getNumInFlight());
+			ImGui::Text("encoding: %.2f ms per frame", frameExporter.getEncodeMilliseconds());
+			if ( turntableFramesLeft > 0 ) { ImGui::Text("turntable: %d frames left", turntableFramesLeft); }
+		}
+		if (ImGui::CollapsingHeader("Streaming"))
+		{
+			if (ImGui::Checkbox("serve frames", &s_streaming))
+			{
+				updateStreamServer();
+			}
+			if (!s_streaming)
+			{
+				ImGui::Checkbox("Unix domain socket", &s_streamUnix);
+				if (s_streamUnix)
+				{
+					ImGui::InputText("socket path", s_streamUnixPath, IM_ARRAYSIZE(s_streamUnixPath));
+				}
+				else
+				{
+					ImGui::InputInt("port", &s_streamPort);
+					ImGui::Checkbox("accept remote clients", &s_streamRemote);
+				}
+			}
+			else if (!streamServer.isConnected())
+			{
+				ImGui::Text("waiting for a client");
+			}
+			else
+			{
+				ImGui::Text("%d x %d (scale %.2f), latency %.1f ms (budget %.0f ms)", streamServer.getStreamWidth(), streamServer.getStreamHeight(), streamServer.getScale(), streamServer.getLatency(), streamServer.getLatencyBudget());
+				ImGui::Text("%d frames sent, %d unchanged", streamServer.getNumFramesSent(), streamServer.getNumUnchangedFrames());
+				ImGui::Text("last frame: %d / %d tiles, %.1f KB, encoded in %.2f ms", streamServer.getNumChangedTiles(), streamServer.getNumTiles(), (float) streamServer.getLastFrameBytes() / 1024.0f, streamServer.getEncodeMilliseconds());
+				ImGui::Text("%.1f MB sent", (float) streamServer.getBytesSent() / (1024.0f * 1024.0f));
+			}
+		}
+		if (ImGui::CollapsingHeader("Timeline"))
+		{
+			if ( timeline.isRecording() )
+			{
+				ImGui::Text("recording: %d frames, %d parameters, %.1f KB", timeline.getNumFrames(), timeline.getNumParameters(), (float) timeline.getNumBytes() / 1024.0f);
+				if (ImGui::Button("stop and save"))
+				{
+					timeline.stop();
+					timeline.save(s_timelinePath);
+				}
+			}
+			else if ( timeline.isReplaying() )
+			{
+				ImGui::Text("replaying: frame %d of %d", timeline.getCurrentFrame() + 1, timeline.getNumFrames());
+				if (ImGui::Button("stop"))
+				{
+					timeline.stop();
+					finishReplay();
+				}
+			}
+			else
+			{
+				ImGui::InputText("timeline file", s_timelinePath, IM_ARRAYSIZE(s_timelinePath));
+				ImGui::InputText("report prefix", s_reportPrefix, IM_ARRAYSIZE(s_reportPrefix));
+				if (ImGui::Button("record")) { startTimeline(false); } // from the next frame on
+				ImGui::SameLine();
+				if (ImGui::Button("replay")) { startTimeline(true); }
+				if ( !replaySummary.empty() ) { ImGui::Text("last replay: %s", replaySummary.c_str()); }
+			}
+		}
 		if (ImGui::CollapsingHeader("Experimental Settings"))
     	{
             ImGui::Text("Experimental Parameters at a glance");
@@ -341,29 +1414,144 @@ int main()
 		}
         
 		ImGui::Checkbox("auto-rotate", &s_isRotating); // enable/disable rotating volume
-    	ImGui::ListBox("active model", &s_activeModel, s_models, IM_ARRAYSIZE(s_models), 2);
-    	if (s_lastTimeModel != s_activeModel)
-    	{
-    		if ( s_activeModel == 0) //MRT
-    		{
-				activateVolume(volumeDataMRTBrain);
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_3D, volumeTextureMRT);
-				s_lastTimeModel = 0;
-    		}
-    		else
-    		{
-    			activateVolume(volumeDataCTHead);
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_3D, volumeTextureCT);
-				s_lastTimeModel = 1;
-    		}
-    	}
+		ImGui::Checkbox("render on demand", &s_renderOnDemand); // skip frames if nothing changed
+		ImGui::SameLine(); ImGui::Text("volume traversed in %d, rendered in %d of %d frames", numTraversals, numSceneRenders, numFrames);
+    	ImGui::ListBox("active model", &s_activeModel, s_models, IM_ARRAYSIZE(s_models), 3);
+    	activateModel();
+		if (ImGui::CollapsingHeader("Fusion"))
+		{
+			ImGui::Checkbox("fuse CT + MRT", &s_fusionEnabled);
+			ImGui::Checkbox("packed (MRT resampled to CT grid)", &s_fusionPacked);
+			ImGui::DragFloat3("MRT translation", glm::value_ptr(s_fusionTranslation), 0.005f, -1.0f, 1.0f);
+			ImGui::DragFloat3("MRT rotation", glm::value_ptr(s_fusionRotation), 0.5f, -180.0f, 180.0f);
+			ImGui::DragFloat("MRT scale", &s_fusionScale, 0.005f, 0.25f, 4.0f);
+			ImGui::DragFloatRange2("CT window",  &s_fusionWindowCT.x,  &s_fusionWindowCT.y,  5.0f, (float) volumeDataCTHead.min,   (float) volumeDataCTHead.max);
+			ImGui::DragFloatRange2("MRT window", &s_fusionWindowMRT.x, &s_fusionWindowMRT.y, 5.0f, (float) volumeDataMRTBrain.min, (float) volumeDataMRTBrain.max);
+			ImGui::SliderFloat("CT weight",  &s_fusionWeightCT,  0.0f, 1.0f);
+			ImGui::SliderFloat("MRT weight", &s_fusionWeightMRT, 0.0f, 1.0f);
+			ImGui::ColorEdit4("CT color",  glm::value_ptr(s_fusionColorCT));
+			ImGui::ColorEdit4("MRT color", glm::value_ptr(s_fusionColorMRT));
+		}
+		if (s_activeModel == 2 && ImGui::CollapsingHeader("Time Series"))
+		{
+			ImGui::Checkbox("play", &s_timeSeriesPlaying);
+			ImGui::SliderFloat("time point", &s_timeSeriesPosition, 0.0f, (float) timeSeries.numTimePoints - 0.001f);
+			ImGui::SliderFloat("time points / s", &s_timeSeriesSpeed, 1.0f, 60.0f);
+			ImGui::Checkbox("interpolate time points", &s_timeSeriesInterpolate);
+			ImGui::Text("resident %d / %d, uploads %d, stalls %d", volumeStreamer.getNumResident(), volumeStreamer.getNumTextures(), volumeStreamer.getNumUploads(), volumeStreamer.getNumStalls());
+			ImGui::Text("decode %.2f ms, upload %.2f ms", volumeStreamer.getDecodeMilliseconds(), volumeStreamer.getUploadMilliseconds());
+		}
+		ImGui::Checkbox("slice view", &s_showSliceView);
 		ImGui::PopItemWidth();
+
+		if (s_showSliceView)
+		{
+			glm::mat4 modelViewProjection = perspective * view * turntable.getRotationMatrix() * model;
+			std::vector<float> sliceState = captureSliceState(modelViewProjection);
+			if (sliceState != lastSliceState)
+			{
+				updateSliceView(modelViewProjection);
+				lastSliceState = sliceState;
+			}
+
+			ImGui::Begin("Slice View", &s_showSliceView);
+			ImGui::PushItemWidth(-100);
+			ImGui::Combo("orientation", &s_sliceOrientation, s_sliceOrientationLabels, IM_ARRAYSIZE(s_sliceOrientationLabels));
+			if (s_sliceOrientation == MPR::OBLIQUE)
+			{
+				ImGui::Checkbox("follow view", &s_sliceFollowView);
+				ImGui::SliderFloat("yaw",   &s_sliceYaw,   -180.0f, 180.0f);
+				ImGui::SliderFloat("pitch", &s_slicePitch,  -90.0f,  90.0f);
+			}
+			else
+			{
+				ImGui::SliderFloat("position", &s_slicePosition, 0.0f, 1.0f);
+			}
+			ImGui::SliderFloat("slab thickness", &s_slabThickness, 1.0f, 64.0f);
+			ImGui::Combo("slab mode", &s_slabMode, s_slabModeLabels, IM_ARRAYSIZE(s_slabModeLabels));
+			if (s_sliceOrientation != MPR::OBLIQUE && s_slabMode == MPR::SLAB_MIP)
+			{
+				ImGui::Checkbox("incremental slab", &s_incrementalSlab);
+				if (s_incrementalSlab)
+				{
+					ImGui::Combo("slab engine", &s_slabEngine, s_slabEngineLabels, IM_ARRAYSIZE(s_slabEngineLabels));
+				}
+			}
+			if (s_incrementalSlab && s_sliceOrientation != MPR::OBLIQUE && s_slabMode == MPR::SLAB_MIP && s_slabEngine == 0)
+			{
+				ImGui::Text("%.2f ms, %d rebuilds, %d incremental steps", slabMIP.getStats().milliseconds, slabMIP.getNumRebuilds(), slabMIP.getNumIncrementalSteps());
+			}
+			else
+			{
+				ImGui::Text("%.2f ms", mpr.getStats().milliseconds);
+			}
+			ImGui::PopItemWidth();
+
+			// keep the aspect ratio of the slice; texture row 0 is the bottom row
+			float displayWidth = 300.0f;
+			float displayHeight = displayWidth * (float) sliceImage.height / (float) std::max(1, sliceImage.width);
+			ImGui::Image( (void*) (intptr_t) sliceDisplayTexture, ImVec2(displayWidth, displayHeight), ImVec2(0.0f, 1.0f), ImVec2(1.0f, 0.0f) );
+			ImGui::End();
+		}
         //////////////////////////////////////////////////////////////////////////////
 
+		/////////////////////////////// STREAMING /////////////////////////////////
+		// client input is applied like local input
+		streamServer.update();
+		MessageChannel::Message streamMessage;
+		while ( streamServer.receive(streamMessage) )
+		{
+			if ( streamMessage.type == FrameStream::CAMERA && streamMessage.payload.size() == sizeof(FrameStream::CameraMessage) )
+			{
+				const FrameStream::CameraMessage* camera = (const FrameStream::CameraMessage*) &streamMessage.payload[0];
+				turntable.dragBy(camera->dragX, camera->dragY, view);
+				glm::vec4 move = glm::inverse(view) * glm::vec4(camera->moveX, camera->moveY, camera->moveZ, 0.0f);
+				eye += move;
+				center += move;
+			}
+			else if ( streamMessage.type == FrameStream::PARAMETER && streamMessage.payload.size() == sizeof(FrameStream::ParameterMessage) )
+			{
+				const FrameStream::ParameterMessage* parameter = (const FrameStream::ParameterMessage*) &streamMessage.payload[0];
+				switch (parameter->parameter)
+				{
+					case FrameStream::WINDOW_MIN:  s_windowingMinValue = parameter->value; break;
+					case FrameStream::WINDOW_MAX:  s_windowingMaxValue = parameter->value; break;
+					case FrameStream::PROJECTION:  s_projection = glm::clamp( (int) parameter->value, 0, IM_ARRAYSIZE(s_projectionLabels) - 1 ); break;
+					case FrameStream::RENDER_MODE: s_renderMode = glm::clamp( (int) parameter->value, 0, IM_ARRAYSIZE(s_renderModeLabels) - 1 ); break;
+					case FrameStream::ISO_VALUE:   s_isoValue = parameter->value; break;
+					case FrameStream::ROTATING:    s_isRotating = (parameter->value != 0.0f); break;
+					default: break;
+				}
+			}
+		}
+		if ( streamServer.isConnected() )
+		{
+			// keep the client's view of the parameters current, it sends absolute values
+			FrameStream::StateMessage streamState = {
+				(float) activeVolumeData->min, (float) activeVolumeData->max, s_windowingMinValue, s_windowingMaxValue,
+				s_isoValue, s_projection, s_renderMode, s_isRotating ? 1 : 0 };
+			int connections = streamServer.getNumConnections();
+			if ( std::memcmp(&streamState, &lastStreamState, sizeof(streamState)) != 0 || connections != streamStateConnections )
+			{
+				streamServer.sendState(streamState);
+				lastStreamState = streamState;
+				streamStateConnections = connections;
+			}
+		}
+		//////////////////////////////////////////////////////////////////////////////
+
+		trackTimeline();
+		updateLazyTextures(s_shading == 2, s_renderMode == 1 && s_brickSkipping);
+
 		///////////////////////////// MATRIX UPDATING ///////////////////////////////
-		if (s_isRotating) // update view matrix
+		if (turntableFramesLeft > 0) // fixed rotation per recorded frame, independent of the encoding speed
+		{
+			if ( !lastCaptureRefused )
+			{
+				model = glm::rotate(glm::mat4(1.0f), 1.0f / s_recordFrameRate, glm::vec3(0.0f, 1.0f, 0.0f) ) * model;
+			}
+		}
+		else if (s_isRotating) // update view matrix
 		{
 			model = glm::rotate(glm::mat4(1.0f), (float) dt, glm::vec3(0.0f, 1.0f, 0.0f) ) * model;
 		}
@@ -378,31 +1566,111 @@ int main()
 		shaderProgram.update(   "model", turntable.getRotationMatrix() * model);
 		uvwShaderProgram.update("model", turntable.getRotationMatrix() * model);
 
-		/************* update color mapping parameters ******************/
+		/************* update time series playback *********************/
+		GLuint nextVolumeTexture = volumeTexture;
+		float timeMix = 0.0f;
+		if (s_activeModel == 2)
+		{
+			if (s_timeSeriesPlaying)
+			{
+				s_timeSeriesPosition = std::fmod( s_timeSeriesPosition + (float) dt * s_timeSeriesSpeed, (float) timeSeries.numTimePoints );
+			}
+			volumeStreamer.setInterpolation(s_timeSeriesInterpolate);
+			volumeStreamer.update(s_timeSeriesPosition);
+			volumeTexture = volumeStreamer.getCurrentTexture();
+			nextVolumeTexture = volumeStreamer.getNextTexture();
+			timeMix = volumeStreamer.getMix();
+		}
+		glActiveTexture(GL_TEXTURE4);
+		glBindTexture(GL_TEXTURE_3D, nextVolumeTexture);
+		glActiveTexture(GL_TEXTURE8);
+		glBindTexture(GL_TEXTURE_3D, getGradientTexture());
+		glActiveTexture(GL_TEXTURE9);
+		glBindTexture(GL_TEXTURE_3D, getBrickTexture());
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_3D, volumeTexture);
+		shaderProgram.update("uTimeMix", timeMix); // interpolation weight of next time point
+
+		/************* update fusion parameters *************************/
+		if (s_fusionEnabled)
+		{
+			glm::mat4 registrationMRT = VolumeFusion::computeRegistration(s_fusionTranslation, s_fusionRotation, glm::vec3(s_fusionScale));
+
+			// resampling takes a while: re-pack once the registration is not being dragged anymore
+			if (s_fusionPacked && registrationMRT != packedRegistration && !ImGui::IsAnyItemActive())
+			{
+				VolumeFusion::resample(volumeDataMRTBrain, registrationMRT, volumeDataCTHead, resampledMRT);
+				if (packedVolumeTexture != 0)
+				{
+					glDeleteTextures(1, &packedVolumeTexture);
+				}
+				packedVolumeTexture = loadTo3DTexturePacked<short>(volumeDataCTHead, resampledMRT);
+				packedRegistration = registrationMRT;
+
+				glActiveTexture(GL_TEXTURE7);
+				glBindTexture(GL_TEXTURE_3D, packedVolumeTexture);
+				glActiveTexture(GL_TEXTURE0);
+			}
+
+			fusionShaderProgram.update("view", view);
+			fusionShaderProgram.update("model", turntable.getRotationMatrix() * model);
+			fusionShaderProgram.update("uRayParamStart", s_rayParamStart);
+			fusionShaderProgram.update("uRayParamEnd",   s_rayParamEnd);
+			fusionShaderProgram.update("uStepSize", s_rayStepSize);
+			fusionShaderProgram.update("uPacked", (s_fusionPacked && packedVolumeTexture != 0) ? 1 : 0);
+			fusionShaderProgram.update("uRegistrationB", registrationMRT);
+			fusionShaderProgram.update("uWindowingMinValA", s_fusionWindowCT.x);
+			fusionShaderProgram.update("uWindowingRangeA",  s_fusionWindowCT.y - s_fusionWindowCT.x);
+			fusionShaderProgram.update("uWindowingMinValB", s_fusionWindowMRT.x);
+			fusionShaderProgram.update("uWindowingRangeB",  s_fusionWindowMRT.y - s_fusionWindowMRT.x);
+			fusionShaderProgram.update("uWeightA", s_fusionWeightCT);
+			fusionShaderProgram.update("uWeightB", s_fusionWeightMRT);
+			fusionShaderProgram.update("uColorA", s_fusionColorCT);
+			fusionShaderProgram.update("uColorB", s_fusionColorMRT);
+		}
+
+		/************* update ray casting parameters ******************/
 		// ray start/end parameters
 		shaderProgram.update("uRayParamStart", s_rayParamStart);  // ray start parameter
 		shaderProgram.update("uRayParamEnd",   s_rayParamEnd);    // ray end   parameter
 		shaderProgram.update("uStepSize", s_rayStepSize); 	  // ray step size
-		// color mapping parameters
-		shaderProgram.update("uWindowingMinVal", s_windowingMinValue); 	  // lower grayscale ramp boundary
-		shaderProgram.update("uWindowingMaxVal", s_windowingMaxValue); 	  // upper grayscale ramp boundary
-		shaderProgram.update("uWindowingRange",  s_windowingMaxValue - s_windowingMinValue); // full range of values in window
-		shaderProgram.update("uMaxDistColor", s_maxDistColor);    // color at full distance
-		shaderProgram.update("uMinDistColor", s_minDistColor);    // color at min depth
-		shaderProgram.update("uMixMode", 	  s_mixMode);		  // color mixing mode
-		shaderProgram.update("uColorEffectInfl",    s_colorEffectInfluence);  	// color shift effect influence
-		shaderProgram.update("uContrastEffectInfl", s_contrastEffectInfluence); // contrast attenuation effect influence
+		// color mapping parameters, applied by the recolor pass
+		recolorShader.update("uWindowingMinVal", s_windowingMinValue); 	  // lower grayscale ramp boundary
+		recolorShader.update("uWindowingMaxVal", s_windowingMaxValue); 	  // upper grayscale ramp boundary
+		recolorShader.update("uWindowingRange",  s_windowingMaxValue - s_windowingMinValue); // full range of values in window
+		recolorShader.update("uMaxDistColor", s_maxDistColor);    // color at full distance
+		recolorShader.update("uMinDistColor", s_minDistColor);    // color at min depth
+		recolorShader.update("uMixMode", 	  s_mixMode);		  // color mixing mode
+		recolorShader.update("uColorEffectInfl",    s_colorEffectInfluence);  	// color shift effect influence
+		recolorShader.update("uContrastEffectInfl", s_contrastEffectInfluence); // contrast attenuation effect influence
 
 		// LMIP parameter
 		shaderProgram.update("uThresholdLMIP", 	s_LMIP_threshold);
 
+		// shading parameters
+		shaderProgram.update("uShading", getShadingMode());
+		shaderProgram.update("uGradientMaxMagnitude", getGradients() ? getGradients()->maxMagnitude : 0.0f);
+		recolorShader.update("uShadingInfl", getShadingMode() != 0 ? s_shadingInfluence : 0.0f);
+
+		// isosurface parameters
+		shaderProgram.update("uRenderMode", s_renderMode);
+		shaderProgram.update("uIsoValue", s_isoValue);
+		shaderProgram.update("uIsoRefinementSteps", s_isoRefinementSteps);
+		shaderProgram.update("uBrickSize", getBrickSize());
+		recolorShader.update("uRenderMode", s_renderMode);
+		recolorShader.update("uIsoColor", s_isoColor);
+
+		// projection parameters
+		shaderProgram.update("uMultiProjection", isAccumulatingProjections() ? 1 : 0);
+		recolorShader.update("uProjection", s_projection);
+
 		/************* update experimental  parameters ******************/
 		/// experimental: LMIP 'smoothing'
 		shaderProgram.update("uMinStepsLMIP", 	s_LMIP_minStepsToLocalMaximum);
 
 		/// experimental: constrained depth range
-		shaderProgram.update("uMinDepthRange",  s_minDepthRange);
-		shaderProgram.update("uMaxDepthRange",  s_maxDepthRange);
+		recolorShader.update("uMinDepthRange",  s_minDepthRange);
+		recolorShader.update("uMaxDepthRange",  s_maxDepthRange);
 
 		/// experimental: value thresholds; out-of-range values are ignored
 		shaderProgram.update("uMinValThreshold", s_minValThreshold);
@@ -412,12 +1680,145 @@ int main()
 		////////////////////////////////  RENDERING //// /////////////////////////////
 		glDisable(GL_BLEND);
 		glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA); // this is altered by ImGui::Render(), so set it every frame
-		uvwRenderPass.render();
-		renderPass.render();
+		std::vector<float> traversalState = captureTraversalState(nextVolumeTexture, timeMix);
+		std::vector<float> colorState = captureColorState();
+		bool traverse = (traversalState != lastTraversalState);
+		if (traverse || colorState != lastColorState)
+		{
+			// color mapping changes (windowing, depth effects) only need the recolor pass
+			if (s_renderEngine == 0)
+			{
+				if (s_fusionEnabled)
+				{
+					// the fused shader maps colors itself
+					if (traverse)
+					{
+						uvwRenderPass.render();
+						fusionRenderPass.render();
+						numTraversals++;
+					}
+				}
+				else
+				{
+					if (traverse)
+					{
+						uvwRenderPass.render();
+						renderPass.render();
+						numTraversals++;
+					}
+					recolorPass.render();
+				}
+			}
+			else
+			{
+				if (traverse)
+				{
+					renderCPU(s_renderEngine, perspective * view * turntable.getRotationMatrix() * model);
+					numTraversals++;
+				}
+				else
+				{
+					uploadCPUImage(); // displayed projection may have changed
+				}
+				bool isosurface = (s_renderMode == 1 && s_renderEngine == 1); // diffuse term in [0,1]; shear-warp renders the MIP only
+				windowingShader.update("uWindowingMinVal", isosurface ? 0.0f : s_windowingMinValue);
+				windowingShader.update("uWindowingRange",  isosurface ? 1.0f : s_windowingMaxValue - s_windowingMinValue);
+				cpuRenderPass.render();
+			}
+			lastTraversalState = traversalState;
+			lastColorState = colorState;
+			numSceneRenders++;
+		}
+
+		// picking: the GPU traversal result is current now; the readback is polled in the next frames
+		glm::ivec3 activeVolumeSize(activeVolumeData->size_x, activeVolumeData->size_y, activeVolumeData->size_z);
+		if ( pickRequested )
+		{
+			pickRequested = false;
+			pickFrame = numFrames;
+			if ( s_renderEngine == 0 && !s_fusionEnabled && !s_cpuPicking )
+			{
+				voxelPicker.request(traversalFBO.getFramebufferHandle(), GL_COLOR_ATTACHMENT3, pickPixel.x, pickPixel.y);
+			}
+			else
+			{
+				glm::vec2 resolution = getResolution(window);
+				glm::mat4 voxelToPixel = CPURendering::computeVoxelToPixel(activeVolumeSize, volumeProxySize, perspective * view * turntable.getRotationMatrix() * model, (int) resolution.x, (int) resolution.y);
+				cpuRaycaster.setStepSize( s_rayStepSize * (float) activeVolumeData->size_x ); // uvw step size to voxels
+				cpuRaycaster.setIsoRefinementSteps(s_isoRefinementSteps);
+				float px = (float) pickPixel.x + 0.5f;
+				float py = (float) pickPixel.y + 0.5f;
+				lastPick = ( s_renderMode == 1 )
+					? cpuRaycaster.pickIsosurface(*activeVolumeData, voxelToPixel, s_isoValue, s_brickSkipping ? getBricks() : 0, px, py)
+					: cpuRaycaster.pick(*activeVolumeData, voxelToPixel, px, py);
+				pickFromGPU = false;
+				pickLatency = 0;
+				DEBUGLOG->log("CPU pick: voxel ", glm::vec3(lastPick.voxel)); DEBUGLOG->indent(); DEBUGLOG->log("value: ", lastPick.value); DEBUGLOG->outdent();
+			}
+		}
+		if ( voxelPicker.poll(activeVolumeSize, lastPick) )
+		{
+			pickFromGPU = true;
+			pickLatency = numFrames - pickFrame;
+			DEBUGLOG->log("GPU pick: voxel ", glm::vec3(lastPick.voxel)); DEBUGLOG->indent(); DEBUGLOG->log("value: ", lastPick.value); DEBUGLOG->outdent();
+		}
+		if ( voxelPicker.isPending() )
+		{
+			invalidateFrame(); // keep polling
+		}
+
+		// frame export: the scene (or the traversal result) is current now, the readback is not waited for
+		if ( screenshotRequested || s_recording || turntableFramesLeft > 0 )
+		{
+			bool gpuValues = (s_renderEngine == 0 && !s_fusionEnabled);
+			FrameExporter::Format format = gpuValues ? (FrameExporter::Format) s_exportFormat : FrameExporter::PNG;
+			FrameBufferObject& source = (format == FrameExporter::PNG) ? sceneFBO : traversalFBO;
+			frameExporter.setFormat(format);
+			frameExporter.setValueRange(s_windowingMinValue, s_windowingMaxValue);
+
+			bool captured = frameExporter.capture(source.getFramebufferHandle(), GL_COLOR_ATTACHMENT0, source.getWidth(), source.getHeight());
+			if ( captured )
+			{
+				screenshotRequested = false;
+				if ( turntableFramesLeft > 0 ) { turntableFramesLeft--; }
+			}
+			lastCaptureRefused = !captured;
+		}
+		frameExporter.update();
+
+		// frame streaming: the scene is current now; sent once the readback is complete, if the client is ready
+		if ( streamServer.wantsFrame() && (numSceneRenders != streamedSceneRender || streamServer.needsFrame()) )
+		{
+			streamServer.capture(sceneFBO.getFramebufferHandle(), GL_COLOR_ATTACHMENT0, sceneFBO.getWidth(), sceneFBO.getHeight());
+			streamedSceneRender = numSceneRenders;
+		}
+
+		// present the cached volume rendering
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFBO.getFramebufferHandle());
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glBlitFramebuffer(0, 0, sceneFBO.getWidth(), sceneFBO.getHeight(), 0, 0, sceneFBO.getWidth(), sceneFBO.getHeight(), GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
 		ImGui::Render();
 		//////////////////////////////////////////////////////////////////////////////
+
+		if ( timeline.isReplaying() ) { replayTimer.end(); }
+		timeline.endFrame();
 	});
 
+	if ( timeline.isRecording() )
+	{
+		timeline.stop();
+		timeline.save(s_timelinePath);
+	}
+	else if ( timeline.isReplaying() )
+	{
+		timeline.stop();
+		finishReplay(); // window closed during the replay
+	}
+	ShaderProgram::s_timeline = 0;
+	frameExporter.finish(); // write the frames in flight
+	streamServer.close();
 	destroyWindow(window);
 
 	return 0;
@@ -123,9 +123,7 @@ int main()
 
 	DEBUGLOG->log("FrameBufferObject Creation: volume uvw coords"); DEBUGLOG->indent();
 	FrameBufferObject fbo(getResolution(window).x, getResolution(window).y);
-	FrameBufferObject::s_internalFormat  = GL_RGBA32F; // to allow arbitrary values in G-Buffer
-	fbo.addColorAttachments(4); DEBUGLOG->outdent();   // G-Buffer
-	FrameBufferObject::s_internalFormat  = GL_RGBA;	   // restore default
+	fbo.addColorAttachments( FrameBufferObject::getCompactGBufferFormats() ); DEBUGLOG->outdent(); // G-Buffer: color, normal, uv
 
 	RenderPass renderPass(&shaderProgram, &fbo);
 	renderPass.addEnable(GL_DEPTH_TEST);
@@ -133,6 +131,10 @@ int main()
 	renderPass.addRenderable(&grid);
 
 	ShaderProgram compShader("/screenSpace/fullscreen.vert", "/screenSpace/finalCompositing.frag");
+	compShader.update("inverseProjection", glm::inverse(perspective));
+	compShader.addTexture("colorMap",  fbo.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT0));
+	compShader.addTexture("normalMap", fbo.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT1));
+	compShader.addTexture("depthMap",  fbo.getDepthTextureHandle());
 	// ShaderProgram compShader("/screenSpace/fullscreen.vert", "/screenSpace/simpleAlphaTexture.frag");
 
 	Quad quad;
@@ -293,12 +295,12 @@ int main()
 		// glActiveTexture(GL_TEXTURE1);
 		// glBindTexture(GL_TEXTURE_2D, fbo.getColorAttachmeHntTextureHandle(GL_COLOR_ATTACHMENT1)); // normal
 		// glActiveTexture(GL_TEXTURE2);
-		// glBindTexture(GL_TEXTURE_2D, fbo.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT2)); // position
+		// glBindTexture(GL_TEXTURE_2D, fbo.getDepthTextureHandle()); // depth
 		// glActiveTexture(GL_TEXTURE0);
 
 		// compShader.update("colorMap",    0);
 		// compShader.update("normalMap",   1);
-		// compShader.update("positionMap", 2);
+		// compShader.update("depthMap",    2);
 
 		// renderPass.render();
 		// compositing.render();
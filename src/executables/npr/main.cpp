@@ -1,5 +1,15 @@
 /*******************************************
  * **** DESCRIPTION ****
+ * Non-photorealistic rendering of nested transparent objects.
+ *
+ * Three transparency engines can be selected at runtime:
+ * 1) depth peeling: one geometry pass per layer into a G-Buffer, composited back to front
+ * 2) per-pixel linked lists: one geometry pass appends all fragments, one pass sorts and composites them
+ * 3) ping-pong depth peeling: two G-Buffers are alternated and every layer is composited front to back
+ *    right after peeling it; peeling stops as soon as an occlusion query reports an empty layer
+ * GPU memory and GPU time of all engines are shown in the UI.
+ * Optionally, the iso surface of a phantom volume is extracted with marching cubes and rendered as
+ * an additional nested object; it is re-extracted whenever the iso value changes.
  ****************************************/
 
 #include <iostream>
@@ -7,12 +17,15 @@
 #include <Rendering/GLTools.h>
 #include <Rendering/VertexArrayObjects.h>
 #include <Rendering/RenderPass.h>
+#include <Rendering/FragmentListBuffers.h>
+#include <Rendering/IsoSurfaceMesh.h>
 
 #include "UI/imgui/imgui.h"
 #include <UI/imguiTools.h>
 #include <UI/Turntable.h>
 
 #include <Importing/TextureTools.h>
+#include <Importing/PhantomGenerator.h>
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -28,6 +41,17 @@ static glm::vec4 s_lightPos = glm::vec4(2.0,2.0,2.0,1.0);
 static float s_strength = 0.05f;
 static float s_transparency = 0.05f;
 
+static int 	 s_transparencyEngine = 0; // active order independent transparency engine
+static const char* s_transparencyEngineLabels[] = {"Depth peeling", "Linked lists", "Depth peeling (ping-pong)"};
+static int   s_maxLayers = 4; // linked lists, ping-pong depth peeling: amount of front-most layers to be composited
+
+static bool  s_showIsoSurface = false;
+static int   s_isoPhantom = 1;       // PhantomGenerator::PhantomType of the iso surface volume
+static const char* s_isoPhantomLabels[] = {"Spheres", "Vessel tree", "Noise", "Sparse occupancy"};
+static int   s_isoVolumeSize = 1;      // index into s_isoVolumeSizeLabels
+static const char* s_isoVolumeSizeLabels[] = {"64", "128", "256", "512"};
+static float s_isoValue = 0.4f;      // relative to the value range of the volume
+
 const glm::vec2 WINDOW_RESOLUTION = glm::vec2(800.0f, 600.0f);
 //////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////// MAIN ///////////////////////////////////////
@@ -71,15 +95,28 @@ int main()
 	}
 	objects.push_back(new Sphere(20,40,object_size));
 
+	// iso surface of a phantom, spanning the outermost object
+	VolumeData<short> isoVolume;
+	IsoSurfaceMesh isoSurface;
+	auto updateIsoSurface = [&]()
+	{
+		isoSurface.extract(isoVolume, isoVolume.min + s_isoValue * (isoVolume.max - isoVolume.min), glm::vec3(1.0f));
+	};
+	auto updateIsoVolume = [&]()
+	{
+		DEBUGLOG->log("Phantom Generation: iso surface volume"); DEBUGLOG->indent();
+		isoVolume = PhantomGenerator::generate<short>( PhantomGenerator::PhantomParameters( (PhantomGenerator::PhantomType) s_isoPhantom, 64 << s_isoVolumeSize, 1 ) );
+		DEBUGLOG->outdent();
+		updateIsoSurface();
+	};
+
 	/////////////////////// 	Renderpass     ///////////////////////////
 	int num_depth_buffers = 4;
-	int num_color_attachments = 3;
+	std::vector<FrameBufferObject::AttachmentFormat> gBufferFormats = FrameBufferObject::getCompactGBufferFormats(); // color, normal, uv
 
-	FrameBufferObject::s_internalFormat  = GL_RGBA32F; // to allow arbitrary values in G-Buffer
 	DepthPeelingBuffers depthPeelingBuffers(WINDOW_RESOLUTION.x, WINDOW_RESOLUTION.y,
 		num_depth_buffers,
-		num_color_attachments);
-	FrameBufferObject::s_internalFormat  = GL_RGBA;	   // restore default
+		gBufferFormats);
 
 	DEBUGLOG->log("Shader Compilation: depth peeling shader"); DEBUGLOG->indent();
 	ShaderProgram depthPeelingShader("/modelSpace/GBuffer.vert", "/modelSpace/dpGBuffer.frag");
@@ -106,6 +143,7 @@ int main()
 	// depth peeling compositing shader
 	DEBUGLOG->log("Shader Compilation: depth peeling compositing"); DEBUGLOG->indent();
 	ShaderProgram compShader("/screenSpace/fullscreen.vert", "/screenSpace/dpCompositing.frag");
+	compShader.update("inverseProjection", glm::inverse(perspective));
 	DEBUGLOG->outdent();
 
 	Quad quad;
@@ -114,6 +152,100 @@ int main()
 	compositing.addEnable(GL_BLEND);
 	compositing.addRenderable(&quad);
 
+	/////////////////////// 	Linked List Renderpass     ///////////////////////////
+	DEBUGLOG->log("Buffer Creation: fragment linked lists"); DEBUGLOG->indent();
+	FragmentListBuffers fragmentLists(WINDOW_RESOLUTION.x, WINDOW_RESOLUTION.y);
+	DEBUGLOG->outdent();
+
+	DEBUGLOG->log("Shader Compilation: linked list shader"); DEBUGLOG->indent();
+	ShaderProgram linkedListShader("/modelSpace/GBuffer.vert", "/modelSpace/oitLinkedList.frag");
+	linkedListShader.update("model", model);
+	linkedListShader.update("view", view);
+	linkedListShader.update("projection", perspective);
+	linkedListShader.update("color", s_color);
+	DEBUGLOG->outdent();
+
+	// fragments are only appended to the lists, nothing is written to the fbo
+	FrameBufferObject linkedListFBO(WINDOW_RESOLUTION.x, WINDOW_RESOLUTION.y);
+	RenderPass linkedListPass(&linkedListShader, &linkedListFBO);
+	linkedListPass.addDisable(GL_DEPTH_TEST); // every fragment is needed
+	linkedListPass.addDisable(GL_BLEND);
+	for (auto r : objects )
+	{
+		linkedListPass.addRenderable(r);
+	}
+
+	DEBUGLOG->log("Shader Compilation: linked list compositing"); DEBUGLOG->indent();
+	ShaderProgram oitCompShader("/screenSpace/fullscreen.vert", "/screenSpace/oitCompositing.frag");
+	oitCompShader.update("backgroundColor", glm::vec4(0.5f, 0.5f, 0.5f, 0.0f)); // same as depth peeling compositing
+	DEBUGLOG->outdent();
+
+	RenderPass oitCompositing(&oitCompShader, 0);
+	oitCompositing.addDisable(GL_DEPTH_TEST);
+	oitCompositing.addDisable(GL_BLEND); // blending is done in the shader
+	oitCompositing.addRenderable(&quad);
+
+	/////////////////////// 	Ping-Pong Depth Peeling     ///////////////////////////
+	// memory is independent of the amount of layers: two G-Buffers and one accumulation buffer
+	DEBUGLOG->log("FrameBufferObject Creation: ping-pong depth peeling"); DEBUGLOG->indent();
+	DepthPeelingBuffers pingPongBuffers(WINDOW_RESOLUTION.x, WINDOW_RESOLUTION.y, 2, gBufferFormats);
+	FrameBufferObject::AttachmentFormat accumulationFormat = { GL_RGBA32F, GL_RGBA, GL_FLOAT }; // to allow arbitrary values in accumulation
+	FrameBufferObject accumulationFBO(WINDOW_RESOLUTION.x, WINDOW_RESOLUTION.y);
+	accumulationFBO.addColorAttachments( std::vector<FrameBufferObject::AttachmentFormat>(1, accumulationFormat) );
+	DEBUGLOG->outdent();
+
+	// front to back 'under' blending of premultiplied colors
+	RenderPass accumulation(&compShader, &accumulationFBO);
+	accumulation.setClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	accumulation.addDisable(GL_DEPTH_TEST);
+	accumulation.addEnable(GL_BLEND);
+	accumulation.addRenderable(&quad);
+
+	DEBUGLOG->log("Shader Compilation: accumulation presentation"); DEBUGLOG->indent();
+	ShaderProgram presentShader("/screenSpace/fullscreen.vert", "/screenSpace/simpleAlphaTexture.frag");
+	presentShader.addTexture("tex", accumulationFBO.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT0));
+	presentShader.update("transparency", 0.0f);
+	DEBUGLOG->outdent();
+
+	RenderPass present(&presentShader, 0);
+	present.setClearColor(0.5,0.5,0.5,0.0); // same background as depth peeling compositing
+	present.addClearBit(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+	present.addDisable(GL_DEPTH_TEST);
+	present.addEnable(GL_BLEND);
+	present.addRenderable(&quad);
+
+	GLuint occlusionQueries[2]; // any samples passed of the last two peeled layers
+	glGenQueries(2, occlusionQueries);
+	int numPeeledLayers = 0; // layers peeled in the last frame
+
+	auto setIsoSurfaceVisible = [&](bool visible)
+	{
+		if ( visible )
+		{
+			if ( isoVolume.data.empty() ) { updateIsoVolume(); }
+			depthPeel.addRenderable(&isoSurface);
+			linkedListPass.addRenderable(&isoSurface);
+		}
+		else
+		{
+			depthPeel.removeRenderable(&isoSurface);
+			linkedListPass.removeRenderable(&isoSurface);
+		}
+	};
+	setIsoSurfaceVisible(s_showIsoSurface);
+
+	// GPU memory of all engines
+	size_t gBufferBytes = (size_t) WINDOW_RESOLUTION.x * WINDOW_RESOLUTION.y * (4 + 2 * 2 + 2 * 2 + sizeof(float)); // RGBA8 + RG16 + RG16F attachments + depth
+	size_t depthPeelingBytes = num_depth_buffers * gBufferBytes;
+	size_t pingPongBytes = 2 * gBufferBytes + (size_t) WINDOW_RESOLUTION.x * WINDOW_RESOLUTION.y * (4 * sizeof(float) + sizeof(float));
+
+	// GPU time of all engines, queried one frame late to avoid stalls
+	GLuint timerQueries[2];
+	glGenQueries(2, timerQueries);
+	int timerQueryEngine[2] = {-1, -1};
+	int currentTimerQuery = 0;
+	double engineMilliseconds[3] = {0.0, 0.0, 0.0};
+
 	//////////////////////////////////////////////////////////////////////////////
 	///////////////////////    GUI / USER INPUT   ////////////////////////////////
 	//////////////////////////////////////////////////////////////////////////////
@@ -211,6 +343,25 @@ int main()
         ImGui::SliderFloat("transparency", &s_transparency, 0.0f, 1.0f); // influence of color shift
         
 		ImGui::Checkbox("auto-rotate", &s_isRotating); // enable/disable rotating volume
+
+		ImGui::ListBox("transparency", &s_transparencyEngine, s_transparencyEngineLabels, IM_ARRAYSIZE(s_transparencyEngineLabels), 3);
+		ImGui::SliderInt("max layers", &s_maxLayers, 1, 16); // linked lists, ping-pong depth peeling
+		ImGui::Text("depth peeling: %.2f ms, %.1f MB (%d layers)", engineMilliseconds[0], depthPeelingBytes / (1024.0 * 1024.0), num_depth_buffers);
+		ImGui::Text("linked lists : %.2f ms, %.1f MB (%u of %u nodes)", engineMilliseconds[1], fragmentLists.getMemoryBytes() / (1024.0 * 1024.0), fragmentLists.getNumNodes(), fragmentLists.getMaxNodes());
+		ImGui::Text("ping-pong    : %.2f ms, %.1f MB (%d layers peeled)", engineMilliseconds[2], pingPongBytes / (1024.0 * 1024.0), numPeeledLayers);
+
+		if (ImGui::CollapsingHeader("Iso Surface"))
+		{
+			if ( ImGui::Checkbox("show iso surface", &s_showIsoSurface) ) { setIsoSurfaceVisible(s_showIsoSurface); }
+			if ( s_showIsoSurface )
+			{
+				bool volumeChanged = ImGui::Combo("phantom", &s_isoPhantom, s_isoPhantomLabels, IM_ARRAYSIZE(s_isoPhantomLabels));
+				volumeChanged |= ImGui::Combo("volume size", &s_isoVolumeSize, s_isoVolumeSizeLabels, IM_ARRAYSIZE(s_isoVolumeSizeLabels));
+				if ( volumeChanged ) { updateIsoVolume(); }
+				if ( ImGui::SliderFloat("iso value", &s_isoValue, 0.0f, 1.0f) ) { updateIsoSurface(); }
+				ImGui::Text("marching cubes: %.1f ms, %u vertices, %u triangles", isoSurface.getStats().milliseconds, isoSurface.getStats().numVertices, isoSurface.getStats().numTriangles);
+			}
+		}
 		ImGui::PopItemWidth();
 
         //////////////////////////////////////////////////////////////////////////////
@@ -233,53 +384,154 @@ int main()
 		compShader.update("vLightPos", view * turntable.getRotationMatrix() * s_lightPos);
 		compShader.update("strength", s_strength);
 		compShader.update("transparency", s_transparency);
+
+		linkedListShader.update( "color", s_color);
+		linkedListShader.update( "view", view);
+		linkedListShader.update( "model", turntable.getRotationMatrix() * model);
+
+		oitCompShader.update("vLightPos", view * turntable.getRotationMatrix() * s_lightPos);
+		oitCompShader.update("strength", s_strength);
+		oitCompShader.update("transparency", s_transparency);
+		oitCompShader.update("maxLayers", s_maxLayers);
 		//////////////////////////////////////////////////////////////////////////////
 		
 		////////////////////////////////  RENDERING //// /////////////////////////////
-		for ( int i = 0; i < num_depth_buffers; i++)
+		// result of the query issued last frame
+		int lastTimerQuery = 1 - currentTimerQuery;
+		if ( timerQueryEngine[lastTimerQuery] >= 0 )
 		{
-			// current fbo to fill
-			FrameBufferObject* currentFBO = depthPeelingBuffers.m_fbos[i];
-			
-			// depth texture from last pass exists
-			if ( i > 0)
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(timerQueries[lastTimerQuery], GL_QUERY_RESULT, &nanoseconds);
+			engineMilliseconds[ timerQueryEngine[lastTimerQuery] ] = (double) nanoseconds / 1.0e6;
+		}
+		glBeginQuery(GL_TIME_ELAPSED, timerQueries[currentTimerQuery]);
+		timerQueryEngine[currentTimerQuery] = s_transparencyEngine;
+
+		if (s_transparencyEngine == 1)
+		{
+			// one geometry pass, one resolve pass
+			fragmentLists.clear();
+			linkedListPass.render();
+			fragmentLists.barrier();
+			oitCompositing.render();
+		}
+		else if (s_transparencyEngine == 2)
+		{
+			compShader.update("premultiplyAlpha", true);
+			glBlendFuncSeparate(GL_ONE_MINUS_DST_ALPHA, GL_ONE, GL_ONE_MINUS_DST_ALPHA, GL_ONE); // under operator
+			accumulation.addClearBit(GL_COLOR_BUFFER_BIT);
+
+			numPeeledLayers = 0;
+			bool isLastLayerEmpty = false;
+			for ( int i = 0; i < s_maxLayers; i++)
 			{
-				FrameBufferObject* beforeFBO = depthPeelingBuffers.m_fbos[i-1];
+				FrameBufferObject* currentFBO = pingPongBuffers.m_fbos[i % 2];
+				FrameBufferObject* beforeFBO  = pingPongBuffers.m_fbos[(i + 1) % 2];
 				depthPeelingShader.addTexture("lastDepth", beforeFBO->getDepthTextureHandle() );
+				depthPeelingShader.update("peel_level",i);
+
+				// peel next layer, count its fragments
+				depthPeel.setFrameBufferObject(currentFBO);
+				glBeginQuery(GL_ANY_SAMPLES_PASSED, occlusionQueries[i % 2]);
+				depthPeel.render();
+				glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+				// the previous layer's result is read while the GPU already peels this one
+				if ( i > 0 )
+				{
+					GLuint anySamplesPassed = GL_FALSE;
+					glGetQueryObjectuiv(occlusionQueries[(i - 1) % 2], GL_QUERY_RESULT, &anySamplesPassed);
+					if ( !anySamplesPassed )
+					{
+						isLastLayerEmpty = true;
+						break; // no more layers, this one is empty as well
+					}
+					numPeeledLayers++;
+				}
+
+				// composite it behind the layers before; the GPU skips it if the layer is empty
+				compShader.addTexture("colorMap", currentFBO->getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT0));
+				compShader.addTexture("normalMap", currentFBO->getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT1));
+				compShader.addTexture("depthMap", currentFBO->getDepthTextureHandle());
+				if ( i == 0 ) { accumulation.render(); } // clears the accumulation buffer
+				else
+				{
+					glBeginConditionalRender(occlusionQueries[i % 2], GL_QUERY_WAIT);
+					accumulation.render();
+					glEndConditionalRender();
+				}
+				accumulation.removeClearBit(GL_COLOR_BUFFER_BIT);
 			}
-			else
+			if ( !isLastLayerEmpty && s_maxLayers > 0 )
 			{
-				depthPeelingShader.addTexture("lastDepth", currentFBO->getDepthTextureHandle() );
+				// last layer: only for the statistics, don't wait for it
+				GLuint available = GL_FALSE;
+				GLuint anySamplesPassed = GL_TRUE;
+				glGetQueryObjectuiv(occlusionQueries[(s_maxLayers - 1) % 2], GL_QUERY_RESULT_AVAILABLE, &available);
+				if ( available ) { glGetQueryObjectuiv(occlusionQueries[(s_maxLayers - 1) % 2], GL_QUERY_RESULT, &anySamplesPassed); }
+				numPeeledLayers += anySamplesPassed ? 1 : 0;
 			}
-			depthPeelingShader.update("peel_level",i);
-
-			depthPeel.setFrameBufferObject(currentFBO);
+			compShader.update("premultiplyAlpha", false);
 
-			// render current fbo
-			depthPeel.render();
+			// accumulated layers over the background
+			glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+			present.render();
 		}
-
-		// render depth peeling compositing
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		for (int i = num_depth_buffers - 1; i >= 0; i--) // render from back to front
+		else
 		{
-			if ( i == num_depth_buffers - 1)
+			for ( int i = 0; i < num_depth_buffers; i++)
 			{
-				compositing.addClearBit(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+				// current fbo to fill
+				FrameBufferObject* currentFBO = depthPeelingBuffers.m_fbos[i];
+			
+				// depth texture from last pass exists
+				if ( i > 0)
+				{
+					FrameBufferObject* beforeFBO = depthPeelingBuffers.m_fbos[i-1];
+					depthPeelingShader.addTexture("lastDepth", beforeFBO->getDepthTextureHandle() );
+				}
+				else
+				{
+					depthPeelingShader.addTexture("lastDepth", currentFBO->getDepthTextureHandle() );
+				}
+				depthPeelingShader.update("peel_level",i);
+
+				depthPeel.setFrameBufferObject(currentFBO);
+
+				// render current fbo
+				depthPeel.render();
 			}
-			else if ( i == num_depth_buffers - 2)
+
+			// render depth peeling compositing
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			for (int i = num_depth_buffers - 1; i >= 0; i--) // render from back to front
 			{
-				compositing.removeClearBit(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+				if ( i == num_depth_buffers - 1)
+				{
+					compositing.addClearBit(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+				}
+				else if ( i == num_depth_buffers - 2)
+				{
+					compositing.removeClearBit(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+				}
+
+				auto buffer = depthPeelingBuffers.m_fbos[i];
+
+				// set texture references, execute compositing
+				compShader.addTexture("colorMap", buffer->getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT0));
+				compShader.addTexture("normalMap", buffer->getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT1));
+				compShader.addTexture("depthMap", buffer->getDepthTextureHandle());
+
+				compositing.render();
 			}
+		}
 
-			auto buffer = depthPeelingBuffers.m_fbos[i];
-
-			// set texture references, execute compositing
-			compShader.addTexture("colorMap", buffer->getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT0));
-			compShader.addTexture("normalMap", buffer->getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT1));
-			compShader.addTexture("positionMap", buffer->getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT2));
+		glEndQuery(GL_TIME_ELAPSED);
+		currentTimerQuery = lastTimerQuery;
 
-			compositing.render();
+		if (s_transparencyEngine == 1)
+		{
+			fragmentLists.updateNodeCount(); // grows the node buffer a few frames late if fragments were dropped, without a stall
 		}
 
 		ImGui::Render();
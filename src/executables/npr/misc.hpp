@@ -1,4 +1,5 @@
 #include <Rendering/FrameBufferObject.h>
+#include <vector>
 
 class DepthPeelingBuffers
 {
@@ -18,5 +19,16 @@ public:
 				m_fbos[i]->addColorAttachments(colorAttachments);
 			}
 		}
-	}	
+	}
+
+	DepthPeelingBuffers(int width, int height, int depthBuffers, const std::vector<FrameBufferObject::AttachmentFormat>& attachmentFormats)
+	{
+		m_fbos.resize(depthBuffers, 0);
+
+		for ( int i = 0; i < depthBuffers; i++)
+		{
+			m_fbos[i] = new FrameBufferObject(width, height);
+			m_fbos[i]->addColorAttachments(attachmentFormats);
+		}
+	}
 };
\ No newline at end of file
@@ -1,12 +1,21 @@
 /*******************************************
  * **** DESCRIPTION ****
+ * Screen space reflections on a G-Buffer, in one of two modes:
+ * 1) billboard: reflection rays are intersected with the analytic plane of the billboard only
+ * 2) Hi-Z: reflection rays are traced through a min-depth pyramid of the depth buffer, so the whole
+ *    visible scene is reflected. Rays are traced at half or full resolution with a limited amount of
+ *    steps and resolved with bilateral upsampling and temporal accumulation.
+ * The G-Buffer is filled either per object or batched (see InstancedScene), the latter also scales
+ * to thousands of markers scattered on the ground.
  ****************************************/
 
 #include <iostream>
+#include <algorithm>
 
 #include <Rendering/GLTools.h>
 #include <Rendering/VertexArrayObjects.h>
 #include <Rendering/RenderPass.h>
+#include <Rendering/InstancedScene.h>
 
 #include "UI/imgui/imgui.h"
 #include <UI/imguiTools.h>
@@ -25,6 +34,17 @@ static glm::vec4 s_lightPos = glm::vec4(2.0,2.0,2.0,1.0);
 
 static float s_strength = 0.5f;
 
+static int 	 s_ssrMode = 1; // active reflection mode
+static const char* s_ssrModeLabels[] = {"Billboard (analytic)", "Hi-Z (scene)"};
+static bool  s_halfResolution = true;  // Hi-Z: trace rays at half resolution
+static int   s_maxIterations = 64;     // Hi-Z: ray budget, traversal steps per ray
+static float s_maxDistance = 3.0f;     // Hi-Z: maximum reflection ray length in view space
+static float s_thickness = 0.1f;       // Hi-Z: assumed thickness of surfaces in view space
+static float s_temporalWeight = 0.8f;  // Hi-Z: weight of the reprojected last frame
+
+static bool  s_batchedSubmission = true; // G-Buffer: single multi draw call instead of one draw call per object
+static int   s_numMarkers = 1000;         // G-Buffer: small cubes scattered on the ground
+
 const glm::vec2 WINDOW_RESOLUTION = glm::vec2(800.0f, 600.0f);
 //////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////// MAIN ///////////////////////////////////////
@@ -81,6 +101,31 @@ int main()
 	modelMatrices[3] = glm::translate( glm::mat4(1.0f), glm::vec3(0.5f, 0.4f,1.1f) ); // sphere 
 	modelMatrices[4] = glm::translate( glm::mat4(1.0f), glm::vec3(-1.0f, 0.5f,-0.5f) ) * glm::rotate(glm::mat4(1.0f), glm::radians(45.0f), glm::vec3(0.0f,1.0,0.0) ); // sphere 
 	glm::mat4 model = modelMatrices[0];
+	int numSceneObjects = (int) objects.size();
+	std::vector<glm::vec4 > sceneColors(numSceneObjects, s_color);
+	DEBUGLOG->outdent();
+
+	// markers
+	Renderable* marker = new Volume( 0.02f );
+	auto markerTransform = [&](int m)
+	{
+		float angle  = (float) m * 2.39996f; // golden angle spiral
+		float radius = 1.4f * std::sqrt( ((float) m + 0.5f) / (float) std::max(s_numMarkers, 1) );
+		return glm::translate( glm::mat4(1.0f), glm::vec3(radius * std::cos(angle), -0.48f, radius * std::sin(angle)) );
+	};
+	auto markerColor = [&](int m)
+	{
+		float hue = (float) m / (float) std::max(s_numMarkers, 1);
+		return glm::vec4( 0.5f + 0.5f * std::cos( 6.2832f * hue ), 0.5f + 0.5f * std::cos( 6.2832f * (hue - 0.333f) ), 0.5f + 0.5f * std::cos( 6.2832f * (hue - 0.667f) ), 1.0f);
+	};
+
+	// batched scene: same objects and markers, merged geometry
+	DEBUGLOG->log("Setup: instanced scene"); DEBUGLOG->indent();
+	InstancedScene instancedScene;
+	std::vector<int> sceneMeshes;
+	for (auto r : objects){ sceneMeshes.push_back( instancedScene.addMesh(r) ); }
+	int markerMesh = instancedScene.addMesh(marker);
+	DEBUGLOG->outdent();
 
 	/////////////////////// 	Renderpasses     ///////////////////////////
 	// regular GBuffer
@@ -92,9 +137,7 @@ int main()
 
 	DEBUGLOG->log("FrameBufferObject Creation: GBuffer"); DEBUGLOG->indent();
 	FrameBufferObject fbo(getResolution(window).x, getResolution(window).y);
-	FrameBufferObject::s_internalFormat  = GL_RGBA32F; // to allow arbitrary values in G-Buffer
-	fbo.addColorAttachments(4); DEBUGLOG->outdent();   // G-Buffer
-	FrameBufferObject::s_internalFormat  = GL_RGBA;	   // restore default
+	fbo.addColorAttachments( FrameBufferObject::getCompactGBufferFormats() ); DEBUGLOG->outdent(); // G-Buffer: color, normal, uv
 
 	DEBUGLOG->log("RenderPass Creation: GBuffer"); DEBUGLOG->indent();
 	RenderPass renderPass(&shaderProgram, &fbo);
@@ -104,17 +147,60 @@ int main()
 	renderPass.addClearBit(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 	for (auto r : objects){renderPass.addRenderable(r);}
 
+	// batched GBuffer
+	DEBUGLOG->log("Shader Compilation: GBuffer instanced"); DEBUGLOG->indent();
+	ShaderProgram instancedShader("/modelSpace/GBufferInstanced.vert", "/modelSpace/GBufferInstanced.frag"); DEBUGLOG->outdent();
+	instancedShader.update("model", glm::mat4(1.0f));
+	instancedShader.update("view", view);
+	instancedShader.update("projection", perspective);
+	instancedShader.addTexture("tex", bbTexture);
+
+	RenderPass batchedRenderPass(&instancedShader, &fbo);
+	batchedRenderPass.addEnable(GL_DEPTH_TEST);
+	batchedRenderPass.setClearColor(0.0,0.0,0.0,0.0);
+	batchedRenderPass.addClearBit(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+	batchedRenderPass.addRenderable(&instancedScene);
+
+	// (re-)create the markers in both submission paths
+	auto updateScene = [&]()
+	{
+		modelMatrices.resize(numSceneObjects);
+		sceneColors.resize(numSceneObjects);
+		renderPass.clearRenderables();
+		instancedScene.clearInstances();
+		for (int i = 0; i < numSceneObjects; i++)
+		{
+			renderPass.addRenderable(objects[i]);
+			instancedScene.addInstance(sceneMeshes[i], modelMatrices[i], sceneColors[i], (i == 2) ? 1.0f : 0.0f ); // billboard is textured
+		}
+		for (int m = 0; m < s_numMarkers; m++)
+		{
+			modelMatrices.push_back( markerTransform(m) );
+			sceneColors.push_back( markerColor(m) );
+			renderPass.addRenderable(marker);
+			instancedScene.addInstance(markerMesh, modelMatrices.back(), sceneColors.back());
+		}
+	};
+	updateScene();
+	double submissionMilliseconds = 0.0;
+
 	// regular GBuffer compositing
 	DEBUGLOG->log("Shader Compilation: GBuffer compositing"); DEBUGLOG->indent();
 	ShaderProgram compShader("/screenSpace/fullscreen.vert", "/screenSpace/finalCompositing.frag"); DEBUGLOG->outdent();
 	// set texture references
 	compShader.addTexture("colorMap", 	 fbo.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT0));
 	compShader.addTexture("normalMap", 	 fbo.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT1));
-	compShader.addTexture("positionMap", fbo.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT2));
+	compShader.addTexture("depthMap",    fbo.getDepthTextureHandle());
+	compShader.update("inverseProjection", glm::inverse(perspective));
+
+	// the lit scene is reflected by the Hi-Z reflections, so it is rendered to a texture
+	DEBUGLOG->log("FrameBufferObject Creation: scene"); DEBUGLOG->indent();
+	FrameBufferObject sceneFBO(getResolution(window).x, getResolution(window).y);
+	sceneFBO.addColorAttachments(1); DEBUGLOG->outdent();
 
 	DEBUGLOG->log("RenderPass Creation: GBuffer Compositing"); DEBUGLOG->indent();
 	Quad quad;
-	RenderPass compositing(&compShader, 0);
+	RenderPass compositing(&compShader, &sceneFBO);
 	compositing.addClearBit(GL_COLOR_BUFFER_BIT);
 	compositing.setClearColor(0.25,0.25,0.35,0.0);
 	// compositing.addEnable(GL_BLEND);
@@ -131,9 +217,10 @@ int main()
 	ssrShader.addTexture("bbTex", bbTexture);
 	ssrShader.addTexture("distortionTex", distortionTex);
 
-	ssrShader.addTexture("positionMap", fbo.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT2));
+	ssrShader.update("inverseProjection", glm::inverse(perspective));
+	ssrShader.addTexture("depthMap",    fbo.getDepthTextureHandle());
 	ssrShader.addTexture("normalMap",   fbo.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT1));
-	ssrShader.addTexture("uvMap", 		fbo.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT3));
+	ssrShader.addTexture("uvMap", 		fbo.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT2));
 
 	DEBUGLOG->log("FrameBufferObject Creation: SSR"); DEBUGLOG->indent();
 	FrameBufferObject ssrFBO(getResolution(window).x, getResolution(window).y);
@@ -155,6 +242,84 @@ int main()
 	simpleTexture.addEnable(GL_BLEND);
 	simpleTexture.addRenderable(&quad);
 
+	///////////////////////    Hi-Z Screen Space Reflections    ///////////////////////////
+	// min-depth pyramid of the G-Buffer depth
+	int width  = (int) getResolution(window).x;
+	int height = (int) getResolution(window).y;
+	int numHiZLevels = 1;
+	while ( (width >> numHiZLevels) > 0 && (height >> numHiZLevels) > 0 ) { numHiZLevels++; }
+
+	GLuint hiZTexture;
+	glGenTextures(1, &hiZTexture);
+	glBindTexture(GL_TEXTURE_2D, hiZTexture);
+	glTexStorage2D(GL_TEXTURE_2D, numHiZLevels, GL_R32F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	DEBUGLOG->log("Shader Compilation: Hi-Z"); DEBUGLOG->indent();
+	ShaderProgram hiZShader("/compute/hiZ.comp"); DEBUGLOG->outdent();
+	hiZShader.addTexture("depth_map", fbo.getDepthTextureHandle());
+	hiZShader.addTexture("hi_z", hiZTexture);
+
+	// ray hits at full and half resolution
+	DEBUGLOG->log("FrameBufferObject Creation: Hi-Z SSR"); DEBUGLOG->indent();
+	FrameBufferObject::s_internalFormat = GL_RGBA32F; // hit uv
+	FrameBufferObject::s_format = GL_RGBA;
+	FrameBufferObject::s_type = GL_FLOAT;
+	FrameBufferObject traceFBOFull(width, height);
+	traceFBOFull.addColorAttachments(1);
+	FrameBufferObject traceFBOHalf(width / 2, height / 2);
+	traceFBOHalf.addColorAttachments(1);
+	FrameBufferObject::s_internalFormat = GL_RGBA16F; // accumulated over several frames
+	FrameBufferObject* historyFBOs[2] = { new FrameBufferObject(width, height), new FrameBufferObject(width, height) };
+	historyFBOs[0]->addColorAttachments(1);
+	historyFBOs[1]->addColorAttachments(1);
+	FrameBufferObject::s_internalFormat = GL_RGBA; // restore default
+	FrameBufferObject::s_type = GL_UNSIGNED_BYTE;
+	DEBUGLOG->outdent();
+
+	DEBUGLOG->log("Shader Compilation: Hi-Z SSR"); DEBUGLOG->indent();
+	ShaderProgram ssrHiZShader("/screenSpace/fullscreen.vert", "/screenSpace/ssrHiZ.frag"); DEBUGLOG->outdent();
+	ssrHiZShader.update("projection", perspective);
+	ssrHiZShader.update("inverseProjection", glm::inverse(perspective));
+	ssrHiZShader.update("uMaxLevel", numHiZLevels - 1);
+	ssrHiZShader.addTexture("normalMap",   fbo.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT1));
+	ssrHiZShader.addTexture("hi_z", hiZTexture);
+
+	RenderPass ssrTrace(&ssrHiZShader, &traceFBOHalf);
+	ssrTrace.setClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	ssrTrace.addClearBit(GL_COLOR_BUFFER_BIT);
+	ssrTrace.addDisable(GL_DEPTH_TEST);
+	ssrTrace.addDisable(GL_BLEND);
+	ssrTrace.addRenderable(&quad);
+
+	DEBUGLOG->log("Shader Compilation: Hi-Z SSR resolve"); DEBUGLOG->indent();
+	ShaderProgram ssrResolveShader("/screenSpace/fullscreen.vert", "/screenSpace/ssrResolve.frag"); DEBUGLOG->outdent();
+	ssrResolveShader.update("projection", perspective);
+	ssrResolveShader.update("inverseProjection", glm::inverse(perspective));
+	ssrResolveShader.addTexture("sceneMap",    sceneFBO.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT0));
+	ssrResolveShader.addTexture("hi_z", hiZTexture);
+
+	RenderPass ssrResolve(&ssrResolveShader, historyFBOs[0]);
+	ssrResolve.setViewport(0, 0, width, height); // the trace pass may have set a lower resolution
+	ssrResolve.addDisable(GL_DEPTH_TEST);
+	ssrResolve.addDisable(GL_BLEND);
+	ssrResolve.addRenderable(&quad);
+
+	int currentHistory = 0;
+	bool historyValid = false;
+	glm::mat4 lastViewRotation(1.0f);
+
+	// GPU time of the reflections, queried one frame late to avoid stalls
+	GLuint timerQueries[2];
+	glGenQueries(2, timerQueries);
+	int currentTimerQuery = 0;
+	bool timerQueryIssued[2] = {false, false};
+	double ssrMilliseconds = 0.0;
+
 	//////////////////////////////////////////////////////////////////////////////
 	///////////////////////    GUI / USER INPUT   ////////////////////////////////
 	//////////////////////////////////////////////////////////////////////////////
@@ -231,9 +396,11 @@ int main()
 	setKeyCallback(window, keyboardCB);
 
 	// model matrices / texture update function
+	int renderableIndex = 0;
 	std::function<void(Renderable*)> perRenderableFunction = [&](Renderable* r){ 
-		static int i = 0;
+		int& i = renderableIndex;
 		shaderProgram.update("model", turntable.getRotationMatrix() * modelMatrices[i]);
+		shaderProgram.update("color", sceneColors[i]);
 		shaderProgram.update("mixTexture", 0.0);
 
 		if (i == 2) // is billboard
@@ -267,6 +434,32 @@ int main()
         ImGui::SliderFloat("strength", &s_strength, 0.0f, 2.0f); // influence of color shift
         
 		ImGui::Checkbox("auto-rotate", &s_isRotating); // enable/disable rotating volume
+
+		int lastSSRMode = s_ssrMode;
+		bool lastHalfResolution = s_halfResolution;
+		ImGui::ListBox("reflections", &s_ssrMode, s_ssrModeLabels, IM_ARRAYSIZE(s_ssrModeLabels), 2);
+		if (s_ssrMode == 1)
+		{
+			ImGui::Checkbox("half resolution", &s_halfResolution);
+			ImGui::SliderInt("max iterations", &s_maxIterations, 4, 256); // ray budget
+			ImGui::SliderFloat("max distance", &s_maxDistance, 0.1f, 10.0f);
+			ImGui::SliderFloat("thickness", &s_thickness, 0.001f, 1.0f);
+			ImGui::SliderFloat("temporal weight", &s_temporalWeight, 0.0f, 0.95f);
+		}
+		ImGui::Text("reflections: %.2f ms", ssrMilliseconds);
+
+		int lastNumMarkers = s_numMarkers;
+		ImGui::Checkbox("batched submission", &s_batchedSubmission);
+		ImGui::SliderInt("markers", &s_numMarkers, 0, 20000);
+		ImGui::Text("G-Buffer: %.2f ms CPU, %d draw calls", submissionMilliseconds, s_batchedSubmission ? 1 : (int) modelMatrices.size());
+		if (s_numMarkers != lastNumMarkers)
+		{
+			updateScene();
+		}
+		if (s_ssrMode != lastSSRMode || s_halfResolution != lastHalfResolution)
+		{
+			historyValid = false;
+		}
 		ImGui::PopItemWidth();
 
         //////////////////////////////////////////////////////////////////////////////
@@ -282,23 +475,111 @@ int main()
 				
 		////////////////////////  SHADER / UNIFORM UPDATING //////////////////////////
 		// update view related uniforms
-		shaderProgram.update( "color", s_color);
 		shaderProgram.update( "view", view);
+		instancedShader.update( "view", view);
+		instancedShader.update( "model", turntable.getRotationMatrix() );
+		if (sceneColors[0] != s_color)
+		{
+			for (int i = 0; i < numSceneObjects; i++)
+			{
+				sceneColors[i] = s_color;
+				instancedScene.setInstance(i, modelMatrices[i], s_color, (i == 2) ? 1.0f : 0.0f );
+			}
+		}
 		ssrShader.update( "view", view);
 		ssrShader.update( "strength", s_strength);
 		ssrShader.update("bbModel", turntable.getRotationMatrix() * modelMatrices[2]);
 
 		compShader.update("vLightPos", view * turntable.getRotationMatrix() * s_lightPos);
+
+		glm::mat4 viewRotation = view * turntable.getRotationMatrix(); // all objects are rotated by the turntable
+		ssrHiZShader.update("uMaxIterations", s_maxIterations);
+		ssrHiZShader.update("uMaxDistance", s_maxDistance);
+		ssrHiZShader.update("uThickness", s_thickness);
+		ssrResolveShader.update("uReprojection", perspective * lastViewRotation * glm::inverse(viewRotation));
+		ssrResolveShader.update("uTemporalWeight", s_temporalWeight);
+		ssrResolveShader.update("uHistoryValid", historyValid ? 1 : 0);
 		//////////////////////////////////////////////////////////////////////////////
 		
 		////////////////////////////////  RENDERING //// /////////////////////////////
-		renderPass.render();
+		double submissionStart = glfwGetTime();
+		if (s_batchedSubmission)
+		{
+			batchedRenderPass.render();
+		}
+		else
+		{
+			renderableIndex = 0;
+			renderPass.render();
+		}
+		submissionMilliseconds = (glfwGetTime() - submissionStart) * 1000.0;
 
 		compositing.render();
 
-		ssrRenderPass.render();
+		// present the lit scene
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFBO.getFramebufferHandle());
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glBlitFramebuffer(0, 0, sceneFBO.getWidth(), sceneFBO.getHeight(), 0, 0, sceneFBO.getWidth(), sceneFBO.getHeight(), GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		// result of the query issued last frame
+		int lastTimerQuery = 1 - currentTimerQuery;
+		if ( timerQueryIssued[lastTimerQuery] )
+		{
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(timerQueries[lastTimerQuery], GL_QUERY_RESULT, &nanoseconds);
+			ssrMilliseconds = (double) nanoseconds / 1.0e6;
+		}
+		glBeginQuery(GL_TIME_ELAPSED, timerQueries[currentTimerQuery]);
+		timerQueryIssued[currentTimerQuery] = true;
+
+		if (s_ssrMode == 0)
+		{
+			ssrRenderPass.render();
+
+			texShader.addTexture("tex", ssrFBO.getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT0) );
+			texShader.update("transparency", 0.0f);
+			simpleTexture.render();
+		}
+		else
+		{
+			// build the min-depth pyramid, level by level
+			for (int level = 0; level < numHiZLevels; level++)
+			{
+				int levelWidth  = std::max(1, width >> level);
+				int levelHeight = std::max(1, height >> level);
+				glBindImageTexture(0, hiZTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+				hiZShader.update("uLevel", level);
+				hiZShader.dispatch( (levelWidth + 7) / 8, (levelHeight + 7) / 8 );
+				glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+			}
+
+			// trace rays
+			FrameBufferObject* traceFBO = s_halfResolution ? &traceFBOHalf : &traceFBOFull;
+			ssrTrace.setFrameBufferObject(traceFBO);
+			ssrTrace.setViewport(0, 0, traceFBO->getWidth(), traceFBO->getHeight());
+			ssrTrace.render();
+
+			// upsample and accumulate
+			FrameBufferObject* historyFBO = historyFBOs[currentHistory];
+			ssrResolveShader.addTexture("traceMap", traceFBO->getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT0));
+			ssrResolveShader.addTexture("historyMap", historyFBOs[1 - currentHistory]->getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT0));
+			ssrResolveShader.update("uTraceLevel", s_halfResolution ? 1 : 0);
+			ssrResolve.setFrameBufferObject(historyFBO);
+			ssrResolve.render();
+
+			// confidence as alpha, scaled by strength
+			texShader.addTexture("tex", historyFBO->getColorAttachmentTextureHandle(GL_COLOR_ATTACHMENT0) );
+			texShader.update("transparency", 1.0f - std::min(s_strength, 1.0f));
+			simpleTexture.render();
+
+			currentHistory = 1 - currentHistory;
+			historyValid = true;
+		}
+		lastViewRotation = viewRotation;
 
-		simpleTexture.render();
+		glEndQuery(GL_TIME_ELAPSED);
+		currentTimerQuery = lastTimerQuery;
 
 		ImGui::Render();
 		glDisable(GL_BLEND);
@@ -0,0 +1,289 @@
+/*******************************************
+ * **** DESCRIPTION ****
+ * This program is a minimal thin client of the frame streaming server of interactive_MIP
+ * (see the "Streaming" section there): it connects over TCP or a Unix domain socket,
+ * displays the received frames and sends mouse and keyboard input back as camera and parameter messages.
+ *
+ * Frames arrive as tile deltas against the previous frame (see Core/FrameStream.h). Every displayed frame is
+ * acknowledged; the server measures the latency from its readback to the acknowledgement and lowers the
+ * streamed resolution whenever a frame exceeds the latency budget given here. Frames smaller than the
+ * window are scaled up, keeping the aspect ratio.
+ *
+ * USAGE
+ * stream_client [--host name] [--port N] [--unix path] [--budget milliseconds]
+ *
+ * CONTROLS
+ * left drag: rotate, W/A/S/D: move, P: next projection, I: toggle isosurface, R: toggle rotation,
+ * up/down: shift the window, left/right: narrow/widen the window, +/-: iso value, [/]: latency budget
+ ****************************************/
+
+#include <iostream>
+#include <cstdlib>
+
+#include <Rendering/GLTools.h>
+
+#include <Core/MessageChannel.h>
+#include <Core/FrameStream.h>
+
+////////////////////// PARAMETERS /////////////////////////////
+static std::string s_host = "127.0.0.1";
+static int s_port = 4000;                 // default port of interactive_MIP
+static std::string s_unixPath = "";       // connect to a Unix domain socket instead, if set
+static float s_latencyBudget = 50.0f;     // milliseconds from the server's readback to the acknowledgement
+
+void parseArguments(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = (i + 1 < argc);
+		if      (arg == "--host"   && hasValue) { s_host = argv[++i]; }
+		else if (arg == "--port"   && hasValue) { s_port = std::atoi(argv[++i]); }
+		else if (arg == "--unix"   && hasValue) { s_unixPath = argv[++i]; }
+		else if (arg == "--budget" && hasValue) { s_latencyBudget = std::max(1.0f, (float) std::atof(argv[++i])); }
+		else
+		{
+			DEBUGLOG->log("unknown argument: " + arg);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+///////////////////////////////// MAIN ///////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+	DEBUGLOG->setAutoPrint(true);
+	parseArguments(argc, argv);
+
+	auto window = generateWindow(800, 600);
+
+	MessageChannel channel;
+	channel.setOnReceive( []() { invalidateFrame(); } ); // frames arrive on the network thread
+	bool connected = s_unixPath.empty() ? channel.connect(s_host, s_port) : channel.connectUnix(s_unixPath);
+	if ( !connected )
+	{
+		destroyWindow(window);
+		return 1;
+	}
+
+	// decoded frames are uploaded to a texture and blitted to the window
+	GLuint frameTexture;
+	glGenTextures(1, &frameTexture);
+	glBindTexture(GL_TEXTURE_2D, frameTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	GLuint frameFramebuffer;
+	glGenFramebuffers(1, &frameFramebuffer);
+	int textureWidth = 0;
+	int textureHeight = 0;
+
+	FrameStream::TileDeltaDecoder decoder;
+	FrameStream::FrameHeader lastHeader = FrameStream::FrameHeader();
+	FrameStream::StateMessage state = FrameStream::StateMessage();
+	bool hasState = false;
+	size_t lastFrameBytes = 0;
+	int numFrames = 0;
+	int numFramesPerSecond = 0;
+	double secondStart = glfwGetTime();
+
+	//////////////////////////////////////////////////////////////////////////////
+	///////////////////////    GUI / USER INPUT   ////////////////////////////////
+	//////////////////////////////////////////////////////////////////////////////
+
+	glm::ivec2 sentViewport(0);
+	float sentBudget = 0.0f;
+	auto sendViewport = [&]()
+	{
+		glm::ivec2 viewport = glm::ivec2( getResolution(window) );
+		if ( viewport != sentViewport || s_latencyBudget != sentBudget )
+		{
+			FrameStream::ViewportMessage message = { viewport.x, viewport.y, s_latencyBudget };
+			channel.send(FrameStream::VIEWPORT, &message, sizeof(message));
+			sentViewport = viewport;
+			sentBudget = s_latencyBudget;
+		}
+	};
+
+	auto sendCamera = [&](float dragX, float dragY, float moveX, float moveY, float moveZ)
+	{
+		FrameStream::CameraMessage message = { dragX, dragY, moveX, moveY, moveZ };
+		channel.send(FrameStream::CAMERA, &message, sizeof(message));
+	};
+
+	auto sendParameter = [&](FrameStream::Parameter parameter, float value)
+	{
+		if ( !hasState ) { return; } // changes are relative to the server's state
+		FrameStream::ParameterMessage message = { (unsigned int) parameter, value };
+		channel.send(FrameStream::PARAMETER, &message, sizeof(message));
+	};
+
+	bool dragActive = false;
+	double old_x;
+	double old_y;
+	glfwGetCursorPos(window, &old_x, &old_y);
+
+	auto cursorPosCB = [&](double x, double y)
+	{
+		if ( dragActive )
+		{
+			sendCamera( (float) (x - old_x), (float) (y - old_y), 0.0f, 0.0f, 0.0f );
+		}
+		old_x = x;
+		old_y = y;
+	};
+
+	auto mouseButtonCB = [&](int b, int a, int /*m*/)
+	{
+		if (b == GLFW_MOUSE_BUTTON_LEFT)
+		{
+			dragActive = (a == GLFW_PRESS);
+		}
+	};
+
+	auto keyboardCB = [&](int k, int /*s*/, int a, int /*m*/)
+	{
+		if (a == GLFW_RELEASE) {return;}
+		float valueStep = hasState ? (state.valueMax - state.valueMin) * 0.02f : 0.0f;
+		switch (k)
+		{
+			case GLFW_KEY_W: sendCamera(0.0f, 0.0f,  0.0f, 0.0f, -0.1f); break;
+			case GLFW_KEY_A: sendCamera(0.0f, 0.0f, -0.1f, 0.0f,  0.0f); break;
+			case GLFW_KEY_S: sendCamera(0.0f, 0.0f,  0.0f, 0.0f,  0.1f); break;
+			case GLFW_KEY_D: sendCamera(0.0f, 0.0f,  0.1f, 0.0f,  0.0f); break;
+			case GLFW_KEY_P: sendParameter(FrameStream::PROJECTION,  (float) ( (state.projection + 1) % 3 )); break;
+			case GLFW_KEY_I: sendParameter(FrameStream::RENDER_MODE, (float) ( 1 - state.renderMode )); break;
+			case GLFW_KEY_R: sendParameter(FrameStream::ROTATING,    (float) ( 1 - state.rotating )); break;
+			case GLFW_KEY_UP:
+				sendParameter(FrameStream::WINDOW_MIN, state.windowMin + valueStep);
+				sendParameter(FrameStream::WINDOW_MAX, state.windowMax + valueStep);
+				break;
+			case GLFW_KEY_DOWN:
+				sendParameter(FrameStream::WINDOW_MIN, state.windowMin - valueStep);
+				sendParameter(FrameStream::WINDOW_MAX, state.windowMax - valueStep);
+				break;
+			case GLFW_KEY_LEFT:
+				sendParameter(FrameStream::WINDOW_MIN, state.windowMin + valueStep);
+				sendParameter(FrameStream::WINDOW_MAX, state.windowMax - valueStep);
+				break;
+			case GLFW_KEY_RIGHT:
+				sendParameter(FrameStream::WINDOW_MIN, state.windowMin - valueStep);
+				sendParameter(FrameStream::WINDOW_MAX, state.windowMax + valueStep);
+				break;
+			case GLFW_KEY_KP_ADD:
+			case GLFW_KEY_EQUAL:        sendParameter(FrameStream::ISO_VALUE, state.isoValue + valueStep); break;
+			case GLFW_KEY_KP_SUBTRACT:
+			case GLFW_KEY_MINUS:        sendParameter(FrameStream::ISO_VALUE, state.isoValue - valueStep); break;
+			case GLFW_KEY_LEFT_BRACKET:  s_latencyBudget = std::max(5.0f, s_latencyBudget - 5.0f); break;
+			case GLFW_KEY_RIGHT_BRACKET: s_latencyBudget += 5.0f; break;
+			default:
+				break;
+		}
+	};
+
+	setCursorPosCallback(window, cursorPosCB);
+	setMouseButtonCallback(window, mouseButtonCB);
+	setKeyCallback(window, keyboardCB);
+
+	//////////////////////////////////////////////////////////////////////////////
+	//////////////////////////////// RENDER LOOP /////////////////////////////////
+	//////////////////////////////////////////////////////////////////////////////
+
+	renderOnDemand(window, [&](double /*dt*/)
+	{
+		sendViewport();
+
+		MessageChannel::Message message;
+		while ( channel.receive(message) )
+		{
+			if ( message.type == FrameStream::STATE && message.payload.size() == sizeof(FrameStream::StateMessage) )
+			{
+				state = *( (const FrameStream::StateMessage*) &message.payload[0] );
+				hasState = true;
+			}
+			else if ( message.type == FrameStream::FRAME )
+			{
+				FrameStream::FrameHeader header;
+				if ( !decoder.decode(message.payload, header) )
+				{
+					DEBUGLOG->log("could not decode frame ", (int) header.frameId);
+					continue;
+				}
+
+				glBindTexture(GL_TEXTURE_2D, frameTexture);
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+				if ( decoder.getWidth() != textureWidth || decoder.getHeight() != textureHeight )
+				{
+					textureWidth = decoder.getWidth();
+					textureHeight = decoder.getHeight();
+					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, textureWidth, textureHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, &decoder.getPixels()[0]);
+					glBindFramebuffer(GL_READ_FRAMEBUFFER, frameFramebuffer);
+					glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frameTexture, 0);
+					glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+				}
+				else
+				{
+					glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, textureWidth, textureHeight, GL_RGBA, GL_UNSIGNED_BYTE, &decoder.getPixels()[0]);
+				}
+				glBindTexture(GL_TEXTURE_2D, 0);
+
+				// displayed with the next swap
+				FrameStream::AckMessage ack = { header.frameId };
+				channel.send(FrameStream::ACK, &ack, sizeof(ack));
+
+				lastHeader = header;
+				lastFrameBytes = message.payload.size();
+				numFrames++;
+			}
+		}
+
+		if ( glfwGetTime() - secondStart >= 1.0 )
+		{
+			numFramesPerSecond = numFrames;
+			numFrames = 0;
+			secondStart = glfwGetTime();
+		}
+
+		std::string window_header = "Stream Client - ";
+		if ( channel.isConnected() )
+		{
+			window_header += std::to_string(lastHeader.width) + "x" + std::to_string(lastHeader.height)
+				+ " (scale " + std::to_string(lastHeader.scale).substr(0, 4) + "), "
+				+ std::to_string( (int) lastHeader.latency ) + "/" + std::to_string( (int) s_latencyBudget ) + " ms latency, "
+				+ std::to_string(lastHeader.numTiles) + " tiles, "
+				+ std::to_string( (int) (lastFrameBytes / 1024) ) + " KB, "
+				+ std::to_string(numFramesPerSecond) + " FPS";
+		}
+		else
+		{
+			window_header += "disconnected";
+		}
+		glfwSetWindowTitle(window, window_header.c_str() );
+
+		// fit the frame into the window
+		glm::vec2 resolution = getResolution(window);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		if ( textureWidth > 0 )
+		{
+			float fit = std::min(resolution.x / (float) textureWidth, resolution.y / (float) textureHeight);
+			int width  = (int) ( (float) textureWidth  * fit );
+			int height = (int) ( (float) textureHeight * fit );
+			int x = ( (int) resolution.x - width ) / 2;
+			int y = ( (int) resolution.y - height ) / 2;
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, frameFramebuffer);
+			glBlitFramebuffer(0, 0, textureWidth, textureHeight, x, y, x + width, y + height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		}
+	});
+
+	channel.close();
+	glDeleteFramebuffers(1, &frameFramebuffer);
+	glDeleteTextures(1, &frameTexture);
+	destroyWindow(window);
+
+	return 0;
+}
@@ -0,0 +1,177 @@
+#include "Benchmark.h"
+
+#include "DebugLog.h"
+
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+namespace {
+	std::string escapeJSON(const std::string& str)
+	{
+		std::string result;
+		for (unsigned int i = 0; i < str.size(); i++)
+		{
+			switch (str[i])
+			{
+			case '"':  result += "\\\""; break;
+			case '\\': result += "\\\\"; break;
+			case '\n': result += "\\n";  break;
+			case '\t': result += "\\t";  break;
+			default:   result += str[i]; break;
+			}
+		}
+		return result;
+	}
+}
+
+Benchmark::Benchmark()
+{
+}
+
+Benchmark::~Benchmark()
+{
+}
+
+double Benchmark::computePercentile(std::vector<double> values, double percentile)
+{
+	if (values.empty())
+	{
+		return 0.0;
+	}
+	std::sort(values.begin(), values.end());
+
+	double position = (percentile / 100.0) * (double) (values.size() - 1);
+	size_t lower = (size_t) position;
+	size_t upper = std::min(lower + 1, values.size() - 1);
+	double fraction = position - (double) lower;
+
+	return values[lower] + fraction * (values[upper] - values[lower]);
+}
+
+const BenchmarkResult& Benchmark::run(const std::string& name, int warmup, int iterations, std::function<void()> func, double workPerIteration, const std::string& workUnit)
+{
+	DEBUGLOG->log("Benchmark: " + name);
+
+	for (int i = 0; i < warmup; i++)
+	{
+		func();
+	}
+
+	std::vector<double> milliseconds;
+	for (int i = 0; i < iterations; i++)
+	{
+		std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+		func();
+		milliseconds.push_back( std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - startTime ).count() );
+	}
+
+	return addResult(name, milliseconds, workPerIteration, workUnit);
+}
+
+const BenchmarkResult& Benchmark::addResult(const std::string& name, const std::vector<double>& milliseconds, double workPerIteration, const std::string& workUnit)
+{
+	BenchmarkResult result;
+	result.name = name;
+	result.iterations = (int) milliseconds.size();
+	result.medianMilliseconds = computePercentile(milliseconds, 50.0);
+	result.p95Milliseconds    = computePercentile(milliseconds, 95.0);
+	result.meanMilliseconds = milliseconds.empty() ? 0.0 : std::accumulate(milliseconds.begin(), milliseconds.end(), 0.0) / (double) milliseconds.size();
+	result.minMilliseconds  = milliseconds.empty() ? 0.0 : *std::min_element(milliseconds.begin(), milliseconds.end());
+	result.maxMilliseconds  = milliseconds.empty() ? 0.0 : *std::max_element(milliseconds.begin(), milliseconds.end());
+	result.workPerIteration = workPerIteration;
+	result.workUnit = workUnit;
+	result.throughput = (result.medianMilliseconds > 0.0) ? workPerIteration / (result.medianMilliseconds / 1000.0) : 0.0;
+
+	m_results.push_back(result);
+	return m_results.back();
+}
+
+void Benchmark::addConfig(const std::string& key, const std::string& value)
+{
+	m_config.push_back( std::make_pair(key, "\"" + escapeJSON(value) + "\"") );
+}
+
+void Benchmark::addConfig(const std::string& key, double value)
+{
+	std::stringstream ss;
+	ss << std::setprecision(10) << value;
+	m_config.push_back( std::make_pair(key, ss.str()) );
+}
+
+const std::vector<BenchmarkResult>& Benchmark::getResults() const
+{
+	return m_results;
+}
+
+std::string Benchmark::toJSON() const
+{
+	std::stringstream ss;
+	ss << std::setprecision(10);
+	ss << "{\n";
+
+	ss << "  \"config\": {";
+	for (unsigned int i = 0; i < m_config.size(); i++)
+	{
+		ss << (i == 0 ? "\n" : ",\n");
+		ss << "    \"" << escapeJSON(m_config[i].first) << "\": " << m_config[i].second;
+	}
+	ss << (m_config.empty() ? "},\n" : "\n  },\n");
+
+	ss << "  \"benchmarks\": [";
+	for (unsigned int i = 0; i < m_results.size(); i++)
+	{
+		const BenchmarkResult& r = m_results[i];
+		ss << (i == 0 ? "\n" : ",\n");
+		ss << "    {\n";
+		ss << "      \"name\": \"" << escapeJSON(r.name) << "\",\n";
+		ss << "      \"iterations\": " << r.iterations << ",\n";
+		ss << "      \"median_ms\": " << r.medianMilliseconds << ",\n";
+		ss << "      \"p95_ms\": " << r.p95Milliseconds << ",\n";
+		ss << "      \"mean_ms\": " << r.meanMilliseconds << ",\n";
+		ss << "      \"min_ms\": " << r.minMilliseconds << ",\n";
+		ss << "      \"max_ms\": " << r.maxMilliseconds << ",\n";
+		ss << "      \"work_per_iteration\": " << r.workPerIteration << ",\n";
+		ss << "      \"throughput\": " << r.throughput << ",\n";
+		ss << "      \"throughput_unit\": \"" << escapeJSON(r.workUnit.empty() ? "" : r.workUnit + "/s") << "\"\n";
+		ss << "    }";
+	}
+	ss << (m_results.empty() ? "]\n" : "\n  ]\n");
+
+	ss << "}\n";
+	return ss.str();
+}
+
+bool Benchmark::writeJSON(const std::string& path) const
+{
+	std::ofstream file(path.c_str());
+	if ( !file.is_open() )
+	{
+		DEBUGLOG_ERROR("could not write benchmark results to " + path);
+		return false;
+	}
+	file << toJSON();
+	return true;
+}
+
+void Benchmark::print() const
+{
+	DEBUGLOG->log("Benchmark results:");
+	DEBUGLOG->indent();
+	for (unsigned int i = 0; i < m_results.size(); i++)
+	{
+		const BenchmarkResult& r = m_results[i];
+		std::stringstream ss;
+		ss << std::fixed << std::setprecision(3);
+		ss << r.name << ": median " << r.medianMilliseconds << " ms, p95 " << r.p95Milliseconds << " ms";
+		if ( !r.workUnit.empty() )
+		{
+			ss << std::scientific << std::setprecision(3) << ", " << r.throughput << " " << r.workUnit << "/s";
+		}
+		DEBUGLOG->log(ss.str());
+	}
+	DEBUGLOG->outdent();
+}
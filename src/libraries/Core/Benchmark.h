@@ -0,0 +1,71 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <vector>
+#include <string>
+#include <functional>
+
+/**
+ * @brief statistics of a timed benchmark
+ */
+struct BenchmarkResult
+{
+	std::string name;
+	int iterations;
+
+	double medianMilliseconds;
+	double p95Milliseconds;
+	double meanMilliseconds;
+	double minMilliseconds;
+	double maxMilliseconds;
+
+	double workPerIteration; //!< e.g. bytes or samples processed per iteration
+	std::string workUnit;    //!< unit of the work, throughput is reported as workUnit/s
+	double throughput;       //!< workPerIteration per median iteration time, in workUnit/s
+};
+
+/**
+ * @brief run warmed-up, timed iterations of a function and collect the results as JSON
+ */
+class Benchmark
+{
+protected:
+	std::vector<BenchmarkResult> m_results;
+	std::vector< std::pair<std::string, std::string> > m_config; //!< (key, json value) pairs
+
+public:
+	Benchmark();
+	~Benchmark();
+
+	/**
+	 * @brief time a function
+	 *
+	 * @param name of the benchmark
+	 * @param warmup iterations which are executed but not timed
+	 * @param iterations timed iterations
+	 * @param func to be timed; must return only after the work is finished (e.g. call glFinish)
+	 * @param workPerIteration amount of work done by a single call of func
+	 * @param workUnit unit of the work
+	 * @return statistics, also stored for the report
+	 */
+	const BenchmarkResult& run(const std::string& name, int warmup, int iterations, std::function<void()> func, double workPerIteration = 0.0, const std::string& workUnit = "");
+
+	/**
+	 * @brief compute statistics from externally measured times
+	 */
+	const BenchmarkResult& addResult(const std::string& name, const std::vector<double>& milliseconds, double workPerIteration = 0.0, const std::string& workUnit = "");
+
+	void addConfig(const std::string& key, const std::string& value);
+	void addConfig(const std::string& key, double value);
+
+	const std::vector<BenchmarkResult>& getResults() const;
+
+	std::string toJSON() const;
+	bool writeJSON(const std::string& path) const;
+
+	void print() const; //!< print a summary to the DebugLog
+
+	static double computePercentile(std::vector<double> values, double percentile); //!< percentile in [0,100], linearly interpolated
+};
+
+#endif
@@ -1,86 +1,302 @@
+
 #include "DebugLog.h"
 
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+
+static std::atomic<DebugLog*> g_debugLog(0); // the instance to shut down at exit, if still alive
+
 DebugLog::DebugLog(bool autoPrint)
+	: m_head(0),
+	m_tail(0),
+	m_consumed(0),
+	m_numDropped(0),
+	m_running(false),
+	m_indent(0),
+	m_autoPrint(autoPrint),
+	m_level(DEBUGLOG_MAX_LEVEL)
 {
-	m_autoPrint = autoPrint;
-	m_indent = 0;
+	m_ring = new Slot[s_ringSize];
+	for (unsigned int i = 0; i < s_ringSize; i++)
+	{
+		m_ring[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	m_running = true;
+	m_writer = std::thread( [this]() { runWriter(); } );
+	g_debugLog = this;
+	std::atexit(&DebugLog::shutdownAtExit); // write what is left in the ring
 }
 
 
 DebugLog::~DebugLog()
 {
+	g_debugLog = 0;
+	shutdown();
+	delete[] m_ring;
 	clear();
 }
 
+void DebugLog::shutdownAtExit()
+{
+	DebugLog* debugLog = g_debugLog.load();
+	if ( debugLog ) { debugLog->shutdown(); }
+}
 
-void DebugLog::log(std::string msg)
+void DebugLog::shutdown()
 {
-	m_log.push_back( createIndent() +  msg );
-	if (m_autoPrint)
+	if ( m_running.exchange(false) )
 	{
-		printLast();
+		{
+			std::lock_guard<std::mutex> lock(m_wakeMutex);
+		}
+		m_wake.notify_one();
+		m_writer.join();
 	}
 }
 
-void DebugLog::log(std::string msg, bool value)
+
+void DebugLog::log(Level level, const std::string& msg)
 {
-	std::stringstream ss;
-	if ( value )
+	if ( !isEnabled(level) ) { return; }
+	int indent = m_indent.load(std::memory_order_relaxed);
+
+	if ( !m_running.load() ) // after shutdown
 	{
-		ss<< "TRUE";
+		write(level, indent, msg);
+		return;
 	}
-	else
+
+	size_t numSlots = std::max( (size_t) 1, (msg.size() + s_slotLength - 1) / s_slotLength );
+	numSlots = std::min( numSlots, (size_t) s_maxSlotsPerMessage );
+
+	// claim consecutive slots: slots are consumed in order, so they are all free if the last one is
+	size_t position = m_head.load(std::memory_order_relaxed);
+	for (;;)
 	{
-		ss<< "FALSE";
+		size_t last = position + numSlots - 1;
+		size_t sequence = m_ring[last & (s_ringSize - 1)].sequence.load(std::memory_order_acquire);
+		std::ptrdiff_t difference = (std::ptrdiff_t) sequence - (std::ptrdiff_t) last;
+		if ( difference == 0 )
+		{
+			if ( m_head.compare_exchange_weak(position, position + numSlots, std::memory_order_relaxed) ) { break; }
+		}
+		else if ( difference < 0 )
+		{
+			m_numDropped.fetch_add(1, std::memory_order_relaxed); // full: never wait for the writer
+			return;
+		}
+		else
+		{
+			position = m_head.load(std::memory_order_relaxed); // claimed by another thread meanwhile
+		}
 	}
-	log(msg + ss.str());
+
+	for (size_t i = 0; i < numSlots; i++)
+	{
+		Slot& slot = m_ring[(position + i) & (s_ringSize - 1)];
+		size_t offset = i * s_slotLength;
+		size_t length = std::min( (size_t) s_slotLength, msg.size() - std::min(offset, msg.size()) );
+		slot.level = level;
+		slot.indent = indent;
+		slot.continued = (i + 1 < numSlots);
+		slot.length = (unsigned int) length;
+		if ( length > 0 ) { std::memcpy(slot.text, msg.data() + offset, length); }
+		slot.sequence.store(position + i + 1, std::memory_order_release);
+	}
+
+	// shutdown() may have stopped the writer after it checked m_running above, and its last drain() may
+	// have missed these slots: then they are drained here. The fences make one of both see the other.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if ( !m_running.load() )
+	{
+		std::lock_guard<std::mutex> lock(m_drainMutex);
+		drain();
+		return;
+	}
+	m_wake.notify_one();
+}
+
+void DebugLog::log(std::string msg)
+{
+	log(LEVEL_INFO, msg);
+}
+
+void DebugLog::log(std::string msg, bool value)
+{
+	log(LEVEL_INFO, msg, value);
 }
 
 void DebugLog::log(std::string msg, int value)
+{
+	log(LEVEL_INFO, msg, value);
+}
+
+void DebugLog::log(std::string msg, unsigned int value)
+{
+	log(LEVEL_INFO, msg, value);
+}
+
+void DebugLog::log(std::string msg, const glm::vec3& vector)
+{
+	log(LEVEL_INFO, msg, vector);
+}
+
+void DebugLog::log(std::string msg, const glm::vec4& vector)
+{
+	log(LEVEL_INFO, msg, vector);
+}
+
+void DebugLog::log(std::string msg, float value)
+{
+	log(LEVEL_INFO, msg, value);
+}
+
+void DebugLog::log(std::string msg, double value)
+{
+	log(LEVEL_INFO, msg, value);
+}
+
+std::string DebugLog::toString(bool value)
+{
+	return value ? "TRUE" : "FALSE";
+}
+
+std::string DebugLog::toString(int value)
 {
 	std::stringstream ss;
 	ss << value;
-	log(msg + ss.str());
+	return ss.str();
 }
 
-void DebugLog::log(std::string msg, unsigned int value)
+std::string DebugLog::toString(unsigned int value)
 {
 	std::stringstream ss;
 	ss << value;
-	log(msg + ss.str());
+	return ss.str();
 }
 
-void DebugLog::log(std::string msg, const glm::vec3& vector)
+std::string DebugLog::toString(float value)
+{
+	std::stringstream ss;
+	ss << value;
+	return ss.str();
+}
+
+std::string DebugLog::toString(double value)
+{
+	std::stringstream ss;
+	ss << value;
+	return ss.str();
+}
+
+std::string DebugLog::toString(const glm::vec3& vector)
 {
 	std::stringstream ss;
 	ss << vector.x << ", ";
 	ss << vector.y << ", ";
 	ss << vector.z;
-	log(msg + ss.str());
+	return ss.str();
 }
 
-void DebugLog::log(std::string msg, const glm::vec4& vector)
+std::string DebugLog::toString(const glm::vec4& vector)
 {
 	std::stringstream ss;
 	ss << vector.x << ", ";
 	ss << vector.y << ", ";
 	ss << vector.z << ", ";
 	ss << vector.w;
-	log(msg + ss.str());
+	return ss.str();
 }
 
-void DebugLog::log(std::string msg, float value)
+void DebugLog::write(Level level, int indent, const std::string& msg)
 {
-	std::stringstream ss;
-	ss << value;
-	log(msg + ss.str());
+	std::string line = createIndent(indent);
+	if ( level == LEVEL_ERROR )   { line += "ERROR: "; }
+	if ( level == LEVEL_WARNING ) { line += "WARNING: "; }
+	line += msg;
+
+	std::lock_guard<std::mutex> lock(m_historyMutex);
+	if ( m_autoPrint.load() )
+	{
+		std::cout << line << '\n';
+	}
+	m_history.push_back(line);
+	if ( m_history.size() > s_historySize )
+	{
+		m_history.pop_front();
+	}
 }
 
-void DebugLog::log(std::string msg, double value)
+bool DebugLog::drain()
 {
-	std::stringstream ss;
-	ss << value;
-	log(msg + ss.str());
+	bool consumed = false;
+	for (;;)
+	{
+		Slot& slot = m_ring[m_tail & (s_ringSize - 1)];
+		if ( slot.sequence.load(std::memory_order_acquire) != m_tail + 1 )
+		{
+			break; // not written yet
+		}
+
+		m_pending.append(slot.text, slot.length);
+		Level level = slot.level;
+		int indent = slot.indent;
+		bool continued = slot.continued;
+		slot.sequence.store(m_tail + s_ringSize, std::memory_order_release);
+		m_tail++;
+		consumed = true;
+
+		if ( !continued )
+		{
+			write(level, indent, m_pending);
+			m_pending.clear();
+			m_consumed.store(m_tail, std::memory_order_release);
+		}
+	}
+
+	unsigned int numDropped = m_numDropped.exchange(0);
+	if ( numDropped > 0 )
+	{
+		write(LEVEL_WARNING, 0, "DebugLog: " + toString(numDropped) + " messages dropped, the log buffer was full");
+	}
+	if ( consumed && m_autoPrint.load() )
+	{
+		std::cout.flush();
+	}
+	return consumed;
+}
+
+void DebugLog::runWriter()
+{
+	while ( m_running.load() )
+	{
+		bool consumed;
+		{
+			std::lock_guard<std::mutex> lock(m_drainMutex);
+			consumed = drain();
+		}
+		if ( !consumed )
+		{
+			// producers notify without locking, so a wakeup may be missed: the timeout bounds the delay
+			std::unique_lock<std::mutex> lock(m_wakeMutex);
+			m_wake.wait_for(lock, std::chrono::milliseconds(10));
+		}
+	}
+	std::atomic_thread_fence(std::memory_order_seq_cst); // see log()
+	std::lock_guard<std::mutex> lock(m_drainMutex);
+	drain(); // written before the shutdown
+}
+
+void DebugLog::flush() const
+{
+	size_t target = m_head.load();
+	while ( m_running.load() && m_consumed.load(std::memory_order_acquire) < target )
+	{
+		m_wake.notify_one();
+		std::this_thread::yield();
+	}
 }
 
 void DebugLog::indent()
@@ -90,43 +306,50 @@ void DebugLog::indent()
 
 void DebugLog::outdent()
 {
-	m_indent--;
-	if(m_indent < 0)
-	{
-		m_indent = 0;
-	}
+	int current = m_indent.load();
+	while ( current > 0 && !m_indent.compare_exchange_weak(current, current - 1) ) {}
 }
 
-std::string DebugLog::createIndent() const
+std::string DebugLog::createIndent(int indent) const
 {
-	std::string indent;
-	for ( int j = 0; j < m_indent; j++)
-		{
-			indent.append( ".." );
-		}
-	return indent;
+	return std::string( 2 * std::max(0, indent), '.' );
 }
 
 void DebugLog::print() const{
-	for (unsigned int i = 0; i < m_log.size(); i++)
+	flush();
+	std::lock_guard<std::mutex> lock(m_historyMutex);
+	for (unsigned int i = 0; i < m_history.size(); i++)
 	{
-		std::cout << m_log[i] << std::endl;
+		std::cout << m_history[i] << std::endl;
 	}
 }
 
 void DebugLog::printLast() const{
-	if (!m_log.empty())
+	flush();
+	std::lock_guard<std::mutex> lock(m_historyMutex);
+	if (!m_history.empty())
 	{
-		std::cout << m_log.back() << std::endl;
+		std::cout << m_history.back() << std::endl;
 	}
 }
 
 void DebugLog::clear()
 {
-	m_log.clear();
+	std::lock_guard<std::mutex> lock(m_historyMutex);
+	m_history.clear();
 }
 
 void DebugLog::setAutoPrint(bool to)
 {
 	m_autoPrint = to;
 }
+
+void DebugLog::setLevel(Level level)
+{
+	m_level = (int) level;
+}
+
+unsigned int DebugLog::getNumDropped() const
+{
+	return m_numDropped.load();
+}
@@ -5,23 +5,96 @@
 #include <string>
 #include <sstream>
 #include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 
 #include <glm/glm.hpp>
 
 #include "Singleton.h"
 
+/**
+ * @brief leveled, thread safe log with a background writer
+ *
+ * log() formats the message on the calling thread and copies it into a bounded lock-free ring buffer
+ * (multiple producers, one consumer); it never waits for the console and never takes a lock.
+ * A writer thread drains the ring, prints the messages if auto print is enabled and keeps the most
+ * recent s_historySize lines for print(). If the ring is full, messages are dropped and the writer
+ * reports how many. The ring is drained when the program exits; flush() waits for it explicitly.
+ *
+ * Messages above the runtime level (setLevel()) are discarded before they are formatted.
+ * The DEBUGLOG_<LEVEL>() macros additionally compile out levels above DEBUGLOG_MAX_LEVEL,
+ * arguments included; by default, verbose messages are only compiled into debug builds.
+ */
 class DebugLog : public Singleton<DebugLog>
 {
 friend class Singleton< DebugLog >;
+public:
+	enum Level
+	{
+		LEVEL_ERROR = 0,   //!< printed with "ERROR: " prefix
+		LEVEL_WARNING = 1, //!< printed with "WARNING: " prefix
+		LEVEL_INFO = 2,    //!< default of log(msg)
+		LEVEL_VERBOSE = 3  //!< per item details, e.g. every uniform of a shader
+	};
+
+	static const unsigned int s_ringSize = 1024;    //!< slots of the ring buffer, a power of two
+	static const unsigned int s_slotLength = 256;   //!< characters per slot; longer messages span consecutive slots
+	static const unsigned int s_maxSlotsPerMessage = 16; //!< longer messages are truncated
+	static const unsigned int s_historySize = 4096; //!< lines kept for print()
+
 private:
-	std::vector< std::string > m_log;
-	int  m_indent;
-	bool m_autoPrint;
-	inline std::string createIndent() const;
+	struct Slot
+	{
+		std::atomic<size_t> sequence; //!< position + 1 once written, position + s_ringSize once consumed
+		Level level;
+		int indent;
+		bool continued;               //!< the message continues in the next slot
+		unsigned int length;
+		char text[s_slotLength];
+	};
+
+	Slot* m_ring;
+	std::atomic<size_t> m_head;      //!< next position claimed by a producer
+	size_t m_tail;                   //!< writer thread: next position to consume
+	std::atomic<size_t> m_consumed;  //!< positions consumed so far, for flush()
+	std::atomic<unsigned int> m_numDropped;
+
+	std::thread m_writer;
+	std::atomic<bool> m_running;
+	std::mutex m_drainMutex;         //!< serializes drain(): the writer thread, and producers racing with shutdown()
+	mutable std::mutex m_wakeMutex;
+	mutable std::condition_variable m_wake; //!< wakes up the writer thread
+
+	mutable std::mutex m_historyMutex; //!< guards the history and synchronous printing
+	std::deque< std::string > m_history;
+	std::string m_pending;             //!< writer thread: message assembled from continued slots
+
+	std::atomic<int>  m_indent;
+	std::atomic<bool> m_autoPrint;
+	std::atomic<int>  m_level;
+
+	inline std::string createIndent(int indent) const;
+	void write(Level level, int indent, const std::string& msg); //!< writer thread, or synchronously once stopped
+	bool drain();      //!< consume all written slots, with m_drainMutex held; returns whether any was consumed
+	void runWriter();  //!< writer thread
+	void shutdown();   //!< stop the writer thread after draining the ring; log() prints synchronously afterwards
+	static void shutdownAtExit();
+
 public:
 	DebugLog(bool autoPrint = false);
 	~DebugLog();
-	void log(std::string msg);
+
+	void log(Level level, const std::string& msg);
+	template <typename T>
+	void log(Level level, const std::string& msg, const T& value)
+	{
+		if ( isEnabled(level) ) { log( level, msg + toString(value) ); }
+	}
+
+	void log(std::string msg); //!< LEVEL_INFO
 	void log(std::string msg, bool value);
 	void log(std::string msg, int value);
 	void log(std::string msg, unsigned int value);
@@ -29,17 +102,55 @@ public:
 	void log(std::string msg, double value);
 	void log(std::string msg, const glm::vec3& vector);
 	void log(std::string msg, const glm::vec4& vector);
+
+	static std::string toString(bool value);
+	static std::string toString(int value);
+	static std::string toString(unsigned int value);
+	static std::string toString(float value);
+	static std::string toString(double value);
+	static std::string toString(const glm::vec3& vector);
+	static std::string toString(const glm::vec4& vector);
+
 	void indent();
 	void outdent();
-	void print() const;
-	void printLast() const;
-	void clear();
+	void print() const;     //!< the kept lines, after flushing
+	void printLast() const; //!< the last line, after flushing
+	void clear();           //!< forget the kept lines
+	void flush() const;     //!< block until every message logged so far was written
 
 	void setAutoPrint(bool to);
+	void setLevel(Level level); //!< messages above level are discarded
+	inline bool isEnabled(Level level) const { return (int) level <= m_level.load(std::memory_order_relaxed); }
+	unsigned int getNumDropped() const; //!< messages dropped since the last report of the writer
 };
 
 // for convenient access
 #define DEBUGLOG DebugLog::getInstance()
 
+// highest level compiled into DEBUGLOG_<LEVEL>() calls, 0 (errors) to 3 (verbose)
+#ifndef DEBUGLOG_MAX_LEVEL
+	#ifdef _DEBUG
+		#define DEBUGLOG_MAX_LEVEL 3
+	#else
+		#define DEBUGLOG_MAX_LEVEL 2
+	#endif
 #endif
 
+#define DEBUGLOG_ERROR(...) DEBUGLOG->log(DebugLog::LEVEL_ERROR, __VA_ARGS__)
+#if DEBUGLOG_MAX_LEVEL >= 1
+	#define DEBUGLOG_WARNING(...) DEBUGLOG->log(DebugLog::LEVEL_WARNING, __VA_ARGS__)
+#else
+	#define DEBUGLOG_WARNING(...) ((void) 0)
+#endif
+#if DEBUGLOG_MAX_LEVEL >= 2
+	#define DEBUGLOG_INFO(...) DEBUGLOG->log(DebugLog::LEVEL_INFO, __VA_ARGS__)
+#else
+	#define DEBUGLOG_INFO(...) ((void) 0)
+#endif
+#if DEBUGLOG_MAX_LEVEL >= 3
+	#define DEBUGLOG_VERBOSE(...) DEBUGLOG->log(DebugLog::LEVEL_VERBOSE, __VA_ARGS__)
+#else
+	#define DEBUGLOG_VERBOSE(...) ((void) 0)
+#endif
+
+#endif
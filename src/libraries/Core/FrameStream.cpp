@@ -0,0 +1,308 @@
+#include "FrameStream.h"
+
+#include <Core/ThreadPool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace FrameStream;
+
+namespace {
+	template <class T>
+	void append(std::vector<char>& buffer, const T& value)
+	{
+		const char* bytes = (const char*) &value;
+		buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+	}
+
+	template <class T>
+	bool read(const std::vector<char>& buffer, size_t& offset, T& value)
+	{
+		if ( buffer.size() - offset < sizeof(T) ) { return false; }
+		std::memcpy(&value, &buffer[offset], sizeof(T));
+		offset += sizeof(T);
+		return true;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+///////////////////////////// TileDeltaEncoder ///////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+TileDeltaEncoder::TileDeltaEncoder(int tileSize)
+	: m_tileSize(std::max(1, tileSize)),
+	m_width(0),
+	m_height(0),
+	m_keyframe(true),
+	m_numChangedTiles(0),
+	m_numSolidTiles(0)
+{
+}
+
+void TileDeltaEncoder::reset()
+{
+	m_keyframe = true;
+}
+
+int TileDeltaEncoder::encode(const unsigned char* rgba, int width, int height, FrameHeader& header, std::vector<char>& message)
+{
+	if ( width != m_width || height != m_height )
+	{
+		m_width = width;
+		m_height = height;
+		m_previous.assign( (size_t) width * height * 4, 0 );
+		m_keyframe = true;
+	}
+
+	int tilesX = (width  + m_tileSize - 1) / m_tileSize;
+	int tilesY = (height + m_tileSize - 1) / m_tileSize;
+	m_rowTiles.resize(tilesY);
+	m_rowNumTiles.assign(tilesY, 0);
+	m_rowNumSolid.assign(tilesY, 0);
+	bool keyframe = m_keyframe;
+
+	THREADPOOL->parallelFor(0, tilesY, [&](int rowBegin, int rowEnd)
+	{
+		for (int ty = rowBegin; ty < rowEnd; ty++)
+		{
+			std::vector<char>& out = m_rowTiles[ty];
+			out.clear();
+			int y0 = ty * m_tileSize;
+			int tileHeight = std::min(m_tileSize, height - y0);
+			for (int tx = 0; tx < tilesX; tx++)
+			{
+				int x0 = tx * m_tileSize;
+				int tileWidth = std::min(m_tileSize, width - x0);
+				size_t rowBytes = (size_t) tileWidth * 4;
+
+				bool changed = keyframe;
+				for (int y = y0; y < y0 + tileHeight && !changed; y++)
+				{
+					size_t offset = ( (size_t) y * width + x0 ) * 4;
+					changed = ( std::memcmp(rgba + offset, &m_previous[offset], rowBytes) != 0 );
+				}
+				if ( !changed ) { continue; }
+
+				bool solid = true;
+				for (int y = y0; y < y0 + tileHeight && solid; y++)
+				{
+					const unsigned char* row = rgba + ( (size_t) y * width + x0 ) * 4;
+					const unsigned char* first = rgba + ( (size_t) y0 * width + x0 ) * 4;
+					for (int x = 0; x < tileWidth && solid; x++)
+					{
+						solid = ( row[x * 4] == first[0] && row[x * 4 + 1] == first[1] && row[x * 4 + 2] == first[2] );
+					}
+				}
+
+				unsigned int code = ( (unsigned int) (ty * tilesX + tx) << 1 ) | (solid ? 1u : 0u);
+				append(out, code);
+				size_t start = out.size();
+				if ( solid )
+				{
+					out.resize(start + 3);
+					std::memcpy(&out[start], rgba + ( (size_t) y0 * width + x0 ) * 4, 3);
+					m_rowNumSolid[ty]++;
+				}
+				else
+				{
+					out.resize(start + (size_t) tileWidth * tileHeight * 3);
+					char* rgb = &out[start];
+					for (int y = y0; y < y0 + tileHeight; y++)
+					{
+						const unsigned char* row = rgba + ( (size_t) y * width + x0 ) * 4;
+						for (int x = 0; x < tileWidth; x++)
+						{
+							*rgb++ = (char) row[x * 4];
+							*rgb++ = (char) row[x * 4 + 1];
+							*rgb++ = (char) row[x * 4 + 2];
+						}
+					}
+				}
+				for (int y = y0; y < y0 + tileHeight; y++)
+				{
+					size_t offset = ( (size_t) y * width + x0 ) * 4;
+					std::memcpy(&m_previous[offset], rgba + offset, rowBytes);
+				}
+				m_rowNumTiles[ty]++;
+			}
+		}
+	});
+	m_keyframe = false;
+
+	m_numChangedTiles = 0;
+	m_numSolidTiles = 0;
+	size_t bytes = sizeof(FrameHeader);
+	for (int ty = 0; ty < tilesY; ty++)
+	{
+		m_numChangedTiles += m_rowNumTiles[ty];
+		m_numSolidTiles += m_rowNumSolid[ty];
+		bytes += m_rowTiles[ty].size();
+	}
+
+	header.width = width;
+	header.height = height;
+	header.tileSize = m_tileSize;
+	header.keyframe = keyframe ? 1 : 0;
+	header.numTiles = m_numChangedTiles;
+
+	message.clear();
+	message.reserve(bytes);
+	append(message, header);
+	for (int ty = 0; ty < tilesY; ty++)
+	{
+		message.insert(message.end(), m_rowTiles[ty].begin(), m_rowTiles[ty].end());
+	}
+	return m_numChangedTiles;
+}
+
+int TileDeltaEncoder::getNumChangedTiles() const
+{
+	return m_numChangedTiles;
+}
+
+int TileDeltaEncoder::getNumSolidTiles() const
+{
+	return m_numSolidTiles;
+}
+
+int TileDeltaEncoder::getNumTiles() const
+{
+	return ( (m_width + m_tileSize - 1) / m_tileSize ) * ( (m_height + m_tileSize - 1) / m_tileSize );
+}
+
+//////////////////////////////////////////////////////////////////////////////
+///////////////////////////// TileDeltaDecoder ///////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+TileDeltaDecoder::TileDeltaDecoder()
+	: m_width(0),
+	m_height(0)
+{
+}
+
+bool TileDeltaDecoder::decode(const std::vector<char>& payload, FrameHeader& header)
+{
+	size_t offset = 0;
+	if ( !read(payload, offset, header) ) { return false; }
+	if ( header.width <= 0 || header.height <= 0 || header.tileSize <= 0 || header.numTiles < 0 ) { return false; }
+
+	if ( header.width != m_width || header.height != m_height )
+	{
+		if ( !header.keyframe ) { return false; } // delta against a frame we don't have
+		m_width = header.width;
+		m_height = header.height;
+		m_pixels.assign( (size_t) m_width * m_height * 4, 255 );
+	}
+
+	int tilesX = (m_width  + header.tileSize - 1) / header.tileSize;
+	int tilesY = (m_height + header.tileSize - 1) / header.tileSize;
+	for (int i = 0; i < header.numTiles; i++)
+	{
+		unsigned int code;
+		if ( !read(payload, offset, code) ) { return false; }
+		int index = (int) (code >> 1);
+		if ( index >= tilesX * tilesY ) { return false; }
+
+		int x0 = (index % tilesX) * header.tileSize;
+		int y0 = (index / tilesX) * header.tileSize;
+		int tileWidth  = std::min(header.tileSize, m_width - x0);
+		int tileHeight = std::min(header.tileSize, m_height - y0);
+		size_t tileBytes = (code & 1u) ? 3 : (size_t) tileWidth * tileHeight * 3;
+		if ( payload.size() - offset < tileBytes ) { return false; }
+
+		const unsigned char* rgb = (const unsigned char*) &payload[offset];
+		for (int y = y0; y < y0 + tileHeight; y++)
+		{
+			unsigned char* row = &m_pixels[ ( (size_t) y * m_width + x0 ) * 4 ];
+			for (int x = 0; x < tileWidth; x++)
+			{
+				const unsigned char* color = (code & 1u) ? rgb : rgb + ( (size_t) (y - y0) * tileWidth + x ) * 3;
+				row[x * 4]     = color[0];
+				row[x * 4 + 1] = color[1];
+				row[x * 4 + 2] = color[2];
+			}
+		}
+		offset += tileBytes;
+	}
+	return true;
+}
+
+const std::vector<unsigned char>& TileDeltaDecoder::getPixels() const
+{
+	return m_pixels;
+}
+
+int TileDeltaDecoder::getWidth() const
+{
+	return m_width;
+}
+
+int TileDeltaDecoder::getHeight() const
+{
+	return m_height;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////// AdaptiveResolution //////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+AdaptiveResolution::AdaptiveResolution(float latencyBudget, float minScale)
+	: m_latencyBudget(latencyBudget),
+	m_minScale(minScale)
+{
+	reset();
+}
+
+void AdaptiveResolution::reset()
+{
+	m_scale = 1.0f;
+	m_smoothedLatency = -1.0f;
+	m_holdFrames = 0;
+}
+
+void AdaptiveResolution::setLatencyBudget(float latencyBudget)
+{
+	m_latencyBudget = latencyBudget;
+}
+
+float AdaptiveResolution::getLatencyBudget() const
+{
+	return m_latencyBudget;
+}
+
+bool AdaptiveResolution::update(float latencyMilliseconds)
+{
+	m_smoothedLatency = (m_smoothedLatency < 0.0f) ? latencyMilliseconds : 0.75f * m_smoothedLatency + 0.25f * latencyMilliseconds;
+	if ( m_holdFrames > 0 )
+	{
+		m_holdFrames--;
+		return false;
+	}
+
+	float scale = m_scale;
+	if ( latencyMilliseconds > m_latencyBudget )
+	{
+		scale = std::floor(m_scale * 0.75f * 16.0f) / 16.0f; // react to a single late frame
+	}
+	else if ( m_smoothedLatency < 0.5f * m_latencyBudget )
+	{
+		scale = m_scale + 1.0f / 16.0f;
+	}
+	scale = std::max(m_minScale, std::min(1.0f, scale));
+	if ( scale == m_scale ) { return false; }
+
+	m_scale = scale;
+	m_holdFrames = 3;
+	return true;
+}
+
+float AdaptiveResolution::getScale() const
+{
+	return m_scale;
+}
+
+float AdaptiveResolution::getSmoothedLatency() const
+{
+	return std::max(0.0f, m_smoothedLatency);
+}
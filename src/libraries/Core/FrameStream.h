@@ -0,0 +1,199 @@
+#ifndef FRAMESTREAM_H
+#define FRAMESTREAM_H
+
+#include <vector>
+
+/**
+ * @brief protocol of a render server streaming frames to a thin client over a MessageChannel
+ *
+ * The client announces its viewport and latency budget, sends camera and parameter changes and acknowledges
+ * every displayed frame. The server sends frames as tile deltas against the previous frame: only tiles with
+ * changed pixels are transmitted, as RGB rows or as a single color if all pixels are equal.
+ * All messages are plain structs of 32 bit fields.
+ */
+namespace FrameStream {
+	enum MessageType
+	{
+		VIEWPORT = 1, //!< client to server: ViewportMessage, on connect and whenever it changes
+		CAMERA,       //!< client to server: CameraMessage
+		PARAMETER,    //!< client to server: ParameterMessage
+		ACK,          //!< client to server: AckMessage, once a frame is displayed
+		FRAME,        //!< server to client: FrameHeader, followed by FrameHeader::numTiles tiles
+		STATE         //!< server to client: StateMessage, on connect and whenever a parameter changed
+	};
+
+	enum Parameter
+	{
+		WINDOW_MIN,
+		WINDOW_MAX,
+		PROJECTION,  //!< 0: MIP, 1: MinIP, 2: average
+		RENDER_MODE, //!< 0: projection, 1: isosurface
+		ISO_VALUE,
+		ROTATING     //!< 0 or 1
+	};
+
+	struct ViewportMessage
+	{
+		int width;
+		int height;
+		float latencyBudget; //!< milliseconds from the start of a frame's readback to its acknowledgement
+	};
+
+	/**
+	 * @brief relative camera motion, applied in the server's view space
+	 */
+	struct CameraMessage
+	{
+		float dragX; //!< turntable rotation, in pixels of mouse motion
+		float dragY;
+		float moveX; //!< translation of eye and center
+		float moveY;
+		float moveZ;
+	};
+
+	struct ParameterMessage
+	{
+		unsigned int parameter; //!< Parameter
+		float value;
+	};
+
+	struct AckMessage
+	{
+		unsigned int frameId;
+	};
+
+	struct StateMessage
+	{
+		float valueMin; //!< value range of the volume
+		float valueMax;
+		float windowMin;
+		float windowMax;
+		float isoValue;
+		int projection;
+		int renderMode;
+		int rotating;
+	};
+
+	/**
+	 * @brief start of a FRAME message
+	 *
+	 * Tiles are numbered row by row from the lower left corner; the tiles of the last column and row are cropped.
+	 * Each tile is an unsigned int (index << 1 | solid), followed by 3 bytes of RGB if solid, else by its RGB rows,
+	 * bottom to top.
+	 */
+	struct FrameHeader
+	{
+		unsigned int frameId;
+		int width;
+		int height;
+		int tileSize;
+		int keyframe;   //!< 1 if all tiles are contained, e.g. after a resolution change
+		int numTiles;   //!< changed tiles contained
+		float scale;    //!< resolution relative to the viewport, chosen by the server
+		float latency;  //!< smoothed latency measured by the server, milliseconds
+	};
+
+	/**
+	 * @brief encodes frames as tile deltas against the previously encoded frame
+	 */
+	class TileDeltaEncoder
+	{
+	protected:
+		int m_tileSize;
+		int m_width;
+		int m_height;
+		std::vector<unsigned char> m_previous; //!< RGBA of the last encoded frame
+		bool m_keyframe;                       //!< next frame is encoded completely
+
+		std::vector< std::vector<char> > m_rowTiles; //!< encoded tiles per row of tiles
+		std::vector<int> m_rowNumTiles;
+		std::vector<int> m_rowNumSolid;
+
+		int m_numChangedTiles;
+		int m_numSolidTiles;
+
+	public:
+		TileDeltaEncoder(int tileSize = 32);
+
+		/**
+		 * @brief encode a frame, parallel over rows of tiles
+		 *
+		 * @param rgba pixels, rows bottom to top as read by glReadPixels
+		 * @param width of the frame; a different size than the previous frame yields a keyframe
+		 * @param height of the frame
+		 * @param header frameId, scale and latency set by the caller, the rest is filled
+		 * @param message resized to the FRAME payload: header and changed tiles
+		 * @return number of changed tiles; 0 if the frame equals the previous one
+		 */
+		int encode(const unsigned char* rgba, int width, int height, FrameHeader& header, std::vector<char>& message);
+
+		void reset(); //!< encode the next frame completely, e.g. for a new client
+
+		int getNumChangedTiles() const; //!< of the last frame
+		int getNumSolidTiles() const;   //!< of the last frame, sent as a single color
+		int getNumTiles() const;        //!< of the last frame
+	};
+
+	/**
+	 * @brief reconstructs frames from FRAME messages
+	 */
+	class TileDeltaDecoder
+	{
+	protected:
+		int m_width;
+		int m_height;
+		std::vector<unsigned char> m_pixels; //!< RGBA, rows bottom to top
+
+	public:
+		TileDeltaDecoder();
+
+		/**
+		 * @brief apply a FRAME message to the current frame
+		 *
+		 * @param payload of the message
+		 * @param header filled from the message
+		 * @return false if the message is malformed, or a delta which does not match the current frame
+		 */
+		bool decode(const std::vector<char>& payload, FrameHeader& header);
+
+		const std::vector<unsigned char>& getPixels() const;
+		int getWidth() const;
+		int getHeight() const;
+	};
+
+	/**
+	 * @brief chooses the streamed resolution from the measured latency
+	 *
+	 * Multiplicative decrease as soon as a frame exceeds the budget, additive increase while the smoothed
+	 * latency stays well below it. The scale is quantized to sixteenths, so the resolution, and thereby
+	 * the tile grid, only changes in discrete steps; after a change, a few frames are measured before the next one.
+	 */
+	class AdaptiveResolution
+	{
+	protected:
+		float m_latencyBudget;   //!< milliseconds
+		float m_minScale;
+		float m_scale;
+		float m_smoothedLatency; //!< milliseconds, negative if nothing was measured yet
+		int m_holdFrames;        //!< frames left before the scale may change again
+
+	public:
+		AdaptiveResolution(float latencyBudget = 50.0f, float minScale = 0.25f);
+
+		void setLatencyBudget(float latencyBudget);
+		float getLatencyBudget() const;
+
+		/**
+		 * @brief add the latency of an acknowledged frame
+		 * @return whether the scale changed
+		 */
+		bool update(float latencyMilliseconds);
+
+		void reset(); //!< full resolution, forget the measurements
+
+		float getScale() const;
+		float getSmoothedLatency() const; //!< 0 if nothing was measured yet
+	};
+} // namespace FrameStream
+
+#endif
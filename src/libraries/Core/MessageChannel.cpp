@@ -0,0 +1,486 @@
+#include "MessageChannel.h"
+
+#include <Core/DebugLog.h>
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <cerrno>
+#endif
+
+MessageChannel::MessageChannel()
+	: m_listenSocket(-1),
+	m_peerSocket(-1),
+	m_running(false),
+	m_connected(false),
+	m_numConnections(0),
+	m_outboxOffset(0),
+	m_outboxBytes(0),
+	m_bytesSent(0),
+	m_bytesReceived(0)
+{
+	m_wakePipe[0] = -1;
+	m_wakePipe[1] = -1;
+}
+
+MessageChannel::~MessageChannel()
+{
+	close();
+}
+
+void MessageChannel::setOnReceive(std::function<void()> onReceive)
+{
+	m_onReceive = onReceive;
+}
+
+bool MessageChannel::isOpen() const
+{
+	return m_running.load();
+}
+
+bool MessageChannel::isConnected() const
+{
+	return m_connected.load();
+}
+
+int MessageChannel::getNumConnections() const
+{
+	return m_numConnections.load();
+}
+
+size_t MessageChannel::getNumQueuedBytes() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_outboxBytes;
+}
+
+unsigned long long MessageChannel::getBytesSent() const
+{
+	return m_bytesSent.load();
+}
+
+unsigned long long MessageChannel::getBytesReceived() const
+{
+	return m_bytesReceived.load();
+}
+
+void MessageChannel::send(unsigned int type, const std::vector<char>& payload)
+{
+	send(type, payload.empty() ? 0 : &payload[0], payload.size());
+}
+
+void MessageChannel::send(unsigned int type, const void* payload, size_t size)
+{
+	std::vector<char> framed(2 * sizeof(unsigned int) + size);
+	unsigned int header[2] = { type, (unsigned int) size };
+	std::memcpy(&framed[0], header, sizeof(header));
+	if ( size > 0 )
+	{
+		std::memcpy(&framed[sizeof(header)], payload, size);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if ( !m_connected.load() ) { return; }
+		m_outboxBytes += framed.size();
+		m_outbox.push_back( std::vector<char>() );
+		m_outbox.back().swap(framed);
+	}
+	wake();
+}
+
+bool MessageChannel::receive(Message& message)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if ( m_inbox.empty() ) { return false; }
+	message.type = m_inbox.front().type;
+	message.payload.swap( m_inbox.front().payload );
+	m_inbox.pop_front();
+	return true;
+}
+
+#ifndef _WIN32
+
+namespace {
+	void setNonBlocking(int socket)
+	{
+		fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+	}
+
+	void setNoDelay(int socket)
+	{
+		int flag = 1;
+		setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag)); // fails harmlessly on Unix sockets
+	}
+
+	bool makeUnixAddress(const std::string& path, sockaddr_un& address)
+	{
+		std::memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if ( path.size() >= sizeof(address.sun_path) )
+		{
+			DEBUGLOG->log("MessageChannel: socket path too long: " + path);
+			return false;
+		}
+		std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+		return true;
+	}
+}
+
+bool MessageChannel::start()
+{
+	if ( pipe(m_wakePipe) != 0 )
+	{
+		DEBUGLOG->log("MessageChannel: could not create wake pipe");
+		return false;
+	}
+	setNonBlocking(m_wakePipe[0]);
+	setNonBlocking(m_wakePipe[1]);
+
+	m_running = true;
+	m_thread = std::thread( [this]() { run(); } );
+	return true;
+}
+
+void MessageChannel::wake()
+{
+	if ( m_wakePipe[1] != -1 )
+	{
+		char byte = 0;
+		ssize_t written = write(m_wakePipe[1], &byte, 1); // a full pipe wakes up the thread all the same
+		(void) written;
+	}
+}
+
+bool MessageChannel::listen(int port, bool allowRemote)
+{
+	if ( m_running.load() ) { return false; }
+
+	m_listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+	if ( m_listenSocket < 0 ) { return false; }
+	int reuse = 1;
+	setsockopt(m_listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons( (unsigned short) port );
+	address.sin_addr.s_addr = htonl( allowRemote ? INADDR_ANY : INADDR_LOOPBACK );
+	if ( bind(m_listenSocket, (sockaddr*) &address, sizeof(address)) != 0 || ::listen(m_listenSocket, 1) != 0 )
+	{
+		DEBUGLOG->log("MessageChannel: could not listen on port ", port);
+		::close(m_listenSocket);
+		m_listenSocket = -1;
+		return false;
+	}
+	setNonBlocking(m_listenSocket);
+	DEBUGLOG->log("MessageChannel: listening on port ", port);
+	return start();
+}
+
+bool MessageChannel::listenUnix(const std::string& path)
+{
+	if ( m_running.load() ) { return false; }
+
+	sockaddr_un address;
+	if ( !makeUnixAddress(path, address) ) { return false; }
+	m_listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if ( m_listenSocket < 0 ) { return false; }
+
+	unlink( path.c_str() ); // stale socket of a previous run
+	if ( bind(m_listenSocket, (sockaddr*) &address, sizeof(address)) != 0 || ::listen(m_listenSocket, 1) != 0 )
+	{
+		DEBUGLOG->log("MessageChannel: could not listen on " + path);
+		::close(m_listenSocket);
+		m_listenSocket = -1;
+		return false;
+	}
+	setNonBlocking(m_listenSocket);
+	m_unixPath = path;
+	DEBUGLOG->log("MessageChannel: listening on " + path);
+	return start();
+}
+
+bool MessageChannel::connect(const std::string& host, int port)
+{
+	if ( m_running.load() ) { return false; }
+
+	addrinfo hints;
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* result = 0;
+	if ( getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || !result )
+	{
+		DEBUGLOG->log("MessageChannel: unknown host " + host);
+		return false;
+	}
+
+	m_peerSocket = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+	bool connected = m_peerSocket >= 0 && ::connect(m_peerSocket, result->ai_addr, result->ai_addrlen) == 0;
+	freeaddrinfo(result);
+	if ( !connected )
+	{
+		DEBUGLOG->log("MessageChannel: could not connect to " + host + ":" + std::to_string(port));
+		if ( m_peerSocket >= 0 ) { ::close(m_peerSocket); }
+		m_peerSocket = -1;
+		return false;
+	}
+	setNonBlocking(m_peerSocket);
+	setNoDelay(m_peerSocket);
+	m_connected = true;
+	m_numConnections++;
+	return start();
+}
+
+bool MessageChannel::connectUnix(const std::string& path)
+{
+	if ( m_running.load() ) { return false; }
+
+	sockaddr_un address;
+	if ( !makeUnixAddress(path, address) ) { return false; }
+	m_peerSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if ( m_peerSocket < 0 || ::connect(m_peerSocket, (sockaddr*) &address, sizeof(address)) != 0 )
+	{
+		DEBUGLOG->log("MessageChannel: could not connect to " + path);
+		if ( m_peerSocket >= 0 ) { ::close(m_peerSocket); }
+		m_peerSocket = -1;
+		return false;
+	}
+	setNonBlocking(m_peerSocket);
+	m_connected = true;
+	m_numConnections++;
+	return start();
+}
+
+void MessageChannel::close()
+{
+	if ( m_running.load() )
+	{
+		m_running = false;
+		wake();
+		m_thread.join();
+	}
+	if ( m_peerSocket != -1 )  { dropPeer(); }
+	if ( m_listenSocket != -1 ) { ::close(m_listenSocket); m_listenSocket = -1; }
+	if ( !m_unixPath.empty() )  { unlink( m_unixPath.c_str() ); m_unixPath.clear(); }
+	for (int i = 0; i < 2; i++)
+	{
+		if ( m_wakePipe[i] != -1 ) { ::close(m_wakePipe[i]); m_wakePipe[i] = -1; }
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_inbox.clear();
+}
+
+void MessageChannel::dropPeer()
+{
+	::close(m_peerSocket);
+	m_peerSocket = -1;
+	m_receiveBuffer.clear();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_connected = false;
+	m_outbox.clear();
+	m_outboxOffset = 0;
+	m_outboxBytes = 0;
+}
+
+bool MessageChannel::receiveFromPeer()
+{
+	char chunk[64 * 1024];
+	for (;;)
+	{
+		ssize_t received = recv(m_peerSocket, chunk, sizeof(chunk), 0);
+		if ( received > 0 )
+		{
+			m_receiveBuffer.insert(m_receiveBuffer.end(), chunk, chunk + received);
+			m_bytesReceived += (unsigned long long) received;
+			continue;
+		}
+		if ( received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) )
+		{
+			break;
+		}
+		return false; // closed by the peer or failed
+	}
+
+	// split complete messages off the buffer
+	size_t offset = 0;
+	std::deque<Message> messages;
+	while ( m_receiveBuffer.size() - offset >= 2 * sizeof(unsigned int) )
+	{
+		unsigned int header[2];
+		std::memcpy(header, &m_receiveBuffer[offset], sizeof(header));
+		if ( header[1] > s_maxPayloadSize )
+		{
+			DEBUGLOG->log("MessageChannel: oversized message, dropping the connection");
+			return false;
+		}
+		if ( m_receiveBuffer.size() - offset - sizeof(header) < header[1] ) { break; }
+
+		messages.push_back( Message() );
+		messages.back().type = header[0];
+		const char* payload = &m_receiveBuffer[offset + sizeof(header)];
+		messages.back().payload.assign(payload, payload + header[1]);
+		offset += sizeof(header) + header[1];
+	}
+	m_receiveBuffer.erase(m_receiveBuffer.begin(), m_receiveBuffer.begin() + offset);
+
+	if ( !messages.empty() )
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (unsigned int i = 0; i < messages.size(); i++)
+		{
+			m_inbox.push_back( Message() );
+			m_inbox.back().type = messages[i].type;
+			m_inbox.back().payload.swap( messages[i].payload );
+		}
+	}
+	return true;
+}
+
+bool MessageChannel::sendToPeer()
+{
+	std::lock_guard<std::mutex> lock(m_mutex); // send() does not block, the socket is non-blocking
+	while ( !m_outbox.empty() )
+	{
+		const std::vector<char>& front = m_outbox.front();
+		ssize_t sent = ::send(m_peerSocket, &front[m_outboxOffset], front.size() - m_outboxOffset, MSG_NOSIGNAL);
+		if ( sent < 0 )
+		{
+			return ( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR );
+		}
+		m_outboxOffset += (size_t) sent;
+		m_outboxBytes -= (size_t) sent;
+		m_bytesSent += (unsigned long long) sent;
+		if ( m_outboxOffset == front.size() )
+		{
+			m_outbox.pop_front();
+			m_outboxOffset = 0;
+		}
+	}
+	return true;
+}
+
+void MessageChannel::run()
+{
+	while ( m_running.load() )
+	{
+		pollfd fds[3];
+		int numFds = 0;
+		int listenIndex = -1;
+		int peerIndex = -1;
+
+		fds[numFds].fd = m_wakePipe[0];
+		fds[numFds].events = POLLIN;
+		numFds++;
+		if ( m_listenSocket != -1 )
+		{
+			listenIndex = numFds;
+			fds[numFds].fd = m_listenSocket;
+			fds[numFds].events = POLLIN;
+			numFds++;
+		}
+		if ( m_peerSocket != -1 )
+		{
+			peerIndex = numFds;
+			fds[numFds].fd = m_peerSocket;
+			fds[numFds].events = POLLIN | ( getNumQueuedBytes() > 0 ? POLLOUT : 0 );
+			numFds++;
+		}
+		for (int i = 0; i < numFds; i++) { fds[i].revents = 0; }
+
+		if ( poll(fds, numFds, -1) < 0 && errno != EINTR )
+		{
+			DEBUGLOG->log("MessageChannel: poll failed");
+			break;
+		}
+
+		if ( fds[0].revents & POLLIN )
+		{
+			char drain[64];
+			while ( read(m_wakePipe[0], drain, sizeof(drain)) > 0 ) {}
+		}
+		if ( !m_running.load() ) { break; }
+
+		bool notify = false;
+		if ( listenIndex != -1 && (fds[listenIndex].revents & POLLIN) )
+		{
+			int peer = accept(m_listenSocket, 0, 0);
+			if ( peer >= 0 )
+			{
+				if ( m_peerSocket != -1 )
+				{
+					DEBUGLOG->log("MessageChannel: new peer replaces the connected one");
+					dropPeer();
+				}
+				setNonBlocking(peer);
+				setNoDelay(peer);
+				m_peerSocket = peer;
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_connected = true;
+				}
+				m_numConnections++;
+				notify = true;
+				peerIndex = -1; // its poll result belongs to the replaced peer
+			}
+		}
+
+		if ( peerIndex != -1 )
+		{
+			bool alive = true;
+			if ( fds[peerIndex].revents & (POLLIN | POLLHUP | POLLERR) )
+			{
+				alive = receiveFromPeer();
+				notify = true;
+			}
+			if ( alive && (fds[peerIndex].revents & POLLOUT) )
+			{
+				alive = sendToPeer();
+			}
+			if ( !alive )
+			{
+				DEBUGLOG->log("MessageChannel: peer disconnected");
+				dropPeer();
+			}
+		}
+
+		if ( notify && m_onReceive )
+		{
+			m_onReceive();
+		}
+	}
+}
+
+#else // no POSIX sockets
+
+bool MessageChannel::start() { return false; }
+void MessageChannel::wake() {}
+void MessageChannel::run() {}
+void MessageChannel::dropPeer() {}
+bool MessageChannel::receiveFromPeer() { return false; }
+bool MessageChannel::sendToPeer() { return false; }
+
+bool MessageChannel::listen(int port, bool allowRemote)
+{
+	DEBUGLOG->log("MessageChannel: sockets are not supported on this platform");
+	return false;
+}
+
+bool MessageChannel::listenUnix(const std::string& path) { return listen(0, false); }
+bool MessageChannel::connect(const std::string& host, int port) { return listen(0, false); }
+bool MessageChannel::connectUnix(const std::string& path) { return listen(0, false); }
+void MessageChannel::close() {}
+
+#endif
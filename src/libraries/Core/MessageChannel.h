@@ -0,0 +1,118 @@
+#ifndef MESSAGECHANNEL_H
+#define MESSAGECHANNEL_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+/**
+ * @brief typed messages over a TCP or Unix domain stream socket, sent and received by a network thread
+ *
+ * Every message is framed as (type, payload size) in two 32 bit words of host byte order, followed by the payload;
+ * both ends are expected to run on the same architecture (e.g. over loopback or an SSH tunnel).
+ * The network thread blocks in poll() on the sockets: send() only queues a message and wakes it up,
+ * receive() pops what it has parsed. Calling threads never block on the network.
+ *
+ * A listening channel serves one peer at a time; a newly accepted connection replaces the current one.
+ * There is no authentication: TCP listens on the loopback interface unless remote peers are allowed explicitly.
+ * Implemented for POSIX sockets; on other platforms, listen() and connect() fail.
+ */
+class MessageChannel
+{
+public:
+	struct Message
+	{
+		unsigned int type;
+		std::vector<char> payload;
+	};
+
+	static const unsigned int s_maxPayloadSize = 64 * 1024 * 1024; //!< larger messages drop the connection
+
+protected:
+	int m_listenSocket; //!< -1 if not listening
+	int m_peerSocket;   //!< -1 if not connected
+	int m_wakePipe[2];  //!< written by calling threads to wake up the network thread
+
+	std::thread m_thread;
+	std::atomic<bool> m_running;
+	std::atomic<bool> m_connected;
+	std::atomic<int> m_numConnections; //!< peers accepted or connected so far
+	std::string m_unixPath;            //!< unlinked on close, if listening on a Unix socket
+
+	mutable std::mutex m_mutex; //!< guards the queues
+	std::deque< std::vector<char> > m_outbox; //!< framed messages, the front one possibly sent partially
+	size_t m_outboxOffset;      //!< bytes of the front message already sent
+	size_t m_outboxBytes;       //!< unsent bytes in the outbox
+	std::deque<Message> m_inbox;
+	std::vector<char> m_receiveBuffer; //!< network thread only: bytes of incomplete messages
+
+	std::atomic<unsigned long long> m_bytesSent;
+	std::atomic<unsigned long long> m_bytesReceived;
+
+	std::function<void()> m_onReceive;
+
+	bool start();           //!< create the wake pipe and the network thread
+	void run();             //!< network thread
+	void wake();
+	void dropPeer();        //!< network thread: close the peer socket, discard its pending messages
+	bool receiveFromPeer(); //!< network thread: false if the peer is gone
+	bool sendToPeer();      //!< network thread: false if the peer is gone
+
+public:
+	MessageChannel();
+	~MessageChannel(); //!< closes the channel
+
+	/**
+	 * @brief wait for peers on a TCP port
+	 *
+	 * @param port to listen on
+	 * @param allowRemote listen on all interfaces instead of loopback only
+	 * @return false if the port could not be bound or the channel is in use
+	 */
+	bool listen(int port, bool allowRemote = false);
+
+	/**
+	 * @brief wait for peers on a Unix domain socket; an existing file at path is replaced
+	 */
+	bool listenUnix(const std::string& path);
+
+	/**
+	 * @brief connect to a listening channel, blocks until connected or refused
+	 */
+	bool connect(const std::string& host, int port);
+	bool connectUnix(const std::string& path);
+
+	void close(); //!< stop the network thread and close all sockets; queued messages are discarded
+
+	/**
+	 * @brief queue a message; discarded if no peer is connected
+	 */
+	void send(unsigned int type, const void* payload, size_t size);
+	void send(unsigned int type, const std::vector<char>& payload);
+
+	/**
+	 * @brief pop the oldest received message
+	 * @return false if none was received
+	 */
+	bool receive(Message& message);
+
+	/**
+	 * @brief called on the network thread whenever messages were received or the peer changed, e.g. to wake up a render loop
+	 *
+	 * Set before listen() or connect().
+	 */
+	void setOnReceive(std::function<void()> onReceive);
+
+	bool isOpen() const;      //!< listening or connected
+	bool isConnected() const; //!< a peer is connected
+	int getNumConnections() const; //!< changes whenever a new peer was accepted
+	size_t getNumQueuedBytes() const; //!< not yet sent
+	unsigned long long getBytesSent() const;
+	unsigned long long getBytesReceived() const;
+};
+
+#endif
@@ -2,6 +2,8 @@
 #define SINGLETON_H
 
 #include <iostream>
+#include <atomic>
+#include <mutex>
 using namespace std;
 
 
@@ -9,11 +11,21 @@ template <typename C>
  class Singleton
  {
  public:
+    // thread safe: the first concurrent calls construct a single instance
     static C* getInstance ()
     {
-       if (!_instance)
-          _instance = new C ();
-       return _instance;
+       C* instance = _instance.load(std::memory_order_acquire);
+       if (!instance)
+       {
+          std::lock_guard<std::mutex> lock(_mutex);
+          instance = _instance.load(std::memory_order_relaxed);
+          if (!instance)
+          {
+             instance = new C ();
+             _instance.store(instance, std::memory_order_release);
+          }
+       }
+       return instance;
     }
     virtual
     ~Singleton ()
@@ -21,10 +33,12 @@ template <typename C>
        _instance = 0;
     }
  private:
-    static C* _instance;
+    static std::atomic<C*> _instance;
+    static std::mutex _mutex;
  protected:
     Singleton () { }
  };
 
- template <typename C> C* Singleton <C>::_instance = 0;
+ template <typename C> std::atomic<C*> Singleton <C>::_instance(0);
+ template <typename C> std::mutex Singleton <C>::_mutex;
  #endif
@@ -0,0 +1,151 @@
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int numThreads)
+{
+	m_stop = false;
+
+	if (numThreads == 0)
+	{
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (unsigned int i = 0; i < numThreads; i++)
+	{
+		m_workers.push_back( std::thread( &ThreadPool::workerLoop, this ) );
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_condition.notify_all();
+
+	for (unsigned int i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+}
+
+void ThreadPool::workerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]{ return m_stop || !m_tasks.empty(); });
+
+			if (m_stop && m_tasks.empty())
+			{
+				return;
+			}
+
+			task = std::move( m_tasks.front() );
+			m_tasks.pop_front();
+		}
+		task();
+	}
+}
+
+std::future<void> ThreadPool::enqueue(std::function<void()> task)
+{
+	std::shared_ptr< std::packaged_task<void()> > packagedTask = std::make_shared< std::packaged_task<void()> >( task );
+	std::future<void> result = packagedTask->get_future();
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_tasks.push_back( [packagedTask](){ (*packagedTask)(); } );
+	}
+	m_condition.notify_one();
+	return result;
+}
+
+namespace {
+	// shared between the caller and the helper tasks of a single parallelFor call
+	struct ParallelForState
+	{
+		std::function<void(int, int)> body;
+		int begin;
+		int end;
+		int chunkSize;
+		int numChunks;
+		std::atomic<int> nextChunk;
+		std::atomic<int> doneChunks;
+		std::mutex mutex;
+		std::condition_variable finished;
+
+		// process chunks until none are left
+		void work()
+		{
+			int chunk;
+			while ( (chunk = nextChunk.fetch_add(1)) < numChunks )
+			{
+				int chunkBegin = begin + chunk * chunkSize;
+				int chunkEnd   = std::min(end, chunkBegin + chunkSize);
+				body(chunkBegin, chunkEnd);
+
+				if ( doneChunks.fetch_add(1) + 1 == numChunks )
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					finished.notify_all();
+				}
+			}
+		}
+	};
+}
+
+void ThreadPool::parallelFor(int begin, int end, std::function<void(int, int)> body, int grainSize)
+{
+	if (end <= begin)
+	{
+		return;
+	}
+
+	int numThreads = (int) m_workers.size() + 1; // workers + calling thread
+	int range = end - begin;
+
+	// a few chunks per thread to balance uneven work
+	int chunkSize = std::max( std::max(1, grainSize), range / (numThreads * 4) );
+	int numChunks = (range + chunkSize - 1) / chunkSize;
+
+	if (numChunks == 1)
+	{
+		body(begin, end);
+		return;
+	}
+
+	std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+	state->body = body;
+	state->begin = begin;
+	state->end = end;
+	state->chunkSize = chunkSize;
+	state->numChunks = numChunks;
+	state->nextChunk = 0;
+	state->doneChunks = 0;
+
+	int numHelpers = std::min( (int) m_workers.size(), numChunks - 1 );
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		for (int i = 0; i < numHelpers; i++)
+		{
+			m_tasks.push_back( [state](){ state->work(); } );
+		}
+	}
+	m_condition.notify_all();
+
+	state->work();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [&state]{ return state->doneChunks.load() == state->numChunks; });
+}
+
+unsigned int ThreadPool::getNumThreads() const
+{
+	return (unsigned int) m_workers.size();
+}
@@ -0,0 +1,62 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+
+#include "Singleton.h"
+
+/**
+ * @brief Fixed size pool of worker threads, shared by all CPU side volume processing.
+ *
+ * Workers are created once and kept alive, so per-frame work (e.g. CPU rendering)
+ * does not pay for thread creation.
+ */
+class ThreadPool : public Singleton<ThreadPool>
+{
+friend class Singleton< ThreadPool >;
+private:
+	std::vector< std::thread > m_workers;
+	std::deque< std::function<void()> > m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stop;
+
+	void workerLoop();
+public:
+	/**
+	 * @param numThreads amount of worker threads; 0 uses the hardware concurrency
+	 */
+	ThreadPool(unsigned int numThreads = 0);
+	~ThreadPool();
+
+	/**
+	 * @brief queue a task for asynchronous execution
+	 * @return future which becomes ready once the task has been executed
+	 */
+	std::future<void> enqueue(std::function<void()> task);
+
+	/**
+	 * @brief execute body for all chunks of [begin, end) in parallel and block until all are done
+	 *
+	 * The calling thread works on chunks as well, so nested calls from within a worker never deadlock.
+	 *
+	 * @param begin first index
+	 * @param end index after the last index
+	 * @param body called with a sub range [chunkBegin, chunkEnd)
+	 * @param grainSize minimal amount of indices per chunk
+	 */
+	void parallelFor(int begin, int end, std::function<void(int, int)> body, int grainSize = 1);
+
+	unsigned int getNumThreads() const; //!< amount of worker threads
+};
+
+// for convenient access
+#define THREADPOOL ThreadPool::getInstance()
+
+#endif
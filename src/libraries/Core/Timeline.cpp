@@ -0,0 +1,408 @@
+#include "Timeline.h"
+
+#include "DebugLog.h"
+
+#include <cstring>
+#include <fstream>
+
+#include <glm/gtc/type_ptr.hpp>
+
+namespace {
+	const unsigned int s_magic = 0x4C545256; // "VRTL"
+	const unsigned int s_version = 1;
+
+	void writeWord(std::ofstream& file, unsigned int word)
+	{
+		file.write( (const char*) &word, sizeof(word) );
+	}
+
+	bool readWord(std::ifstream& file, unsigned int& word)
+	{
+		return (bool) file.read( (char*) &word, sizeof(word) );
+	}
+}
+
+Timeline::Timeline()
+	: m_mode(IDLE),
+	m_currentFrame(0),
+	m_inFrame(false)
+{
+}
+
+Timeline::~Timeline()
+{
+}
+
+void Timeline::record()
+{
+	m_slots.clear();
+	for (unsigned int i = 0; i < m_slotIds.size(); i++)
+	{
+		m_slotIds[i].clear();
+	}
+	m_data.clear();
+	m_frameOffsets.clear();
+	m_currentFrame = 0;
+	m_inFrame = false;
+	m_mode = RECORDING;
+}
+
+bool Timeline::replay()
+{
+	stop();
+	if ( m_frameOffsets.empty() ) { return false; }
+
+	resetSlots();
+	m_currentFrame = 0;
+	m_mode = REPLAYING;
+	return true;
+}
+
+void Timeline::stop()
+{
+	endFrame();
+	m_mode = IDLE;
+}
+
+void Timeline::resetSlots()
+{
+	for (unsigned int i = 0; i < m_slots.size(); i++)
+	{
+		m_slots[i].isSet = false;
+	}
+}
+
+bool Timeline::beginFrame()
+{
+	endFrame(); // in case the last one was not ended
+
+	for (unsigned int i = 0; i < m_trackedKeys.size(); i++)
+	{
+		m_occurrences[ m_trackedKeys[i] ] = 0;
+	}
+	m_trackedKeys.clear();
+
+	if ( m_mode == RECORDING )
+	{
+		m_frameOffsets.push_back( m_data.size() );
+		m_data.push_back(0); // number of changes, counted by track()
+	}
+	else if ( m_mode == REPLAYING )
+	{
+		if ( m_currentFrame >= getNumFrames() )
+		{
+			m_mode = IDLE; // replay ended
+			return false;
+		}
+
+		size_t position = m_frameOffsets[m_currentFrame];
+		unsigned int numChanges = m_data[position++];
+		for (unsigned int i = 0; i < numChanges; i++)
+		{
+			Slot& slot = m_slots[ m_data[position++] ];
+			std::memcpy( &slot.current[0], &m_data[position], slot.count * sizeof(unsigned int) );
+			slot.isSet = true;
+			position += slot.count;
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	m_inFrame = true;
+	return true;
+}
+
+void Timeline::endFrame()
+{
+	if ( !m_inFrame ) { return; }
+	m_inFrame = false;
+	m_currentFrame++;
+}
+
+int Timeline::getKey(const std::string& name)
+{
+	auto found = m_keys.find(name);
+	if ( found != m_keys.end() )
+	{
+		return found->second;
+	}
+
+	int key = (int) m_names.size();
+	m_names.push_back(name);
+	m_keys[name] = key;
+	m_slotIds.push_back( std::vector<int>() );
+	m_occurrences.push_back(0);
+	return key;
+}
+
+int Timeline::getSlot(int key, int occurrence, int type, int count, bool create)
+{
+	std::vector<int>& slotIds = m_slotIds[key];
+	if ( occurrence < (int) slotIds.size() )
+	{
+		const Slot& slot = m_slots[ slotIds[occurrence] ];
+		if ( slot.type != type || slot.count != count )
+		{
+			DEBUGLOG_VERBOSE("Timeline: type of parameter changed: " + m_names[key]);
+			return -1;
+		}
+		return slotIds[occurrence];
+	}
+	if ( !create )
+	{
+		return -1; // not tracked that often in the recording
+	}
+
+	// occurrences are counted up, so this is the next one
+	Slot slot;
+	slot.key = key;
+	slot.occurrence = occurrence;
+	slot.type = type;
+	slot.count = count;
+	slot.isSet = false;
+	slot.current.resize(count, 0);
+	m_slots.push_back(slot);
+	slotIds.push_back( (int) m_slots.size() - 1 );
+	return slotIds.back();
+}
+
+void Timeline::track(int key, int type, void* values, int count)
+{
+	if ( !isActive() || key < 0 || key >= (int) m_names.size() || count <= 0 ) { return; }
+
+	int occurrence = m_occurrences[key]++;
+	if ( occurrence == 0 )
+	{
+		m_trackedKeys.push_back(key);
+	}
+
+	size_t bytes = count * sizeof(unsigned int);
+	if ( m_mode == RECORDING )
+	{
+		int slotId = getSlot(key, occurrence, type, count, true);
+		if ( slotId < 0 ) { return; }
+
+		Slot& slot = m_slots[slotId];
+		if ( !slot.isSet || std::memcmp( &slot.current[0], values, bytes ) != 0 )
+		{
+			std::memcpy( &slot.current[0], values, bytes );
+			slot.isSet = true;
+			m_data.push_back( (unsigned int) slotId );
+			m_data.insert( m_data.end(), slot.current.begin(), slot.current.end() );
+			m_data[ m_frameOffsets.back() ]++;
+		}
+	}
+	else
+	{
+		int slotId = getSlot(key, occurrence, type, count, false);
+		if ( slotId >= 0 && m_slots[slotId].isSet )
+		{
+			std::memcpy( values, &m_slots[slotId].current[0], bytes );
+		}
+	}
+}
+
+void Timeline::track(int key, float* values, int count)
+{
+	track(key, FLOAT, values, count);
+}
+
+void Timeline::track(int key, int* values, int count)
+{
+	track(key, INT, values, count);
+}
+
+void Timeline::track(const std::string& name, float& value)
+{
+	if ( isActive() ) { track(getKey(name), &value, 1); }
+}
+
+void Timeline::track(const std::string& name, int& value)
+{
+	if ( isActive() ) { track(getKey(name), &value, 1); }
+}
+
+void Timeline::track(const std::string& name, bool& value)
+{
+	if ( !isActive() ) { return; }
+	int word = value ? 1 : 0;
+	track(getKey(name), &word, 1);
+	value = (word != 0);
+}
+
+void Timeline::track(const std::string& name, double& value)
+{
+	if ( !isActive() ) { return; }
+	float word = (float) value;
+	track(getKey(name), &word, 1);
+	if ( isReplaying() ) { value = (double) word; }
+}
+
+void Timeline::track(const std::string& name, glm::vec2& vector)
+{
+	if ( isActive() ) { track(getKey(name), glm::value_ptr(vector), 2); }
+}
+
+void Timeline::track(const std::string& name, glm::vec3& vector)
+{
+	if ( isActive() ) { track(getKey(name), glm::value_ptr(vector), 3); }
+}
+
+void Timeline::track(const std::string& name, glm::vec4& vector)
+{
+	if ( isActive() ) { track(getKey(name), glm::value_ptr(vector), 4); }
+}
+
+void Timeline::track(const std::string& name, glm::mat4& matrix)
+{
+	if ( isActive() ) { track(getKey(name), glm::value_ptr(matrix), 16); }
+}
+
+bool Timeline::save(const std::string& path) const
+{
+	std::ofstream file(path.c_str(), std::ofstream::binary);
+	if ( !file )
+	{
+		DEBUGLOG_ERROR("Timeline: could not open file for writing: " + path);
+		return false;
+	}
+
+	writeWord(file, s_magic);
+	writeWord(file, s_version);
+
+	// slots by name, so keys of the loading timeline may differ
+	writeWord(file, (unsigned int) m_slots.size());
+	for (unsigned int i = 0; i < m_slots.size(); i++)
+	{
+		const std::string& name = m_names[ m_slots[i].key ];
+		writeWord(file, (unsigned int) name.size());
+		file.write( name.data(), name.size() );
+		writeWord(file, (unsigned int) m_slots[i].occurrence);
+		writeWord(file, (unsigned int) m_slots[i].type);
+		writeWord(file, (unsigned int) m_slots[i].count);
+	}
+
+	writeWord(file, (unsigned int) m_data.size());
+	if ( !m_data.empty() )
+	{
+		file.write( (const char*) &m_data[0], m_data.size() * sizeof(unsigned int) );
+	}
+
+	if ( !file )
+	{
+		DEBUGLOG_ERROR("Timeline: could not write " + path);
+		return false;
+	}
+	DEBUGLOG->log("Timeline: saved " + path + ", frames: ", getNumFrames());
+	return true;
+}
+
+bool Timeline::load(const std::string& path)
+{
+	stop();
+
+	std::ifstream file(path.c_str(), std::ifstream::binary);
+	if ( !file )
+	{
+		DEBUGLOG_ERROR("Timeline: could not open file: " + path);
+		return false;
+	}
+
+	unsigned int magic = 0, version = 0, numSlots = 0;
+	if ( !readWord(file, magic) || !readWord(file, version) || magic != s_magic || version != s_version || !readWord(file, numSlots) )
+	{
+		DEBUGLOG_ERROR("Timeline: not a timeline file: " + path);
+		return false;
+	}
+
+	std::vector<Slot> slots;
+	for (unsigned int i = 0; i < numSlots; i++)
+	{
+		unsigned int nameLength = 0, occurrence = 0, type = 0, count = 0;
+		if ( !readWord(file, nameLength) || nameLength > 4096 ) { break; }
+		std::string name(nameLength, ' ');
+		file.read( &name[0], nameLength );
+		if ( !readWord(file, occurrence) || !readWord(file, type) || !readWord(file, count) || count == 0 || count > 1024 ) { break; }
+
+		Slot slot;
+		slot.key = getKey(name);
+		slot.occurrence = (int) occurrence;
+		slot.type = (int) type;
+		slot.count = (int) count;
+		slot.isSet = false;
+		slot.current.resize(count, 0);
+		slots.push_back(slot);
+	}
+
+	unsigned int numWords = 0;
+	std::vector<unsigned int> data;
+	bool valid = ( slots.size() == numSlots && readWord(file, numWords) );
+	if ( valid )
+	{
+		data.resize(numWords);
+		valid = ( numWords == 0 || file.read( (char*) &data[0], numWords * sizeof(unsigned int) ) );
+	}
+
+	// frame offsets, checking every change against the slots
+	std::vector<size_t> frameOffsets;
+	size_t position = 0;
+	while ( valid && position < data.size() )
+	{
+		frameOffsets.push_back(position);
+		unsigned int numChanges = data[position++];
+		for (unsigned int i = 0; valid && i < numChanges; i++)
+		{
+			valid = ( position < data.size() && data[position] < slots.size() );
+			if ( valid )
+			{
+				position += 1 + slots[ data[position] ].count;
+				valid = ( position <= data.size() );
+			}
+		}
+	}
+
+	// slots must be stored in order of their occurrence
+	std::vector< std::vector<int> > slotIds( m_names.size() );
+	for (unsigned int i = 0; valid && i < slots.size(); i++)
+	{
+		valid = ( slots[i].occurrence == (int) slotIds[ slots[i].key ].size() );
+		slotIds[ slots[i].key ].push_back( (int) i );
+	}
+
+	if ( !valid )
+	{
+		DEBUGLOG_ERROR("Timeline: corrupt file: " + path);
+		return false;
+	}
+
+	m_slots.swap(slots);
+	m_slotIds.swap(slotIds);
+	m_data.swap(data);
+	m_frameOffsets.swap(frameOffsets);
+	m_currentFrame = 0;
+
+	DEBUGLOG->log("Timeline: loaded " + path + ", frames: ", getNumFrames());
+	return true;
+}
+
+int Timeline::getNumFrames() const
+{
+	return (int) m_frameOffsets.size();
+}
+
+int Timeline::getCurrentFrame() const
+{
+	return m_currentFrame;
+}
+
+int Timeline::getNumParameters() const
+{
+	return (int) m_slots.size();
+}
+
+size_t Timeline::getNumBytes() const
+{
+	return m_data.size() * sizeof(unsigned int);
+}
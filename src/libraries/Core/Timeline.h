@@ -0,0 +1,116 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <glm/glm.hpp>
+
+/**
+ * @brief records named parameters per frame into a compact binary timeline and replays them
+ *
+ * Every frame is enclosed by beginFrame() and endFrame(). In between, track() is called for every
+ * parameter, e.g. camera matrices, GUI values or shader uniforms (see ShaderProgram::s_timeline):
+ * while recording, the value is stored; while replaying, it is overwritten by the recorded value of
+ * the same frame. A parameter tracked several times per frame is kept per occurrence, so a uniform
+ * set once per slice of a loop replays in the same order.
+ *
+ * Only values which changed since the previous frame are stored, as 32 bit words. Replays start at the
+ * first frame; as long as the application tracks everything that drives its control flow, a replay runs
+ * the same workload regardless of input, which makes sessions comparable across builds and GPUs.
+ */
+class Timeline
+{
+public:
+	enum Mode
+	{
+		IDLE,
+		RECORDING,
+		REPLAYING
+	};
+
+protected:
+	enum Type
+	{
+		FLOAT = 0,
+		INT = 1
+	};
+
+	struct Slot
+	{
+		int key;
+		int occurrence;                    //!< n-th track() of the key within a frame
+		int type;
+		int count;                         //!< 32 bit words of the value
+		bool isSet;                        //!< current holds a value of the timeline
+		std::vector<unsigned int> current; //!< value at the current frame
+	};
+
+	Mode m_mode;
+
+	std::vector<std::string> m_names;           //!< key -> name
+	std::map<std::string, int> m_keys;          //!< name -> key
+	std::vector< std::vector<int> > m_slotIds;  //!< key, occurrence -> slot
+	std::vector<Slot> m_slots;
+	std::vector<int> m_occurrences;             //!< key -> track() calls in the current frame
+	std::vector<int> m_trackedKeys;             //!< keys tracked in the current frame, to reset m_occurrences
+
+	std::vector<unsigned int> m_data;           //!< per frame: number of changes, then (slot, value words) per change
+	std::vector<size_t> m_frameOffsets;         //!< into m_data
+	std::vector<unsigned int> m_frameChanges;   //!< recording: changes of the current frame
+	int m_currentFrame;                         //!< frame between beginFrame() and endFrame(), or the next one
+	bool m_inFrame;
+
+	int getSlot(int key, int occurrence, int type, int count, bool create);
+	void track(int key, int type, void* values, int count);
+	void resetSlots();
+
+public:
+	Timeline();
+	~Timeline();
+
+	void record(); //!< discard the timeline and start recording with the next beginFrame()
+	bool replay(); //!< replay from the first frame; false if there is nothing to replay
+	void stop();   //!< stop recording or replaying; a recorded frame in progress is kept
+
+	/**
+	 * @brief start a frame; while replaying, the recorded changes of the frame are applied
+	 * @return false if nothing is recorded or replayed, e.g. the replay just ended
+	 */
+	bool beginFrame();
+	void endFrame();
+
+	/**
+	 * @brief key of a parameter name for the track() overloads taking keys, which skip the name lookup
+	 *
+	 * Keys stay valid for the lifetime of the timeline, also across record() and load().
+	 */
+	int getKey(const std::string& name);
+
+	void track(int key, float* values, int count);
+	void track(int key, int* values, int count);
+
+	void track(const std::string& name, float& value);
+	void track(const std::string& name, int& value);
+	void track(const std::string& name, bool& value);
+	void track(const std::string& name, double& value); //!< stored as float
+	void track(const std::string& name, glm::vec2& vector);
+	void track(const std::string& name, glm::vec3& vector);
+	void track(const std::string& name, glm::vec4& vector);
+	void track(const std::string& name, glm::mat4& matrix);
+
+	bool save(const std::string& path) const;
+	bool load(const std::string& path); //!< stops recording or replaying
+
+	inline Mode getMode() const { return m_mode; }
+	inline bool isActive() const { return m_mode != IDLE && m_inFrame; } //!< track() has an effect
+	inline bool isRecording() const { return m_mode == RECORDING; }
+	inline bool isReplaying() const { return m_mode == REPLAYING; }
+	int getNumFrames() const;
+	int getCurrentFrame() const;
+	int getNumParameters() const; //!< distinct parameter occurrences
+	size_t getNumBytes() const;   //!< of the recorded changes
+};
+
+#endif
@@ -0,0 +1,503 @@
+#include "Dicom.h"
+
+#include <Core/DebugLog.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#ifndef _WIN32
+	#include <dirent.h>
+#else
+	#include <windows.h>
+#endif
+
+namespace {
+	const unsigned int s_undefinedLength = 0xFFFFFFFF;
+	const unsigned int s_itemTag = 0xFFFEE000;
+	const unsigned int s_itemDelimitationTag = 0xFFFEE00D;
+	const unsigned int s_sequenceDelimitationTag = 0xFFFEE0DD;
+	const unsigned int s_pixelDataTag = 0x7FE00010;
+
+	const char* s_implicitLittleEndian = "1.2.840.10008.1.2";
+	const char* s_explicitLittleEndian = "1.2.840.10008.1.2.1";
+
+	bool isLittleEndianHost()
+	{
+		unsigned short probe = 1;
+		return *reinterpret_cast<unsigned char*>(&probe) == 1;
+	}
+
+	unsigned short toUShort(const unsigned char* bytes)
+	{
+		return (unsigned short) ( bytes[0] | (bytes[1] << 8) );
+	}
+
+	unsigned int toUInt(const unsigned char* bytes)
+	{
+		return (unsigned int) bytes[0] | ((unsigned int) bytes[1] << 8) | ((unsigned int) bytes[2] << 16) | ((unsigned int) bytes[3] << 24);
+	}
+
+	// VRs with a reserved field and a 32 bit length in explicit VR encoding
+	bool hasLongLength(const char* vr)
+	{
+		const char* longVRs[] = { "OB", "OD", "OF", "OL", "OV", "OW", "SQ", "SV", "UC", "UN", "UR", "UT", "UV" };
+		for (unsigned int i = 0; i < sizeof(longVRs) / sizeof(longVRs[0]); i++)
+		{
+			if ( vr[0] == longVRs[i][0] && vr[1] == longVRs[i][1] ) { return true; }
+		}
+		return false;
+	}
+
+	struct Element
+	{
+		unsigned int tag;
+		unsigned int length;
+	};
+
+	class HeaderReader
+	{
+	public:
+		std::ifstream file;
+		bool explicitVR;
+
+		bool read(void* target, size_t bytes)
+		{
+			return (bool) file.read( reinterpret_cast<char*>(target), bytes );
+		}
+
+		bool skip(size_t bytes)
+		{
+			return (bool) file.seekg( (std::streamoff) bytes, std::ifstream::cur );
+		}
+
+		size_t tell()
+		{
+			return (size_t) file.tellg();
+		}
+
+		// tag and length of the next element; group 0002 is explicit VR regardless of the transfer syntax
+		bool readElement(Element& element)
+		{
+			unsigned char bytes[8];
+			if ( !read(bytes, 8) ) { return false; }
+			element.tag = ( (unsigned int) toUShort(bytes) << 16 ) | toUShort(bytes + 2);
+
+			bool isItem = ( (element.tag >> 16) == 0xFFFE ); // items and delimiters have no VR
+			if ( isItem || !(explicitVR || (element.tag >> 16) == 0x0002) )
+			{
+				element.length = toUInt(bytes + 4);
+			}
+			else if ( hasLongLength( (const char*) bytes + 4 ) )
+			{
+				unsigned char length[4];
+				if ( !read(length, 4) ) { return false; }
+				element.length = toUInt(length);
+			}
+			else
+			{
+				element.length = toUShort(bytes + 6);
+			}
+			return true;
+		}
+
+		// skip elements until the delimiter, e.g. the items of a sequence of undefined length
+		bool skipUntil(unsigned int delimiterTag)
+		{
+			Element element;
+			while ( readElement(element) )
+			{
+				if ( element.tag == delimiterTag ) { return true; }
+				if ( element.length == s_undefinedLength )
+				{
+					unsigned int delimiter = ( element.tag == s_itemTag ) ? s_itemDelimitationTag : s_sequenceDelimitationTag;
+					if ( !skipUntil(delimiter) ) { return false; }
+				}
+				else if ( !skip(element.length) )
+				{
+					return false;
+				}
+			}
+			return false;
+		}
+	};
+
+	std::string trim(const std::string& value)
+	{
+		size_t end = value.find_last_not_of(std::string(" \0", 2));
+		size_t begin = value.find_first_not_of(' ');
+		return ( end == std::string::npos ) ? std::string() : value.substr(begin, end - begin + 1);
+	}
+
+	// multi-valued decimal strings, separated by backslashes
+	std::vector<float> toFloats(const std::string& value)
+	{
+		std::vector<float> result;
+		size_t begin = 0;
+		while ( begin <= value.size() )
+		{
+			size_t end = value.find('\\', begin);
+			if ( end == std::string::npos ) { end = value.size(); }
+			result.push_back( (float) std::atof( value.substr(begin, end - begin).c_str() ) );
+			begin = end + 1;
+		}
+		return result;
+	}
+
+	// pad to even length: UIDs with a zero byte, other strings with a space
+	void writeElement(std::vector<char>& target, unsigned short group, unsigned short element, const char* vr, const void* value, size_t length, char padding = ' ')
+	{
+		size_t paddedLength = length + (length % 2);
+		unsigned char header[12];
+		header[0] = group & 0xFF; header[1] = group >> 8;
+		header[2] = element & 0xFF; header[3] = element >> 8;
+		header[4] = vr[0]; header[5] = vr[1];
+		size_t headerLength = 8;
+		if ( hasLongLength(vr) )
+		{
+			header[6] = header[7] = 0;
+			for (int i = 0; i < 4; i++) { header[8 + i] = (paddedLength >> (8 * i)) & 0xFF; }
+			headerLength = 12;
+		}
+		else
+		{
+			header[6] = paddedLength & 0xFF; header[7] = (paddedLength >> 8) & 0xFF;
+		}
+		target.insert( target.end(), header, header + headerLength );
+		target.insert( target.end(), (const char*) value, (const char*) value + length );
+		if ( length % 2 ) { target.push_back(padding); }
+	}
+
+	void writeString(std::vector<char>& target, unsigned short group, unsigned short element, const char* vr, const std::string& value)
+	{
+		writeElement(target, group, element, vr, value.data(), value.size(), (vr[0] == 'U' && vr[1] == 'I') ? '\0' : ' ');
+	}
+
+	void writeUShort(std::vector<char>& target, unsigned short group, unsigned short element, unsigned short value)
+	{
+		unsigned char bytes[2] = { (unsigned char) (value & 0xFF), (unsigned char) (value >> 8) };
+		writeElement(target, group, element, "US", bytes, 2);
+	}
+}
+
+Dicom::SliceHeader::SliceHeader()
+	: isSupported(false),
+	rows(0),
+	columns(0),
+	samplesPerPixel(1),
+	numberOfFrames(1),
+	bitsAllocated(0),
+	bitsStored(0),
+	pixelRepresentation(0),
+	instanceNumber(0),
+	pixelSpacing(1.0f),
+	sliceThickness(0.0f),
+	spacingBetweenSlices(0.0f),
+	hasImagePosition(false),
+	imagePosition(0.0f),
+	hasImageOrientation(false),
+	rowDirection(1.0f, 0.0f, 0.0f),
+	columnDirection(0.0f, 1.0f, 0.0f),
+	rescaleSlope(1.0f),
+	rescaleIntercept(0.0f),
+	pixelDataOffset(0),
+	pixelDataLength(0)
+{
+}
+
+bool Dicom::readHeader(const std::string& path, SliceHeader& header)
+{
+	header = SliceHeader();
+	header.path = path;
+
+	HeaderReader reader;
+	reader.file.open( path.c_str(), std::ifstream::binary );
+	if ( !reader.file.is_open() ) { return false; }
+
+	// preamble and "DICM"; old files without start with the data set, implicit VR
+	char preamble[132];
+	bool hasPreamble = reader.read(preamble, 132) && std::memcmp(preamble + 128, "DICM", 4) == 0;
+	if ( !hasPreamble )
+	{
+		reader.file.clear();
+		reader.file.seekg(0);
+	}
+	reader.explicitVR = false; // until the meta group tells otherwise
+	bool inMetaGroup = true;
+
+	Element element;
+	while ( reader.readElement(element) )
+	{
+		unsigned int group = element.tag >> 16;
+		if ( !hasPreamble && inMetaGroup && group != 0x0002 && group != 0x0008 )
+		{
+			return false; // neither a meta group nor an identifying group: not a DICOM file
+		}
+		if ( inMetaGroup && group != 0x0002 )
+		{
+			// the data set starts: reread the element, which was read as implicit VR, in its transfer syntax
+			inMetaGroup = false;
+			reader.explicitVR = !header.transferSyntaxUID.empty() && header.transferSyntaxUID != s_implicitLittleEndian;
+			reader.file.seekg( -8, std::ifstream::cur );
+			continue;
+		}
+
+		if ( element.tag == s_pixelDataTag )
+		{
+			header.pixelDataOffset = reader.tell();
+			header.pixelDataLength = element.length;
+			break;
+		}
+
+		if ( element.length == s_undefinedLength )
+		{
+			if ( !reader.skipUntil(s_sequenceDelimitationTag) ) { return false; }
+			continue;
+		}
+
+		bool isWanted = ( group == 0x0002 || group == 0x0018 || group == 0x0020 || group == 0x0028 ) && element.length <= 256;
+		if ( !isWanted )
+		{
+			if ( !reader.skip(element.length) ) { return false; }
+			continue;
+		}
+
+		std::string value(element.length, '\0');
+		if ( element.length > 0 && !reader.read(&value[0], element.length) ) { return false; }
+		const unsigned char* bytes = (const unsigned char*) value.data();
+		unsigned int binary = ( element.length >= 2 ) ? toUShort(bytes) : 0; // US values are binary in every transfer syntax
+
+		switch ( element.tag )
+		{
+			case 0x00020010: header.transferSyntaxUID = trim(value); break;
+			case 0x0020000E: header.seriesInstanceUID = trim(value); break;
+			case 0x00200013: header.instanceNumber = std::atoi( trim(value).c_str() ); break;
+			case 0x00180050: header.sliceThickness = (float) std::atof( trim(value).c_str() ); break;
+			case 0x00180088: header.spacingBetweenSlices = (float) std::atof( trim(value).c_str() ); break;
+			case 0x00200032:
+			{
+				std::vector<float> position = toFloats( trim(value) );
+				if ( position.size() >= 3 )
+				{
+					header.imagePosition = glm::vec3(position[0], position[1], position[2]);
+					header.hasImagePosition = true;
+				}
+				break;
+			}
+			case 0x00200037:
+			{
+				std::vector<float> orientation = toFloats( trim(value) );
+				if ( orientation.size() >= 6 )
+				{
+					header.rowDirection    = glm::vec3(orientation[0], orientation[1], orientation[2]);
+					header.columnDirection = glm::vec3(orientation[3], orientation[4], orientation[5]);
+					header.hasImageOrientation = true;
+				}
+				break;
+			}
+			case 0x00280002: header.samplesPerPixel = binary; break;
+			case 0x00280008: header.numberOfFrames = std::max(1, std::atoi( trim(value).c_str() )); break;
+			case 0x00280010: header.rows = binary; break;
+			case 0x00280011: header.columns = binary; break;
+			case 0x00280030:
+			{
+				std::vector<float> spacing = toFloats( trim(value) ); // between rows, between columns
+				if ( spacing.size() >= 2 )
+				{
+					header.pixelSpacing = glm::vec2(spacing[1], spacing[0]);
+				}
+				break;
+			}
+			case 0x00280100: header.bitsAllocated = binary; break;
+			case 0x00280101: header.bitsStored = binary; break;
+			case 0x00280103: header.pixelRepresentation = binary; break;
+			case 0x00281052: header.rescaleIntercept = (float) std::atof( trim(value).c_str() ); break;
+			case 0x00281053: header.rescaleSlope = (float) std::atof( trim(value).c_str() ); break;
+			default: break;
+		}
+	}
+
+	if ( header.pixelDataOffset == 0 )
+	{
+		return false; // no image
+	}
+
+	if ( header.bitsStored == 0 || header.bitsStored > header.bitsAllocated ) { header.bitsStored = header.bitsAllocated; }
+	if ( header.rescaleSlope == 0.0f ) { header.rescaleSlope = 1.0f; }
+
+	size_t numBytes = (size_t) header.rows * header.columns * (header.bitsAllocated / 8);
+	bool littleEndian = header.transferSyntaxUID.empty() || header.transferSyntaxUID == s_implicitLittleEndian || header.transferSyntaxUID == s_explicitLittleEndian;
+	header.isSupported = littleEndian
+		&& header.pixelDataLength != s_undefinedLength // encapsulated, i.e. compressed
+		&& header.samplesPerPixel == 1
+		&& header.numberOfFrames == 1
+		&& ( header.bitsAllocated == 8 || header.bitsAllocated == 16 )
+		&& numBytes > 0
+		&& header.pixelDataLength >= numBytes;
+	return true;
+}
+
+bool Dicom::readPixels(const SliceHeader& header, short* target, short& min, short& max)
+{
+	if ( !header.isSupported ) { return false; }
+
+	std::ifstream file( header.path.c_str(), std::ifstream::binary );
+	if ( !file.is_open() ) { return false; }
+	file.seekg( (std::streamoff) header.pixelDataOffset );
+
+	size_t numPixels = (size_t) header.rows * header.columns;
+	char* bytes = reinterpret_cast<char*>(target);
+	bool is16Bit = ( header.bitsAllocated == 16 );
+
+	// 8 bit pixels are read into the upper half of the target and widened in place, front to back
+	char* destination = is16Bit ? bytes : bytes + numPixels;
+	size_t numBytes = is16Bit ? numPixels * 2 : numPixels;
+	if ( !file.read(destination, numBytes) ) { return false; }
+
+	bool isSigned = ( header.pixelRepresentation == 1 );
+	bool rescale = ( header.rescaleSlope != 1.0f || header.rescaleIntercept != 0.0f );
+	int shift = (int) header.bitsAllocated - (int) header.bitsStored;
+	int mask = (1 << header.bitsStored) - 1;
+	bool swap = is16Bit && !isLittleEndianHost();
+
+	int minValue = std::numeric_limits<int>::max();
+	int maxValue = std::numeric_limits<int>::min();
+	if ( is16Bit && isSigned && shift == 0 && !rescale && !swap )
+	{
+		// stored as is: only the range is needed
+		short minStored = target[0];
+		short maxStored = target[0];
+		for (size_t i = 1; i < numPixels; i++)
+		{
+			minStored = std::min(minStored, target[i]);
+			maxStored = std::max(maxStored, target[i]);
+		}
+		minValue = minStored;
+		maxValue = maxStored;
+	}
+	else
+	{
+		const unsigned char* source = reinterpret_cast<const unsigned char*>(destination);
+		for (size_t i = 0; i < numPixels; i++)
+		{
+			int raw = is16Bit ? ( swap ? toUShort(source + 2 * i) : (int) reinterpret_cast<const unsigned short*>(source)[i] ) : (int) source[i];
+			int value = isSigned
+				? ( (int) ( (unsigned int) raw << (32 - header.bitsStored) ) >> (32 - header.bitsStored) ) // sign extension of the stored bits
+				: ( raw & mask );
+			if ( rescale )
+			{
+				value = (int) std::floor( (float) value * header.rescaleSlope + header.rescaleIntercept + 0.5f );
+			}
+			value = std::max( (int) std::numeric_limits<short>::min(), std::min( (int) std::numeric_limits<short>::max(), value ) );
+			target[i] = (short) value;
+			minValue = std::min(minValue, value);
+			maxValue = std::max(maxValue, value);
+		}
+	}
+
+	min = (short) minValue;
+	max = (short) maxValue;
+	return true;
+}
+
+bool Dicom::writeSlice(const std::string& path, const short* values, unsigned int columns, unsigned int rows, const glm::vec3& imagePosition, const glm::vec2& pixelSpacing, int instanceNumber, const std::string& seriesInstanceUID)
+{
+	std::string sopClassUID = "1.2.840.10008.5.1.4.1.1.7"; // secondary capture
+	std::string sopInstanceUID = seriesInstanceUID + "." + std::to_string(instanceNumber);
+	char buffer[256];
+
+	std::vector<char> meta;
+	const char version[2] = { 0, 1 };
+	writeElement(meta, 0x0002, 0x0001, "OB", version, 2);
+	writeString(meta, 0x0002, 0x0002, "UI", sopClassUID);
+	writeString(meta, 0x0002, 0x0003, "UI", sopInstanceUID);
+	writeString(meta, 0x0002, 0x0010, "UI", s_explicitLittleEndian);
+
+	std::vector<char> data;
+	writeString(data, 0x0008, 0x0016, "UI", sopClassUID);
+	writeString(data, 0x0008, 0x0018, "UI", sopInstanceUID);
+	writeString(data, 0x0008, 0x0060, "CS", "OT");
+	writeString(data, 0x0020, 0x000E, "UI", seriesInstanceUID);
+	writeString(data, 0x0020, 0x0013, "IS", std::to_string(instanceNumber));
+	std::snprintf(buffer, sizeof(buffer), "%g\\%g\\%g", imagePosition.x, imagePosition.y, imagePosition.z);
+	writeString(data, 0x0020, 0x0032, "DS", buffer);
+	writeString(data, 0x0020, 0x0037, "DS", "1\\0\\0\\0\\1\\0");
+	writeUShort(data, 0x0028, 0x0002, 1);
+	writeString(data, 0x0028, 0x0004, "CS", "MONOCHROME2");
+	writeUShort(data, 0x0028, 0x0010, (unsigned short) rows);
+	writeUShort(data, 0x0028, 0x0011, (unsigned short) columns);
+	std::snprintf(buffer, sizeof(buffer), "%g\\%g", pixelSpacing.y, pixelSpacing.x);
+	writeString(data, 0x0028, 0x0030, "DS", buffer);
+	writeUShort(data, 0x0028, 0x0100, 16);
+	writeUShort(data, 0x0028, 0x0101, 16);
+	writeUShort(data, 0x0028, 0x0102, 15);
+	writeUShort(data, 0x0028, 0x0103, 1);
+
+	std::ofstream file( path.c_str(), std::ofstream::binary );
+	if ( !file )
+	{
+		DEBUGLOG_ERROR("could not open file for writing: " + path);
+		return false;
+	}
+
+	char preamble[132] = { 0 };
+	std::memcpy(preamble + 128, "DICM", 4);
+	file.write(preamble, 132);
+
+	std::vector<char> groupLength;
+	unsigned char length[4];
+	for (int i = 0; i < 4; i++) { length[i] = (meta.size() >> (8 * i)) & 0xFF; }
+	writeElement(groupLength, 0x0002, 0x0000, "UL", length, 4);
+	file.write( &groupLength[0], groupLength.size() );
+	file.write( &meta[0], meta.size() );
+	file.write( &data[0], data.size() );
+
+	// pixel data header, values in native (little endian) byte order
+	std::vector<char> pixelHeader;
+	writeElement(pixelHeader, 0x7FE0, 0x0010, "OW", 0, 0);
+	size_t numBytes = (size_t) columns * rows * sizeof(short);
+	for (int i = 0; i < 4; i++) { pixelHeader[8 + i] = (char) ( (numBytes >> (8 * i)) & 0xFF ); }
+	file.write( &pixelHeader[0], pixelHeader.size() );
+	file.write( reinterpret_cast<const char*>(values), numBytes );
+
+	return (bool) file;
+}
+
+std::vector<std::string> Dicom::listFiles(const std::string& directory)
+{
+	std::vector<std::string> files;
+#ifndef _WIN32
+	DIR* dir = opendir( directory.c_str() );
+	if ( !dir )
+	{
+		DEBUGLOG_ERROR("could not open directory: " + directory);
+		return files;
+	}
+	while ( struct dirent* entry = readdir(dir) )
+	{
+		if ( entry->d_name[0] == '.' ) { continue; } // also skips . and ..
+		files.push_back( directory + "/" + entry->d_name );
+	}
+	closedir(dir);
+#else
+	WIN32_FIND_DATAA entry;
+	HANDLE find = FindFirstFileA( (directory + "\\*").c_str(), &entry );
+	if ( find == INVALID_HANDLE_VALUE )
+	{
+		DEBUGLOG_ERROR("could not open directory: " + directory);
+		return files;
+	}
+	do
+	{
+		if ( entry.cFileName[0] == '.' || (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ) { continue; }
+		files.push_back( directory + "/" + entry.cFileName );
+	} while ( FindNextFileA(find, &entry) );
+	FindClose(find);
+#endif
+	std::sort(files.begin(), files.end());
+	return files;
+}
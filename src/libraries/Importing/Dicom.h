@@ -0,0 +1,95 @@
+#ifndef DICOM_H
+#define DICOM_H
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/**
+ * @brief minimal DICOM reader for uncompressed single frame grayscale slices, see Importer::loadDicomSeries
+ *
+ * Supported are the implicit and explicit VR little endian transfer syntaxes (and files without preamble,
+ * read as implicit VR little endian) with 8 or 16 bits allocated per pixel. Headers are parsed until the
+ * pixel data, skipping everything else including nested sequences; the pixels are read separately,
+ * straight into the caller's memory. All functions are thread safe.
+ */
+namespace Dicom {
+	struct SliceHeader
+	{
+		std::string path;
+		std::string transferSyntaxUID;
+		std::string seriesInstanceUID;
+		bool isSupported;             //!< the pixels can be read by readPixels()
+
+		unsigned int rows;
+		unsigned int columns;
+		unsigned int samplesPerPixel;
+		unsigned int numberOfFrames;
+		unsigned int bitsAllocated;
+		unsigned int bitsStored;
+		unsigned int pixelRepresentation; //!< 0: unsigned, 1: two's complement
+
+		int instanceNumber;
+		glm::vec2 pixelSpacing;       //!< x: between columns, y: between rows, mm
+		float sliceThickness;         //!< mm, 0 if unknown
+		float spacingBetweenSlices;   //!< mm, 0 if unknown
+		bool hasImagePosition;
+		glm::vec3 imagePosition;      //!< of the first pixel, patient coordinates in mm
+		bool hasImageOrientation;
+		glm::vec3 rowDirection;       //!< direction of increasing column index
+		glm::vec3 columnDirection;    //!< direction of increasing row index
+
+		float rescaleSlope;
+		float rescaleIntercept;
+
+		size_t pixelDataOffset;       //!< bytes from the beginning of the file
+		size_t pixelDataLength;
+
+		SliceHeader();
+	};
+
+	/**
+	 * @brief parse the header of a DICOM file
+	 *
+	 * @param path of the file
+	 * @param header to be filled
+	 * @return false if the file is no DICOM image, e.g. a DICOMDIR or an unrelated file
+	 */
+	bool readHeader(const std::string& path, SliceHeader& header);
+
+	/**
+	 * @brief read the pixels of a supported slice, rescaled by slope and intercept and clamped to short
+	 *
+	 * The pixels are read straight into target and converted in place.
+	 *
+	 * @param header of the slice, header.isSupported
+	 * @param target rows * columns values, row by row
+	 * @param min of the values read
+	 * @param max of the values read
+	 * @return false if the pixel data could not be read completely
+	 */
+	bool readPixels(const SliceHeader& header, short* target, short& min, short& max);
+
+	/**
+	 * @brief write a 16 bit signed slice in explicit VR little endian, e.g. to test or benchmark the importer
+	 *
+	 * @param path of the file
+	 * @param values columns * rows values, row by row
+	 * @param columns of the slice
+	 * @param rows of the slice
+	 * @param imagePosition of the first pixel in mm, axial orientation
+	 * @param pixelSpacing x: between columns, y: between rows, mm
+	 * @param instanceNumber of the slice, also part of its instance UID
+	 * @param seriesInstanceUID of the series
+	 * @return false if the file could not be written
+	 */
+	bool writeSlice(const std::string& path, const short* values, unsigned int columns, unsigned int rows, const glm::vec3& imagePosition, const glm::vec2& pixelSpacing, int instanceNumber, const std::string& seriesInstanceUID);
+
+	/**
+	 * @brief paths of the files in a directory, not recursive, sorted by name
+	 */
+	std::vector<std::string> listFiles(const std::string& directory);
+} // namespace Dicom
+
+#endif
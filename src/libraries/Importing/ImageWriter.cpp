@@ -0,0 +1,169 @@
+#include "ImageWriter.h"
+
+#include <Core/DebugLog.h>
+
+#include <fstream>
+#include <cstring>
+
+namespace {
+	void appendBigEndian(std::vector<unsigned char>& out, unsigned int value)
+	{
+		out.push_back( (unsigned char) (value >> 24) );
+		out.push_back( (unsigned char) (value >> 16) );
+		out.push_back( (unsigned char) (value >> 8) );
+		out.push_back( (unsigned char) value );
+	}
+
+	void appendChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data)
+	{
+		appendBigEndian(out, (unsigned int) data.size());
+		size_t typeOffset = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+		appendBigEndian(out, ImageWriter::crc32(&out[typeOffset], out.size() - typeOffset));
+	}
+
+	bool writeFile(const std::string& path, const std::vector<unsigned char>& header, const unsigned char* data, size_t size)
+	{
+		std::ofstream file(path.c_str(), std::ofstream::binary);
+		if ( !file.is_open() )
+		{
+			DEBUGLOG_ERROR("could not open file for writing: " + path);
+			return false;
+		}
+		if ( !header.empty() ) { file.write( (const char*) &header[0], header.size() ); }
+		if ( size ) { file.write( (const char*) data, size ); }
+		return file.good();
+	}
+}
+
+unsigned int ImageWriter::crc32(const unsigned char* data, size_t size, unsigned int crc)
+{
+	static unsigned int table[256];
+	static bool initialized = [](){
+		for (unsigned int n = 0; n < 256; n++)
+		{
+			unsigned int c = n;
+			for (int k = 0; k < 8; k++) { c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1; }
+			table[n] = c;
+		}
+		return true;
+	}();
+	(void) initialized;
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+	{
+		crc = table[ (crc ^ data[i]) & 0xFF ] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+bool ImageWriter::writePNG(const std::string& path, const unsigned char* rgba, int width, int height)
+{
+	std::vector<unsigned char> png;
+	const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	png.insert(png.end(), signature, signature + 8);
+
+	std::vector<unsigned char> header;
+	appendBigEndian(header, (unsigned int) width);
+	appendBigEndian(header, (unsigned int) height);
+	const unsigned char format[5] = { 8, 6, 0, 0, 0 }; // 8 bit, RGBA, deflate, adaptive filtering, no interlace
+	header.insert(header.end(), format, format + 5);
+	appendChunk(png, "IHDR", header);
+
+	// zlib stream of stored deflate blocks; every row is prefixed by filter type 0 (none)
+	size_t rowBytes = (size_t) width * 4 + 1;
+	size_t rawSize = rowBytes * height;
+	std::vector<unsigned char> zlib;
+	zlib.reserve( rawSize + rawSize / 65535 * 5 + 16 );
+	zlib.push_back(0x78);
+	zlib.push_back(0x01);
+
+	unsigned int adlerA = 1;
+	unsigned int adlerB = 0;
+	unsigned int adlerRun = 0;
+	std::vector<unsigned char> block;
+	block.reserve(65535);
+	size_t written = 0;
+	auto flushBlock = [&](bool last)
+	{
+		unsigned int length = (unsigned int) block.size();
+		zlib.push_back( last ? 1 : 0 );
+		zlib.push_back( (unsigned char) length );
+		zlib.push_back( (unsigned char) (length >> 8) );
+		zlib.push_back( (unsigned char) ~length );
+		zlib.push_back( (unsigned char) (~length >> 8) );
+		zlib.insert(zlib.end(), block.begin(), block.end());
+		block.clear();
+	};
+	auto append = [&](const unsigned char* bytes, size_t size)
+	{
+		for (size_t i = 0; i < size; )
+		{
+			size_t n = std::min( size - i, (size_t) 65535 - block.size() );
+			block.insert(block.end(), bytes + i, bytes + i + n);
+			for (size_t k = 0; k < n; k++)
+			{
+				adlerA += bytes[i + k];
+				adlerB += adlerA;
+				if ( ++adlerRun == 5552 ) // longest run without overflow of adlerB
+				{
+					adlerA %= 65521;
+					adlerB %= 65521;
+					adlerRun = 0;
+				}
+			}
+			i += n;
+			written += n;
+			if ( block.size() == 65535 && written < rawSize ) { flushBlock(false); }
+		}
+	};
+
+	const unsigned char filter = 0;
+	for (int y = height - 1; y >= 0; y--)
+	{
+		append(&filter, 1);
+		append(rgba + (size_t) y * width * 4, (size_t) width * 4);
+	}
+	flushBlock(true);
+	adlerA %= 65521;
+	adlerB %= 65521;
+	appendBigEndian(zlib, (adlerB << 16) | adlerA);
+
+	appendChunk(png, "IDAT", zlib);
+	appendChunk(png, "IEND", std::vector<unsigned char>());
+
+	return writeFile(path, std::vector<unsigned char>(), &png[0], png.size());
+}
+
+bool ImageWriter::writePGM16(const std::string& path, const unsigned short* values, int width, int height)
+{
+	std::string header = "P5\n" + std::to_string(width) + " " + std::to_string(height) + "\n65535\n";
+
+	// big endian samples, top row first
+	std::vector<unsigned char> data( (size_t) width * height * 2 );
+	for (int y = 0; y < height; y++)
+	{
+		const unsigned short* row = values + (size_t) (height - 1 - y) * width;
+		unsigned char* target = &data[ (size_t) y * width * 2 ];
+		for (int x = 0; x < width; x++)
+		{
+			target[2 * x]     = (unsigned char) (row[x] >> 8);
+			target[2 * x + 1] = (unsigned char) row[x];
+		}
+	}
+
+	return writeFile(path, std::vector<unsigned char>(header.begin(), header.end()), data.empty() ? 0 : &data[0], data.size());
+}
+
+bool ImageWriter::writeRaw(const std::string& path, const void* pixels, int width, int height, int bytesPerPixel)
+{
+	size_t rowBytes = (size_t) width * bytesPerPixel;
+	std::vector<unsigned char> data( rowBytes * height );
+	for (int y = 0; y < height; y++)
+	{
+		std::memcpy( &data[ (size_t) y * rowBytes ], (const unsigned char*) pixels + (size_t) (height - 1 - y) * rowBytes, rowBytes );
+	}
+	return writeFile(path, std::vector<unsigned char>(), data.empty() ? 0 : &data[0], data.size());
+}
@@ -0,0 +1,49 @@
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief minimal encoders for exporting rendered frames, without external dependencies
+ *
+ * All writers take rows in OpenGL order (row 0 is the bottom row) and store them top to bottom.
+ * Files are written in one go; the functions are thread safe, so frames can be encoded on the ThreadPool.
+ */
+namespace ImageWriter {
+	/**
+	 * @brief write 8 bit RGBA as PNG
+	 *
+	 * The image data is stored in uncompressed deflate blocks: encoding costs little more than a copy,
+	 * at the price of file size. Any PNG reader accepts it; compress afterwards if needed.
+	 *
+	 * @param path of the file
+	 * @param rgba width * height * 4 bytes
+	 * @param width of the image
+	 * @param height of the image
+	 * @return false if the file could not be written
+	 */
+	bool writePNG(const std::string& path, const unsigned char* rgba, int width, int height);
+
+	/**
+	 * @brief write 16 bit grayscale as binary PGM (P5, maxval 65535)
+	 *
+	 * @param path of the file
+	 * @param values width * height values
+	 * @param width of the image
+	 * @param height of the image
+	 * @return false if the file could not be written
+	 */
+	bool writePGM16(const std::string& path, const unsigned short* values, int width, int height);
+
+	/**
+	 * @brief write headerless rows of bytesPerPixel bytes, top to bottom, e.g. for Importer::loadRaw
+	 *
+	 * @return false if the file could not be written
+	 */
+	bool writeRaw(const std::string& path, const void* pixels, int width, int height, int bytesPerPixel);
+
+	unsigned int crc32(const unsigned char* data, size_t size, unsigned int crc = 0); //!< CRC of PNG chunks
+} // namespace ImageWriter
+
+#endif
@@ -1,67 +1,170 @@
 #include "Importer.h"
 
+#include "Dicom.h"
+
+#include <Core/ThreadPool.h>
+
+#include <map>
+#include <chrono>
+
 VolumeData<short> Importer::loadBruder()
 {
 	std::string path = RESOURCES_PATH +  std::string( "/Bruder/psirInt16Signed.raw");
-		
-	DEBUGLOG->log("Loading file: " + path);
-	DEBUGLOG->log("Reading slice data...");
 
-	VolumeData<short> result;
-	result.size_x = 240;
-	result.size_y = 240;
-	result.size_z = 190;
-	result.data.clear();
-
-	short min = SHRT_MAX;
-	short max = SHRT_MIN;
+	return loadRaw<short>(path, 240, 240, 190);
+}
 
-	std::string current_file_path = path;
+VolumeData<short> Importer::loadDicomSeries(const std::string& directory)
+{
+	DEBUGLOG->log("Loading DICOM series from directory: " + directory);
+	return loadDicomSeries( Dicom::listFiles(directory) );
+}
 
-	// read file into input vector
-	std::ifstream file( current_file_path.c_str(), std::ifstream::binary);	
-	std::vector<short> input;
+VolumeData<short> Importer::loadDicomSeries(const std::vector<std::string>& files)
+{
+	auto start = std::chrono::high_resolution_clock::now();
 
-	// load data
-	if (file.is_open()) 
+	VolumeData<short> result;
+	result.size_x = result.size_y = result.size_z = 0;
+	result.real_size_x = result.real_size_y = result.real_size_z = 1.0f;
+	result.min = result.max = 0;
+
+	// headers of all files, in parallel
+	std::vector<Dicom::SliceHeader> headers( files.size() );
+	std::vector<char> isImage( files.size(), 0 );
+	THREADPOOL->parallelFor(0, (int) files.size(), [&](int begin, int end)
 	{
-
-		// get (byte) length of file:
-		file.seekg (0, file.end);
-		int length = file.tellg();
-		file.seekg (0, file.beg);
-
-		// allocate memory:
-		input.resize(length / 2 + 1 );
-
-		//DEBUGLOG->log("file length: ", length);
-		//DEBUGLOG->log("input size : ", input.size());
-		//DEBUGLOG->log("shorts to read:", 10944000);
-
-		int i = 0;
-		while ( file.good())
+		for (int i = begin; i < end; i++)
 		{
-			short val;
-			file.read(reinterpret_cast<char*>(&val), sizeof val);
+			isImage[i] = Dicom::readHeader(files[i], headers[i]) ? 1 : 0;
+		}
+	}, 4);
 
-			input[i] = val;
+	// largest series of supported slices
+	std::map<std::string, std::vector<const Dicom::SliceHeader*> > series;
+	int numUnsupported = 0;
+	for (unsigned int i = 0; i < headers.size(); i++)
+	{
+		if ( !isImage[i] ) { continue; }
+		if ( !headers[i].isSupported )
+		{
+			numUnsupported++;
+			continue;
+		}
+		series[ headers[i].seriesInstanceUID ].push_back( &headers[i] );
+	}
+	if ( numUnsupported > 0 )
+	{
+		DEBUGLOG_WARNING("DICOM: skipped slices with unsupported encoding (compressed, big endian, color or multi-frame): ", numUnsupported);
+	}
+	if ( series.empty() )
+	{
+		DEBUGLOG_ERROR("DICOM: no readable slices found");
+		return result;
+	}
 
-			min = std::min<short>(val, min);
-			max = std::max<short>(val, max);
+	std::vector<const Dicom::SliceHeader*> slices;
+	for (auto it = series.begin(); it != series.end(); ++it)
+	{
+		if ( it->second.size() > slices.size() ) { slices = it->second; }
+	}
+	if ( series.size() > 1 )
+	{
+		DEBUGLOG_WARNING("DICOM: several series found, loading the largest: " + slices[0]->seriesInstanceUID);
+	}
 
-			if (i % (result.size_x * result.size_y) == 0 )
-			{ std::cout << "."; }
+	// slices must match the first one
+	const Dicom::SliceHeader& first = *slices[0];
+	size_t numMatching = 0;
+	for (unsigned int i = 0; i < slices.size(); i++)
+	{
+		if ( slices[i]->rows == first.rows && slices[i]->columns == first.columns ) { slices[numMatching++] = slices[i]; }
+	}
+	if ( numMatching < slices.size() )
+	{
+		DEBUGLOG_WARNING("DICOM: skipped slices of different size: ", (unsigned int) (slices.size() - numMatching));
+		slices.resize(numMatching);
+	}
 
-			i++;
+	// sort along the slice normal; files without position by instance number, then by name
+	glm::vec3 normal = glm::cross(first.rowDirection, first.columnDirection);
+	bool usePosition = true;
+	for (unsigned int i = 0; i < slices.size(); i++)
+	{
+		usePosition = usePosition && slices[i]->hasImagePosition;
+	}
+	auto sliceLocation = [&](const Dicom::SliceHeader* slice)
+	{
+		return usePosition ? glm::dot(slice->imagePosition, normal) : (float) slice->instanceNumber;
+	};
+	std::sort(slices.begin(), slices.end(), [&](const Dicom::SliceHeader* a, const Dicom::SliceHeader* b)
+	{
+		float locationA = sliceLocation(a);
+		float locationB = sliceLocation(b);
+		return ( locationA != locationB ) ? locationA < locationB : a->path < b->path;
+	});
+
+	// slice distance: median of consecutive locations, robust against a missing or duplicated slice
+	float sliceDistance = 0.0f;
+	if ( usePosition && slices.size() > 1 )
+	{
+		std::vector<float> distances;
+		for (unsigned int i = 1; i < slices.size(); i++)
+		{
+			distances.push_back( sliceLocation(slices[i]) - sliceLocation(slices[i - 1]) );
+		}
+		std::nth_element(distances.begin(), distances.begin() + distances.size() / 2, distances.end());
+		sliceDistance = distances[ distances.size() / 2 ];
+	}
+	if ( sliceDistance <= 0.0f ) { sliceDistance = first.spacingBetweenSlices; }
+	if ( sliceDistance <= 0.0f ) { sliceDistance = first.sliceThickness; }
+	if ( sliceDistance <= 0.0f ) { sliceDistance = 1.0f; }
+
+	result.size_x = first.columns;
+	result.size_y = first.rows;
+	result.size_z = (unsigned int) slices.size();
+	result.real_size_x = first.pixelSpacing.x;
+	result.real_size_y = first.pixelSpacing.y;
+	result.real_size_z = sliceDistance;
+
+	DEBUGLOG->log("DICOM series: " + std::to_string(result.size_x) + " x " + std::to_string(result.size_y) + " x " + std::to_string(result.size_z) + " voxels, spacing (mm): ",
+		glm::vec3(result.real_size_x, result.real_size_y, result.real_size_z));
+
+	// every slice is decoded straight into its place in the volume, in parallel
+	size_t sliceSize = (size_t) result.size_x * result.size_y;
+	result.data.resize( sliceSize * result.size_z );
+	std::vector<short> sliceMin( slices.size(), 0 );
+	std::vector<short> sliceMax( slices.size(), 0 );
+	std::vector<char> isRead( slices.size(), 0 );
+	THREADPOOL->parallelFor(0, (int) slices.size(), [&](int begin, int end)
+	{
+		for (int z = begin; z < end; z++)
+		{
+			isRead[z] = Dicom::readPixels(*slices[z], &result.data[z * sliceSize], sliceMin[z], sliceMax[z]) ? 1 : 0;
 		}
-		std::cout << std::endl;
+	});
 
-		file.close();
+	bool hasRange = false;
+	int numFailed = 0;
+	for (unsigned int z = 0; z < slices.size(); z++)
+	{
+		if ( !isRead[z] )
+		{
+			numFailed++;
+			std::fill( result.data.begin() + z * sliceSize, result.data.begin() + (z + 1) * sliceSize, (short) 0 );
+			continue;
+		}
+		result.min = hasRange ? std::min(result.min, sliceMin[z]) : sliceMin[z];
+		result.max = hasRange ? std::max(result.max, sliceMax[z]) : sliceMax[z];
+		hasRange = true;
+	}
+	if ( numFailed > 0 )
+	{
+		DEBUGLOG_WARNING("DICOM: slices could not be read and were set to 0: ", numFailed);
 	}
 
-	result.data.insert(result.data.end(), input.begin(), input.end());
-	result.min = min;		
-	result.max = max;
+	double milliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+	DEBUGLOG->log("DICOM series loaded in ms: ", milliseconds);
 
 	return result;
-}
\ No newline at end of file
+}
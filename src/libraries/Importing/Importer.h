@@ -11,24 +11,44 @@
 #include <Core/DebugLog.h>
 
 #include <algorithm>
+#include <memory>
+#include <utility>
+
+/**
+ * @brief std::allocator which default-initializes, i.e. leaves values uninitialized on resize()
+ *
+ * Volumes are completely written after allocation, mostly in parallel: skipping the serial zero fill
+ * saves a pass over the memory and lets the writing threads touch the pages first.
+ */
+template<class T>
+struct DefaultInitAllocator : public std::allocator<T>
+{
+	template<class U> struct rebind { typedef DefaultInitAllocator<U> other; };
+
+	DefaultInitAllocator() {}
+	template<class U> DefaultInitAllocator(const DefaultInitAllocator<U>&) {}
+
+	template<class U> void construct(U* p) { ::new( (void*) p ) U; }
+	template<class U, class... Args> void construct(U* p, Args&&... args) { ::new( (void*) p ) U( std::forward<Args>(args)... ); }
+};
 
 template<class T>
 struct VolumeData
 {
-	unsigned int size_x; //!< x: left
-	unsigned int size_y; //!< y: forward
-	unsigned int size_z; //!< z: up
+	unsigned int size_x = 0; //!< x: left
+	unsigned int size_y = 0; //!< y: forward
+	unsigned int size_z = 0; //!< z: up
 
-	std::vector<T> data; //!< size: x
+	std::vector<T, DefaultInitAllocator<T> > data; //!< size: x * y * z; not initialized by resize()
 
 	//std::vector<T> midSlice;
 
-	float real_size_x; // actual step size in mm
-	float real_size_y; // acutal step size in mm
-	float real_size_z; // acutal step size in mm
+	float real_size_x = 1.0f; // actual step size in mm
+	float real_size_y = 1.0f; // acutal step size in mm
+	float real_size_z = 1.0f; // acutal step size in mm
 
-	T min;
-	T max;
+	T min = T(0);
+	T max = T(0);
 };
 
 namespace Importer {
@@ -49,6 +69,9 @@ namespace Importer {
 		result.size_x = size_x;
 		result.size_y = size_y;
 		result.size_z = num_files;
+		result.real_size_x = 1.0f; // unknown: isotropic
+		result.real_size_y = 1.0f;
+		result.real_size_z = 1.0f;
 		result.data.clear();
 
 		T min = SHRT_MAX;
@@ -121,7 +144,94 @@ namespace Importer {
 		return result;
 	}
 
+	/**
+	 * @brief read a headerless raw file holding values of type T in native byte order directly into target
+	 *
+	 * @param path to the raw file
+	 * @param target memory for numValues values
+	 * @param numValues amount of values to be read
+	 * @return amount of values read; 0 if the file could not be opened
+	 */
+	template<class T>
+	size_t readRaw(std::string path, T* target, size_t numValues)
+	{
+		std::ifstream file( path.c_str(), std::ifstream::binary);
+		if ( !file.is_open() )
+		{
+			DEBUGLOG_ERROR("could not open file: " + path);
+			return 0;
+		}
+
+		file.read( reinterpret_cast<char*>( target ), numValues * sizeof(T) );
+		size_t numRead = (size_t) file.gcount() / sizeof(T);
+		if ( numRead < numValues )
+		{
+			DEBUGLOG_WARNING("file is smaller than expected, values read: ", (unsigned int) numRead);
+		}
+		file.close();
+
+		return numRead;
+	}
+
+	/**
+	 * @brief load a headerless raw file holding size_x * size_y * size_z values of type T in native byte order
+	 *
+	 * @param path to the raw file
+	 * @param size_x of the volume
+	 * @param size_y of the volume
+	 * @param size_z of the volume
+	 * @return data from file; missing values at the end of a short file are set to 0
+	 */
+	template<class T>
+	VolumeData<T> loadRaw(std::string path, unsigned int size_x, unsigned int size_y, unsigned int size_z)
+	{
+		DEBUGLOG->log("Loading file: " + path);
+
+		VolumeData<T> result;
+		result.size_x = size_x;
+		result.size_y = size_y;
+		result.size_z = size_z;
+		result.real_size_x = 1.0f;
+		result.real_size_y = 1.0f;
+		result.real_size_z = 1.0f;
+
+		size_t numValues = (size_t) size_x * size_y * size_z;
+		result.data.assign(numValues, T(0));
+
+		// read data as a single block, directly into the result
+		readRaw<T>(path, &result.data[0], numValues);
+
+		if ( !result.data.empty() )
+		{
+			result.min = *std::min_element(result.data.begin(), result.data.end());
+			result.max = *std::max_element(result.data.begin(), result.data.end());
+		}
+
+		return result;
+	}
+
 	VolumeData<short> loadBruder();
+
+	/**
+	 * @brief load the DICOM series in a directory, see loadDicomSeries(const std::vector<std::string>&)
+	 *
+	 * @param directory holding the slice files; other files are skipped
+	 * @return data of the largest series in the directory
+	 */
+	VolumeData<short> loadDicomSeries(const std::string& directory);
+
+	/**
+	 * @brief load a DICOM series of uncompressed little endian slices (see Dicom), in parallel
+	 *
+	 * The headers are parsed on the ThreadPool; if the files hold several series, the one with the most slices is loaded.
+	 * Slices are sorted by their position along the slice normal, or by instance number if they have none.
+	 * The pixel spacing and the median distance of consecutive slices are stored in real_size_x/y/z.
+	 * Every slice is then read on the ThreadPool straight into its place in the result, rescaled to e.g. Hounsfield units.
+	 *
+	 * @param files of the series, in any order
+	 * @return data of the series; empty (size 0) if no slice could be read
+	 */
+	VolumeData<short> loadDicomSeries(const std::vector<std::string>& files);
 } // namespace Importer
 
 #endif
\ No newline at end of file
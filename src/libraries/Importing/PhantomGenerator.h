@@ -0,0 +1,593 @@
+#ifndef PHANTOMGENERATOR_H
+#define PHANTOMGENERATOR_H
+
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <Core/DebugLog.h>
+#include <Core/ThreadPool.h>
+
+#include "Importer.h"
+
+/**
+ * @brief procedural volume data sets, e.g. for benchmarks which must not depend on external files
+ *
+ * All random numbers are derived from a counter-based hash of (seed, index), so a phantom only
+ * depends on its parameters, not on the amount of threads it was generated with.
+ * Slices are generated in parallel on the ThreadPool.
+ */
+namespace PhantomGenerator {
+
+	enum PhantomType
+	{
+		SPHERES = 0,      //!< randomly placed spheres of different intensity
+		VESSEL_TREE,      //!< recursively branching tubes, bright on dark background
+		NOISE,            //!< fractal value noise, every voxel is occupied
+		SPARSE_OCCUPANCY, //!< few occupied bricks, the remaining volume is background
+		DENSE_OCCUPANCY   //!< most bricks occupied
+	};
+
+	struct PhantomParameters
+	{
+		PhantomType type;
+		unsigned int size_x;
+		unsigned int size_y;
+		unsigned int size_z;
+		unsigned int seed;
+
+		float backgroundValue; //!< value of empty space
+		float foregroundValue; //!< maximum value of structures
+
+		int numObjects;  //!< spheres: amount of spheres, vessel tree: amount of branching levels
+		int noiseOctaves; //!< noise: amount of octaves
+		float noiseFrequency; //!< noise: lattice cells along the largest axis for the first octave
+		int brickSize;    //!< occupancy: edge length of a brick in voxels
+		float occupancy;  //!< occupancy: probability of a brick to be occupied, -1 uses the type's default
+
+		PhantomParameters(PhantomType type = SPHERES, unsigned int size = 128, unsigned int seed = 1)
+			: type(type), size_x(size), size_y(size), size_z(size), seed(seed),
+			  backgroundValue(0.0f), foregroundValue(1000.0f),
+			  numObjects(-1), noiseOctaves(4), noiseFrequency(8.0f),
+			  brickSize(16), occupancy(-1.0f)
+		{}
+	};
+
+	/**
+	 * @brief 32 bit integer hash (murmur3 finalizer)
+	 */
+	inline unsigned int hash(unsigned int x)
+	{
+		x ^= x >> 16;
+		x *= 0x85ebca6bu;
+		x ^= x >> 13;
+		x *= 0xc2b2ae35u;
+		x ^= x >> 16;
+		return x;
+	}
+
+	/**
+	 * @brief random number in [0,1) for a given seed and counter
+	 */
+	inline float random(unsigned int seed, unsigned int counter, unsigned int stream = 0)
+	{
+		unsigned int h = hash( seed * 0x9e3779b9u + hash( counter ^ hash(stream + 0x632be5abu) ) );
+		return (float) (h >> 8) * (1.0f / 16777216.0f);
+	}
+
+	/**
+	 * @brief random number in [0,1) for an integer lattice position
+	 */
+	inline float randomLattice(unsigned int seed, int x, int y, int z)
+	{
+		unsigned int h = hash( (unsigned int) x * 0x8da6b343u ^ hash( (unsigned int) y * 0xd8163841u ^ hash( (unsigned int) z * 0xcb1ab31fu ^ seed ) ) );
+		return (float) (h >> 8) * (1.0f / 16777216.0f);
+	}
+
+	/**
+	 * @brief trilinearly interpolated lattice noise in [0,1), smoothstep weights
+	 */
+	inline float valueNoise(unsigned int seed, float x, float y, float z)
+	{
+		int ix = (int) std::floor(x);
+		int iy = (int) std::floor(y);
+		int iz = (int) std::floor(z);
+		float fx = x - ix; fx = fx * fx * (3.0f - 2.0f * fx);
+		float fy = y - iy; fy = fy * fy * (3.0f - 2.0f * fy);
+		float fz = z - iz; fz = fz * fz * (3.0f - 2.0f * fz);
+
+		float c00 = glm::mix( randomLattice(seed, ix, iy,     iz    ), randomLattice(seed, ix + 1, iy,     iz    ), fx);
+		float c10 = glm::mix( randomLattice(seed, ix, iy + 1, iz    ), randomLattice(seed, ix + 1, iy + 1, iz    ), fx);
+		float c01 = glm::mix( randomLattice(seed, ix, iy,     iz + 1), randomLattice(seed, ix + 1, iy,     iz + 1), fx);
+		float c11 = glm::mix( randomLattice(seed, ix, iy + 1, iz + 1), randomLattice(seed, ix + 1, iy + 1, iz + 1), fx);
+
+		return glm::mix( glm::mix(c00, c10, fy), glm::mix(c01, c11, fy), fz);
+	}
+
+	/**
+	 * @brief convert a value to T, clamped to the range of T
+	 */
+	template<class T>
+	inline T toValue(float value)
+	{
+		value = std::min( std::max( value, (float) std::numeric_limits<T>::lowest() ), (float) std::numeric_limits<T>::max() );
+		return (T) value;
+	}
+
+	/**
+	 * @brief axis aligned object which is rasterized into all slices it overlaps
+	 */
+	struct PhantomPrimitive
+	{
+		glm::vec3 a;      //!< sphere center or segment start
+		glm::vec3 b;      //!< segment end, equal to a for spheres
+		float radius;
+		float intensity;  //!< relative intensity in [0,1]
+
+		glm::vec3 getBoundsMin() const { return glm::min(a, b) - glm::vec3(radius); }
+		glm::vec3 getBoundsMax() const { return glm::max(a, b) + glm::vec3(radius); }
+	};
+
+	/**
+	 * @brief distance of p to the segment [a,b]
+	 */
+	inline float distanceToSegment(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b)
+	{
+		glm::vec3 ab = b - a;
+		float lengthSquared = glm::dot(ab, ab);
+		float t = (lengthSquared > 0.0f) ? glm::clamp( glm::dot(p - a, ab) / lengthSquared, 0.0f, 1.0f ) : 0.0f;
+		return glm::length( p - (a + t * ab) );
+	}
+
+	inline std::vector<PhantomPrimitive> createSpheres(const PhantomParameters& params)
+	{
+		int numSpheres = (params.numObjects > 0) ? params.numObjects : 64;
+		glm::vec3 size( (float) params.size_x, (float) params.size_y, (float) params.size_z );
+		float minSize = std::min( size.x, std::min(size.y, size.z) );
+
+		std::vector<PhantomPrimitive> spheres(numSpheres);
+		for (int i = 0; i < numSpheres; i++)
+		{
+			unsigned int c = (unsigned int) i * 8;
+			spheres[i].a = glm::vec3( random(params.seed, c), random(params.seed, c + 1), random(params.seed, c + 2) ) * size;
+			spheres[i].b = spheres[i].a;
+			spheres[i].radius = minSize * glm::mix( 0.02f, 0.15f, random(params.seed, c + 3) );
+			spheres[i].intensity = glm::mix( 0.3f, 1.0f, random(params.seed, c + 4) );
+		}
+		return spheres;
+	}
+
+	inline std::vector<PhantomPrimitive> createVesselTree(const PhantomParameters& params)
+	{
+		int numLevels = (params.numObjects > 0) ? params.numObjects : 7;
+		glm::vec3 size( (float) params.size_x, (float) params.size_y, (float) params.size_z );
+		float minSize = std::min( size.x, std::min(size.y, size.z) );
+
+		struct Branch { glm::vec3 start; glm::vec3 direction; float length; float radius; int level; };
+
+		// breadth first, so the counter of every branch does not depend on traversal order
+		std::vector<PhantomPrimitive> segments;
+		std::vector<Branch> queue;
+		Branch root = { glm::vec3(0.5f * size.x, 0.5f * size.y, 0.05f * size.z), glm::vec3(0.0f, 0.0f, 1.0f), 0.3f * size.z, 0.025f * minSize, 0 };
+		queue.push_back(root);
+
+		for (size_t i = 0; i < queue.size(); i++)
+		{
+			Branch branch = queue[i];
+			unsigned int c = (unsigned int) i * 16;
+
+			PhantomPrimitive segment;
+			segment.a = branch.start;
+			segment.b = glm::clamp( branch.start + branch.direction * branch.length, glm::vec3(0.0f), size - glm::vec3(1.0f) );
+			segment.radius = std::max(0.75f, branch.radius);
+			segment.intensity = glm::mix( 1.0f, 0.6f, (float) branch.level / (float) std::max(1, numLevels - 1) );
+			segments.push_back(segment);
+
+			if (branch.level + 1 >= numLevels)
+			{
+				continue;
+			}
+
+			// two children, deflected in opposite directions around a random axis
+			glm::vec3 randomAxis = glm::vec3( random(params.seed, c), random(params.seed, c + 1), random(params.seed, c + 2) ) * 2.0f - glm::vec3(1.0f);
+			glm::vec3 normal = glm::cross(branch.direction, randomAxis);
+			if ( glm::length(normal) < 1e-4f )
+			{
+				normal = glm::cross(branch.direction, glm::vec3(1.0f, 0.0f, 0.0f));
+			}
+			normal = glm::normalize(normal);
+
+			for (int k = 0; k < 2; k++)
+			{
+				float angle = glm::mix( 0.3f, 0.8f, random(params.seed, c + 3 + k) ) * (k == 0 ? 1.0f : -1.0f);
+				Branch child;
+				child.start = segment.b;
+				child.direction = glm::normalize( std::cos(angle) * branch.direction + std::sin(angle) * normal );
+				child.length = branch.length * glm::mix( 0.6f, 0.85f, random(params.seed, c + 5 + k) );
+				child.radius = branch.radius * 0.75f;
+				child.level = branch.level + 1;
+				queue.push_back(child);
+			}
+		}
+		return segments;
+	}
+
+	/**
+	 * @brief rasterize primitives into the volume, the maximum of overlapping primitives is kept
+	 *
+	 * Slices are processed in parallel; every slice only considers primitives whose bounding box it intersects.
+	 * The border of a primitive is smoothed over one voxel.
+	 */
+	template<class T>
+	void rasterizePrimitives(VolumeData<T>& volume, const std::vector<PhantomPrimitive>& primitives, const PhantomParameters& params, bool isSegment)
+	{
+		size_t sx = volume.size_x;
+		size_t sy = volume.size_y;
+
+		THREADPOOL->parallelFor(0, (int) volume.size_z, [&](int zBegin, int zEnd)
+		{
+			for (int z = zBegin; z < zEnd; z++)
+			{
+				T* slice = &volume.data[ (size_t) z * sx * sy ];
+
+				for (size_t p = 0; p < primitives.size(); p++)
+				{
+					const PhantomPrimitive& primitive = primitives[p];
+					glm::vec3 boundsMin = primitive.getBoundsMin();
+					glm::vec3 boundsMax = primitive.getBoundsMax();
+					if ( (float) z < boundsMin.z - 1.0f || (float) z > boundsMax.z + 1.0f )
+					{
+						continue;
+					}
+
+					int xBegin = std::max(0, (int) std::floor(boundsMin.x - 1.0f));
+					int xEnd   = std::min((int) sx - 1, (int) std::ceil(boundsMax.x + 1.0f));
+					int yBegin = std::max(0, (int) std::floor(boundsMin.y - 1.0f));
+					int yEnd   = std::min((int) sy - 1, (int) std::ceil(boundsMax.y + 1.0f));
+
+					float value = glm::mix(params.backgroundValue, params.foregroundValue, primitive.intensity);
+
+					for (int y = yBegin; y <= yEnd; y++)
+					{
+						T* row = slice + (size_t) y * sx;
+						for (int x = xBegin; x <= xEnd; x++)
+						{
+							glm::vec3 position( (float) x, (float) y, (float) z );
+							float distance = isSegment ? distanceToSegment(position, primitive.a, primitive.b) : glm::length(position - primitive.a);
+							float coverage = glm::clamp( primitive.radius + 0.5f - distance, 0.0f, 1.0f );
+							if (coverage <= 0.0f)
+							{
+								continue;
+							}
+
+							T mapped = toValue<T>( glm::mix(params.backgroundValue, value, coverage) );
+							row[x] = std::max(row[x], mapped);
+						}
+					}
+				}
+			}
+		});
+	}
+
+	/**
+	 * @brief random values at the integer positions of a noise lattice, so sampling needs no hashing
+	 */
+	struct NoiseLattice
+	{
+		int size[3]; //!< amount of lattice points per axis
+		std::vector<float> values;
+
+		NoiseLattice(unsigned int seed, int size_x, int size_y, int size_z)
+		{
+			size[0] = size_x; size[1] = size_y; size[2] = size_z;
+			values.resize( (size_t) size_x * size_y * size_z );
+			for (int z = 0; z < size_z; z++)
+			{
+				for (int y = 0; y < size_y; y++)
+				{
+					for (int x = 0; x < size_x; x++)
+					{
+						values[ ((size_t) z * size_y + y) * size_x + x ] = randomLattice(seed, x, y, z);
+					}
+				}
+			}
+		}
+
+		inline float get(int x, int y, int z) const { return values[ ((size_t) z * size[1] + y) * size[0] + x ]; }
+	};
+
+	template<class T>
+	void fillNoise(VolumeData<T>& volume, const PhantomParameters& params)
+	{
+		size_t sx = volume.size_x;
+		size_t sy = volume.size_y;
+		float maxSize = (float) std::max(volume.size_x, std::max(volume.size_y, volume.size_z));
+		int numOctaves = std::max(1, params.noiseOctaves);
+
+		// lattice and per-column interpolation weights of every octave, equal to valueNoise()
+		std::vector<NoiseLattice> lattices;
+		std::vector<float> scales;
+		std::vector< std::vector<int> > cellX(numOctaves);
+		std::vector< std::vector<float> > weightX(numOctaves);
+		float scale = params.noiseFrequency / maxSize;
+		for (int o = 0; o < numOctaves; o++)
+		{
+			lattices.push_back( NoiseLattice( params.seed + (unsigned int) o,
+				(int) std::floor( (volume.size_x - 1) * scale ) + 2,
+				(int) std::floor( (volume.size_y - 1) * scale ) + 2,
+				(int) std::floor( (volume.size_z - 1) * scale ) + 2 ) );
+			scales.push_back(scale);
+
+			cellX[o].resize(sx);
+			weightX[o].resize(sx);
+			for (size_t x = 0; x < sx; x++)
+			{
+				float fx = (float) x * scale;
+				cellX[o][x] = (int) std::floor(fx);
+				fx -= (float) cellX[o][x];
+				weightX[o][x] = fx * fx * (3.0f - 2.0f * fx);
+			}
+			scale *= 2.0f;
+		}
+
+		THREADPOOL->parallelFor(0, (int) volume.size_z, [&](int zBegin, int zEnd)
+		{
+			std::vector<float> sum(sx);
+			for (int z = zBegin; z < zEnd; z++)
+			{
+				for (size_t y = 0; y < sy; y++)
+				{
+					std::fill(sum.begin(), sum.end(), 0.0f);
+
+					float amplitude = 0.5f;
+					for (int o = 0; o < numOctaves; o++)
+					{
+						const NoiseLattice& lattice = lattices[o];
+						float fy = (float) y * scales[o];
+						float fz = (float) z * scales[o];
+						int iy = (int) std::floor(fy);
+						int iz = (int) std::floor(fz);
+						fy -= (float) iy; fy = fy * fy * (3.0f - 2.0f * fy);
+						fz -= (float) iz; fz = fz * fz * (3.0f - 2.0f * fz);
+
+						for (size_t x = 0; x < sx; x++)
+						{
+							int ix = cellX[o][x];
+							float fx = weightX[o][x];
+							float c00 = glm::mix( lattice.get(ix, iy,     iz    ), lattice.get(ix + 1, iy,     iz    ), fx);
+							float c10 = glm::mix( lattice.get(ix, iy + 1, iz    ), lattice.get(ix + 1, iy + 1, iz    ), fx);
+							float c01 = glm::mix( lattice.get(ix, iy,     iz + 1), lattice.get(ix + 1, iy,     iz + 1), fx);
+							float c11 = glm::mix( lattice.get(ix, iy + 1, iz + 1), lattice.get(ix + 1, iy + 1, iz + 1), fx);
+							sum[x] += amplitude * glm::mix( glm::mix(c00, c10, fy), glm::mix(c01, c11, fy), fz);
+						}
+						amplitude *= 0.5f;
+					}
+
+					T* row = &volume.data[ ((size_t) z * sy + y) * sx ];
+					for (size_t x = 0; x < sx; x++)
+					{
+						row[x] = toValue<T>( glm::mix(params.backgroundValue, params.foregroundValue, sum[x]) );
+					}
+				}
+			}
+		});
+	}
+
+	template<class T>
+	void fillOccupancy(VolumeData<T>& volume, const PhantomParameters& params, float occupancy)
+	{
+		size_t sx = volume.size_x;
+		size_t sy = volume.size_y;
+		int brickSize = std::max(1, params.brickSize);
+		int bricksX = ((int) volume.size_x + brickSize - 1) / brickSize;
+		int bricksY = ((int) volume.size_y + brickSize - 1) / brickSize;
+
+		THREADPOOL->parallelFor(0, (int) volume.size_z, [&](int zBegin, int zEnd)
+		{
+			for (int z = zBegin; z < zEnd; z++)
+			{
+				int brickZ = z / brickSize;
+				for (size_t y = 0; y < sy; y++)
+				{
+					int brickY = (int) y / brickSize;
+					T* row = &volume.data[ ((size_t) z * sy + y) * sx ];
+					for (size_t x = 0; x < sx; x++)
+					{
+						int brickX = (int) x / brickSize;
+						unsigned int brickIndex = (unsigned int) ( (brickZ * bricksY + brickY) * bricksX + brickX );
+						if ( random(params.seed, brickIndex, 1) >= occupancy )
+						{
+							continue; // empty brick, already background
+						}
+
+						// occupied bricks carry a brick constant level plus per voxel noise
+						float level = glm::mix( 0.4f, 0.9f, random(params.seed, brickIndex, 2) );
+						float noise = 0.1f * randomLattice(params.seed, (int) x, (int) y, z);
+						row[x] = toValue<T>( glm::mix(params.backgroundValue, params.foregroundValue, level + noise) );
+					}
+				}
+			}
+		});
+	}
+
+	/**
+	 * @brief compute min and max of the volume data in parallel
+	 */
+	template<class T>
+	void computeMinMax(VolumeData<T>& volume)
+	{
+		size_t sliceSize = (size_t) volume.size_x * volume.size_y;
+		std::vector<T> sliceMin(volume.size_z, std::numeric_limits<T>::max());
+		std::vector<T> sliceMax(volume.size_z, std::numeric_limits<T>::lowest());
+
+		THREADPOOL->parallelFor(0, (int) volume.size_z, [&](int zBegin, int zEnd)
+		{
+			for (int z = zBegin; z < zEnd; z++)
+			{
+				const T* slice = &volume.data[ (size_t) z * sliceSize ];
+				T curMin = sliceMin[z];
+				T curMax = sliceMax[z];
+				for (size_t i = 0; i < sliceSize; i++)
+				{
+					curMin = std::min(curMin, slice[i]);
+					curMax = std::max(curMax, slice[i]);
+				}
+				sliceMin[z] = curMin;
+				sliceMax[z] = curMax;
+			}
+		});
+
+		volume.min = *std::min_element(sliceMin.begin(), sliceMin.end());
+		volume.max = *std::max_element(sliceMax.begin(), sliceMax.end());
+	}
+
+	/**
+	 * @brief clear to background in parallel, so pages are touched by the threads which fill them later on
+	 * (VolumeData::data is not initialized by resize())
+	 */
+	template<class T>
+	void clearToBackground(VolumeData<T>& volume, const PhantomParameters& params)
+	{
+		T background = toValue<T>(params.backgroundValue);
+		size_t sliceSize = (size_t) volume.size_x * volume.size_y;
+		THREADPOOL->parallelFor(0, (int) volume.size_z, [&](int zBegin, int zEnd)
+		{
+			std::fill( volume.data.begin() + zBegin * sliceSize, volume.data.begin() + zEnd * sliceSize, background );
+		});
+	}
+
+	/**
+	 * @brief generate a phantom volume
+	 *
+	 * @param params describing type, resolution and seed of the phantom; equal parameters yield equal data
+	 * @return volume data with a voxel size of 1mm
+	 */
+	template<class T>
+	VolumeData<T> generate(const PhantomParameters& params)
+	{
+		static const char* typeNames[] = {"spheres", "vessel tree", "noise", "sparse occupancy", "dense occupancy"};
+		DEBUGLOG->log("Generating phantom: " + std::string(typeNames[params.type]));
+		DEBUGLOG->indent();
+			DEBUGLOG->log("res. x   : ", params.size_x);
+			DEBUGLOG->log("res. y   : ", params.size_y);
+			DEBUGLOG->log("res. z   : ", params.size_z);
+			DEBUGLOG->log("seed     : ", params.seed);
+		DEBUGLOG->outdent();
+
+		VolumeData<T> result;
+		result.size_x = params.size_x;
+		result.size_y = params.size_y;
+		result.size_z = params.size_z;
+		result.real_size_x = 1.0f;
+		result.real_size_y = 1.0f;
+		result.real_size_z = 1.0f;
+
+		size_t numVoxels = (size_t) params.size_x * params.size_y * params.size_z;
+		result.data.resize(numVoxels);
+
+		clearToBackground(result, params);
+
+		switch (params.type)
+		{
+		case SPHERES:
+			rasterizePrimitives(result, createSpheres(params), params, false);
+			break;
+		case VESSEL_TREE:
+			rasterizePrimitives(result, createVesselTree(params), params, true);
+			break;
+		case NOISE:
+			fillNoise(result, params);
+			break;
+		case SPARSE_OCCUPANCY:
+			fillOccupancy(result, params, (params.occupancy >= 0.0f) ? params.occupancy : 0.05f);
+			break;
+		case DENSE_OCCUPANCY:
+			fillOccupancy(result, params, (params.occupancy >= 0.0f) ? params.occupancy : 0.7f);
+			break;
+		}
+
+		computeMinMax(result);
+
+		return result;
+	}
+
+	/**
+	 * @brief generate one time point of a periodic 4D phantom into an existing volume
+	 *
+	 * Spheres pulsate with individual phases, vessel trees pulse as a whole while a contrast
+	 * bolus washes in and out, all other types keep their structure and modulate their intensity.
+	 * One period spans numTimePoints time points, so a looped series has no discontinuity.
+	 *
+	 * @param params describing type, resolution and seed of the phantom
+	 * @param timePoint in [0, numTimePoints)
+	 * @param numTimePoints amount of time points per period
+	 * @param volume target, data is resized only if its size does not match params
+	 */
+	template<class T>
+	void generateTimePoint(const PhantomParameters& params, unsigned int timePoint, unsigned int numTimePoints, VolumeData<T>& volume)
+	{
+		volume.size_x = params.size_x;
+		volume.size_y = params.size_y;
+		volume.size_z = params.size_z;
+		volume.real_size_x = 1.0f;
+		volume.real_size_y = 1.0f;
+		volume.real_size_z = 1.0f;
+		volume.data.resize( (size_t) params.size_x * params.size_y * params.size_z );
+
+		clearToBackground(volume, params);
+
+		float phase = 2.0f * glm::pi<float>() * (float) timePoint / (float) std::max(1u, numTimePoints);
+		switch (params.type)
+		{
+		case SPHERES:
+			{
+				std::vector<PhantomPrimitive> spheres = createSpheres(params);
+				for (size_t i = 0; i < spheres.size(); i++)
+				{
+					float offset = 2.0f * glm::pi<float>() * random(params.seed, (unsigned int) i * 8 + 5);
+					spheres[i].radius *= 1.0f + 0.25f * std::sin(phase + offset);
+				}
+				rasterizePrimitives(volume, spheres, params, false);
+			}
+			break;
+		case VESSEL_TREE:
+			{
+				std::vector<PhantomPrimitive> segments = createVesselTree(params);
+				float bolus = 0.5f - 0.5f * std::cos(phase);
+				for (size_t i = 0; i < segments.size(); i++)
+				{
+					segments[i].radius *= 1.0f + 0.15f * std::sin(phase);
+					segments[i].intensity *= glm::mix(0.4f, 1.0f, bolus);
+				}
+				rasterizePrimitives(volume, segments, params, true);
+			}
+			break;
+		default:
+			{
+				PhantomParameters modulated = params;
+				modulated.foregroundValue = glm::mix( params.backgroundValue, params.foregroundValue, 0.75f + 0.25f * std::sin(phase) );
+				switch (params.type)
+				{
+				case NOISE:
+					fillNoise(volume, modulated);
+					break;
+				case SPARSE_OCCUPANCY:
+					fillOccupancy(volume, modulated, (params.occupancy >= 0.0f) ? params.occupancy : 0.05f);
+					break;
+				default:
+					fillOccupancy(volume, modulated, (params.occupancy >= 0.0f) ? params.occupancy : 0.7f);
+					break;
+				}
+			}
+			break;
+		}
+
+		computeMinMax(volume);
+	}
+} // namespace PhantomGenerator
+
+#endif
@@ -23,7 +23,7 @@ namespace TextureTools {
         if(data == NULL){
 //        	std::cout << "ERROR: Unable to open image "  << fileName << std::endl;
 //        	DEBUGLOG->log("ERROR : Unable to open image " + fileName);
-        	DEBUGLOG->log("ERROR : Unable to open image " + fileString);
+        	DEBUGLOG_ERROR("Unable to open image " + fileString);
         	  return -1;}
 
 
@@ -44,7 +44,7 @@ namespace TextureTools {
      
         //send image data to the new texture
         if (bytesPerPixel < 3) {
-        	DEBUGLOG->log("ERROR : Unable to open image " + fileString);
+        	DEBUGLOG_ERROR("Unable to open image " + fileString);
 //        	DEBUGLOG->log("ERROR : Unable to open image " + fileName);
 //            std::cout << "ERROR: Unable to open image"  << fileName << std::endl;
             return -1;
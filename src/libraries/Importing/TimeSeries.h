@@ -0,0 +1,114 @@
+#ifndef TIMESERIES_H
+#define TIMESERIES_H
+
+#include <functional>
+#include <string>
+
+#include "Importer.h"
+#include "PhantomGenerator.h"
+
+/**
+ * @brief 4D data set: a sequence of volumes of equal resolution, e.g. a perfusion or cardiac series
+ *
+ * Time points are not held in memory. They are decoded on demand by decodeTimePoint, which may be
+ * called from any thread (see VolumeStreamer), so decoders must not depend on shared mutable state.
+ */
+struct VolumeTimeSeries
+{
+	unsigned int size_x; //!< x: left
+	unsigned int size_y; //!< y: forward
+	unsigned int size_z; //!< z: up
+
+	float real_size_x; // actual step size in mm
+	float real_size_y; // actual step size in mm
+	float real_size_z; // actual step size in mm
+
+	short min; //!< value range of the series, used for windowing
+	short max;
+
+	unsigned int numTimePoints;
+	float timePointsPerSecond; //!< acquisition rate, default playback speed
+
+	/**
+	 * @brief decode a time point into target; target.data may be reused from a previous call
+	 */
+	std::function<void(unsigned int timePoint, VolumeData<short>& target)> decodeTimePoint;
+};
+
+namespace TimeSeries {
+	/**
+	 * @brief series of headerless raw files, one per time point: path.1 .2 .. .numTimePoints
+	 *
+	 * @param path to file prefix, file suffix is the 1-based time point
+	 * @param size_x of each volume
+	 * @param size_y of each volume
+	 * @param size_z of each volume
+	 * @param numTimePoints amount of files
+	 * @return series; the value range is taken from the first time point
+	 */
+	inline VolumeTimeSeries fromRawFiles(std::string path, unsigned int size_x, unsigned int size_y, unsigned int size_z, unsigned int numTimePoints)
+	{
+		DEBUGLOG->log("Time series with file prefix: " + path);
+
+		VolumeTimeSeries series;
+		series.size_x = size_x;
+		series.size_y = size_y;
+		series.size_z = size_z;
+		series.real_size_x = 1.0f;
+		series.real_size_y = 1.0f;
+		series.real_size_z = 1.0f;
+		series.numTimePoints = numTimePoints;
+		series.timePointsPerSecond = 10.0f;
+
+		series.decodeTimePoint = [=](unsigned int timePoint, VolumeData<short>& target)
+		{
+			target.size_x = size_x;
+			target.size_y = size_y;
+			target.size_z = size_z;
+			target.real_size_x = 1.0f;
+			target.real_size_y = 1.0f;
+			target.real_size_z = 1.0f;
+
+			size_t numValues = (size_t) size_x * size_y * size_z;
+			target.data.resize(numValues);
+			size_t numRead = Importer::readRaw<short>(path + "." + std::to_string(timePoint + 1), &target.data[0], numValues);
+			std::fill(target.data.begin() + numRead, target.data.end(), (short) 0);
+
+			PhantomGenerator::computeMinMax(target);
+		};
+
+		VolumeData<short> first;
+		series.decodeTimePoint(0, first);
+		series.min = first.min;
+		series.max = first.max;
+
+		return series;
+	}
+
+	/**
+	 * @brief periodic procedural series, see PhantomGenerator::generateTimePoint
+	 */
+	inline VolumeTimeSeries fromPhantom(const PhantomGenerator::PhantomParameters& params, unsigned int numTimePoints)
+	{
+		VolumeTimeSeries series;
+		series.size_x = params.size_x;
+		series.size_y = params.size_y;
+		series.size_z = params.size_z;
+		series.real_size_x = 1.0f;
+		series.real_size_y = 1.0f;
+		series.real_size_z = 1.0f;
+		series.min = PhantomGenerator::toValue<short>(params.backgroundValue);
+		series.max = PhantomGenerator::toValue<short>(params.foregroundValue);
+		series.numTimePoints = numTimePoints;
+		series.timePointsPerSecond = 10.0f;
+
+		series.decodeTimePoint = [=](unsigned int timePoint, VolumeData<short>& target)
+		{
+			PhantomGenerator::generateTimePoint<short>(params, timePoint, numTimePoints, target);
+		};
+
+		return series;
+	}
+} // namespace TimeSeries
+
+#endif
@@ -0,0 +1,77 @@
+#include "Bricks.h"
+
+#include <Core/ThreadPool.h>
+#include <Core/DebugLog.h>
+
+#include <climits>
+
+void Bricks::computeMinMax(const VolumeData<short>& volume, int brickSize, MinMaxBricks& bricks)
+{
+	brickSize = std::max(1, brickSize);
+	bricks.brickSize = brickSize;
+
+	VolumeData<short>* ranges[2] = { &bricks.min, &bricks.max };
+	for (int i = 0; i < 2; i++)
+	{
+		ranges[i]->size_x = (volume.size_x + brickSize - 1) / brickSize;
+		ranges[i]->size_y = (volume.size_y + brickSize - 1) / brickSize;
+		ranges[i]->size_z = (volume.size_z + brickSize - 1) / brickSize;
+		ranges[i]->real_size_x = volume.real_size_x * brickSize;
+		ranges[i]->real_size_y = volume.real_size_y * brickSize;
+		ranges[i]->real_size_z = volume.real_size_z * brickSize;
+		ranges[i]->min = volume.min;
+		ranges[i]->max = volume.max;
+		ranges[i]->data.assign( (size_t) ranges[i]->size_x * ranges[i]->size_y * ranges[i]->size_z, 0 );
+	}
+
+	THREADPOOL->parallelFor(0, (int) bricks.min.size_z, [&](int bzBegin, int bzEnd)
+	{
+		for (int bz = bzBegin; bz < bzEnd; bz++)
+		{
+			int zEnd = std::min( (bz + 1) * brickSize, (int) volume.size_z - 1 ); // inclusive, overlaps the next brick
+			for (unsigned int by = 0; by < bricks.min.size_y; by++)
+			{
+				int yEnd = std::min( ( (int) by + 1 ) * brickSize, (int) volume.size_y - 1 );
+				for (unsigned int bx = 0; bx < bricks.min.size_x; bx++)
+				{
+					int xEnd = std::min( ( (int) bx + 1 ) * brickSize, (int) volume.size_x - 1 );
+
+					short curMin = SHRT_MAX;
+					short curMax = SHRT_MIN;
+					for (int z = bz * brickSize; z <= zEnd; z++)
+					{
+						for (int y = (int) by * brickSize; y <= yEnd; y++)
+						{
+							const short* row = &volume.data[ ( (size_t) z * volume.size_y + y ) * volume.size_x ];
+							for (int x = (int) bx * brickSize; x <= xEnd; x++)
+							{
+								curMin = std::min(curMin, row[x]);
+								curMax = std::max(curMax, row[x]);
+							}
+						}
+					}
+
+					size_t i = ( (size_t) bz * bricks.min.size_y + by ) * bricks.min.size_x + bx;
+					bricks.min.data[i] = curMin;
+					bricks.max.data[i] = curMax;
+				}
+			}
+		}
+	});
+
+	DEBUGLOG->log("Bricks: computed value ranges of bricks, amount: ", (int) bricks.min.data.size());
+}
+
+float Bricks::computeBrickExit(int brickSize, const glm::vec3& position, const glm::vec3& origin, const glm::vec3& direction)
+{
+	glm::vec3 brickMin = glm::floor( glm::max(position, glm::vec3(0.0f)) / (float) brickSize ) * (float) brickSize;
+	glm::vec3 brickMax = brickMin + glm::vec3( (float) brickSize );
+
+	float tExit = FLT_MAX;
+	for (int a = 0; a < 3; a++)
+	{
+		if ( direction[a] > 0.0f )      { tExit = std::min( tExit, (brickMax[a] - origin[a]) / direction[a] ); }
+		else if ( direction[a] < 0.0f ) { tExit = std::min( tExit, (brickMin[a] - origin[a]) / direction[a] ); }
+	}
+	return tExit;
+}
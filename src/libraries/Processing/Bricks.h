@@ -0,0 +1,55 @@
+#ifndef BRICKS_H
+#define BRICKS_H
+
+#include "CPURendering.h"
+
+/**
+ * @brief value range of every brick of a volume, for empty space skipping
+ *
+ * Brick (i, j, k) covers the voxels [i * brickSize, (i + 1) * brickSize] along x, and likewise along y and z.
+ * The range includes the first voxel layer of the next brick, so it bounds every interpolated sample
+ * between the voxels of the brick as well. A ray segment inside a brick can only cross an iso value
+ * which lies in the brick's range.
+ */
+struct MinMaxBricks
+{
+	int brickSize;         //!< edge length of a brick in voxels
+	VolumeData<short> min; //!< minimum per brick, one "voxel" per brick
+	VolumeData<short> max; //!< maximum per brick, one "voxel" per brick
+
+	/**
+	 * @brief whether the brick containing voxel coordinates (x, y, z) may contain value
+	 */
+	inline bool mayContain(float x, float y, float z, float value) const
+	{
+		int bx = std::max( 0, std::min( (int) (x / brickSize), (int) min.size_x - 1 ) );
+		int by = std::max( 0, std::min( (int) (y / brickSize), (int) min.size_y - 1 ) );
+		int bz = std::max( 0, std::min( (int) (z / brickSize), (int) min.size_z - 1 ) );
+		size_t i = ( (size_t) bz * min.size_y + by ) * min.size_x + bx;
+		return (float) min.data[i] <= value && value <= (float) max.data[i];
+	}
+};
+
+namespace Bricks {
+	/**
+	 * @brief compute the value range of all bricks, parallel over brick slices
+	 *
+	 * @param volume to be partitioned
+	 * @param brickSize edge length of a brick in voxels
+	 * @param bricks resized and filled
+	 */
+	void computeMinMax(const VolumeData<short>& volume, int brickSize, MinMaxBricks& bricks);
+
+	/**
+	 * @brief ray parameter at which a ray leaves the brick containing a point
+	 *
+	 * @param brickSize edge length of a brick in voxels
+	 * @param position point on the ray, voxel coordinates
+	 * @param origin of the ray, voxel coordinates
+	 * @param direction of the ray, voxel coordinates per unit of the ray parameter
+	 * @return ray parameter t of the exit point origin + t * direction
+	 */
+	float computeBrickExit(int brickSize, const glm::vec3& position, const glm::vec3& origin, const glm::vec3& direction);
+} // namespace Bricks
+
+#endif
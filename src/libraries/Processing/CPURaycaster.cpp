@@ -0,0 +1,339 @@
+#include "CPURaycaster.h"
+
+#include <Core/ThreadPool.h>
+
+#include <chrono>
+
+CPURaycaster::CPURaycaster(float stepSize)
+{
+	m_stepSize = stepSize;
+	m_isoRefinementSteps = 5;
+	m_stats.milliseconds = 0.0;
+	m_stats.samples = 0.0;
+}
+
+CPURaycaster::~CPURaycaster()
+{
+}
+
+void CPURaycaster::render(const VolumeData<short>& volume, const glm::mat4& voxelToPixel, MIPImage& image)
+{
+	renderRays(volume, voxelToPixel, image, 0, 0, 0);
+}
+
+void CPURaycaster::render(const VolumeData<short>& volume, const glm::mat4& voxelToPixel, MIPImage& image, MIPImage& minImage, MIPImage& averageImage, MIPImage& maxDepthImage)
+{
+	if (minImage.width != image.width || minImage.height != image.height) { minImage.resize(image.width, image.height); }
+	if (averageImage.width != image.width || averageImage.height != image.height) { averageImage.resize(image.width, image.height); }
+	if (maxDepthImage.width != image.width || maxDepthImage.height != image.height) { maxDepthImage.resize(image.width, image.height); }
+
+	renderRays(volume, voxelToPixel, image, &minImage, &averageImage, &maxDepthImage);
+}
+
+void CPURaycaster::renderRays(const VolumeData<short>& volume, const glm::mat4& voxelToPixel, MIPImage& image, MIPImage* minImage, MIPImage* averageImage, MIPImage* maxDepthImage)
+{
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+
+	glm::mat4 pixelToVoxel = glm::inverse(voxelToPixel);
+	glm::ivec3 volumeSize(volume.size_x, volume.size_y, volume.size_z);
+	float stepSize = std::max(m_stepSize, 0.01f);
+	bool accumulate = (minImage != 0);
+
+	std::vector<double> samplesPerRow(image.height, 0.0);
+
+	THREADPOOL->parallelFor(0, image.height, [&](int rowBegin, int rowEnd)
+	{
+		for (int y = rowBegin; y < rowEnd; y++)
+		{
+			double samples = 0.0;
+			size_t rowOffset = (size_t) y * image.width;
+			float* row = &image.value[ rowOffset ];
+
+			for (int x = 0; x < image.width; x++)
+			{
+				row[x] = MIPImage::BACKGROUND;
+				if (accumulate)
+				{
+					minImage->value[ rowOffset + x ] = MIPImage::BACKGROUND;
+					averageImage->value[ rowOffset + x ] = MIPImage::BACKGROUND;
+					maxDepthImage->value[ rowOffset + x ] = MIPImage::BACKGROUND;
+				}
+
+				glm::vec3 start, end;
+				CPURendering::computePixelRay(pixelToVoxel, (float) x + 0.5f, (float) y + 0.5f, start, end);
+
+				float tNear, tFar;
+				if ( !CPURendering::clipRayToVolume(start, end, volumeSize, tNear, tFar) )
+				{
+					continue;
+				}
+
+				glm::vec3 entry = start + tNear * (end - start);
+				glm::vec3 exit  = start + tFar  * (end - start);
+				float rayLength = glm::length(exit - entry);
+				int numSteps = (int) (rayLength / stepSize) + 1;
+				glm::vec3 step = (numSteps > 1) ? (exit - entry) / (float) (numSteps - 1) : glm::vec3(0.0f);
+
+				if (!accumulate)
+				{
+					// traverse ray, perform mip
+					float curMax = MIPImage::BACKGROUND;
+					glm::vec3 pos = entry;
+					for (int i = 0; i < numSteps; i++)
+					{
+						curMax = std::max( curMax, CPURendering::sampleTrilinear(volume, pos.x, pos.y, pos.z) );
+						pos += step;
+					}
+					row[x] = curMax;
+				}
+				else
+				{
+					// traverse ray, perform mip, minip and average in one go
+					float curMax = MIPImage::BACKGROUND;
+					float curMin = FLT_MAX;
+					double sum = 0.0;
+					int maxStep = 0;
+					glm::vec3 pos = entry;
+					for (int i = 0; i < numSteps; i++)
+					{
+						float value = CPURendering::sampleTrilinear(volume, pos.x, pos.y, pos.z);
+						if (value > curMax)
+						{
+							curMax = value;
+							maxStep = i;
+						}
+						curMin = std::min(curMin, value);
+						sum += value;
+						pos += step;
+					}
+					row[x] = curMax;
+					minImage->value[ rowOffset + x ] = curMin;
+					averageImage->value[ rowOffset + x ] = (float) (sum / numSteps);
+					maxDepthImage->value[ rowOffset + x ] = (numSteps > 1) ? (float) maxStep / (float) (numSteps - 1) : 0.0f;
+				}
+				samples += numSteps;
+			}
+			samplesPerRow[y] = samples;
+		}
+	});
+
+	m_stats.samples = 0.0;
+	for (unsigned int i = 0; i < samplesPerRow.size(); i++)
+	{
+		m_stats.samples += samplesPerRow[i];
+	}
+	m_stats.milliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - startTime ).count();
+}
+
+void CPURaycaster::renderIsosurface(const VolumeData<short>& volume, const glm::mat4& voxelToPixel, float isoValue, const MinMaxBricks* bricks, MIPImage& image, MIPImage* depthImage)
+{
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+
+	if (depthImage && (depthImage->width != image.width || depthImage->height != image.height)) { depthImage->resize(image.width, image.height); }
+
+	glm::mat4 pixelToVoxel = glm::inverse(voxelToPixel);
+	glm::ivec3 volumeSize(volume.size_x, volume.size_y, volume.size_z);
+
+	std::vector<double> samplesPerRow(image.height, 0.0);
+
+	THREADPOOL->parallelFor(0, image.height, [&](int rowBegin, int rowEnd)
+	{
+		for (int y = rowBegin; y < rowEnd; y++)
+		{
+			double samples = 0.0;
+			size_t rowOffset = (size_t) y * image.width;
+
+			for (int x = 0; x < image.width; x++)
+			{
+				image.value[ rowOffset + x ] = MIPImage::BACKGROUND;
+				if (depthImage) { depthImage->value[ rowOffset + x ] = MIPImage::BACKGROUND; }
+
+				glm::vec3 start, end;
+				CPURendering::computePixelRay(pixelToVoxel, (float) x + 0.5f, (float) y + 0.5f, start, end);
+
+				float tNear, tFar;
+				if ( !CPURendering::clipRayToVolume(start, end, volumeSize, tNear, tFar) )
+				{
+					continue;
+				}
+
+				glm::vec3 entry = start + tNear * (end - start);
+				glm::vec3 direction = (start + tFar * (end - start)) - entry; // voxels per unit of t
+				float tHit = traceIsosurface(volume, entry, direction, isoValue, bricks, samples);
+				if ( tHit < 0.0f )
+				{
+					continue;
+				}
+
+				// headlight shading with central difference gradients
+				glm::vec3 p = entry + tHit * direction;
+				glm::vec3 gradient(
+					CPURendering::sampleTrilinear(volume, p.x + 1.0f, p.y, p.z) - CPURendering::sampleTrilinear(volume, p.x - 1.0f, p.y, p.z),
+					CPURendering::sampleTrilinear(volume, p.x, p.y + 1.0f, p.z) - CPURendering::sampleTrilinear(volume, p.x, p.y - 1.0f, p.z),
+					CPURendering::sampleTrilinear(volume, p.x, p.y, p.z + 1.0f) - CPURendering::sampleTrilinear(volume, p.x, p.y, p.z - 1.0f) );
+				samples += 6.0;
+
+				float diffuse = 1.0f;
+				if ( glm::length(gradient) > 0.0f && glm::length(direction) > 0.0f )
+				{
+					diffuse = std::abs( glm::dot( glm::normalize(gradient), glm::normalize(direction) ) );
+				}
+				image.value[ rowOffset + x ] = diffuse;
+				if (depthImage) { depthImage->value[ rowOffset + x ] = tHit; }
+			}
+			samplesPerRow[y] = samples;
+		}
+	});
+
+	m_stats.samples = 0.0;
+	for (unsigned int i = 0; i < samplesPerRow.size(); i++)
+	{
+		m_stats.samples += samplesPerRow[i];
+	}
+	m_stats.milliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - startTime ).count();
+}
+
+float CPURaycaster::traceIsosurface(const VolumeData<short>& volume, const glm::vec3& entry, const glm::vec3& direction, float isoValue, const MinMaxBricks* bricks, double& samples) const
+{
+	float stepSize = std::max(m_stepSize, 0.01f);
+	int numSteps = (int) (glm::length(direction) / stepSize) + 1;
+	float dt = (numSteps > 1) ? 1.0f / (float) (numSteps - 1) : 1.0f;
+
+	auto sampleAt = [&](float t)
+	{
+		glm::vec3 p = entry + t * direction;
+		return CPURendering::sampleTrilinear(volume, p.x, p.y, p.z);
+	};
+
+	// march until the iso value is crossed
+	float t = 0.0f;
+	float value = sampleAt(t);
+	samples += 1.0;
+	bool inside = value >= isoValue;
+	float tHit = inside ? 0.0f : -1.0f;
+	while ( tHit < 0.0f && t < 1.0f )
+	{
+		float tNext = t + dt;
+		glm::vec3 p = entry + t * direction;
+		if ( bricks && !bricks->mayContain(p.x, p.y, p.z, isoValue) )
+		{
+			// the segment inside this brick can't cross the iso value: continue on the sampling grid behind it
+			float tExit = Bricks::computeBrickExit(bricks->brickSize, p, entry, direction);
+			tNext = std::max( tNext, std::ceil(tExit / dt) * dt );
+		}
+		if ( tNext > 1.0f + 0.5f * dt )
+		{
+			break;
+		}
+		tNext = std::min(tNext, 1.0f);
+
+		float nextValue = sampleAt(tNext);
+		samples += 1.0;
+		if ( (nextValue >= isoValue) != inside )
+		{
+			// refine the crossing in [t, tNext]
+			float lo = t;
+			float hi = tNext;
+			for (int i = 0; i < m_isoRefinementSteps; i++)
+			{
+				float mid = 0.5f * (lo + hi);
+				if ( (sampleAt(mid) >= isoValue) == inside ) { lo = mid; }
+				else { hi = mid; }
+			}
+			samples += m_isoRefinementSteps;
+			tHit = 0.5f * (lo + hi);
+		}
+		t = tNext;
+	}
+	return tHit;
+}
+
+VoxelPick CPURaycaster::pick(const VolumeData<short>& volume, const glm::mat4& voxelToPixel, float px, float py) const
+{
+	VoxelPick result;
+	glm::ivec3 volumeSize(volume.size_x, volume.size_y, volume.size_z);
+
+	glm::vec3 start, end;
+	CPURendering::computePixelRay(glm::inverse(voxelToPixel), px, py, start, end);
+	float tNear, tFar;
+	if ( !CPURendering::clipRayToVolume(start, end, volumeSize, tNear, tFar) )
+	{
+		return result;
+	}
+
+	// same traversal as render()
+	glm::vec3 entry = start + tNear * (end - start);
+	glm::vec3 exit  = start + tFar  * (end - start);
+	int numSteps = (int) (glm::length(exit - entry) / std::max(m_stepSize, 0.01f)) + 1;
+	glm::vec3 step = (numSteps > 1) ? (exit - entry) / (float) (numSteps - 1) : glm::vec3(0.0f);
+
+	float curMax = MIPImage::BACKGROUND;
+	glm::vec3 pos = entry;
+	for (int i = 0; i < numSteps; i++)
+	{
+		float value = CPURendering::sampleTrilinear(volume, pos.x, pos.y, pos.z);
+		if (value > curMax)
+		{
+			curMax = value;
+			result.setPosition(pos, volumeSize);
+		}
+		pos += step;
+	}
+	result.hit = true;
+	result.value = curMax;
+	return result;
+}
+
+VoxelPick CPURaycaster::pickIsosurface(const VolumeData<short>& volume, const glm::mat4& voxelToPixel, float isoValue, const MinMaxBricks* bricks, float px, float py) const
+{
+	VoxelPick result;
+	glm::ivec3 volumeSize(volume.size_x, volume.size_y, volume.size_z);
+
+	glm::vec3 start, end;
+	CPURendering::computePixelRay(glm::inverse(voxelToPixel), px, py, start, end);
+	float tNear, tFar;
+	if ( !CPURendering::clipRayToVolume(start, end, volumeSize, tNear, tFar) )
+	{
+		return result;
+	}
+
+	glm::vec3 entry = start + tNear * (end - start);
+	glm::vec3 direction = (start + tFar * (end - start)) - entry;
+	double samples = 0.0;
+	float tHit = traceIsosurface(volume, entry, direction, isoValue, bricks, samples);
+	if ( tHit < 0.0f )
+	{
+		return result;
+	}
+
+	glm::vec3 p = entry + tHit * direction;
+	result.hit = true;
+	result.setPosition(p, volumeSize);
+	result.value = CPURendering::sampleTrilinear(volume, p.x, p.y, p.z);
+	return result;
+}
+
+void CPURaycaster::setStepSize(float stepSize)
+{
+	m_stepSize = stepSize;
+}
+
+float CPURaycaster::getStepSize() const
+{
+	return m_stepSize;
+}
+
+const CPURenderStats& CPURaycaster::getStats() const
+{
+	return m_stats;
+}
+
+void CPURaycaster::setIsoRefinementSteps(int steps)
+{
+	m_isoRefinementSteps = std::max(0, steps);
+}
+
+int CPURaycaster::getIsoRefinementSteps() const
+{
+	return m_isoRefinementSteps;
+}
@@ -0,0 +1,89 @@
+#ifndef CPURAYCASTER_H
+#define CPURAYCASTER_H
+
+#include "CPURendering.h"
+#include "Bricks.h"
+
+/**
+ * @brief reference CPU implementation of the maximum intensity projection and isosurface mode of volume.frag
+ *
+ * Rays are cast per pixel through the volume and sampled with trilinear interpolation.
+ * Works for orthographic and perspective projections. Image rows are distributed over the ThreadPool.
+ */
+class CPURaycaster
+{
+protected:
+	float m_stepSize; //!< ray sampling step size in voxels
+	int m_isoRefinementSteps; //!< bisection steps refining an isosurface hit
+	CPURenderStats m_stats;
+
+	// shared traversal of both render() variants; the optional images are filled if minImage is not null
+	void renderRays(const VolumeData<short>& volume, const glm::mat4& voxelToPixel, MIPImage& image, MIPImage* minImage, MIPImage* averageImage, MIPImage* maxDepthImage);
+
+	// first crossing of isoValue along entry + t * direction, t in [0,1]; -1 if there is none
+	float traceIsosurface(const VolumeData<short>& volume, const glm::vec3& entry, const glm::vec3& direction, float isoValue, const MinMaxBricks* bricks, double& samples) const;
+
+public:
+	CPURaycaster(float stepSize = 0.5f);
+	virtual ~CPURaycaster();
+
+	/**
+	 * @brief render a maximum intensity projection
+	 *
+	 * @param volume to be rendered
+	 * @param voxelToPixel transformation as computed by CPURendering::computeVoxelToPixel
+	 * @param image target image; its size defines the amount of rays
+	 */
+	void render(const VolumeData<short>& volume, const glm::mat4& voxelToPixel, MIPImage& image);
+
+	/**
+	 * @brief render a maximum, minimum and average intensity projection in a single traversal
+	 *
+	 * @param volume to be rendered
+	 * @param voxelToPixel transformation as computed by CPURendering::computeVoxelToPixel
+	 * @param image target image of the MIP; its size defines the amount of rays
+	 * @param minImage target image of the minimum intensity projection, resized to the size of image
+	 * @param averageImage target image of the average intensity projection, resized to the size of image
+	 * @param maxDepthImage target image of the relative position of the maximum along the ray in [0,1], resized to the size of image
+	 */
+	void render(const VolumeData<short>& volume, const glm::mat4& voxelToPixel, MIPImage& image, MIPImage& minImage, MIPImage& averageImage, MIPImage& maxDepthImage);
+
+	/**
+	 * @brief render the first hit of an isosurface, shaded by a two sided headlight
+	 *
+	 * Rays end at the first crossing of the iso value, which is refined by bisection. Rays starting
+	 * inside the surface hit at their entry point. Bricks whose value range excludes the iso value are skipped.
+	 *
+	 * @param volume to be rendered
+	 * @param voxelToPixel transformation as computed by CPURendering::computeVoxelToPixel
+	 * @param isoValue value of the surface
+	 * @param bricks value ranges of the bricks of volume, may be 0 to traverse every step
+	 * @param image target image of the diffuse term in [0,1]; its size defines the amount of rays
+	 * @param depthImage target image of the relative position of the hit along the ray in [0,1], may be 0
+	 */
+	void renderIsosurface(const VolumeData<short>& volume, const glm::mat4& voxelToPixel, float isoValue, const MinMaxBricks* bricks, MIPImage& image, MIPImage* depthImage = 0);
+
+	/**
+	 * @brief the maximum render() finds along the ray of a single pixel, e.g. for picking without a GL context
+	 *
+	 * @param volume to be picked in
+	 * @param voxelToPixel transformation as computed by CPURendering::computeVoxelToPixel
+	 * @param px pixel x coordinate, pixel centers lie at +0.5
+	 * @param py pixel y coordinate, pixel centers lie at +0.5
+	 */
+	VoxelPick pick(const VolumeData<short>& volume, const glm::mat4& voxelToPixel, float px, float py) const;
+
+	/**
+	 * @brief the hit renderIsosurface() finds along the ray of a single pixel, see pick()
+	 */
+	VoxelPick pickIsosurface(const VolumeData<short>& volume, const glm::mat4& voxelToPixel, float isoValue, const MinMaxBricks* bricks, float px, float py) const;
+
+	void setStepSize(float stepSize);
+	float getStepSize() const;
+	void setIsoRefinementSteps(int steps);
+	int getIsoRefinementSteps() const;
+
+	const CPURenderStats& getStats() const; //!< timing of the last call to render
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "CPURendering.h"
+
+#include <Core/ThreadPool.h>
+
+const float MIPImage::BACKGROUND = -FLT_MAX;
+
+void MIPImage::resize(int w, int h)
+{
+	width = w;
+	height = h;
+	value.resize( (size_t) w * h );
+}
+
+void MIPImage::clear()
+{
+	std::fill(value.begin(), value.end(), BACKGROUND);
+}
+
+double CPURenderStats::getSamplesPerSecond() const
+{
+	if (milliseconds <= 0.0)
+	{
+		return 0.0;
+	}
+	return samples / (milliseconds / 1000.0);
+}
+
+glm::mat4 CPURendering::computeVoxelToPixel(const glm::ivec3& volumeSize, const glm::vec3& proxySize, const glm::mat4& modelViewProjection, int width, int height)
+{
+	// voxel index -> uvw, texel centers lie at (i + 0.5) / size
+	glm::mat4 uvwFromVoxel(1.0f);
+	uvwFromVoxel[0][0] = 1.0f / (float) volumeSize.x;
+	uvwFromVoxel[1][1] = 1.0f / (float) volumeSize.y;
+	uvwFromVoxel[2][2] = 1.0f / (float) volumeSize.z;
+	uvwFromVoxel[3] = glm::vec4( 0.5f / (float) volumeSize.x, 0.5f / (float) volumeSize.y, 0.5f / (float) volumeSize.z, 1.0f);
+
+	// uvw -> proxy model space [-proxySize, proxySize]
+	glm::mat4 modelFromUVW(1.0f);
+	modelFromUVW[0][0] = 2.0f * proxySize.x;
+	modelFromUVW[1][1] = 2.0f * proxySize.y;
+	modelFromUVW[2][2] = 2.0f * proxySize.z;
+	modelFromUVW[3] = glm::vec4( -proxySize, 1.0f);
+
+	// ndc -> pixel, depth stays in ndc
+	glm::mat4 pixelFromNDC(1.0f);
+	pixelFromNDC[0][0] = 0.5f * (float) width;
+	pixelFromNDC[1][1] = 0.5f * (float) height;
+	pixelFromNDC[3] = glm::vec4( 0.5f * (float) width, 0.5f * (float) height, 0.0f, 1.0f);
+
+	return pixelFromNDC * modelViewProjection * modelFromUVW * uvwFromVoxel;
+}
+
+void CPURendering::computePixelRay(const glm::mat4& pixelToVoxel, float px, float py, glm::vec3& start, glm::vec3& end)
+{
+	glm::vec4 nearPoint = pixelToVoxel * glm::vec4(px, py, -1.0f, 1.0f);
+	glm::vec4 farPoint  = pixelToVoxel * glm::vec4(px, py,  1.0f, 1.0f);
+
+	start = glm::vec3(nearPoint) / nearPoint.w;
+	end   = glm::vec3(farPoint)  / farPoint.w;
+}
+
+bool CPURendering::clipRayToVolume(const glm::vec3& start, const glm::vec3& end, const glm::ivec3& volumeSize, float& tNear, float& tFar)
+{
+	glm::vec3 direction = end - start;
+	tNear = 0.0f;
+	tFar  = 1.0f;
+
+	for (int i = 0; i < 3; i++)
+	{
+		float boxMin = -0.5f;
+		float boxMax = (float) volumeSize[i] - 0.5f;
+
+		if ( std::abs(direction[i]) < 1e-12f )
+		{
+			// parallel to slab: either completely inside or outside
+			if ( start[i] < boxMin || start[i] > boxMax )
+			{
+				return false;
+			}
+			continue;
+		}
+
+		float t0 = (boxMin - start[i]) / direction[i];
+		float t1 = (boxMax - start[i]) / direction[i];
+		if (t0 > t1)
+		{
+			std::swap(t0, t1);
+		}
+
+		tNear = std::max(tNear, t0);
+		tFar  = std::min(tFar,  t1);
+
+		if (tNear > tFar)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void CPURendering::windowToRGBA8(const MIPImage& image, float windowMin, float windowMax, std::vector<unsigned char>& rgba)
+{
+	rgba.resize( (size_t) image.width * image.height * 4 );
+	float scale = 255.0f / std::max(windowMax - windowMin, 1e-6f);
+
+	THREADPOOL->parallelFor(0, image.height, [&](int rowBegin, int rowEnd)
+	{
+		for (size_t i = (size_t) rowBegin * image.width; i < (size_t) rowEnd * image.width; i++)
+		{
+			float value = image.value[i];
+			unsigned char gray = (unsigned char) std::min( std::max( (value - windowMin) * scale, 0.0f ), 255.0f );
+			rgba[4 * i]     = gray;
+			rgba[4 * i + 1] = gray;
+			rgba[4 * i + 2] = gray;
+			rgba[4 * i + 3] = (value == MIPImage::BACKGROUND) ? 0 : 255;
+		}
+	});
+}
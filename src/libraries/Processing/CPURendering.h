@@ -0,0 +1,147 @@
+#ifndef CPURENDERING_H
+#define CPURENDERING_H
+
+#include <vector>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include <Importing/Importer.h>
+
+/**
+ * @brief result of a CPU projection or reslicing of a volume
+ */
+struct MIPImage
+{
+	int width;
+	int height;
+
+	std::vector<float> value; //!< projected value per pixel, row 0 is the bottom row (like OpenGL textures)
+
+	static const float BACKGROUND; //!< value of pixels not covered by the volume
+
+	void resize(int w, int h);
+	void clear();
+};
+
+/**
+ * @brief timing of the last frame of a CPU rendering engine
+ */
+struct CPURenderStats
+{
+	double milliseconds;   //!< wall clock time of the last frame
+	double samples;        //!< volume samples processed in the last frame
+
+	double getSamplesPerSecond() const; //!< throughput of the last frame
+};
+
+/**
+ * @brief the sample a ray selected for a pixel: the maximum of a MIP or the first hit of an isosurface
+ */
+struct VoxelPick
+{
+	bool hit;           //!< false if the pixel is not covered by the volume or the ray found nothing
+	glm::vec3 position; //!< voxel coordinates of the sample, voxel centers are at integer coordinates
+	glm::ivec3 voxel;   //!< nearest voxel
+	float value;        //!< interpolated value of the sample
+
+	VoxelPick() : hit(false), position(0.0f), voxel(0), value(0.0f) {}
+
+	//! set position and the nearest voxel inside the volume
+	inline void setPosition(const glm::vec3& p, const glm::ivec3& volumeSize)
+	{
+		position = p;
+		voxel = glm::clamp( glm::ivec3( glm::floor(p + 0.5f) ), glm::ivec3(0), volumeSize - 1 );
+	}
+};
+
+namespace CPURendering {
+	/**
+	 * @brief compute the transformation from voxel index space to pixel space
+	 *
+	 * Voxel centers are at integer coordinates. The volume proxy geometry spans [-proxySize, proxySize]
+	 * in model space and is mapped to uvw [0,1], just like the Volume renderable does.
+	 *
+	 * @param volumeSize voxel resolution of the volume
+	 * @param proxySize half extent of the volume proxy geometry (the Volume renderable sizes)
+	 * @param modelViewProjection matrix applied to the proxy geometry
+	 * @param width of the target image in pixels
+	 * @param height of the target image in pixels
+	 * @return matrix mapping voxel coordinates to (pixel x, pixel y, ndc depth)
+	 */
+	glm::mat4 computeVoxelToPixel(const glm::ivec3& volumeSize, const glm::vec3& proxySize, const glm::mat4& modelViewProjection, int width, int height);
+
+	/**
+	 * @brief compute the segment of the viewing ray through a pixel, clipped by the near and far plane
+	 *
+	 * @param pixelToVoxel inverse of the voxelToPixel transformation
+	 * @param px pixel x coordinate, pixel centers lie at +0.5
+	 * @param py pixel y coordinate, pixel centers lie at +0.5
+	 * @param start ray start on the near plane in voxel coordinates
+	 * @param end ray end on the far plane in voxel coordinates
+	 */
+	void computePixelRay(const glm::mat4& pixelToVoxel, float px, float py, glm::vec3& start, glm::vec3& end);
+
+	/**
+	 * @brief clip a ray segment against the volume bounds [-0.5, size - 0.5]
+	 *
+	 * @param start of the segment, as in start + t * (end - start)
+	 * @param end of the segment
+	 * @param volumeSize voxel resolution of the volume
+	 * @param tNear parameter of the entry point
+	 * @param tFar parameter of the exit point
+	 * @return true if the segment hits the volume
+	 */
+	bool clipRayToVolume(const glm::vec3& start, const glm::vec3& end, const glm::ivec3& volumeSize, float& tNear, float& tFar);
+
+	/**
+	 * @brief map image values linearly to 8 bit grayscale, e.g. for display as an ImGui image
+	 *
+	 * @param image to be mapped
+	 * @param windowMin value mapped to black
+	 * @param windowMax value mapped to white
+	 * @param rgba target, resized to 4 bytes per pixel; background pixels are transparent
+	 */
+	void windowToRGBA8(const MIPImage& image, float windowMin, float windowMax, std::vector<unsigned char>& rgba);
+
+	/**
+	 * @brief trilinear sample at voxel coordinates, clamped to the border
+	 */
+	template<class T>
+	inline float sampleTrilinear(const VolumeData<T>& volume, float x, float y, float z)
+	{
+		x = std::min( std::max(x, 0.0f), (float) (volume.size_x - 1) );
+		y = std::min( std::max(y, 0.0f), (float) (volume.size_y - 1) );
+		z = std::min( std::max(z, 0.0f), (float) (volume.size_z - 1) );
+
+		// lower corner of the interpolation cell, kept inside the volume
+		int x0 = std::max( 0, std::min( (int) x, (int) volume.size_x - 2 ) );
+		int y0 = std::max( 0, std::min( (int) y, (int) volume.size_y - 2 ) );
+		int z0 = std::max( 0, std::min( (int) z, (int) volume.size_z - 2 ) );
+		float fx = x - x0;
+		float fy = y - y0;
+		float fz = z - z0;
+
+		size_t strideY = volume.size_x;
+		size_t strideZ = (size_t) volume.size_x * volume.size_y;
+		int dx = volume.size_x > 1 ? 1 : 0;
+		size_t dy = volume.size_y > 1 ? strideY : 0;
+		size_t dz = volume.size_z > 1 ? strideZ : 0;
+
+		const T* p = &volume.data[ z0 * strideZ + y0 * strideY + x0 ];
+
+		float c00 = p[0]       + fx * (p[dx]           - p[0]);
+		float c10 = p[dy]      + fx * (p[dy + dx]      - p[dy]);
+		float c01 = p[dz]      + fx * (p[dz + dx]      - p[dz]);
+		float c11 = p[dz + dy] + fx * (p[dz + dy + dx] - p[dz + dy]);
+
+		float c0 = c00 + fy * (c10 - c00);
+		float c1 = c01 + fy * (c11 - c01);
+
+		return c0 + fz * (c1 - c0);
+	}
+} // namespace CPURendering
+
+#endif
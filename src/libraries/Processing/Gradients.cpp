@@ -0,0 +1,192 @@
+#include "Gradients.h"
+
+#include <Core/ThreadPool.h>
+#include <Core/DebugLog.h>
+
+#include <chrono>
+#include <mutex>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+	/**
+	 * @brief dst[i] += weight * src[i] for a contiguous row
+	 */
+	inline void addRow(float* dst, const short* src, float weight, int n)
+	{
+		int i = 0;
+	#ifdef __SSE2__
+		__m128 w = _mm_set1_ps(weight);
+		for (; i + 4 <= n; i += 4)
+		{
+			__m128i s = _mm_loadl_epi64( (const __m128i*) (src + i) );
+			s = _mm_srai_epi32( _mm_unpacklo_epi16(s, s), 16 ); // sign extend to 32 bit
+			__m128 d = _mm_loadu_ps(dst + i);
+			_mm_storeu_ps( dst + i, _mm_add_ps( d, _mm_mul_ps(w, _mm_cvtepi32_ps(s)) ) );
+		}
+	#endif
+		for (; i < n; i++)
+		{
+			dst[i] += weight * (float) src[i];
+		}
+	}
+
+	/**
+	 * @brief scratch rows of the separable evaluation
+	 */
+	struct RowBuffers
+	{
+		std::vector<float> smoothed; //!< smoothed along y and z, differentiated along x afterwards
+		std::vector<float> diffY;    //!< differentiated along y, smoothed along z; smoothed along x afterwards
+		std::vector<float> diffZ;    //!< differentiated along z, smoothed along y; smoothed along x afterwards
+		std::vector<float> gx, gy, gz;
+
+		RowBuffers(int n) : smoothed(n), diffY(n), diffZ(n), gx(n), gy(n), gz(n) {}
+	};
+
+	/**
+	 * @brief unnormalized gradients of row (y, z)
+	 *
+	 * @param weights perpendicular to the derivative: (0, 1, 0) central difference, (1, 2, 1) Sobel
+	 */
+	void computeRow(const VolumeData<short>& volume, const float* weights, int y, int z, RowBuffers& rows)
+	{
+		int n = (int) volume.size_x;
+		std::fill(rows.smoothed.begin(), rows.smoothed.end(), 0.0f);
+		std::fill(rows.diffY.begin(), rows.diffY.end(), 0.0f);
+		std::fill(rows.diffZ.begin(), rows.diffZ.end(), 0.0f);
+
+		for (int dz = -1; dz <= 1; dz++)
+		{
+			int rowZ = std::max( 0, std::min(z + dz, (int) volume.size_z - 1) );
+			for (int dy = -1; dy <= 1; dy++)
+			{
+				int rowY = std::max( 0, std::min(y + dy, (int) volume.size_y - 1) );
+				const short* row = &volume.data[ ( (size_t) rowZ * volume.size_y + rowY ) * volume.size_x ];
+
+				float wy = weights[dy + 1];
+				float wz = weights[dz + 1];
+				if ( wy * wz != 0.0f )       { addRow(&rows.smoothed[0], row, wy * wz, n); }
+				if ( dy != 0 && wz != 0.0f ) { addRow(&rows.diffY[0], row, (float) dy * wz, n); }
+				if ( dz != 0 && wy != 0.0f ) { addRow(&rows.diffZ[0], row, (float) dz * wy, n); }
+			}
+		}
+
+		for (int x = 0; x < n; x++)
+		{
+			int xm = std::max(x - 1, 0);
+			int xp = std::min(x + 1, n - 1);
+			rows.gx[x] = rows.smoothed[xp] - rows.smoothed[xm];
+			rows.gy[x] = weights[0] * rows.diffY[xm] + weights[1] * rows.diffY[x] + weights[2] * rows.diffY[xp];
+			rows.gz[x] = weights[0] * rows.diffZ[xm] + weights[1] * rows.diffZ[x] + weights[2] * rows.diffZ[xp];
+		}
+	}
+}
+
+size_t GradientVolume::getBytes() const
+{
+	return data.size() * sizeof(unsigned int);
+}
+
+void Gradients::compute(const VolumeData<short>& volume, Operator op, GradientVolume& gradients)
+{
+	DEBUGLOG->log( op == SOBEL ? "Gradients: computing Sobel gradients" : "Gradients: computing central difference gradients" );
+	auto start = std::chrono::high_resolution_clock::now();
+
+	gradients.size_x = volume.size_x;
+	gradients.size_y = volume.size_y;
+	gradients.size_z = volume.size_z;
+	gradients.data.resize( (size_t) volume.size_x * volume.size_y * volume.size_z );
+
+	static const float centralWeights[3] = { 0.0f, 1.0f, 0.0f };
+	static const float sobelWeights[3]   = { 1.0f, 2.0f, 1.0f };
+	const float* weights = (op == SOBEL) ? sobelWeights : centralWeights;
+
+	// both operators in values per voxel: central difference / 2, Sobel / (2 * 4 * 4)
+	float weightSum = weights[0] + weights[1] + weights[2];
+	float scale = 1.0f / (2.0f * weightSum * weightSum);
+
+	// first pass: maximum magnitude, needed for the encoding
+	std::mutex maxMutex;
+	float maxSquaredMagnitude = 0.0f;
+	THREADPOOL->parallelFor(0, (int) volume.size_z, [&](int zBegin, int zEnd)
+	{
+		RowBuffers rows( (int) volume.size_x );
+		float chunkMax = 0.0f;
+		for (int z = zBegin; z < zEnd; z++)
+		{
+			for (int y = 0; y < (int) volume.size_y; y++)
+			{
+				computeRow(volume, weights, y, z, rows);
+				for (unsigned int x = 0; x < volume.size_x; x++)
+				{
+					chunkMax = std::max(chunkMax, rows.gx[x] * rows.gx[x] + rows.gy[x] * rows.gy[x] + rows.gz[x] * rows.gz[x]);
+				}
+			}
+		}
+		std::lock_guard<std::mutex> lock(maxMutex);
+		maxSquaredMagnitude = std::max(maxSquaredMagnitude, chunkMax);
+	});
+	gradients.maxMagnitude = std::sqrt(maxSquaredMagnitude) * scale;
+
+	// second pass: pack
+	THREADPOOL->parallelFor(0, (int) volume.size_z, [&](int zBegin, int zEnd)
+	{
+		RowBuffers rows( (int) volume.size_x );
+		for (int z = zBegin; z < zEnd; z++)
+		{
+			for (int y = 0; y < (int) volume.size_y; y++)
+			{
+				computeRow(volume, weights, y, z, rows);
+				unsigned int* packed = &gradients.data[ ( (size_t) z * volume.size_y + y ) * volume.size_x ];
+				for (unsigned int x = 0; x < volume.size_x; x++)
+				{
+					packed[x] = pack( glm::vec3(rows.gx[x], rows.gy[x], rows.gz[x]) * scale, gradients.maxMagnitude );
+				}
+			}
+		}
+	});
+
+	gradients.milliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+	DEBUGLOG->indent();
+		DEBUGLOG->log("max magnitude: ", gradients.maxMagnitude);
+		DEBUGLOG->log("ms           : ", (float) gradients.milliseconds);
+		DEBUGLOG->log("MB           : ", (float) gradients.getBytes() / (1024.0f * 1024.0f));
+	DEBUGLOG->outdent();
+}
+
+unsigned int Gradients::pack(const glm::vec3& gradient, float maxMagnitude)
+{
+	float magnitude = glm::length(gradient);
+	float relative = 0.0f;
+	glm::vec3 e(0.0f);
+	if ( magnitude > 0.0f && maxMagnitude > 0.0f )
+	{
+		relative = std::sqrt( std::min(1.0f, magnitude / maxMagnitude) );
+		e = gradient * (relative / magnitude);
+	}
+
+	unsigned int r = (unsigned int) ( (e.x * 0.5f + 0.5f) * 1023.0f + 0.5f );
+	unsigned int g = (unsigned int) ( (e.y * 0.5f + 0.5f) * 1023.0f + 0.5f );
+	unsigned int b = (unsigned int) ( (e.z * 0.5f + 0.5f) * 1023.0f + 0.5f );
+	unsigned int a = (unsigned int) ( relative * 3.0f + 0.5f );
+	return r | (g << 10) | (b << 20) | (a << 30);
+}
+
+glm::vec3 Gradients::unpack(unsigned int packed, float maxMagnitude)
+{
+	glm::vec3 e(
+		(float) ( packed         & 1023u ),
+		(float) ( (packed >> 10) & 1023u ),
+		(float) ( (packed >> 20) & 1023u ) );
+	e = e / 1023.0f * 2.0f - 1.0f;
+
+	float length = glm::length(e);
+	if ( length == 0.0f )
+	{
+		return glm::vec3(0.0f);
+	}
+	return e * (length * maxMagnitude); // direction e / length, magnitude length^2 * maxMagnitude
+}
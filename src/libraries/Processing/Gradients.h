@@ -0,0 +1,53 @@
+#ifndef GRADIENTS_H
+#define GRADIENTS_H
+
+#include "CPURendering.h"
+
+/**
+ * @brief precomputed gradients of a volume, packed for a GL_RGB10_A2 3D texture
+ *
+ * Per voxel, rgb holds the gradient direction scaled by the square root of its relative magnitude,
+ * mapped to [0,1]: e = direction * sqrt(magnitude / maxMagnitude), rgb = e * 0.5 + 0.5.
+ * The square root keeps the direction of weak gradients precise; the magnitude is recovered as
+ * dot(e, e) * maxMagnitude. Alpha holds the relative magnitude quantized to 2 bits, as a cheap
+ * classification (0: homogeneous region).
+ * The packed encoding survives trilinear filtering reasonably, since e is a continuous vector field.
+ */
+struct GradientVolume
+{
+	unsigned int size_x;
+	unsigned int size_y;
+	unsigned int size_z;
+
+	std::vector<unsigned int> data; //!< GL_UNSIGNED_INT_2_10_10_10_REV per voxel, r in the lowest bits
+
+	float maxMagnitude;   //!< magnitude of the strongest gradient, in values per voxel
+	double milliseconds;  //!< wall clock time of the computation
+
+	size_t getBytes() const; //!< memory of the packed gradients
+};
+
+namespace Gradients {
+	enum Operator
+	{
+		CENTRAL_DIFFERENCE, //!< 6 neighbours
+		SOBEL               //!< 3x3x3 neighbourhood, smoothed perpendicular to the derivative
+	};
+
+	/**
+	 * @brief compute the gradients of all voxels, parallel over slices
+	 *
+	 * Both operators are evaluated separably on whole rows, which is vectorized with SSE2 if available.
+	 * Gradients are in values per voxel; the volume border is clamped, like GL_CLAMP_TO_EDGE.
+	 *
+	 * @param volume to derive
+	 * @param op difference operator
+	 * @param gradients resized and filled
+	 */
+	void compute(const VolumeData<short>& volume, Operator op, GradientVolume& gradients);
+
+	unsigned int pack(const glm::vec3& gradient, float maxMagnitude); //!< see GradientVolume
+	glm::vec3 unpack(unsigned int packed, float maxMagnitude);         //!< see GradientVolume
+} // namespace Gradients
+
+#endif
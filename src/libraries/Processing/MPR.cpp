@@ -0,0 +1,300 @@
+#include "MPR.h"
+
+#include <Core/ThreadPool.h>
+
+#include <chrono>
+
+namespace {
+	inline bool isInteger(float value)
+	{
+		return std::abs(value - std::floor(value + 0.5f)) < 1e-4f;
+	}
+
+	inline bool isInsideVolume(const glm::vec3& p, const glm::ivec3& size)
+	{
+		return p.x >= -0.5f && p.y >= -0.5f && p.z >= -0.5f
+			&& p.x <= (float) size.x - 0.5f && p.y <= (float) size.y - 0.5f && p.z <= (float) size.z - 0.5f;
+	}
+
+	// voxel size in mm, 1 if unknown
+	inline glm::vec3 voxelSpacing(const VolumeData<short>& volume)
+	{
+		glm::vec3 spacing(volume.real_size_x, volume.real_size_y, volume.real_size_z);
+		for (int i = 0; i < 3; i++)
+		{
+			if ( !(spacing[i] > 0.0f) ) { spacing[i] = 1.0f; }
+		}
+		return spacing;
+	}
+
+	// combine one line of voxels into a row of the image; Stride 0: runtime stride, else a constant one,
+	// so the contiguous case (axial images) compiles to vectorized loops
+	template <size_t Stride>
+	inline void combineRow(const short* src, size_t runtimeStride, float* dst, int count, bool first, MPR::SlabMode mode)
+	{
+		const size_t stride = Stride ? Stride : runtimeStride;
+		if (first)
+		{
+			for (int x = 0; x < count; x++) { dst[x] = (float) src[x * stride]; }
+		}
+		else if (mode == MPR::SLAB_MIP)
+		{
+			for (int x = 0; x < count; x++) { dst[x] = std::max(dst[x], (float) src[x * stride]); }
+		}
+		else if (mode == MPR::SLAB_MINIP)
+		{
+			for (int x = 0; x < count; x++) { dst[x] = std::min(dst[x], (float) src[x * stride]); }
+		}
+		else
+		{
+			for (int x = 0; x < count; x++) { dst[x] += (float) src[x * stride]; }
+		}
+	}
+
+	// index of the axis if v is the positive unit vector along it, -1 otherwise
+	inline int unitAxis(const glm::vec3& v)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			if ( v[i] == 1.0f && v[(i + 1) % 3] == 0.0f && v[(i + 2) % 3] == 0.0f )
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+}
+
+glm::vec3 SlicePlane::getNormal() const
+{
+	return glm::normalize( glm::cross(axisU, axisV) );
+}
+
+MPR::MPR()
+{
+	m_slabThickness = 1.0f;
+	m_slabMode = SLAB_MIP;
+	m_stats.milliseconds = 0.0;
+	m_stats.samples = 0.0;
+}
+
+MPR::~MPR()
+{
+}
+
+SlicePlane MPR::createPlane(const VolumeData<short>& volume, Orientation orientation, float position)
+{
+	glm::ivec3 size(volume.size_x, volume.size_y, volume.size_z);
+	glm::vec3 center = glm::vec3(size - glm::ivec3(1)) * 0.5f;
+
+	int axisU = 0, axisV = 1, axisN = 2; // AXIAL
+	if (orientation == CORONAL)  { axisU = 0; axisV = 2; axisN = 1; }
+	if (orientation == SAGITTAL) { axisU = 1; axisV = 2; axisN = 0; }
+
+	// snap to voxel positions, so the fast path is taken
+	center[axisN] = std::floor( glm::clamp(position, 0.0f, 1.0f) * (float) (size[axisN] - 1) + 0.5f );
+
+	SlicePlane plane;
+	plane.center = center;
+	plane.axisU = glm::vec3(0.0f);
+	plane.axisV = glm::vec3(0.0f);
+	plane.axisU[axisU] = 1.0f;
+	plane.axisV[axisV] = 1.0f;
+	plane.width = size[axisU];
+	plane.height = size[axisV];
+	return plane;
+}
+
+SlicePlane MPR::createObliquePlane(const VolumeData<short>& volume, const glm::vec3& center, const glm::vec3& normal, int resolution, float pixelSpacing)
+{
+	// the in-plane axes are orthonormal in mm, so anisotropic voxels don't shear or stretch the image;
+	// plane normals map to mm with the inverse voxel spacing
+	glm::vec3 spacing = voxelSpacing(volume);
+	glm::vec3 n = glm::normalize(normal / spacing);
+
+	// in-plane axes: u is perpendicular to z if possible, so the image stays upright
+	glm::vec3 reference = ( std::abs(n.z) < 0.99f ) ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::vec3 u = glm::normalize( glm::cross(reference, n) );
+	glm::vec3 v = glm::cross(n, u);
+	float pixelSize = pixelSpacing * std::min( spacing.x, std::min(spacing.y, spacing.z) ); // mm
+
+	glm::ivec3 size(volume.size_x, volume.size_y, volume.size_z);
+	SlicePlane plane;
+	plane.center = glm::clamp( center, glm::vec3(0.0f), glm::vec3( glm::max(size - glm::ivec3(1), glm::ivec3(0)) ) );
+	plane.axisU = u * pixelSize / spacing;
+	plane.axisV = v * pixelSize / spacing;
+	plane.width = resolution;
+	plane.height = resolution;
+	return plane;
+}
+
+int MPR::getNumSlabSamples() const
+{
+	return std::max(1, (int) (m_slabThickness + 0.5f));
+}
+
+void MPR::extract(const VolumeData<short>& volume, const SlicePlane& plane, MIPImage& image)
+{
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+
+	if (image.width != plane.width || image.height != plane.height)
+	{
+		image.resize(plane.width, plane.height);
+	}
+
+	if ( !extractAxisAligned(volume, plane, image) )
+	{
+		extractOblique(volume, plane, image);
+	}
+
+	m_stats.samples = (double) plane.width * (double) plane.height * (double) getNumSlabSamples();
+	m_stats.milliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - startTime ).count();
+}
+
+bool MPR::extractAxisAligned(const VolumeData<short>& volume, const SlicePlane& plane, MIPImage& image)
+{
+	int axisU = unitAxis(plane.axisU);
+	int axisV = unitAxis(plane.axisV);
+	if (axisU < 0 || axisV < 0 || axisU == axisV)
+	{
+		return false;
+	}
+	int axisN = 3 - axisU - axisV;
+
+	int numSlabSamples = getNumSlabSamples();
+	glm::vec3 first = plane.center + (0.5f - 0.5f * (float) plane.width) * plane.axisU + (0.5f - 0.5f * (float) plane.height) * plane.axisV;
+	float firstN = plane.center[axisN] - 0.5f * (float) (numSlabSamples - 1);
+	if ( !isInteger(first[axisU]) || !isInteger(first[axisV]) || !isInteger(firstN) )
+	{
+		return false; // samples between voxels need interpolation
+	}
+
+	glm::ivec3 size(volume.size_x, volume.size_y, volume.size_z);
+	size_t strides[3] = { 1, (size_t) volume.size_x, (size_t) volume.size_x * volume.size_y };
+	size_t strideU = strides[axisU];
+
+	int u0 = (int) std::floor(first[axisU] + 0.5f);
+	int v0 = (int) std::floor(first[axisV] + 0.5f);
+	int n0 = (int) std::floor(firstN + 0.5f);
+
+	// slab samples inside the volume
+	int nBegin = std::max(0, n0);
+	int nEnd = std::min(size[axisN], n0 + numSlabSamples);
+
+	// pixel columns inside the volume
+	int xBegin = std::max(0, -u0);
+	int xEnd = std::min(plane.width, size[axisU] - u0);
+
+	SlabMode mode = m_slabMode;
+	THREADPOOL->parallelFor(0, plane.height, [&](int rowBegin, int rowEnd)
+	{
+		for (int y = rowBegin; y < rowEnd; y++)
+		{
+			float* row = &image.value[ (size_t) y * image.width ];
+			std::fill(row, row + image.width, MIPImage::BACKGROUND);
+
+			int v = v0 + y;
+			if (v < 0 || v >= size[axisV] || nBegin >= nEnd || xBegin >= xEnd)
+			{
+				continue;
+			}
+
+			for (int n = nBegin; n < nEnd; n++)
+			{
+				const short* src = &volume.data[ (size_t) v * strides[axisV] + (size_t) n * strides[axisN] + (size_t) (u0 + xBegin) * strideU ];
+				if (strideU == 1)
+				{
+					combineRow<1>(src, strideU, row + xBegin, xEnd - xBegin, n == nBegin, mode);
+				}
+				else
+				{
+					combineRow<0>(src, strideU, row + xBegin, xEnd - xBegin, n == nBegin, mode);
+				}
+			}
+
+			if (mode == SLAB_AVERAGE && nEnd - nBegin > 1)
+			{
+				float normalization = 1.0f / (float) (nEnd - nBegin);
+				for (int x = xBegin; x < xEnd; x++) { row[x] *= normalization; }
+			}
+		}
+	});
+
+	return true;
+}
+
+void MPR::extractOblique(const VolumeData<short>& volume, const SlicePlane& plane, MIPImage& image)
+{
+	glm::ivec3 size(volume.size_x, volume.size_y, volume.size_z);
+
+	// slab samples perpendicular to the plane in mm, one voxel of the finest axis apart
+	glm::vec3 spacing = voxelSpacing(volume);
+	glm::vec3 normal = glm::normalize( glm::cross(plane.axisU * spacing, plane.axisV * spacing) )
+		* std::min( spacing.x, std::min(spacing.y, spacing.z) ) / spacing;
+	int numSlabSamples = getNumSlabSamples();
+	glm::vec3 first = plane.center + (0.5f - 0.5f * (float) plane.width) * plane.axisU + (0.5f - 0.5f * (float) plane.height) * plane.axisV
+		- normal * (0.5f * (float) (numSlabSamples - 1));
+
+	SlabMode mode = m_slabMode;
+	THREADPOOL->parallelFor(0, plane.height, [&](int rowBegin, int rowEnd)
+	{
+		for (int y = rowBegin; y < rowEnd; y++)
+		{
+			float* row = &image.value[ (size_t) y * image.width ];
+			glm::vec3 rowStart = first + (float) y * plane.axisV;
+
+			for (int x = 0; x < plane.width; x++)
+			{
+				glm::vec3 p = rowStart + (float) x * plane.axisU;
+
+				float result = MIPImage::BACKGROUND;
+				int numInside = 0;
+				for (int s = 0; s < numSlabSamples; s++, p += normal)
+				{
+					if ( !isInsideVolume(p, size) )
+					{
+						continue;
+					}
+
+					float value = CPURendering::sampleTrilinear(volume, p.x, p.y, p.z);
+					if (numInside == 0)               { result = value; }
+					else if (mode == SLAB_MIP)        { result = std::max(result, value); }
+					else if (mode == SLAB_MINIP)      { result = std::min(result, value); }
+					else                              { result += value; }
+					numInside++;
+				}
+
+				if (mode == SLAB_AVERAGE && numInside > 1)
+				{
+					result /= (float) numInside;
+				}
+				row[x] = result;
+			}
+		}
+	});
+}
+
+void MPR::setSlabThickness(float thickness)
+{
+	m_slabThickness = thickness;
+}
+
+float MPR::getSlabThickness() const
+{
+	return m_slabThickness;
+}
+
+void MPR::setSlabMode(SlabMode mode)
+{
+	m_slabMode = mode;
+}
+
+MPR::SlabMode MPR::getSlabMode() const
+{
+	return m_slabMode;
+}
+
+const CPURenderStats& MPR::getStats() const
+{
+	return m_stats;
+}
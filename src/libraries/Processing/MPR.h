@@ -0,0 +1,90 @@
+#ifndef MPR_H
+#define MPR_H
+
+#include "CPURendering.h"
+
+/**
+ * @brief plane through the volume, sampled on a regular pixel grid
+ *
+ * All vectors are given in voxel coordinates; voxel centers lie at integer coordinates.
+ * Pixel (x,y) is sampled at center + (x + 0.5 - width / 2) * axisU + (y + 0.5 - height / 2) * axisV.
+ */
+struct SlicePlane
+{
+	glm::vec3 center; //!< position of the image center
+	glm::vec3 axisU;  //!< step per pixel in x direction
+	glm::vec3 axisV;  //!< step per pixel in y direction
+	int width;
+	int height;
+
+	glm::vec3 getNormal() const; //!< unit normal of the plane, the slab extends along it
+};
+
+/**
+ * @brief multi-planar reconstruction: axial, coronal, sagittal and oblique slices of a volume
+ *
+ * Slices are sampled with trilinear interpolation. An optional slab thickness combines samples along the
+ * plane normal by maximum, minimum or average. Axis aligned planes on voxel positions take a fast path
+ * which reads contiguous rows without interpolation. Image rows are distributed over the ThreadPool;
+ * works without an OpenGL context.
+ */
+class MPR
+{
+public:
+	enum Orientation { AXIAL = 0, CORONAL = 1, SAGITTAL = 2, OBLIQUE = 3 };
+	enum SlabMode { SLAB_MIP = 0, SLAB_MINIP = 1, SLAB_AVERAGE = 2 };
+
+protected:
+	float m_slabThickness; //!< thickness of the slab in voxels, values <= 1 sample a single plane
+	SlabMode m_slabMode;
+	CPURenderStats m_stats;
+
+	bool extractAxisAligned(const VolumeData<short>& volume, const SlicePlane& plane, MIPImage& image);
+	void extractOblique(const VolumeData<short>& volume, const SlicePlane& plane, MIPImage& image);
+
+	int getNumSlabSamples() const;
+
+public:
+	MPR();
+	virtual ~MPR();
+
+	/**
+	 * @brief create an axis aligned plane covering the whole volume cross section
+	 *
+	 * axial: z = const, image axes (x,y); coronal: y = const, image axes (x,z); sagittal: x = const, image axes (y,z)
+	 *
+	 * @param volume to be sliced
+	 * @param orientation AXIAL, CORONAL or SAGITTAL
+	 * @param position relative position of the plane along its normal axis [0,1]
+	 */
+	static SlicePlane createPlane(const VolumeData<short>& volume, Orientation orientation, float position);
+
+	/**
+	 * @brief create a square oblique plane, with square pixels in mm (real_size_x/y/z) for anisotropic volumes
+	 *
+	 * @param volume to be sliced
+	 * @param center of the plane in voxel coordinates, clamped to the volume
+	 * @param normal of the plane in voxel coordinates
+	 * @param resolution of the image in pixels
+	 * @param pixelSpacing in voxels along the finest axis
+	 */
+	static SlicePlane createObliquePlane(const VolumeData<short>& volume, const glm::vec3& center, const glm::vec3& normal, int resolution, float pixelSpacing = 1.0f);
+
+	/**
+	 * @brief extract a slice or slab
+	 *
+	 * @param volume to be sliced
+	 * @param plane to be sampled
+	 * @param image target image, resized to the plane resolution; samples outside the volume are MIPImage::BACKGROUND
+	 */
+	void extract(const VolumeData<short>& volume, const SlicePlane& plane, MIPImage& image);
+
+	void setSlabThickness(float thickness);
+	float getSlabThickness() const;
+	void setSlabMode(SlabMode mode);
+	SlabMode getSlabMode() const;
+
+	const CPURenderStats& getStats() const; //!< timing of the last call to extract
+};
+
+#endif
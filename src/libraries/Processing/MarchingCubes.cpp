@@ -0,0 +1,475 @@
+#include "MarchingCubes.h"
+
+#include <Core/ThreadPool.h>
+#include <Core/DebugLog.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+
+namespace {
+	/**
+	 * @brief triangles of all 256 corner configurations of a cube
+	 *
+	 * Corner c lies at (c & 1, (c >> 1) & 1, (c >> 2) & 1); bit c of a configuration is set if corner c is inside.
+	 * Edge e runs along axis e / 4 and starts at corner edgeStart[e].
+	 * The table is derived from these definitions instead of being spelled out: the cut edges of every cube
+	 * face are connected to segments, the segments form closed loops around the inside corners, and every
+	 * loop is fanned into triangles.
+	 */
+	struct CaseTable
+	{
+		unsigned char edgeStart[12];
+		unsigned char numTriangles[256];
+		unsigned char triangles[256][12 * 3]; //!< edge indices
+
+		CaseTable()
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				int k = 0;
+				for (int c = 0; c < 8; c++)
+				{
+					if ( !(c & (1 << axis)) ) { edgeStart[axis * 4 + k++] = (unsigned char) c; }
+				}
+			}
+
+			for (int config = 0; config < 256; config++)
+			{
+				buildCase(config);
+			}
+		}
+
+		int edgeBetween(int c0, int c1) const
+		{
+			int axis = (c0 ^ c1) == 1 ? 0 : ( (c0 ^ c1) == 2 ? 1 : 2 );
+			int start = std::min(c0, c1);
+			for (int k = 0; k < 4; k++)
+			{
+				if ( edgeStart[axis * 4 + k] == start ) { return axis * 4 + k; }
+			}
+			return -1;
+		}
+
+		glm::vec3 corner(int c) const
+		{
+			return glm::vec3( (float) (c & 1), (float) ((c >> 1) & 1), (float) ((c >> 2) & 1) );
+		}
+
+		void buildCase(int config)
+		{
+			auto inside = [&](int c) { return ((config >> c) & 1) != 0; };
+
+			// connect the cut edges of every face; each cut edge is connected on both of its faces
+			int neighbours[12][2];
+			int numNeighbours[12] = {0};
+			auto connect = [&](int e0, int e1)
+			{
+				neighbours[e0][ numNeighbours[e0]++ ] = e1;
+				neighbours[e1][ numNeighbours[e1]++ ] = e0;
+			};
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				int u = 1 << ((axis + 1) % 3);
+				int v = 1 << ((axis + 2) % 3);
+				for (int side = 0; side < 2; side++)
+				{
+					int base = side << axis;
+					int f[4] = { base, base | u, base | u | v, base | v }; // cyclic
+					int fe[4];
+					int cut[4];
+					int numCut = 0;
+					for (int i = 0; i < 4; i++)
+					{
+						fe[i] = edgeBetween( f[i], f[(i + 1) % 4] );
+						if ( inside(f[i]) != inside(f[(i + 1) % 4]) ) { cut[numCut++] = fe[i]; }
+					}
+
+					if ( numCut == 2 )
+					{
+						connect(cut[0], cut[1]);
+					}
+					else if ( numCut == 4 )
+					{
+						// ambiguous face: separate the two inside corners
+						for (int i = 0; i < 4; i++)
+						{
+							if ( inside(f[i]) ) { connect( fe[(i + 3) % 4], fe[i] ); }
+						}
+					}
+				}
+			}
+
+			// walk the loops
+			numTriangles[config] = 0;
+			bool visited[12] = {false};
+			for (int first = 0; first < 12; first++)
+			{
+				if ( visited[first] || numNeighbours[first] == 0 ) { continue; }
+
+				std::vector<int> loop;
+				int previous = -1;
+				int current = first;
+				do
+				{
+					visited[current] = true;
+					loop.push_back(current);
+					int next = ( neighbours[current][0] != previous ) ? neighbours[current][0] : neighbours[current][1];
+					previous = current;
+					current = next;
+				} while ( current != first );
+
+				// orient the loop such that its normal points from the inside corners to the outside corners
+				glm::vec3 normal(0.0f);
+				glm::vec3 outwards(0.0f);
+				for (unsigned int i = 0; i < loop.size(); i++)
+				{
+					glm::vec3 a = midpoint( loop[i] );
+					glm::vec3 b = midpoint( loop[(i + 1) % loop.size()] );
+					normal += glm::cross(a, b);
+
+					int c0 = edgeStart[ loop[i] ];
+					int c1 = c0 | ( 1 << (loop[i] / 4) );
+					outwards += inside(c0) ? corner(c1) - corner(c0) : corner(c0) - corner(c1);
+				}
+				if ( glm::dot(normal, outwards) < 0.0f )
+				{
+					std::reverse(loop.begin(), loop.end());
+				}
+
+				for (unsigned int i = 1; i + 1 < loop.size(); i++)
+				{
+					unsigned char* t = &triangles[config][ 3 * numTriangles[config]++ ];
+					t[0] = (unsigned char) loop[0];
+					t[1] = (unsigned char) loop[i];
+					t[2] = (unsigned char) loop[i + 1];
+				}
+			}
+		}
+
+		glm::vec3 midpoint(int e) const
+		{
+			return corner( edgeStart[e] ) + 0.5f * corner( 1 << (e / 4) );
+		}
+	};
+
+	const CaseTable& getCaseTable()
+	{
+		static const CaseTable table;
+		return table;
+	}
+
+	/**
+	 * @brief lock-free map from edge id to vertex index, open addressing with linear probing
+	 *
+	 * Insertions race only for slots, never for keys, since every edge is inserted exactly once.
+	 */
+	class EdgeHashMap
+	{
+	public:
+		static const uint64_t EMPTY = UINT64_MAX;
+
+		EdgeHashMap(size_t numEntries)
+		{
+			m_bits = 4;
+			while ( ((size_t) 1 << m_bits) < 2 * numEntries ) { m_bits++; }
+			m_mask = ((size_t) 1 << m_bits) - 1;
+			m_keys = std::vector< std::atomic<uint64_t> >(m_mask + 1);
+			m_values.resize(m_mask + 1);
+
+			THREADPOOL->parallelFor(0, (int) ((m_mask + 1) >> 12) + 1, [&](int begin, int end)
+			{
+				size_t last = std::min( (size_t) end << 12, m_mask + 1 );
+				for (size_t i = (size_t) begin << 12; i < last; i++)
+				{
+					m_keys[i].store(EMPTY, std::memory_order_relaxed);
+				}
+			});
+		}
+
+		void insert(uint64_t key, unsigned int value)
+		{
+			for (size_t i = slot(key); ; i = (i + 1) & m_mask)
+			{
+				uint64_t expected = EMPTY;
+				if ( m_keys[i].compare_exchange_strong(expected, key, std::memory_order_relaxed) )
+				{
+					m_values[i] = value;
+					return;
+				}
+			}
+		}
+
+		//! key must have been inserted before, by a finished parallel pass
+		unsigned int find(uint64_t key) const
+		{
+			size_t i = slot(key);
+			while ( m_keys[i].load(std::memory_order_relaxed) != key )
+			{
+				i = (i + 1) & m_mask;
+			}
+			return m_values[i];
+		}
+
+	private:
+		size_t slot(uint64_t key) const
+		{
+			return (size_t) ( (key * 0x9E3779B97F4A7C15ull) >> (64 - m_bits) ); // Fibonacci hashing
+		}
+
+		std::vector< std::atomic<uint64_t> > m_keys;
+		std::vector<unsigned int> m_values;
+		int m_bits;
+		size_t m_mask;
+	};
+
+	/**
+	 * @brief a range of slices, processed by one task per pass
+	 */
+	struct Slab
+	{
+		int zBegin;
+		int zEnd;
+		std::vector<uint64_t> edges;   //!< edge id of every vertex
+		std::vector<float> positions;
+		std::vector<float> normals;
+		std::vector<unsigned int> indices;
+		unsigned int vertexOffset;
+		unsigned int indexOffset;
+	};
+
+	inline float valueAt(const VolumeData<short>& volume, int x, int y, int z)
+	{
+		x = std::max( 0, std::min(x, (int) volume.size_x - 1) );
+		y = std::max( 0, std::min(y, (int) volume.size_y - 1) );
+		z = std::max( 0, std::min(z, (int) volume.size_z - 1) );
+		return (float) volume.data[ ( (size_t) z * volume.size_y + y ) * volume.size_x + x ];
+	}
+
+	inline uint64_t load8(const unsigned char* bytes)
+	{
+		uint64_t word;
+		std::memcpy(&word, bytes, sizeof(word));
+		return word;
+	}
+
+	//! central difference gradient of a voxel, border clamped
+	inline glm::vec3 gradientAt(const VolumeData<short>& volume, int x, int y, int z)
+	{
+		return 0.5f * glm::vec3(
+			valueAt(volume, x + 1, y, z) - valueAt(volume, x - 1, y, z),
+			valueAt(volume, x, y + 1, z) - valueAt(volume, x, y - 1, z),
+			valueAt(volume, x, y, z + 1) - valueAt(volume, x, y, z - 1) );
+	}
+}
+
+bool MarchingCubes::extract(const VolumeData<short>& volume, float isoValue, const glm::vec3& proxySize, const Allocator& allocate, IsoSurfaceStats* stats)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+	const CaseTable& table = getCaseTable();
+
+	const int nx = (int) volume.size_x;
+	const int ny = (int) volume.size_y;
+	const int nz = (int) volume.size_z;
+	const glm::vec3 size( (float) nx, (float) ny, (float) nz );
+	const glm::vec3 voxelToProxy = 2.0f * proxySize / size;
+	const glm::vec3 gradientToProxy = size / (2.0f * proxySize); // d value / d proxy = d value / d voxel * d voxel / d proxy
+	const int threshold = (int) std::ceil(isoValue); // value >= isoValue <=> value >= threshold, for integer values
+
+	auto edgeId = [&](int x, int y, int z, int axis)
+	{
+		return ( ( (uint64_t) z * ny + y ) * nx + x ) * 3 + axis;
+	};
+
+	int numSlabs = std::max( 1, std::min( nz, (int) THREADPOOL->getNumThreads() * 4 ) );
+	std::vector<Slab> slabs(numSlabs);
+	for (int i = 0; i < numSlabs; i++)
+	{
+		slabs[i].zBegin = (int) ( (int64_t) nz * i / numSlabs );
+		slabs[i].zEnd   = (int) ( (int64_t) nz * (i + 1) / numSlabs );
+	}
+
+	// first pass: one vertex per cut edge, owned by the slab of the edge's start voxel
+	if ( nx > 1 && ny > 1 && nz > 1 )
+	{
+		THREADPOOL->parallelFor(0, numSlabs, [&](int slabBegin, int slabEnd)
+		{
+			std::vector<unsigned char> cuts(nx + 8, 0); // bit axis: the edge along axis is cut; padded for skipping 8 at once
+			for (int s = slabBegin; s < slabEnd; s++)
+			{
+				Slab& slab = slabs[s];
+				for (int z = slab.zBegin; z < slab.zEnd; z++)
+				{
+					for (int y = 0; y < ny; y++)
+					{
+						// neighbour rows beyond the border are replaced by the row itself, which yields no cuts
+						const short* row  = &volume.data[ ( (size_t) z * ny + y ) * nx ];
+						const short* rowY = (y + 1 < ny) ? row + nx : row;
+						const short* rowZ = (z + 1 < nz) ? row + (size_t) nx * ny : row;
+						const short* neighbours[3] = { row + 1, rowY, rowZ };
+
+						for (int x = 0; x < nx - 1; x++)
+						{
+							int in0 = row[x] >= threshold;
+							cuts[x] = (unsigned char) ( ( in0 ^ (row[x + 1] >= threshold) ) | ( ( in0 ^ (rowY[x] >= threshold) ) << 1 ) | ( ( in0 ^ (rowZ[x] >= threshold) ) << 2 ) );
+						}
+						int in0 = row[nx - 1] >= threshold;
+						cuts[nx - 1] = (unsigned char) ( ( ( in0 ^ (rowY[nx - 1] >= threshold) ) << 1 ) | ( ( in0 ^ (rowZ[nx - 1] >= threshold) ) << 2 ) );
+
+						for (int x = 0; x < nx; x++)
+						{
+							if ( load8(&cuts[x]) == 0 ) { x += 7; continue; }
+							for (int axis = 0; axis < 3; axis++)
+							{
+								if ( !( (cuts[x] >> axis) & 1 ) ) { continue; }
+
+								glm::ivec3 p0(x, y, z);
+								glm::ivec3 p1 = p0;
+								p1[axis]++;
+								float v0 = (float) row[x];
+								float t = (isoValue - v0) / ( (float) neighbours[axis][x] - v0 );
+
+								glm::vec3 position = glm::vec3(p0);
+								position[axis] += t;
+								position = (position + 0.5f) * voxelToProxy - proxySize;
+
+								glm::vec3 gradient = glm::mix( gradientAt(volume, p0.x, p0.y, p0.z), gradientAt(volume, p1.x, p1.y, p1.z), t ) * gradientToProxy;
+								glm::vec3 normal(0.0f);
+								if ( glm::dot(gradient, gradient) > 0.0f ) { normal = -glm::normalize(gradient); }
+								else { normal[axis] = (row[x] >= threshold) ? 1.0f : -1.0f; }
+
+								slab.edges.push_back( edgeId(x, y, z, axis) );
+								slab.positions.insert( slab.positions.end(), &position[0], &position[0] + 3 );
+								slab.normals.insert( slab.normals.end(), &normal[0], &normal[0] + 3 );
+							}
+						}
+					}
+				}
+			}
+		});
+	}
+
+	unsigned int numVertices = 0;
+	for (int s = 0; s < numSlabs; s++)
+	{
+		slabs[s].vertexOffset = numVertices;
+		numVertices += (unsigned int) slabs[s].edges.size();
+	}
+
+	// second pass: publish the global vertex index of every edge
+	EdgeHashMap edgeToVertex(numVertices);
+	THREADPOOL->parallelFor(0, numSlabs, [&](int slabBegin, int slabEnd)
+	{
+		for (int s = slabBegin; s < slabEnd; s++)
+		{
+			for (unsigned int i = 0; i < slabs[s].edges.size(); i++)
+			{
+				edgeToVertex.insert( slabs[s].edges[i], slabs[s].vertexOffset + i );
+			}
+		}
+	});
+
+	// third pass: triangles of all cubes whose lower slice lies in the slab
+	static const unsigned char spread[16] = { 0x00, 0x01, 0x04, 0x05, 0x10, 0x11, 0x14, 0x15, 0x40, 0x41, 0x44, 0x45, 0x50, 0x51, 0x54, 0x55 };
+	if ( numVertices > 0 )
+	{
+		THREADPOOL->parallelFor(0, numSlabs, [&](int slabBegin, int slabEnd)
+		{
+			std::vector<unsigned char> columns(nx);
+			const uint64_t allInside = 0x0F0F0F0F0F0F0F0Full; // 8 columns
+			for (int s = slabBegin; s < slabEnd; s++)
+			{
+				Slab& slab = slabs[s];
+				for (int z = slab.zBegin; z < std::min(slab.zEnd, nz - 1); z++)
+				{
+					for (int y = 0; y < ny - 1; y++)
+					{
+						// inside flags of the 4 voxel rows around the cube row, bit (dy + 2 * dz)
+						const short* row = &volume.data[ ( (size_t) z * ny + y ) * nx ];
+						const short* rows[4] = { row, row + nx, row + (size_t) nx * ny, row + (size_t) nx * ny + nx };
+						for (int x = 0; x < nx; x++)
+						{
+							columns[x] = (unsigned char) (
+								  ( rows[0][x] >= threshold ? 1 : 0 )
+								| ( rows[1][x] >= threshold ? 2 : 0 )
+								| ( rows[2][x] >= threshold ? 4 : 0 )
+								| ( rows[3][x] >= threshold ? 8 : 0 ) );
+						}
+
+						for (int x = 0; x < nx - 1; x++)
+						{
+							if ( x + 8 < nx )
+							{
+								// skip 8 cubes at once if they are all outside or all inside
+								uint64_t w = load8(&columns[x]);
+								if ( (w == 0 || w == allInside) && w == load8(&columns[x + 1]) ) { x += 7; continue; }
+							}
+
+							int config = spread[ columns[x] ] | ( spread[ columns[x + 1] ] << 1 );
+							if ( config == 0 || config == 255 ) { continue; }
+
+							unsigned int vertexOfEdge[12];
+							std::fill(vertexOfEdge, vertexOfEdge + 12, UINT32_MAX);
+							const unsigned char* edges = table.triangles[config];
+							for (int i = 0; i < 3 * table.numTriangles[config]; i++)
+							{
+								int e = edges[i];
+								if ( vertexOfEdge[e] == UINT32_MAX )
+								{
+									int c = table.edgeStart[e];
+									vertexOfEdge[e] = edgeToVertex.find( edgeId( x + (c & 1), y + ((c >> 1) & 1), z + ((c >> 2) & 1), e / 4 ) );
+								}
+								slab.indices.push_back( vertexOfEdge[e] );
+							}
+						}
+					}
+				}
+			}
+		});
+	}
+
+	unsigned int numIndices = 0;
+	for (int s = 0; s < numSlabs; s++)
+	{
+		slabs[s].indexOffset = numIndices;
+		numIndices += (unsigned int) slabs[s].indices.size();
+	}
+
+	// fourth pass: write the mesh straight into the destination
+	IsoSurfaceBuffers buffers = allocate(numVertices, numIndices);
+	bool written = ( numVertices == 0 && numIndices == 0 ) || ( buffers.positions && buffers.normals && buffers.indices );
+	if ( written && numVertices > 0 )
+	{
+		THREADPOOL->parallelFor(0, numSlabs, [&](int slabBegin, int slabEnd)
+		{
+			for (int s = slabBegin; s < slabEnd; s++)
+			{
+				const Slab& slab = slabs[s];
+				if ( !slab.positions.empty() )
+				{
+					std::memcpy( buffers.positions + 3 * (size_t) slab.vertexOffset, &slab.positions[0], slab.positions.size() * sizeof(float) );
+					std::memcpy( buffers.normals   + 3 * (size_t) slab.vertexOffset, &slab.normals[0],   slab.normals.size()   * sizeof(float) );
+				}
+				if ( !slab.indices.empty() )
+				{
+					std::memcpy( buffers.indices + slab.indexOffset, &slab.indices[0], slab.indices.size() * sizeof(unsigned int) );
+				}
+			}
+		});
+	}
+
+	double milliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - startTime ).count();
+	if ( stats )
+	{
+		stats->numVertices  = written ? numVertices : 0;
+		stats->numTriangles = written ? numIndices / 3 : 0;
+		stats->milliseconds = milliseconds;
+	}
+	if ( !written )
+	{
+		DEBUGLOG->log("MarchingCubes: could not obtain the destination buffers");
+	}
+	return written;
+}
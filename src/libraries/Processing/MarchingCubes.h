@@ -0,0 +1,60 @@
+#ifndef MARCHINGCUBES_H
+#define MARCHINGCUBES_H
+
+#include "CPURendering.h"
+
+#include <functional>
+
+/**
+ * @brief destination of an extracted surface, 3 floats per position and normal, 3 indices per triangle
+ */
+struct IsoSurfaceBuffers
+{
+	float* positions;      //!< numVertices * 3
+	float* normals;        //!< numVertices * 3
+	unsigned int* indices; //!< numIndices
+};
+
+/**
+ * @brief size and timing of an extracted surface
+ */
+struct IsoSurfaceStats
+{
+	unsigned int numVertices;
+	unsigned int numTriangles;
+	double milliseconds; //!< wall clock time of the extraction, including the writes to the destination
+};
+
+namespace MarchingCubes {
+	/**
+	 * @brief called once the size of the surface is known; returns where to write it
+	 *
+	 * Invoked on the calling thread of extract(), so it may e.g. map GL buffers.
+	 * Returning a null pointer aborts the extraction.
+	 */
+	typedef std::function<IsoSurfaceBuffers(unsigned int numVertices, unsigned int numIndices)> Allocator;
+
+	/**
+	 * @brief extract the iso surface of a volume as an indexed triangle mesh, parallel over slabs of slices
+	 *
+	 * A voxel is inside if its value is >= isoValue. Every cut voxel edge yields exactly one vertex,
+	 * shared by all adjacent triangles through a lock-free hash map from edge to vertex index,
+	 * so the mesh of a closed surface is watertight. Ambiguous cube faces are resolved by separating
+	 * the inside corners, consistently for both cubes sharing the face.
+	 * Triangles are front facing (counter clockwise) when seen from outside, normals are the normalized
+	 * negative gradients, i.e. they point outwards as well.
+	 *
+	 * Positions are in proxy space: voxel (x, y, z) lies at ((x + 0.5) / size_x * 2 - 1) * proxySize.x, etc.,
+	 * matching a Volume(proxySize) proxy geometry.
+	 *
+	 * @param volume to extract the surface from
+	 * @param isoValue threshold
+	 * @param proxySize half extent of the volume in proxy space
+	 * @param allocate provides the destination of the mesh
+	 * @param stats filled if not null
+	 * @return whether the mesh was written
+	 */
+	bool extract(const VolumeData<short>& volume, float isoValue, const glm::vec3& proxySize, const Allocator& allocate, IsoSurfaceStats* stats = 0);
+} // namespace MarchingCubes
+
+#endif
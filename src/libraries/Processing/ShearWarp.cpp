@@ -0,0 +1,316 @@
+#include "ShearWarp.h"
+
+#include <Core/ThreadPool.h>
+#include <Core/DebugLog.h>
+
+#include <chrono>
+#include <climits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+	/**
+	 * @brief dst[i] = max(dst[i], src[i]) for a contiguous row
+	 */
+	inline void maxRow(short* dst, const short* src, int n)
+	{
+		int i = 0;
+	#ifdef __SSE2__
+		for (; i + 8 <= n; i += 8)
+		{
+			__m128i a = _mm_loadu_si128( (const __m128i*) (dst + i) );
+			__m128i b = _mm_loadu_si128( (const __m128i*) (src + i) );
+			_mm_storeu_si128( (__m128i*) (dst + i), _mm_max_epi16(a, b) );
+		}
+	#endif
+		for (; i < n; i++)
+		{
+			dst[i] = std::max(dst[i], src[i]);
+		}
+	}
+
+	/**
+	 * @brief interpolate two slice rows with constant 8 bit fixed point weights
+	 *
+	 * @param r0 slice row j
+	 * @param r1 slice row j + 1, may be r0 if wJ == 0
+	 * @param wI weight of voxel i + 1, [0,256]
+	 * @param wJ weight of row j + 1, [0,256]
+	 * @param n amount of output values; reads n + 1 values per row if wI > 0
+	 */
+	inline void interpolateRow(const short* r0, const short* r1, int wI, int wJ, short* dst, int n)
+	{
+		if (wI == 0 && wJ == 0)
+		{
+			std::copy(r0, r0 + n, dst);
+			return;
+		}
+		if (wI == 0)
+		{
+			for (int i = 0; i < n; i++)
+			{
+				dst[i] = (short) ( ( (256 - wJ) * r0[i] + wJ * r1[i] ) >> 8 );
+			}
+			return;
+		}
+		for (int i = 0; i < n; i++)
+		{
+			int h0 = (256 - wI) * r0[i] + wI * r0[i + 1];
+			int h1 = (256 - wI) * r1[i] + wI * r1[i + 1];
+			dst[i] = (short) ( ( (256 - wJ) * h0 + wJ * h1 ) >> 16 );
+		}
+	}
+}
+
+ShearWarp::ShearWarp(Interpolation interpolation)
+{
+	m_interpolation = interpolation;
+	m_stats.milliseconds = 0.0;
+	m_stats.samples = 0.0;
+	m_intermediateWidth = 0;
+	m_intermediateHeight = 0;
+	p_transposedSource = nullptr;
+}
+
+ShearWarp::~ShearWarp()
+{
+}
+
+void ShearWarp::createTransposedX(const VolumeData<short>& volume)
+{
+	size_t sx = volume.size_x;
+	size_t sy = volume.size_y;
+	size_t sz = volume.size_z;
+
+	DEBUGLOG->log("ShearWarp: creating transposed volume copy for x-axis slicing");
+
+	m_transposedX.resize( sx * sy * sz );
+	THREADPOOL->parallelFor(0, (int) sz, [&](int zBegin, int zEnd)
+	{
+		for (size_t z = zBegin; z < (size_t) zEnd; z++)
+		{
+			for (size_t y = 0; y < sy; y++)
+			{
+				const short* src = &volume.data[ (z * sy + y) * sx ];
+				for (size_t x = 0; x < sx; x++)
+				{
+					m_transposedX[ (x * sz + z) * sy + y ] = src[x];
+				}
+			}
+		}
+	});
+	p_transposedSource = &volume;
+}
+
+void ShearWarp::render(const VolumeData<short>& volume, const glm::mat4& voxelToPixel, MIPImage& image)
+{
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+
+	// viewing direction in voxel space: the direction along which pixel coordinates stay constant
+	glm::vec3 viewDir = glm::inverse( glm::mat3(voxelToPixel) ) * glm::vec3(0.0f, 0.0f, 1.0f);
+
+	// principal axis k and the two slice axes (i,j), i always being contiguous in memory
+	int axisK = 2;
+	if ( std::abs(viewDir.x) >= std::abs(viewDir.y) && std::abs(viewDir.x) >= std::abs(viewDir.z) ) { axisK = 0; }
+	else if ( std::abs(viewDir.y) >= std::abs(viewDir.z) ) { axisK = 1; }
+
+	size_t sx = volume.size_x;
+	size_t sy = volume.size_y;
+	size_t sz = volume.size_z;
+
+	int axisI, axisJ;
+	const short* base;
+	size_t strideJ, strideK;
+	switch (axisK)
+	{
+	case 0:
+		if ( p_transposedSource != &volume || m_transposedX.size() != sx * sy * sz )
+		{
+			createTransposedX(volume);
+		}
+		axisI = 1; axisJ = 2;
+		base = &m_transposedX[0];
+		strideJ = sy;
+		strideK = sy * sz;
+		break;
+	case 1:
+		axisI = 0; axisJ = 2;
+		base = &volume.data[0];
+		strideJ = sx * sy;
+		strideK = sx;
+		break;
+	default:
+		axisI = 0; axisJ = 1;
+		base = &volume.data[0];
+		strideJ = sx;
+		strideK = sx * sy;
+		break;
+	}
+
+	glm::ivec3 volumeSize(volume.size_x, volume.size_y, volume.size_z);
+	int ni = volumeSize[axisI];
+	int nj = volumeSize[axisJ];
+	int nk = volumeSize[axisK];
+
+	// shear: slice k is shifted by k * (shearI, shearJ) to be aligned with slice 0
+	float shearI = -viewDir[axisI] / viewDir[axisK];
+	float shearJ = -viewDir[axisJ] / viewDir[axisK];
+	float minU = std::min(0.0f, shearI * (float) (nk - 1));
+	float minV = std::min(0.0f, shearJ * (float) (nk - 1));
+
+	m_intermediateWidth  = ni + (int) std::ceil( std::abs(shearI) * (float) (nk - 1) ) + 1;
+	m_intermediateHeight = nj + (int) std::ceil( std::abs(shearJ) * (float) (nk - 1) ) + 1;
+	m_intermediate.assign( (size_t) m_intermediateWidth * m_intermediateHeight, SHRT_MIN );
+
+	int width = m_intermediateWidth;
+	bool bilinear = (m_interpolation == BILINEAR);
+
+	// 1) shear and composite, bands of intermediate rows are independent
+	THREADPOOL->parallelFor(0, m_intermediateHeight, [&](int vBegin, int vEnd)
+	{
+		std::vector<short> row(ni);
+
+		for (int k = 0; k < nk; k++)
+		{
+			float offU = shearI * (float) k - minU;
+			float offV = shearJ * (float) k - minV;
+
+			int u0, v0, wI, wJ;
+			if (bilinear)
+			{
+				// the first intermediate pixel covered by the slice lies at slice coordinate u0 - offU
+				u0 = (int) std::ceil(offU);
+				v0 = (int) std::ceil(offV);
+				wI = (int) ( ( (float) u0 - offU ) * 256.0f + 0.5f );
+				wJ = (int) ( ( (float) v0 - offV ) * 256.0f + 0.5f );
+			}
+			else
+			{
+				u0 = (int) (offU + 0.5f);
+				v0 = (int) (offV + 0.5f);
+				wI = 0;
+				wJ = 0;
+			}
+			int numI = (wI > 0) ? ni - 1 : ni;
+			int numJ = (wJ > 0) ? nj - 1 : nj;
+
+			int jBegin = std::max(0, vBegin - v0);
+			int jEnd = std::min(numJ, vEnd - v0);
+
+			const short* slice = base + (size_t) k * strideK;
+			for (int j = jBegin; j < jEnd; j++)
+			{
+				short* dst = &m_intermediate[ (size_t) (j + v0) * width + u0 ];
+				const short* r0 = slice + (size_t) j * strideJ;
+
+				if (wI == 0 && wJ == 0)
+				{
+					maxRow(dst, r0, numI);
+				}
+				else
+				{
+					const short* r1 = (wJ > 0) ? r0 + strideJ : r0;
+					interpolateRow(r0, r1, wI, wJ, &row[0], numI);
+					maxRow(dst, &row[0], numI);
+				}
+			}
+		}
+	}, 8);
+
+	// 2) warp: intermediate (u,v) lies on slice 0 at (u + minU, v + minV) in sheared coordinates
+	glm::vec3 cornerVoxel(0.0f);
+	cornerVoxel[axisI] = minU;
+	cornerVoxel[axisJ] = minV;
+	glm::vec4 corner = voxelToPixel * glm::vec4(cornerVoxel, 1.0f);
+	glm::vec2 axisU( voxelToPixel[axisI][0], voxelToPixel[axisI][1] );
+	glm::vec2 axisV( voxelToPixel[axisJ][0], voxelToPixel[axisJ][1] );
+
+	float det = axisU.x * axisV.y - axisV.x * axisU.y;
+	if ( std::abs(det) < 1e-12f )
+	{
+		image.clear();
+		return;
+	}
+	// inverse of the 2x2 matrix (axisU, axisV)
+	glm::vec2 invRow0(  axisV.y / det, -axisV.x / det );
+	glm::vec2 invRow1( -axisU.y / det,  axisU.x / det );
+
+	int height = m_intermediateHeight;
+	THREADPOOL->parallelFor(0, image.height, [&](int rowBegin, int rowEnd)
+	{
+		for (int y = rowBegin; y < rowEnd; y++)
+		{
+			float* dstRow = &image.value[ (size_t) y * image.width ];
+			for (int x = 0; x < image.width; x++)
+			{
+				glm::vec2 p( (float) x + 0.5f - corner.x, (float) y + 0.5f - corner.y );
+				float u = glm::dot(invRow0, p);
+				float v = glm::dot(invRow1, p);
+
+				dstRow[x] = MIPImage::BACKGROUND;
+				if ( u <= -1.0f || v <= -1.0f || u >= (float) width || v >= (float) height )
+				{
+					continue;
+				}
+
+				int iu = (int) std::floor(u);
+				int iv = (int) std::floor(v);
+				float fu = u - (float) iu;
+				float fv = v - (float) iv;
+
+				// bilinear interpolation, ignoring taps which were not covered by any slice
+				float sum = 0.0f;
+				float weightSum = 0.0f;
+				for (int t = 0; t < 4; t++)
+				{
+					int tu = iu + (t & 1);
+					int tv = iv + (t >> 1);
+					if ( tu < 0 || tv < 0 || tu >= width || tv >= height )
+					{
+						continue;
+					}
+					short value = m_intermediate[ (size_t) tv * width + tu ];
+					if ( value == SHRT_MIN )
+					{
+						continue;
+					}
+					float weight = ( (t & 1) ? fu : 1.0f - fu ) * ( (t >> 1) ? fv : 1.0f - fv );
+					sum += weight * (float) value;
+					weightSum += weight;
+				}
+
+				if ( weightSum > 1e-6f )
+				{
+					dstRow[x] = sum / weightSum;
+				}
+			}
+		}
+	});
+
+	m_stats.samples = (double) ni * (double) nj * (double) nk;
+	m_stats.milliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - startTime ).count();
+}
+
+void ShearWarp::invalidate()
+{
+	m_transposedX.clear();
+	m_transposedX.shrink_to_fit();
+	p_transposedSource = nullptr;
+}
+
+void ShearWarp::setInterpolation(Interpolation interpolation)
+{
+	m_interpolation = interpolation;
+}
+
+ShearWarp::Interpolation ShearWarp::getInterpolation() const
+{
+	return m_interpolation;
+}
+
+const CPURenderStats& ShearWarp::getStats() const
+{
+	return m_stats;
+}
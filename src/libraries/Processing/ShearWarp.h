@@ -0,0 +1,60 @@
+#ifndef SHEARWARP_H
+#define SHEARWARP_H
+
+#include "CPURendering.h"
+
+/**
+ * @brief CPU maximum intensity projection based on the shear-warp factorization
+ *
+ * Only valid for orthographic projections. The view transformation is factorized into a
+ * shear along the principal viewing axis and a 2D warp:
+ * 1) every slice perpendicular to the principal axis is shifted by its shear offset and merged
+ *    into an intermediate image by a running maximum over contiguous rows (SSE2 where available)
+ * 2) the intermediate image is warped into the final image
+ *
+ * Slices along z and y are contiguous in VolumeData already, slices along x are read from a
+ * transposed copy of the volume which is created on first use.
+ */
+class ShearWarp
+{
+public:
+	enum Interpolation { NEAREST = 0, BILINEAR = 1 };
+
+protected:
+	Interpolation m_interpolation;
+	CPURenderStats m_stats;
+
+	std::vector<short> m_intermediate; //!< sheared maximum image
+	int m_intermediateWidth;
+	int m_intermediateHeight;
+
+	std::vector<short> m_transposedX;       //!< volume with x as slowest axis: (x * size_z + z) * size_y + y
+	const VolumeData<short>* p_transposedSource; //!< volume m_transposedX was created from
+
+	void createTransposedX(const VolumeData<short>& volume);
+
+public:
+	ShearWarp(Interpolation interpolation = BILINEAR);
+	virtual ~ShearWarp();
+
+	/**
+	 * @brief render a maximum intensity projection
+	 *
+	 * @param volume to be rendered
+	 * @param voxelToPixel orthographic transformation as computed by CPURendering::computeVoxelToPixel
+	 * @param image target image
+	 */
+	void render(const VolumeData<short>& volume, const glm::mat4& voxelToPixel, MIPImage& image);
+
+	/**
+	 * @brief release the transposed copy, must be called if the data of the volume has changed
+	 */
+	void invalidate();
+
+	void setInterpolation(Interpolation interpolation);
+	Interpolation getInterpolation() const;
+
+	const CPURenderStats& getStats() const; //!< timing of the last call to render
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include "SlabMIP.h"
+
+#include <Core/ThreadPool.h>
+
+#include <chrono>
+
+namespace {
+	// strides of image x, image y and slab axis in the volume data for an orientation
+	void getStrides(const VolumeData<short>& volume, MPR::Orientation orientation, size_t& strideU, size_t& strideV, size_t& strideK, int& width, int& height, int& numSlices)
+	{
+		size_t sx = volume.size_x;
+		size_t sxy = (size_t) volume.size_x * volume.size_y;
+		switch (orientation)
+		{
+		case MPR::CORONAL:
+			strideU = 1;  strideV = sxy; strideK = sx;
+			width = volume.size_x; height = volume.size_z; numSlices = volume.size_y;
+			break;
+		case MPR::SAGITTAL:
+			strideU = sx; strideV = sxy; strideK = 1;
+			width = volume.size_y; height = volume.size_z; numSlices = volume.size_x;
+			break;
+		default: // AXIAL
+			strideU = 1;  strideV = sx;  strideK = sxy;
+			width = volume.size_x; height = volume.size_y; numSlices = volume.size_z;
+			break;
+		}
+	}
+}
+
+SlabMIP::SlabMIP()
+{
+	p_volume = nullptr;
+	m_orientation = MPR::AXIAL;
+	m_thickness = 0;
+	m_firstSlice = 0;
+	m_direction = 1;
+	m_width = 0;
+	m_height = 0;
+	m_stats.milliseconds = 0.0;
+	m_stats.samples = 0.0;
+	m_numRebuilds = 0;
+	m_numIncrementalSteps = 0;
+}
+
+SlabMIP::~SlabMIP()
+{
+}
+
+void SlabMIP::pushSlice(const VolumeData<short>& volume, int slice, int firstSlice, int rowBegin, int rowEnd)
+{
+	size_t strideU, strideV, strideK;
+	int width, height, numSlices;
+	getStrides(volume, m_orientation, strideU, strideV, strideK, width, height, numSlices);
+
+	int thickness = m_thickness;
+	int lastSlice = firstSlice + thickness - 1;
+
+	for (int y = rowBegin; y < rowEnd; y++)
+	{
+		const short* src = &volume.data[ (size_t) y * strideV + (size_t) slice * strideK ];
+		for (int x = 0; x < width; x++)
+		{
+			size_t pixel = (size_t) y * width + x;
+			size_t ring = pixel * thickness;
+			short value = src[ (size_t) x * strideU ];
+
+			int head = m_dequeHead[pixel];
+			int count = m_dequeCount[pixel];
+
+			// expire front entry which left the slab; entries arrive in slab direction, so only the front can expire
+			while ( count > 0 && ( (int) m_dequeSlices[ring + head] < firstSlice || (int) m_dequeSlices[ring + head] > lastSlice ) )
+			{
+				head = (head + 1 == thickness) ? 0 : head + 1;
+				count--;
+			}
+
+			// drop entries which can never be the maximum again
+			while ( count > 0 )
+			{
+				int back = head + count - 1;
+				if (back >= thickness) { back -= thickness; }
+				if ( m_dequeValues[ring + back] > value ) { break; }
+				count--;
+			}
+
+			int position = head + count;
+			if (position >= thickness) { position -= thickness; }
+			m_dequeValues[ring + position] = value;
+			m_dequeSlices[ring + position] = (unsigned short) slice;
+			count++;
+
+			m_dequeHead[pixel] = (unsigned short) head;
+			m_dequeCount[pixel] = (unsigned short) count;
+		}
+	}
+}
+
+void SlabMIP::rebuild(const VolumeData<short>& volume, int firstSlice, int direction)
+{
+	std::fill(m_dequeHead.begin(), m_dequeHead.end(), 0);
+	std::fill(m_dequeCount.begin(), m_dequeCount.end(), 0);
+
+	// push in the order the slices would have arrived when moving in direction;
+	// all slices per band of rows, so the deques of a band stay in cache
+	THREADPOOL->parallelFor(0, m_height, [&](int rowBegin, int rowEnd)
+	{
+		for (int i = 0; i < m_thickness; i++)
+		{
+			int slice = (direction > 0) ? firstSlice + i : firstSlice + m_thickness - 1 - i;
+			pushSlice(volume, slice, firstSlice, rowBegin, rowEnd);
+		}
+	});
+
+	m_firstSlice = firstSlice;
+	m_direction = direction;
+	m_numRebuilds++;
+	m_stats.samples += (double) m_width * m_height * m_thickness;
+}
+
+void SlabMIP::step(const VolumeData<short>& volume, int direction)
+{
+	int firstSlice = m_firstSlice + direction;
+	int incomingSlice = (direction > 0) ? firstSlice + m_thickness - 1 : firstSlice;
+	THREADPOOL->parallelFor(0, m_height, [&](int rowBegin, int rowEnd)
+	{
+		pushSlice(volume, incomingSlice, firstSlice, rowBegin, rowEnd);
+	});
+
+	m_firstSlice = firstSlice;
+	m_numIncrementalSteps++;
+	m_stats.samples += (double) m_width * m_height;
+}
+
+void SlabMIP::render(const VolumeData<short>& volume, MPR::Orientation orientation, int firstSlice, int thickness, MIPImage& image)
+{
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+	m_stats.samples = 0.0;
+
+	size_t strideU, strideV, strideK;
+	int width, height, numSlices;
+	getStrides(volume, orientation, strideU, strideV, strideK, width, height, numSlices);
+
+	thickness = std::max(1, std::min(thickness, std::min(numSlices, 65535)));
+	firstSlice = std::max(0, std::min(firstSlice, numSlices - thickness));
+
+	bool isValid = (p_volume == &volume && m_orientation == orientation && m_thickness == thickness && m_width == width && m_height == height);
+	if ( !isValid )
+	{
+		p_volume = &volume;
+		m_orientation = orientation;
+		m_thickness = thickness;
+		m_width = width;
+		m_height = height;
+
+		size_t numPixels = (size_t) width * height;
+		m_dequeValues.resize(numPixels * thickness);
+		m_dequeSlices.resize(numPixels * thickness);
+		m_dequeHead.resize(numPixels);
+		m_dequeCount.resize(numPixels);
+
+		rebuild(volume, firstSlice, 1);
+	}
+	else if (firstSlice != m_firstSlice)
+	{
+		int delta = firstSlice - m_firstSlice;
+		int direction = (delta > 0) ? 1 : -1;
+
+		if ( std::abs(delta) >= thickness || direction != m_direction )
+		{
+			rebuild(volume, firstSlice, direction);
+		}
+		else
+		{
+			for (int i = 0; i < std::abs(delta); i++)
+			{
+				step(volume, direction);
+			}
+		}
+	}
+
+	// the front of every deque holds the slab maximum
+	if (image.width != width || image.height != height)
+	{
+		image.resize(width, height);
+	}
+	THREADPOOL->parallelFor(0, height, [&](int rowBegin, int rowEnd)
+	{
+		for (size_t pixel = (size_t) rowBegin * width; pixel < (size_t) rowEnd * width; pixel++)
+		{
+			image.value[pixel] = (float) m_dequeValues[ pixel * m_thickness + m_dequeHead[pixel] ];
+		}
+	});
+
+	m_stats.milliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - startTime ).count();
+}
+
+void SlabMIP::invalidate()
+{
+	p_volume = nullptr;
+}
+
+int SlabMIP::getNumRebuilds() const
+{
+	return m_numRebuilds;
+}
+
+int SlabMIP::getNumIncrementalSteps() const
+{
+	return m_numIncrementalSteps;
+}
+
+const CPURenderStats& SlabMIP::getStats() const
+{
+	return m_stats;
+}
@@ -0,0 +1,70 @@
+#ifndef SLABMIP_H
+#define SLABMIP_H
+
+#include "MPR.h"
+
+/**
+ * @brief thin-slab maximum intensity projection along a volume axis with incremental updates
+ *
+ * Every pixel keeps a monotonic deque of the slices inside the slab: values decrease from front to back,
+ * so the front holds the slab maximum. Moving the slab by one slice pushes the incoming slice at the back
+ * (dropping all smaller values) and pops the front if it left the slab, which is amortized O(1) per pixel
+ * instead of O(thickness).
+ *
+ * The deque only supports moving in one direction; reversing the direction, changing the slab
+ * thickness or jumping by at least the thickness rebuilds the deques in O(thickness).
+ * Image axes are the same as MPR::createPlane: axial (x,y), coronal (x,z), sagittal (y,z).
+ */
+class SlabMIP
+{
+protected:
+	// per pixel ring buffers of capacity m_thickness
+	std::vector<short> m_dequeValues;            //!< values of the deque entries
+	std::vector<unsigned short> m_dequeSlices;   //!< slice indices of the deque entries
+	std::vector<unsigned short> m_dequeHead;     //!< ring buffer position of the front entry
+	std::vector<unsigned short> m_dequeCount;    //!< amount of entries
+
+	const VolumeData<short>* p_volume; //!< volume the deques were built from
+	MPR::Orientation m_orientation;
+	int m_thickness;  //!< slab thickness in slices
+	int m_firstSlice; //!< first slice of the current slab
+	int m_direction;  //!< direction of the last move: +1, -1 or 0 after a rebuild
+	int m_width;
+	int m_height;
+
+	CPURenderStats m_stats;
+	int m_numRebuilds;       //!< statistics: full rebuilds since creation
+	int m_numIncrementalSteps; //!< statistics: incremental single slice steps since creation
+
+	void rebuild(const VolumeData<short>& volume, int firstSlice, int direction);
+	void step(const VolumeData<short>& volume, int direction);
+
+	/**
+	 * @brief push slice into the deques of rows [rowBegin, rowEnd) and expire entries outside [firstSlice, firstSlice + thickness)
+	 */
+	void pushSlice(const VolumeData<short>& volume, int slice, int firstSlice, int rowBegin, int rowEnd);
+
+public:
+	SlabMIP();
+	virtual ~SlabMIP();
+
+	/**
+	 * @brief compute the MIP of the slab [firstSlice, firstSlice + thickness), reusing the previous slab if possible
+	 *
+	 * @param volume to be projected; must not change between calls unless invalidate() is called
+	 * @param orientation AXIAL, CORONAL or SAGITTAL, the slab is moved along the normal axis
+	 * @param firstSlice first slice of the slab, clamped so the slab lies inside the volume
+	 * @param thickness of the slab in slices
+	 * @param image target image
+	 */
+	void render(const VolumeData<short>& volume, MPR::Orientation orientation, int firstSlice, int thickness, MIPImage& image);
+
+	void invalidate(); //!< force a rebuild on the next call of render
+
+	int getNumRebuilds() const;
+	int getNumIncrementalSteps() const;
+
+	const CPURenderStats& getStats() const; //!< timing of the last call to render
+};
+
+#endif
@@ -0,0 +1,62 @@
+#include "VolumeFusion.h"
+
+#include <Core/ThreadPool.h>
+#include <Core/DebugLog.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+glm::mat4 VolumeFusion::computeRegistration(const glm::vec3& translation, const glm::vec3& rotationDegrees, const glm::vec3& scale)
+{
+	// placement of the registered volume in reference uvw space
+	glm::mat4 placement = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f) + translation);
+	placement = glm::rotate(placement, glm::radians(rotationDegrees.z), glm::vec3(0.0f, 0.0f, 1.0f));
+	placement = glm::rotate(placement, glm::radians(rotationDegrees.y), glm::vec3(0.0f, 1.0f, 0.0f));
+	placement = glm::rotate(placement, glm::radians(rotationDegrees.x), glm::vec3(1.0f, 0.0f, 0.0f));
+	placement = glm::scale(placement, scale);
+	placement = glm::translate(placement, glm::vec3(-0.5f));
+
+	return glm::inverse(placement);
+}
+
+void VolumeFusion::resample(const VolumeData<short>& source, const glm::mat4& registration, const VolumeData<short>& reference, VolumeData<short>& target)
+{
+	DEBUGLOG->log("VolumeFusion: resampling volume onto reference grid");
+
+	target.size_x = reference.size_x;
+	target.size_y = reference.size_y;
+	target.size_z = reference.size_z;
+	target.real_size_x = reference.real_size_x;
+	target.real_size_y = reference.real_size_y;
+	target.real_size_z = reference.real_size_z;
+	target.min = source.min;
+	target.max = source.max;
+	target.data.resize( (size_t) target.size_x * target.size_y * target.size_z );
+
+	// reference voxel index -> source voxel coordinates: voxel centers lie at uvw (i + 0.5) / size
+	glm::vec3 referenceSize( (float) reference.size_x, (float) reference.size_y, (float) reference.size_z );
+	glm::vec3 sourceSize( (float) source.size_x, (float) source.size_y, (float) source.size_z );
+	glm::mat4 voxelToUVW = glm::scale( glm::mat4(1.0f), glm::vec3(1.0f) / referenceSize ) * glm::translate( glm::mat4(1.0f), glm::vec3(0.5f) );
+	glm::mat4 uvwToSourceVoxel = glm::translate( glm::mat4(1.0f), glm::vec3(-0.5f) ) * glm::scale( glm::mat4(1.0f), sourceSize );
+	glm::mat4 referenceToSource = uvwToSourceVoxel * registration * voxelToUVW;
+
+	glm::vec3 stepX( referenceToSource[0] );
+	glm::ivec3 size( source.size_x, source.size_y, source.size_z );
+
+	THREADPOOL->parallelFor(0, (int) target.size_z, [&](int zBegin, int zEnd)
+	{
+		for (int z = zBegin; z < zEnd; z++)
+		{
+			for (unsigned int y = 0; y < target.size_y; y++)
+			{
+				short* row = &target.data[ ( (size_t) z * target.size_y + y ) * target.size_x ];
+				glm::vec3 p = glm::vec3( referenceToSource * glm::vec4(0.0f, (float) y, (float) z, 1.0f) );
+				for (unsigned int x = 0; x < target.size_x; x++, p += stepX)
+				{
+					bool inside = p.x >= -0.5f && p.y >= -0.5f && p.z >= -0.5f
+						&& p.x <= (float) size.x - 0.5f && p.y <= (float) size.y - 0.5f && p.z <= (float) size.z - 0.5f;
+					row[x] = inside ? (short) std::floor( CPURendering::sampleTrilinear(source, p.x, p.y, p.z) + 0.5f ) : source.min;
+				}
+			}
+		}
+	});
+}
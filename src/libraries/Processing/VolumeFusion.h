@@ -0,0 +1,39 @@
+#ifndef VOLUMEFUSION_H
+#define VOLUMEFUSION_H
+
+#include "CPURendering.h"
+
+/**
+ * @brief registration of a second volume onto a reference volume, e.g. MRT onto CT
+ *
+ * Registrations map uvw coordinates [0,1] of the reference (the fused display space) to uvw
+ * coordinates of the registered volume, so the ray caster can sample both volumes along one ray.
+ */
+namespace VolumeFusion {
+	/**
+	 * @brief compose a registration from a similarity transformation of the registered volume
+	 *
+	 * The registered volume is scaled and rotated about its center, then translated.
+	 *
+	 * @param translation in uvw units of the reference
+	 * @param rotationDegrees euler angles about x, y and z, applied in this order
+	 * @param scale of the registered volume relative to the reference
+	 * @return matrix mapping reference uvw to registered uvw
+	 */
+	glm::mat4 computeRegistration(const glm::vec3& translation, const glm::vec3& rotationDegrees, const glm::vec3& scale);
+
+	/**
+	 * @brief resample a registered volume onto the voxel grid of the reference
+	 *
+	 * Afterwards both volumes are co-registered voxel by voxel and can be packed into a single
+	 * multi-channel texture. Trilinear interpolation, parallel over slices.
+	 *
+	 * @param source volume to be resampled
+	 * @param registration reference uvw to source uvw, see computeRegistration
+	 * @param reference volume defining the target grid
+	 * @param target resampled volume; voxels outside of source are set to source.min
+	 */
+	void resample(const VolumeData<short>& source, const glm::mat4& registration, const VolumeData<short>& reference, VolumeData<short>& target);
+} // namespace VolumeFusion
+
+#endif
@@ -0,0 +1,124 @@
+#include "AsyncReadback.h"
+
+AsyncReadback::AsyncReadback()
+	: m_buffer(0),
+	m_capacity(0),
+	m_bytes(0),
+	m_fence(0)
+{
+}
+
+AsyncReadback::AsyncReadback(AsyncReadback&& other) noexcept
+	: m_buffer(other.m_buffer),
+	m_capacity(other.m_capacity),
+	m_bytes(other.m_bytes),
+	m_fence(other.m_fence)
+{
+	other.m_buffer = 0;
+	other.m_capacity = 0;
+	other.m_fence = 0;
+}
+
+AsyncReadback::~AsyncReadback()
+{
+	if ( m_fence ) { glDeleteSync(m_fence); }
+	if ( m_buffer ) { glDeleteBuffers(1, &m_buffer); }
+}
+
+void AsyncReadback::prepare(size_t bytes)
+{
+	if ( m_fence )
+	{
+		glDeleteSync(m_fence); // superseded, the buffer is simply overwritten
+		m_fence = 0;
+	}
+	if ( !m_buffer ) { glGenBuffers(1, &m_buffer); }
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffer);
+	if ( bytes > m_capacity )
+	{
+		glBufferData(GL_PIXEL_PACK_BUFFER, bytes, 0, GL_STREAM_READ);
+		m_capacity = bytes;
+	}
+	m_bytes = bytes;
+}
+
+void AsyncReadback::readPixels(GLuint framebuffer, GLenum readBuffer, int x, int y, int width, int height, GLenum format, GLenum type, size_t bytes)
+{
+	prepare(bytes);
+
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glReadBuffer(readBuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(x, y, width, height, format, type, 0); // into the buffer: returns immediately
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, previousFramebuffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void AsyncReadback::copyBuffer(GLuint buffer, size_t offset, size_t bytes)
+{
+	prepare(bytes);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr) offset, 0, (GLsizeiptr) bytes);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool AsyncReadback::poll()
+{
+	if ( !m_fence ) { return false; }
+
+	// timeout 0: only query the state; the flush makes sure the fence is eventually reached
+	GLenum state = glClientWaitSync(m_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	if ( state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED )
+	{
+		return false;
+	}
+	glDeleteSync(m_fence);
+	m_fence = 0;
+	return true;
+}
+
+void AsyncReadback::wait()
+{
+	if ( m_fence )
+	{
+		glClientWaitSync(m_fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+	}
+}
+
+const void* AsyncReadback::map()
+{
+	if ( !m_buffer || m_bytes == 0 ) { return 0; }
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffer);
+	const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr) m_bytes, GL_MAP_READ_BIT);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	return data;
+}
+
+void AsyncReadback::unmap()
+{
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffer);
+	glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+bool AsyncReadback::isPending() const
+{
+	return m_fence != 0;
+}
+
+size_t AsyncReadback::getBytes() const
+{
+	return m_bytes;
+}
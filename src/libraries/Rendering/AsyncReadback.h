@@ -0,0 +1,67 @@
+#ifndef ASYNCREADBACK_H
+#define ASYNCREADBACK_H
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+/**
+ * @brief readback of GPU data into a pixel pack buffer without waiting for the GPU
+ *
+ * readPixels() and copyBuffer() issue the copy into the buffer, which returns immediately, and insert
+ * a fence. poll() only queries the fence; once it returned true, map() gives access to the data until
+ * unmap(). A new request supersedes a pending one. The buffer grows with the requests and is only
+ * created by the first one, so instances may be kept in containers.
+ */
+class AsyncReadback
+{
+protected:
+	GLuint m_buffer;
+	size_t m_capacity; //!< bytes of the buffer
+	size_t m_bytes;    //!< bytes of the last request
+	GLsync m_fence;    //!< non-zero while a request is pending
+
+	void prepare(size_t bytes); //!< drop a pending request, grow the buffer; leaves it bound as pixel pack buffer
+
+public:
+	AsyncReadback();
+	AsyncReadback(AsyncReadback&& other) noexcept;
+	~AsyncReadback();
+
+	/**
+	 * @brief read a region of a framebuffer attachment
+	 *
+	 * @param framebuffer to read from, 0 for the default framebuffer
+	 * @param readBuffer e.g. GL_COLOR_ATTACHMENT0, or GL_BACK for the default framebuffer
+	 * @param x of the region, origin in the lower left corner
+	 * @param y of the region, origin in the lower left corner
+	 * @param width of the region
+	 * @param height of the region
+	 * @param format e.g. GL_RGBA
+	 * @param type e.g. GL_UNSIGNED_BYTE
+	 * @param bytes of the region in format and type, rows packed with an alignment of 4
+	 */
+	void readPixels(GLuint framebuffer, GLenum readBuffer, int x, int y, int width, int height, GLenum format, GLenum type, size_t bytes);
+
+	/**
+	 * @brief copy a range of a buffer object, e.g. an atomic counter; writes by shaders must be made
+	 * visible with glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT) before
+	 */
+	void copyBuffer(GLuint buffer, size_t offset, size_t bytes);
+
+	/**
+	 * @brief query the pending request without waiting
+	 * @return true once, when the data of the pending request became available
+	 */
+	bool poll();
+
+	void wait(); //!< block until the pending request is complete; poll() returns true afterwards
+
+	const void* map(); //!< the data of the last completed request, 0 if it could not be mapped
+	void unmap();
+
+	bool isPending() const; //!< whether a request is in flight
+	size_t getBytes() const; //!< of the last request
+};
+
+#endif
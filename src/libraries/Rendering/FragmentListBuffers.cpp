@@ -0,0 +1,136 @@
+#include "FragmentListBuffers.h"
+
+#include <Core/DebugLog.h>
+
+#include <algorithm>
+#include <vector>
+
+const unsigned int FragmentListBuffers::END_OF_LIST;
+const unsigned int FragmentListBuffers::NODE_SIZE;
+
+FragmentListBuffers::FragmentListBuffers(int width, int height, int averageNodesPerPixel)
+{
+	m_width = width;
+	m_height = height;
+	m_numNodes = 0;
+	m_maxNodes = 0;
+	m_nodeBuffer = 0;
+
+	// head pointers
+	glGenTextures(1, &m_headPointerTexture);
+	glBindTexture(GL_TEXTURE_2D, m_headPointerTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, m_width, m_height, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	std::vector<GLuint> endOfList( (size_t) m_width * m_height, END_OF_LIST );
+	glGenBuffers(1, &m_headPointerClearBuffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_headPointerClearBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, endOfList.size() * sizeof(GLuint), &endOfList[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	// node allocation
+	glGenBuffers(1, &m_atomicCounterBuffer);
+	glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, m_atomicCounterBuffer);
+	glBufferData(GL_ATOMIC_COUNTER_BUFFER, sizeof(GLuint), 0, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+
+	allocateNodeBuffer( (unsigned int) (m_width * m_height * std::max(1, averageNodesPerPixel)) );
+}
+
+FragmentListBuffers::~FragmentListBuffers()
+{
+	glDeleteTextures(1, &m_headPointerTexture);
+	glDeleteBuffers(1, &m_headPointerClearBuffer);
+	glDeleteBuffers(1, &m_atomicCounterBuffer);
+	glDeleteBuffers(1, &m_nodeBuffer);
+}
+
+void FragmentListBuffers::allocateNodeBuffer(unsigned int maxNodes)
+{
+	DEBUGLOG->log("FragmentListBuffers: allocating nodes, amount: ", maxNodes);
+
+	if (m_nodeBuffer == 0)
+	{
+		glGenBuffers(1, &m_nodeBuffer);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_nodeBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) maxNodes * NODE_SIZE, 0, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	m_maxNodes = maxNodes;
+}
+
+void FragmentListBuffers::clear()
+{
+	// reset head pointers
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_headPointerClearBuffer);
+	glBindTexture(GL_TEXTURE_2D, m_headPointerTexture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, GL_RED_INTEGER, GL_UNSIGNED_INT, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	// reset node counter
+	GLuint zero = 0;
+	glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, m_atomicCounterBuffer);
+	glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &zero);
+	glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+
+	bind();
+}
+
+void FragmentListBuffers::bind()
+{
+	glBindImageTexture(0, m_headPointerTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+	glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, 0, m_atomicCounterBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_nodeBuffer);
+}
+
+void FragmentListBuffers::barrier()
+{
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_ATOMIC_COUNTER_BARRIER_BIT);
+}
+
+unsigned int FragmentListBuffers::updateNodeCount()
+{
+	if ( m_nodeCountReadback.poll() )
+	{
+		const GLuint* count = (const GLuint*) m_nodeCountReadback.map();
+		if ( count )
+		{
+			m_numNodes = *count;
+			m_nodeCountReadback.unmap();
+		}
+
+		if (m_numNodes > m_maxNodes)
+		{
+			DEBUGLOG->log("FragmentListBuffers: nodes dropped, amount: ", m_numNodes - m_maxNodes);
+			allocateNodeBuffer( m_numNodes + m_numNodes / 2 );
+			bind();
+		}
+	}
+
+	if ( !m_nodeCountReadback.isPending() )
+	{
+		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT); // atomic counter writes of the geometry pass
+		m_nodeCountReadback.copyBuffer(m_atomicCounterBuffer, 0, sizeof(GLuint));
+	}
+
+	return m_numNodes;
+}
+
+unsigned int FragmentListBuffers::getMaxNodes() const
+{
+	return m_maxNodes;
+}
+
+unsigned int FragmentListBuffers::getNumNodes() const
+{
+	return m_numNodes;
+}
+
+size_t FragmentListBuffers::getMemoryBytes() const
+{
+	return (size_t) m_width * m_height * sizeof(GLuint) + (size_t) m_maxNodes * NODE_SIZE;
+}
@@ -0,0 +1,77 @@
+#ifndef FRAGMENTLISTBUFFERS_H
+#define FRAGMENTLISTBUFFERS_H
+
+#include <GL/glew.h>
+#include <cstddef>
+
+#include <Rendering/AsyncReadback.h>
+
+/**
+ * @brief per-pixel linked lists of fragments for order independent transparency
+ *
+ * A single geometry pass appends every fragment to a node buffer (SSBO) and links it into the
+ * list of its pixel, whose head index is kept in an R32UI image; nodes are allocated by an atomic counter.
+ * A fullscreen resolve pass then sorts each list by depth and composites it, so the cost does not grow
+ * with the amount of layers like depth peeling does. See oitLinkedList.frag and oitCompositing.frag.
+ *
+ * Bindings used by the shaders: image unit 0 (head pointers), atomic counter binding 0, SSBO binding 0 (nodes).
+ */
+class FragmentListBuffers
+{
+protected:
+	int m_width;
+	int m_height;
+
+	GLuint m_headPointerTexture;    //!< R32UI, index of the first node per pixel, END_OF_LIST if empty
+	GLuint m_headPointerClearBuffer; //!< pixel unpack buffer filled with END_OF_LIST, to reset the head pointers
+	GLuint m_atomicCounterBuffer;   //!< amount of nodes appended in the current frame
+	GLuint m_nodeBuffer;            //!< shader storage buffer of the nodes
+
+	unsigned int m_maxNodes;      //!< capacity of m_nodeBuffer
+	unsigned int m_numNodes;      //!< nodes appended in a recent frame, see updateNodeCount()
+	AsyncReadback m_nodeCountReadback; //!< copy of the atomic counter
+
+	void allocateNodeBuffer(unsigned int maxNodes);
+
+public:
+	static const unsigned int END_OF_LIST = 0xFFFFFFFF;
+	static const unsigned int NODE_SIZE = 32; //!< bytes per node, must match FragmentNode in the shaders
+
+	/**
+	 * @param width of the render target
+	 * @param height of the render target
+	 * @param averageNodesPerPixel initial node capacity per pixel; the buffer grows if it overflows
+	 */
+	FragmentListBuffers(int width = 800, int height = 600, int averageNodesPerPixel = 4);
+	~FragmentListBuffers();
+
+	/**
+	 * @brief reset all lists and bind the buffers for the geometry pass
+	 */
+	void clear();
+
+	/**
+	 * @brief bind the buffers to their binding points, e.g. for the resolve pass
+	 */
+	void bind();
+
+	/**
+	 * @brief make the appended nodes visible to the resolve pass
+	 */
+	void barrier();
+
+	/**
+	 * @brief call after the geometry pass: start copying the node counter if no copy is in flight,
+	 * and take the count of a previous frame once its copy is complete, without waiting for the GPU.
+	 * Grows the node buffer if nodes were dropped, so the following frames will fit
+	 *
+	 * @return nodes appended in the most recently read frame, including dropped ones
+	 */
+	unsigned int updateNodeCount();
+
+	unsigned int getMaxNodes() const;
+	unsigned int getNumNodes() const; //!< result of the last updateNodeCount()
+	size_t getMemoryBytes() const;    //!< GPU memory of head pointers and nodes
+};
+
+#endif
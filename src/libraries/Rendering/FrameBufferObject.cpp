@@ -37,6 +37,12 @@ void FrameBufferObject::createDepthTexture()
 }
 
 GLuint FrameBufferObject::createFramebufferTexture()
+{
+	AttachmentFormat attachmentFormat = { s_internalFormat, s_format, s_type };
+	return createFramebufferTexture(attachmentFormat);
+}
+
+GLuint FrameBufferObject::createFramebufferTexture(const AttachmentFormat& attachmentFormat)
 {
 	GLuint textureHandle;
 	glGenTextures(1, &textureHandle);
@@ -45,11 +51,11 @@ GLuint FrameBufferObject::createFramebufferTexture()
 	if ( s_useTexStorage2D )
 	{
 		// for testing purposes
-		glTexStorage2D(GL_TEXTURE_2D, 1, s_internalFormat, m_width, m_height);	
+		glTexStorage2D(GL_TEXTURE_2D, 1, attachmentFormat.internalFormat, m_width, m_height);	
 	}
 	else
 	{
-		glTexImage2D(GL_TEXTURE_2D, 0, s_internalFormat, m_width, m_height, 0, s_format, s_type, 0);	
+		glTexImage2D(GL_TEXTURE_2D, 0, attachmentFormat.internalFormat, m_width, m_height, 0, attachmentFormat.format, attachmentFormat.type, 0);	
 	}
 	
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -62,6 +68,13 @@ GLuint FrameBufferObject::createFramebufferTexture()
 
 void FrameBufferObject::addColorAttachments(int amount)
 {
+	AttachmentFormat attachmentFormat = { s_internalFormat, s_format, s_type };
+	addColorAttachments( std::vector<AttachmentFormat>(amount, attachmentFormat) );
+}
+
+void FrameBufferObject::addColorAttachments(const std::vector<AttachmentFormat>& attachmentFormats)
+{
+	int amount = (int) attachmentFormats.size();
 	int maxColorAttachments;
 	glGetIntegerv(GL_MAX_COLOR_ATTACHMENTS, &maxColorAttachments);
 	if ( m_numColorAttachments + amount <=  maxColorAttachments)
@@ -73,7 +86,7 @@ void FrameBufferObject::addColorAttachments(int amount)
 		DEBUGLOG->indent();
 		for (int i = 0; i < amount; i ++)
 		{
-			GLuint textureHandle = createFramebufferTexture();
+			GLuint textureHandle = createFramebufferTexture(attachmentFormats[i]);
 			
 			glBindTexture(GL_TEXTURE_2D, textureHandle);
 			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + m_numColorAttachments + i, GL_TEXTURE_2D, textureHandle, 0);
@@ -90,6 +103,18 @@ void FrameBufferObject::addColorAttachments(int amount)
 	}
 }
 
+std::vector<FrameBufferObject::AttachmentFormat> FrameBufferObject::getCompactGBufferFormats()
+{
+	std::vector<AttachmentFormat> attachmentFormats;
+	AttachmentFormat color  = { GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE };
+	AttachmentFormat normal = { GL_RG16,  GL_RG,   GL_UNSIGNED_SHORT };
+	AttachmentFormat uv     = { GL_RG16F, GL_RG,   GL_FLOAT };
+	attachmentFormats.push_back(color);
+	attachmentFormats.push_back(normal);
+	attachmentFormats.push_back(uv);
+	return attachmentFormats; // 12 bytes per pixel instead of 64 with four RGBA32F attachments
+}
+
 void FrameBufferObject::setColorAttachmentTextureHandle( GLenum attachment, GLuint textureHandle )
 {
 	glBindTexture(GL_TEXTURE_2D, textureHandle);
@@ -99,13 +124,13 @@ void FrameBufferObject::setColorAttachmentTextureHandle( GLenum attachment, GLui
 
 	if (  width != m_width || height != m_height )
 	{
-		DEBUGLOG->log("ERROR : size of texture differs from frame buffer size");
+		DEBUGLOG_ERROR("size of texture differs from frame buffer size");
 		return;
 	}
 	if ( m_colorAttachments.find( attachment ) != m_colorAttachments.end() )
 	{
 		GLuint oldAttachment = m_colorAttachments[ attachment ];
-		DEBUGLOG->log("WARNING : remember to delete the old texture handle", oldAttachment);
+		DEBUGLOG_WARNING("remember to delete the old texture handle ", oldAttachment);
 
 		m_colorAttachments[ attachment ] = textureHandle;
 		glBindFramebuffer( GL_FRAMEBUFFER, m_frameBufferHandle);
@@ -116,7 +141,7 @@ void FrameBufferObject::setColorAttachmentTextureHandle( GLenum attachment, GLui
 	}
 	else
 	{
-		DEBUGLOG->log("ERROR : specified color attachment does not exist");
+		DEBUGLOG_ERROR("specified color attachment does not exist");
 	}
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
@@ -128,7 +153,7 @@ GLuint FrameBufferObject::getColorAttachmentTextureHandle(GLenum attachment)
 		return m_colorAttachments[attachment];
 	}
 	else{
-		DEBUGLOG->log("ERROR: couldn't find color attachment");
+		DEBUGLOG_ERROR("couldn't find color attachment");
 		return 0;
 	}
 }
@@ -247,7 +272,7 @@ FrameBufferObject::FrameBufferObject(std::map<std::string, int>* outputMap, int
 	// Any errors while generating fbo ?
 	if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 	{
-		DEBUGLOG->log("ERROR: Unable to create FBO!");
+		DEBUGLOG_ERROR("Unable to create FBO!");
 	}
 
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);	
@@ -5,9 +5,19 @@
 #include <GLFW/glfw3.h>
 #include <map>
 #include <vector>
+#include <string>
 
 class FrameBufferObject
 {
+public:
+	/** @brief texture format of a single color attachment */
+	struct AttachmentFormat
+	{
+		GLenum internalFormat;
+		GLenum format;
+		GLenum type;
+	};
+
 protected:
 	GLuint m_frameBufferHandle;
 
@@ -36,7 +46,19 @@ public:
 	void createDepthTexture();
 
 	GLuint createFramebufferTexture();
-	void addColorAttachments(int amount);
+	GLuint createFramebufferTexture(const AttachmentFormat& attachmentFormat);
+	void addColorAttachments(int amount); //!< uses s_internalFormat, s_format and s_type for all attachments
+	void addColorAttachments(const std::vector<AttachmentFormat>& attachmentFormats); //!< one attachment per format
+
+	/**
+	 * @brief compact G-Buffer layout, written by GBuffer.frag and dpGBuffer.frag
+	 *
+	 * attachment 0: color, RGBA8
+	 * attachment 1: octahedral encoded view space normal, RG16
+	 * attachment 2: uv coordinates, RG16F
+	 * view space positions are reconstructed from the depth texture.
+	 */
+	static std::vector<AttachmentFormat> getCompactGBufferFormats();
 
 	GLuint getColorAttachmentTextureHandle(GLenum attachment);
 	void setColorAttachmentTextureHandle(GLenum attachment, GLuint textureHandle);
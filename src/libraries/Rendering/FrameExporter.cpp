@@ -0,0 +1,223 @@
+#include "FrameExporter.h"
+
+#include <Core/ThreadPool.h>
+#include <Core/DebugLog.h>
+#include <Importing/ImageWriter.h>
+
+#include <chrono>
+#include <cstdio>
+
+FrameExporter::FrameExporter(int numBuffers)
+{
+	m_directory = ".";
+	m_prefix = "frame";
+	m_format = PNG;
+	m_valueMin = 0.0f;
+	m_valueMax = 1.0f;
+	m_nextFrame = 0;
+	m_numCaptured = 0;
+	m_numWritten = 0;
+	m_numRefused = 0;
+	m_numFailed = 0;
+	m_encodeMilliseconds = 0.0;
+
+	m_slots.resize( std::max(1, numBuffers) );
+	for (unsigned int i = 0; i < m_slots.size(); i++)
+	{
+		m_slots[i].state = FREE;
+		m_slots[i].written = false;
+		m_slots[i].milliseconds = 0.0;
+	}
+}
+
+FrameExporter::~FrameExporter()
+{
+	finish();
+}
+
+void FrameExporter::setOutput(const std::string& directory, const std::string& prefix)
+{
+	m_directory = directory;
+	m_prefix = prefix;
+	m_nextFrame = 0;
+}
+
+void FrameExporter::setFormat(Format format)
+{
+	m_format = format;
+}
+
+FrameExporter::Format FrameExporter::getFormat() const
+{
+	return m_format;
+}
+
+void FrameExporter::setValueRange(float valueMin, float valueMax)
+{
+	m_valueMin = valueMin;
+	m_valueMax = valueMax;
+}
+
+std::string FrameExporter::getExtension(Format format) const
+{
+	switch (format)
+	{
+		case PGM16: return ".pgm";
+		case RAW:   return ".raw";
+		default:    return ".png";
+	}
+}
+
+bool FrameExporter::capture(GLuint framebuffer, GLenum readBuffer, int width, int height)
+{
+	update(); // recycle what is done already
+
+	Slot* slot = 0;
+	for (unsigned int i = 0; i < m_slots.size() && !slot; i++)
+	{
+		if ( m_slots[i].state == FREE ) { slot = &m_slots[i]; }
+	}
+	if ( !slot )
+	{
+		m_numRefused++;
+		return false;
+	}
+
+	if ( m_format == PNG )
+	{
+		slot->readback.readPixels(framebuffer, readBuffer, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (size_t) width * height * 4);
+	}
+	else
+	{
+		slot->readback.readPixels(framebuffer, readBuffer, 0, 0, width, height, GL_RED, GL_FLOAT, (size_t) width * height * sizeof(float));
+	}
+
+	char frameNumber[16];
+	std::snprintf(frameNumber, sizeof(frameNumber), "_%05d", m_nextFrame++);
+
+	slot->state = READING;
+	slot->width = width;
+	slot->height = height;
+	slot->format = m_format;
+	slot->valueMin = m_valueMin;
+	slot->valueMax = m_valueMax;
+	slot->path = m_directory + "/" + m_prefix + frameNumber + getExtension(m_format);
+	m_numCaptured++;
+	return true;
+}
+
+void FrameExporter::update()
+{
+	for (unsigned int i = 0; i < m_slots.size(); i++)
+	{
+		Slot& slot = m_slots[i];
+		if ( slot.state == READING )
+		{
+			if ( !slot.readback.poll() )
+			{
+				continue;
+			}
+
+			// the buffer stays mapped while the task encodes from it
+			const void* pixels = slot.readback.map();
+			if ( !pixels )
+			{
+				DEBUGLOG->log("FrameExporter: could not map frame " + slot.path);
+				m_numFailed++;
+				slot.state = FREE;
+				continue;
+			}
+
+			Slot* task = &slot;
+			slot.done = THREADPOOL->enqueue( [this, task, pixels]()
+			{
+				auto start = std::chrono::high_resolution_clock::now();
+				task->written = encode(pixels, *task);
+				task->milliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+			} );
+			slot.state = ENCODING;
+		}
+		else if ( slot.state == ENCODING && slot.done.wait_for( std::chrono::seconds(0) ) == std::future_status::ready )
+		{
+			slot.done.get();
+			if ( slot.written ) { m_numWritten++; }
+			else { m_numFailed++; }
+			m_encodeMilliseconds = slot.milliseconds;
+
+			slot.readback.unmap();
+			slot.state = FREE;
+		}
+	}
+}
+
+void FrameExporter::finish()
+{
+	for (unsigned int i = 0; i < m_slots.size(); i++)
+	{
+		if ( m_slots[i].state == READING ) { m_slots[i].readback.wait(); }
+	}
+	update(); // all readbacks are complete: start encoding
+	for (unsigned int i = 0; i < m_slots.size(); i++)
+	{
+		if ( m_slots[i].state == ENCODING ) { m_slots[i].done.wait(); }
+	}
+	update(); // recycle
+}
+
+bool FrameExporter::encode(const void* pixels, const Slot& slot) const
+{
+	switch (slot.format)
+	{
+		case PGM16:
+		{
+			const float* values = (const float*) pixels;
+			std::vector<unsigned short> gray( (size_t) slot.width * slot.height );
+			float scale = (slot.valueMax > slot.valueMin) ? 65535.0f / (slot.valueMax - slot.valueMin) : 0.0f;
+			for (size_t i = 0; i < gray.size(); i++)
+			{
+				float v = (values[i] - slot.valueMin) * scale;
+				gray[i] = (unsigned short) std::min( std::max(v, 0.0f), 65535.0f ); // also maps the -FLT_MAX background to 0
+			}
+			return ImageWriter::writePGM16(slot.path, &gray[0], slot.width, slot.height);
+		}
+		case RAW:
+			return ImageWriter::writeRaw(slot.path, pixels, slot.width, slot.height, sizeof(float));
+		default:
+			return ImageWriter::writePNG(slot.path, (const unsigned char*) pixels, slot.width, slot.height);
+	}
+}
+
+int FrameExporter::getNumInFlight() const
+{
+	int numInFlight = 0;
+	for (unsigned int i = 0; i < m_slots.size(); i++)
+	{
+		if ( m_slots[i].state != FREE ) { numInFlight++; }
+	}
+	return numInFlight;
+}
+
+int FrameExporter::getNumCaptured() const
+{
+	return m_numCaptured;
+}
+
+int FrameExporter::getNumWritten() const
+{
+	return m_numWritten;
+}
+
+int FrameExporter::getNumRefused() const
+{
+	return m_numRefused;
+}
+
+int FrameExporter::getNumFailed() const
+{
+	return m_numFailed;
+}
+
+double FrameExporter::getEncodeMilliseconds() const
+{
+	return m_encodeMilliseconds;
+}
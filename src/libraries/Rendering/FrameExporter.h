@@ -0,0 +1,121 @@
+#ifndef FRAMEEXPORTER_H
+#define FRAMEEXPORTER_H
+
+#include <GL/glew.h>
+
+#include <Rendering/AsyncReadback.h>
+
+#include <string>
+#include <vector>
+#include <future>
+
+/**
+ * @brief saves rendered frames as image sequences without stalling the render loop
+ *
+ * capture() starts an asynchronous readback of a framebuffer into one of a ring of pixel pack
+ * buffers and inserts a fence. update(), called once per frame, maps every buffer whose fence has
+ * signaled and hands it to a ThreadPool task, which encodes and writes the file straight from the
+ * mapped memory; the buffer is unmapped and reused once the task is done. If all buffers are in
+ * flight, capture() refuses the frame instead of waiting, so the caller may retry in the next frame.
+ *
+ * Files are named <directory>/<prefix>_<frame>.<extension>, with consecutive frame numbers.
+ */
+class FrameExporter
+{
+public:
+	enum Format
+	{
+		PNG,   //!< 8 bit RGBA of the color buffer
+		PGM16, //!< red channel, mapped from the value range to 16 bit grayscale, e.g. a MIP traversal result
+		RAW    //!< red channel as 32 bit floats, unmapped
+	};
+
+protected:
+	enum SlotState { FREE, READING, ENCODING };
+
+	struct Slot
+	{
+		AsyncReadback readback; //!< READING: pending, ENCODING: mapped
+		SlotState state;
+		std::future<void> done; //!< ENCODING: ready once the task is done
+		bool written;           //!< whether the file was written, set by the task
+		double milliseconds;    //!< encoding time, set by the task
+		int width;
+		int height;
+		Format format;
+		float valueMin;
+		float valueMax;
+		std::string path;
+	};
+
+	std::vector<Slot> m_slots;
+
+	std::string m_directory;
+	std::string m_prefix;
+	Format m_format;
+	float m_valueMin;
+	float m_valueMax;
+
+	int m_nextFrame;
+	int m_numCaptured;
+	int m_numWritten;
+	int m_numRefused; //!< captures refused since all buffers were in flight
+	int m_numFailed;  //!< files which could not be written
+	double m_encodeMilliseconds; //!< encoding time of the last written frame
+
+	std::string getExtension(Format format) const;
+	bool encode(const void* pixels, const Slot& slot) const; //!< runs on the ThreadPool
+
+public:
+	/**
+	 * @param numBuffers frames in flight; more buffers absorb longer encoding times
+	 */
+	FrameExporter(int numBuffers = 4);
+	~FrameExporter(); //!< writes all frames in flight
+
+	/**
+	 * @brief set where the next frames are written; restarts the frame numbering
+	 *
+	 * @param directory existing directory
+	 * @param prefix of the file names
+	 */
+	void setOutput(const std::string& directory, const std::string& prefix);
+
+	void setFormat(Format format);
+	Format getFormat() const;
+
+	/**
+	 * @brief PGM16: values mapped to 0 and 65535, clamped outside
+	 */
+	void setValueRange(float valueMin, float valueMax);
+
+	/**
+	 * @brief start the readback of a frame
+	 *
+	 * @param framebuffer to read from, 0 for the default framebuffer
+	 * @param readBuffer e.g. GL_COLOR_ATTACHMENT0, or GL_BACK for the default framebuffer
+	 * @param width of the region, starting at the lower left corner
+	 * @param height of the region
+	 * @return false if all buffers are in flight; the frame was not captured
+	 */
+	bool capture(GLuint framebuffer, GLenum readBuffer, int width, int height);
+
+	/**
+	 * @brief advance frames in flight without waiting: start encoding finished readbacks, recycle written frames
+	 */
+	void update();
+
+	/**
+	 * @brief block until all frames in flight have been written
+	 */
+	void finish();
+
+	int getNumInFlight() const;
+	int getNumCaptured() const;
+	int getNumWritten() const;
+	int getNumRefused() const;
+	int getNumFailed() const;
+	double getEncodeMilliseconds() const; //!< encoding time of the last written frame
+};
+
+#endif
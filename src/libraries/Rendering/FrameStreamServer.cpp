@@ -0,0 +1,305 @@
+#include "FrameStreamServer.h"
+
+#include <Core/DebugLog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace FrameStream;
+
+FrameStreamServer::FrameStreamServer(int tileSize, int maxFramesInFlight)
+	: m_encoder(tileSize),
+	m_width(0),
+	m_height(0),
+	m_captureTime(0.0),
+	m_numConnections(0),
+	m_hasViewport(false),
+	m_viewportWidth(0),
+	m_viewportHeight(0),
+	m_needsFrame(false),
+	m_nextFrameId(0),
+	m_maxFramesInFlight(std::max(1, maxFramesInFlight)),
+	m_numFramesSent(0),
+	m_numUnchangedFrames(0),
+	m_lastFrameBytes(0),
+	m_encodeMilliseconds(0.0)
+{
+	glGenFramebuffers(1, &m_framebuffer);
+	glGenRenderbuffers(1, &m_renderbuffer);
+}
+
+FrameStreamServer::~FrameStreamServer()
+{
+	close();
+	glDeleteRenderbuffers(1, &m_renderbuffer);
+	glDeleteFramebuffers(1, &m_framebuffer);
+}
+
+double FrameStreamServer::now() const
+{
+	return std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+bool FrameStreamServer::listen(int port, bool allowRemote)
+{
+	return m_channel.listen(port, allowRemote);
+}
+
+bool FrameStreamServer::listenUnix(const std::string& path)
+{
+	return m_channel.listenUnix(path);
+}
+
+void FrameStreamServer::close()
+{
+	m_channel.close();
+	m_framesInFlight.clear();
+	m_controlMessages.clear();
+	m_hasViewport = false;
+}
+
+void FrameStreamServer::setOnReceive(std::function<void()> onReceive)
+{
+	m_channel.setOnReceive(onReceive);
+}
+
+void FrameStreamServer::update()
+{
+	// a new client starts from scratch
+	if ( m_channel.getNumConnections() != m_numConnections )
+	{
+		m_numConnections = m_channel.getNumConnections();
+		m_encoder.reset();
+		m_resolution.reset();
+		m_framesInFlight.clear();
+		m_controlMessages.clear();
+		m_hasViewport = false;
+		DEBUGLOG->log("FrameStreamServer: client connected");
+	}
+
+	MessageChannel::Message message;
+	while ( m_channel.receive(message) )
+	{
+		if ( message.type == VIEWPORT && message.payload.size() == sizeof(ViewportMessage) )
+		{
+			const ViewportMessage* viewport = (const ViewportMessage*) &message.payload[0];
+			m_viewportWidth  = std::max(1, viewport->width);
+			m_viewportHeight = std::max(1, viewport->height);
+			m_resolution.setLatencyBudget( std::max(1.0f, viewport->latencyBudget) );
+			m_hasViewport = true;
+			m_needsFrame = true;
+		}
+		else if ( message.type == ACK && message.payload.size() == sizeof(AckMessage) )
+		{
+			const AckMessage* ack = (const AckMessage*) &message.payload[0];
+			while ( !m_framesInFlight.empty() && m_framesInFlight.front().frameId != ack->frameId )
+			{
+				m_framesInFlight.pop_front(); // acknowledgements arrive in order: older frames are done as well
+			}
+			if ( !m_framesInFlight.empty() )
+			{
+				float latency = (float) ( (now() - m_framesInFlight.front().captureTime) * 1000.0 );
+				m_framesInFlight.pop_front();
+				if ( m_resolution.update(latency) )
+				{
+					m_needsFrame = true; // resend the current scene at the new resolution
+				}
+			}
+		}
+		else if ( message.type == CAMERA || message.type == PARAMETER )
+		{
+			m_controlMessages.push_back( MessageChannel::Message() );
+			m_controlMessages.back().type = message.type;
+			m_controlMessages.back().payload.swap(message.payload);
+		}
+	}
+
+	if ( m_readback.poll() )
+	{
+		encodeFrame();
+	}
+}
+
+void FrameStreamServer::encodeFrame()
+{
+	if ( !m_channel.isConnected() ) { return; }
+
+	auto start = std::chrono::high_resolution_clock::now();
+	const unsigned char* pixels = (const unsigned char*) m_readback.map();
+	if ( !pixels )
+	{
+		DEBUGLOG_WARNING("FrameStreamServer: could not map frame");
+		return;
+	}
+
+	FrameHeader header;
+	header.frameId = m_nextFrameId;
+	header.scale = m_resolution.getScale();
+	header.latency = m_resolution.getSmoothedLatency();
+	int numTiles = m_encoder.encode(pixels, m_width, m_height, header, m_message);
+
+	m_readback.unmap();
+	m_encodeMilliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+
+	if ( numTiles == 0 )
+	{
+		m_numUnchangedFrames++; // nothing to acknowledge either
+		return;
+	}
+
+	m_channel.send(FRAME, m_message);
+	SentFrame sent = { m_nextFrameId++, m_captureTime };
+	m_framesInFlight.push_back(sent);
+	m_lastFrameBytes = m_message.size();
+	m_numFramesSent++;
+}
+
+bool FrameStreamServer::receive(MessageChannel::Message& message)
+{
+	if ( m_controlMessages.empty() ) { return false; }
+	message.type = m_controlMessages.front().type;
+	message.payload.swap( m_controlMessages.front().payload );
+	m_controlMessages.pop_front();
+	return true;
+}
+
+void FrameStreamServer::sendState(const StateMessage& state)
+{
+	m_channel.send(STATE, &state, sizeof(state));
+}
+
+bool FrameStreamServer::wantsFrame() const
+{
+	return m_channel.isConnected() && m_hasViewport && !m_readback.isPending() && (int) m_framesInFlight.size() < m_maxFramesInFlight;
+}
+
+bool FrameStreamServer::needsFrame() const
+{
+	return m_needsFrame;
+}
+
+bool FrameStreamServer::isReading() const
+{
+	return m_readback.isPending();
+}
+
+void FrameStreamServer::capture(GLuint framebuffer, GLenum readBuffer, int width, int height)
+{
+	if ( !wantsFrame() ) { return; }
+
+	// fit into the viewport without upscaling, keep the aspect ratio
+	float fit = std::min(1.0f, std::min( (float) m_viewportWidth / (float) width, (float) m_viewportHeight / (float) height ));
+	float scale = fit * m_resolution.getScale();
+	int streamWidth  = std::max(1, (int) std::floor( (float) width  * scale + 0.5f ));
+	int streamHeight = std::max(1, (int) std::floor( (float) height * scale + 0.5f ));
+
+	if ( streamWidth != m_width || streamHeight != m_height )
+	{
+		m_width = streamWidth;
+		m_height = streamHeight;
+		glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_width, m_height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	}
+
+	GLint previousReadFramebuffer = 0;
+	GLint previousDrawFramebuffer = 0;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousReadFramebuffer);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousDrawFramebuffer);
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_renderbuffer);
+	glDrawBuffer(GL_COLOR_ATTACHMENT0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glReadBuffer(readBuffer);
+	glBlitFramebuffer(0, 0, width, height, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT, (m_width == width && m_height == height) ? GL_NEAREST : GL_LINEAR);
+
+	m_readback.readPixels(m_framebuffer, GL_COLOR_ATTACHMENT0, 0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, (size_t) m_width * m_height * 4);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, previousReadFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousDrawFramebuffer);
+
+	m_captureTime = now();
+	m_needsFrame = false;
+}
+
+bool FrameStreamServer::isOpen() const
+{
+	return m_channel.isOpen();
+}
+
+bool FrameStreamServer::isConnected() const
+{
+	return m_channel.isConnected();
+}
+
+int FrameStreamServer::getNumConnections() const
+{
+	return m_channel.getNumConnections();
+}
+
+int FrameStreamServer::getMaxFramesInFlight() const
+{
+	return m_maxFramesInFlight;
+}
+
+int FrameStreamServer::getStreamWidth() const
+{
+	return m_width;
+}
+
+int FrameStreamServer::getStreamHeight() const
+{
+	return m_height;
+}
+
+float FrameStreamServer::getScale() const
+{
+	return m_resolution.getScale();
+}
+
+float FrameStreamServer::getLatency() const
+{
+	return m_resolution.getSmoothedLatency();
+}
+
+float FrameStreamServer::getLatencyBudget() const
+{
+	return m_resolution.getLatencyBudget();
+}
+
+int FrameStreamServer::getNumFramesSent() const
+{
+	return m_numFramesSent;
+}
+
+int FrameStreamServer::getNumUnchangedFrames() const
+{
+	return m_numUnchangedFrames;
+}
+
+int FrameStreamServer::getNumChangedTiles() const
+{
+	return m_encoder.getNumChangedTiles();
+}
+
+int FrameStreamServer::getNumTiles() const
+{
+	return m_encoder.getNumTiles();
+}
+
+size_t FrameStreamServer::getLastFrameBytes() const
+{
+	return m_lastFrameBytes;
+}
+
+double FrameStreamServer::getEncodeMilliseconds() const
+{
+	return m_encodeMilliseconds;
+}
+
+unsigned long long FrameStreamServer::getBytesSent() const
+{
+	return m_channel.getBytesSent();
+}
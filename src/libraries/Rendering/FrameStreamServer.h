@@ -0,0 +1,130 @@
+#ifndef FRAMESTREAMSERVER_H
+#define FRAMESTREAMSERVER_H
+
+#include <GL/glew.h>
+
+#include <Core/MessageChannel.h>
+#include <Core/FrameStream.h>
+#include <Rendering/AsyncReadback.h>
+
+#include <deque>
+
+/**
+ * @brief streams rendered frames to a remote client, see FrameStream for the protocol
+ *
+ * capture() scales a framebuffer down to the streamed resolution by a blit and starts an asynchronous
+ * readback; update(), called once per frame, encodes the frame as tile deltas
+ * once the readback is complete and queues it on the MessageChannel, whose network thread sends it.
+ *
+ * The streamed resolution fits the framebuffer into the client's viewport, scaled by an AdaptiveResolution
+ * which keeps the latency from readback to acknowledgement within the client's budget. At most
+ * getMaxFramesInFlight() frames are unacknowledged, so a slow link delays frames instead of queueing them.
+ * Camera and parameter messages of the client are handed to the application by receive().
+ */
+class FrameStreamServer
+{
+protected:
+	struct SentFrame
+	{
+		unsigned int frameId;
+		double captureTime; //!< seconds
+	};
+
+	MessageChannel m_channel;
+	FrameStream::TileDeltaEncoder m_encoder;
+	FrameStream::AdaptiveResolution m_resolution;
+
+	GLuint m_framebuffer;  //!< target of the downscaling blit
+	GLuint m_renderbuffer;
+	int m_width;           //!< streamed resolution of the pending or last captured frame
+	int m_height;
+
+	AsyncReadback m_readback;
+	double m_captureTime;  //!< of the pending readback
+
+	int m_numConnections;  //!< last seen MessageChannel::getNumConnections()
+	bool m_hasViewport;
+	int m_viewportWidth;
+	int m_viewportHeight;
+	bool m_needsFrame;     //!< a frame should be sent even if the scene did not change
+
+	unsigned int m_nextFrameId;
+	int m_maxFramesInFlight;
+	std::deque<SentFrame> m_framesInFlight;
+	std::deque<MessageChannel::Message> m_controlMessages;
+	std::vector<char> m_message;
+
+	int m_numFramesSent;
+	int m_numUnchangedFrames;  //!< captured, but not sent since no tile changed
+	size_t m_lastFrameBytes;
+	double m_encodeMilliseconds;
+
+	double now() const; //!< seconds
+	void encodeFrame(); //!< the readback is complete
+
+public:
+	FrameStreamServer(int tileSize = 32, int maxFramesInFlight = 2);
+	~FrameStreamServer();
+
+	bool listen(int port, bool allowRemote = false); //!< see MessageChannel::listen
+	bool listenUnix(const std::string& path);
+	void close();
+
+	/**
+	 * @brief called on the network thread whenever the client sent something, e.g. to wake up the render loop
+	 */
+	void setOnReceive(std::function<void()> onReceive);
+
+	/**
+	 * @brief handle client messages and finished readbacks; call once per frame
+	 */
+	void update();
+
+	/**
+	 * @brief pop a CAMERA or PARAMETER message of the client
+	 */
+	bool receive(MessageChannel::Message& message);
+
+	void sendState(const FrameStream::StateMessage& state);
+
+	/**
+	 * @brief whether capture() may be called: a client is connected and fewer than getMaxFramesInFlight() frames are pending
+	 */
+	bool wantsFrame() const;
+
+	/**
+	 * @brief whether the client needs a frame although the scene did not change, e.g. it just connected or the resolution changed
+	 */
+	bool needsFrame() const;
+
+	bool isReading() const; //!< a readback is pending; keep calling update()
+
+	/**
+	 * @brief start streaming a frame, if wantsFrame()
+	 *
+	 * @param framebuffer to read from, 0 for the default framebuffer
+	 * @param readBuffer e.g. GL_COLOR_ATTACHMENT0
+	 * @param width of the region, starting at the lower left corner
+	 * @param height of the region
+	 */
+	void capture(GLuint framebuffer, GLenum readBuffer, int width, int height);
+
+	bool isOpen() const;
+	bool isConnected() const;
+	int getNumConnections() const; //!< changes whenever a new client connected
+	int getMaxFramesInFlight() const;
+	int getStreamWidth() const;
+	int getStreamHeight() const;
+	float getScale() const;
+	float getLatency() const;       //!< smoothed, milliseconds
+	float getLatencyBudget() const; //!< of the client, milliseconds
+	int getNumFramesSent() const;
+	int getNumUnchangedFrames() const;
+	int getNumChangedTiles() const; //!< of the last encoded frame
+	int getNumTiles() const;        //!< of the last encoded frame
+	size_t getLastFrameBytes() const;
+	double getEncodeMilliseconds() const;
+	unsigned long long getBytesSent() const;
+};
+
+#endif
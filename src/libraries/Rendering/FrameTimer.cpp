@@ -0,0 +1,142 @@
+#include "FrameTimer.h"
+
+#include <Core/Benchmark.h>
+#include <Core/DebugLog.h>
+
+#include <fstream>
+
+FrameTimer::FrameTimer()
+	: m_inFrame(false)
+{
+}
+
+FrameTimer::~FrameTimer()
+{
+	clear();
+	if ( !m_freeQueries.empty() )
+	{
+		glDeleteQueries( (GLsizei) m_freeQueries.size(), &m_freeQueries[0] );
+	}
+}
+
+GLuint FrameTimer::getQuery()
+{
+	if ( m_freeQueries.empty() )
+	{
+		GLuint query;
+		glGenQueries(1, &query);
+		return query;
+	}
+	GLuint query = m_freeQueries.back();
+	m_freeQueries.pop_back();
+	return query;
+}
+
+void FrameTimer::begin()
+{
+	collect(false);
+
+	auto now = std::chrono::high_resolution_clock::now();
+	Frame frame;
+	frame.intervalMilliseconds = m_frames.empty() ? 0.0 : std::chrono::duration<double, std::milli>( now - m_begin ).count();
+	frame.cpuMilliseconds = 0.0;
+	frame.gpuMilliseconds = -1.0;
+	m_frames.push_back(frame);
+	m_begin = now;
+
+	Pending pending;
+	pending.frame = (int) m_frames.size() - 1;
+	pending.queries[0] = getQuery();
+	pending.queries[1] = getQuery();
+	glQueryCounter(pending.queries[0], GL_TIMESTAMP);
+	m_pending.push_back(pending);
+	m_inFrame = true;
+}
+
+void FrameTimer::end()
+{
+	if ( !m_inFrame ) { return; }
+	m_inFrame = false;
+
+	glQueryCounter(m_pending.back().queries[1], GL_TIMESTAMP);
+	m_frames.back().cpuMilliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - m_begin ).count();
+}
+
+void FrameTimer::collect(bool wait)
+{
+	while ( !m_pending.empty() && !(m_inFrame && m_pending.size() == 1) )
+	{
+		Pending& pending = m_pending.front();
+		if ( !wait )
+		{
+			GLint available = 0;
+			glGetQueryObjectiv(pending.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+			if ( !available ) { return; } // later queries are not available either
+		}
+
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v(pending.queries[0], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(pending.queries[1], GL_QUERY_RESULT, &end);
+		m_frames[pending.frame].gpuMilliseconds = (double) (end - begin) / 1.0e6;
+
+		m_freeQueries.push_back(pending.queries[0]);
+		m_freeQueries.push_back(pending.queries[1]);
+		m_pending.pop_front();
+	}
+}
+
+void FrameTimer::finish()
+{
+	end();
+	collect(true);
+}
+
+void FrameTimer::clear()
+{
+	m_inFrame = false;
+	for (unsigned int i = 0; i < m_pending.size(); i++)
+	{
+		m_freeQueries.push_back(m_pending[i].queries[0]);
+		m_freeQueries.push_back(m_pending[i].queries[1]);
+	}
+	m_pending.clear();
+	m_frames.clear();
+}
+
+const std::vector<FrameTimer::Frame>& FrameTimer::getFrames() const
+{
+	return m_frames;
+}
+
+bool FrameTimer::writeCSV(const std::string& path) const
+{
+	std::ofstream file(path.c_str());
+	if ( !file )
+	{
+		DEBUGLOG_ERROR("FrameTimer: could not open file for writing: " + path);
+		return false;
+	}
+
+	file << "frame,interval_ms,cpu_ms,gpu_ms\n";
+	for (unsigned int i = 0; i < m_frames.size(); i++)
+	{
+		file << i << "," << m_frames[i].intervalMilliseconds << "," << m_frames[i].cpuMilliseconds << "," << m_frames[i].gpuMilliseconds << "\n";
+	}
+	return (bool) file;
+}
+
+void FrameTimer::addResults(Benchmark& benchmark, const std::string& name) const
+{
+	std::vector<double> cpu;
+	std::vector<double> gpu;
+	for (unsigned int i = 0; i < m_frames.size(); i++)
+	{
+		cpu.push_back(m_frames[i].cpuMilliseconds);
+		if ( m_frames[i].gpuMilliseconds >= 0.0 )
+		{
+			gpu.push_back(m_frames[i].gpuMilliseconds);
+		}
+	}
+	benchmark.addResult(name + " cpu", cpu);
+	benchmark.addResult(name + " gpu", gpu);
+}
@@ -0,0 +1,68 @@
+#ifndef FRAMETIMER_H
+#define FRAMETIMER_H
+
+#include <GL/glew.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <chrono>
+
+class Benchmark;
+
+/**
+ * @brief per frame CPU and GPU times, e.g. of a Timeline replay
+ *
+ * begin() and end() enclose the work of a frame. The GPU time is measured by timestamp queries, so it
+ * may enclose other timer queries; the results are collected by later calls without waiting, finish()
+ * waits for the outstanding ones.
+ */
+class FrameTimer
+{
+public:
+	struct Frame
+	{
+		double intervalMilliseconds; //!< since begin() of the previous frame, 0 for the first one
+		double cpuMilliseconds;      //!< from begin() to end()
+		double gpuMilliseconds;      //!< from begin() to end() on the GPU, negative until available
+	};
+
+protected:
+	struct Pending
+	{
+		int frame;
+		GLuint queries[2]; //!< timestamps of begin() and end()
+	};
+
+	std::vector<Frame> m_frames;
+	std::deque<Pending> m_pending;
+	std::vector<GLuint> m_freeQueries;
+	std::chrono::high_resolution_clock::time_point m_begin;
+	bool m_inFrame;
+
+	GLuint getQuery();
+	void collect(bool wait); //!< results of the pending frames, in order
+
+public:
+	FrameTimer();
+	~FrameTimer();
+
+	void begin();
+	void end();
+	void finish(); //!< wait for the GPU times of all frames
+	void clear();
+
+	const std::vector<Frame>& getFrames() const;
+
+	/**
+	 * @brief one line per frame: frame, interval, CPU and GPU milliseconds
+	 */
+	bool writeCSV(const std::string& path) const;
+
+	/**
+	 * @brief add statistics of the CPU and GPU times as "<name> cpu" and "<name> gpu"
+	 */
+	void addResults(Benchmark& benchmark, const std::string& name) const;
+};
+
+#endif
@@ -1,8 +1,12 @@
 #include "GLTools.h"
 
+#include <atomic>
+
 static bool g_initialized = false;
+static std::atomic<int> g_numInvalidFrames(1); // frames left to be rendered by renderOnDemand
+static const int s_numFramesPerEvent = 3; // ImGui needs a few frames to settle after input
 
-GLFWwindow* generateWindow(int width, int height, int posX, int posY) {
+GLFWwindow* generateWindow(int width, int height, int posX, int posY, bool visible) {
 	if (g_initialized == false)
 	{
 		glfwInit();
@@ -17,7 +21,9 @@ GLFWwindow* generateWindow(int width, int height, int posX, int posY) {
 
 	}
 	
+	glfwWindowHint(GLFW_VISIBLE, visible ? GL_TRUE : GL_FALSE);
 	GLFWwindow* window = glfwCreateWindow(width, height, "OpenGL Window", NULL, NULL);
+	glfwWindowHint(GLFW_VISIBLE, GL_TRUE);
 	glfwSetWindowPos(window, posX, posY);
 	glfwSetWindowSize(window, width, height);
 	glfwMakeContextCurrent(window);
@@ -67,6 +73,47 @@ void render(GLFWwindow* window, std::function<void (double)> loop) {
 	}
 }
 
+void invalidateFrame(int numFrames)
+{
+	int current = g_numInvalidFrames.load();
+	while (current < numFrames && !g_numInvalidFrames.compare_exchange_weak(current, numFrames)) {}
+	if (g_initialized)
+	{
+		glfwPostEmptyEvent(); // wake up renderOnDemand, if waiting
+	}
+}
+
+void renderOnDemand(GLFWwindow* window, std::function<void (double)> loop, double maxWaitTime) {
+	glfwSetWindowRefreshCallback(window, [] (GLFWwindow* w) { invalidateFrame(s_numFramesPerEvent); });
+	glfwSetFramebufferSizeCallback(window, [] (GLFWwindow* w, int width, int height) { invalidateFrame(s_numFramesPerEvent); });
+
+	float lastTime = static_cast<float>(glfwGetTime());
+	while ( !glfwWindowShouldClose(window)) {
+		if (g_numInvalidFrames.load() > 0)
+		{
+			g_numInvalidFrames--;
+
+			float currentTime =static_cast<float>(glfwGetTime());
+			loop(currentTime - lastTime);
+			lastTime = currentTime;
+
+			glfwSwapBuffers(window);
+			glfwPollEvents();
+		}
+		else
+		{
+			// returning before the timeout means events were processed, possibly by callbacks installed elsewhere
+			double waitStart = glfwGetTime();
+			glfwWaitEventsTimeout(maxWaitTime);
+			lastTime = static_cast<float>(glfwGetTime()); // idle time is no frame time: dt of the next frame starts now
+			if (lastTime - waitStart < maxWaitTime)
+			{
+				invalidateFrame(s_numFramesPerEvent);
+			}
+		}
+	}
+}
+
 GLenum checkGLError(bool printIfNoError)
 {
 	GLenum error = glGetError();
@@ -124,6 +171,7 @@ std::string decodeGLError(GLenum error)
 void setKeyCallback(GLFWwindow* window, std::function<void (int, int, int, int)> func) {
 	static std::function<void (int, int, int, int)> func_bounce = func;
 	glfwSetKeyCallback(window, [] (GLFWwindow* w, int k, int s, int a, int m) {
+		invalidateFrame(s_numFramesPerEvent);
 		func_bounce(k, s, a, m);
 	});
 }
@@ -131,6 +179,7 @@ void setKeyCallback(GLFWwindow* window, std::function<void (int, int, int, int)>
 void setMouseButtonCallback(GLFWwindow* window, std::function<void (int, int, int)> func) {
 	static std::function<void (int, int, int)> func_bounce = func;
 	glfwSetMouseButtonCallback(window, [] (GLFWwindow* w, int b, int a, int m) {
+		invalidateFrame(s_numFramesPerEvent);
 		func_bounce(b, a, m);
 	});
 }
@@ -138,6 +187,7 @@ void setMouseButtonCallback(GLFWwindow* window, std::function<void (int, int, in
 void setCharCallback(GLFWwindow* window, std::function<void (unsigned int)> func) {
 	static std::function<void (unsigned int)> func_bounce = func;
 	glfwSetCharCallback(window, [] (GLFWwindow* w, unsigned int c) {
+		invalidateFrame(s_numFramesPerEvent);
 		func_bounce(c);
 	});
 }
@@ -145,6 +195,7 @@ void setCharCallback(GLFWwindow* window, std::function<void (unsigned int)> func
 void setCursorPosCallback(GLFWwindow* window, std::function<void (double, double)> func) {
 	static std::function<void (double, double)> func_bounce = func;
 	glfwSetCursorPosCallback(window, [] (GLFWwindow* w, double x, double y) {
+		invalidateFrame(s_numFramesPerEvent);
 		func_bounce(x, y);
 	});
 }
@@ -152,6 +203,7 @@ void setCursorPosCallback(GLFWwindow* window, std::function<void (double, double
 void setScrollCallback(GLFWwindow* window, std::function<void (double, double)> func) {
 	static std::function<void (double, double)> func_bounce = func;
 	glfwSetScrollCallback(window, [] (GLFWwindow* w, double x, double y) {
+		invalidateFrame(s_numFramesPerEvent);
 		func_bounce(x, y);
 	});
 }
@@ -159,6 +211,7 @@ void setScrollCallback(GLFWwindow* window, std::function<void (double, double)>
 void setCursorEnterCallback(GLFWwindow* window, std::function<void (int)> func) {
 	static std::function<void (int)> func_bounce = func;
 	glfwSetCursorEnterCallback(window, [] (GLFWwindow* w, int e) {
+		invalidateFrame(s_numFramesPerEvent);
 		func_bounce(e);
 	});
 }
@@ -173,4 +226,24 @@ float getRatio(GLFWwindow* window) {
     int w, h;
     glfwGetFramebufferSize(window, &w, &h);
     return float(w)/float(h);
-}
\ No newline at end of file
+}
+
+GLuint loadGradientsTo3DTexture(const std::vector<unsigned int>& packed, unsigned int size_x, unsigned int size_y, unsigned int size_z)
+{
+	GLuint gradientTexture;
+	glGenTextures(1, &gradientTexture);
+	glBindTexture(GL_TEXTURE_3D, gradientTexture);
+
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	glTexStorage3D(GL_TEXTURE_3D, 1, GL_RGB10_A2, size_x, size_y, size_z);
+	glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, size_x, size_y, size_z, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, &packed[0]);
+
+	glBindTexture(GL_TEXTURE_3D, 0);
+
+	return gradientTexture;
+}
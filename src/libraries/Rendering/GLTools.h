@@ -11,11 +11,25 @@
 #include <glm/glm.hpp>
 
 
-GLFWwindow* generateWindow(int width = 1280, int height = 720, int posX = 100, int posY = 100);
+GLFWwindow* generateWindow(int width = 1280, int height = 720, int posX = 100, int posY = 100, bool visible = true); // invisible windows provide a context for offscreen rendering
 bool shouldClose(GLFWwindow* window);
 void swapBuffers(GLFWwindow* window);
 void destroyWindow(GLFWwindow* window);
 void render(GLFWwindow* window, std::function<void (double)> loop);
+
+/**
+ * @brief render loop which only renders invalidated frames and sleeps otherwise
+ *
+ * Input events received through the callbacks of this file, window refreshes and any other event
+ * which wakes glfwWaitEventsTimeout invalidate frames automatically. Animations must call
+ * invalidateFrame() every frame they want to continue.
+ *
+ * @param window to render to
+ * @param loop called once per rendered frame with the time since the last rendered frame
+ * @param maxWaitTime seconds to block while no frame is invalid before checking again
+ */
+void renderOnDemand(GLFWwindow* window, std::function<void (double)> loop, double maxWaitTime = 0.5);
+void invalidateFrame(int numFrames = 1); // request the next numFrames frames to be rendered; thread safe
 GLenum checkGLError(bool printIfNoError = false);
 std::string decodeGLError(GLenum error);
 
@@ -29,6 +43,13 @@ void setCursorEnterCallback(GLFWwindow* window, std::function<void (int)> func);
 glm::vec2 getResolution(GLFWwindow* window);
 float getRatio(GLFWwindow* window);
 
+/**
+ * @brief upload packed gradients to a linearly filtered GL_RGB10_A2 3D texture
+ *
+ * @param packed GL_UNSIGNED_INT_2_10_10_10_REV per voxel, see GradientVolume in Processing/Gradients.h
+ */
+GLuint loadGradientsTo3DTexture(const std::vector<unsigned int>& packed, unsigned int size_x, unsigned int size_y, unsigned int size_z);
+
 template <typename T>
 GLuint loadTo3DTexture(VolumeData<T>& volumeData, GLenum internalFormat = GL_R16I, GLenum format = GL_RED_INTEGER, GLenum type = GL_SHORT)
 {
@@ -71,4 +92,44 @@ GLuint loadTo3DTexture(VolumeData<T>& volumeData, GLenum internalFormat = GL_R16
 	return volumeTexture;
 }
 
+/**
+ * @brief upload two co-registered volumes of equal resolution into one two channel RG16I texture
+ *
+ * A single fetch returns the values of both volumes, a in r and b in g.
+ */
+template <typename T>
+GLuint loadTo3DTexturePacked(const VolumeData<T>& a, const VolumeData<T>& b)
+{
+	if (a.size_x != b.size_x || a.size_y != b.size_y || a.size_z != b.size_z)
+	{
+		DEBUGLOG_ERROR("volumes to be packed differ in resolution");
+		return 0;
+	}
+
+	// interleave
+	std::vector<T> packed(a.data.size() * 2);
+	for (size_t i = 0; i < a.data.size(); i++)
+	{
+		packed[2 * i]     = a.data[i];
+		packed[2 * i + 1] = b.data[i];
+	}
+
+	GLuint volumeTexture;
+	glGenTextures(1, &volumeTexture);
+	glBindTexture(GL_TEXTURE_3D, volumeTexture);
+
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); // integer textures can not be filtered
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	glTexStorage3D(GL_TEXTURE_3D, 1, GL_RG16I, a.size_x, a.size_y, a.size_z);
+	glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, a.size_x, a.size_y, a.size_z, GL_RG_INTEGER, GL_SHORT, &packed[0]);
+
+	glBindTexture(GL_TEXTURE_3D, 0);
+
+	return volumeTexture;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,389 @@
+#include "InstancedScene.h"
+
+#include <Core/DebugLog.h>
+#include <Rendering/MeshCache.h>
+
+#include <algorithm>
+
+InstancedScene::InstancedScene()
+{
+	m_mode = GL_TRIANGLES;
+	m_numCommands = 0;
+	m_geometryDirty = false;
+	m_instancesDirty = false;
+	m_instanceDataDirty = false;
+
+	glGenVertexArrays(1, &m_vao);
+
+	GLuint bufferHandles[7];
+	glGenBuffers(7, bufferHandles);
+	m_positions.m_vboHandle = bufferHandles[0];
+	m_uvs.m_vboHandle       = bufferHandles[1];
+	m_normals.m_vboHandle   = bufferHandles[2];
+	m_indices.m_vboHandle   = bufferHandles[3];
+	m_instanceIndexBuffer   = bufferHandles[4];
+	m_instanceBuffer        = bufferHandles[5];
+	m_commandBuffer         = bufferHandles[6];
+	m_positions.m_size = 0;
+	m_uvs.m_size = 0;
+	m_normals.m_size = 0;
+	m_indices.m_size = 0;
+
+	// attribute layout as in GBuffer.vert, plus the instance index
+	glBindVertexArray(m_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, m_positions.m_vboHandle);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, m_uvs.m_vboHandle);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(1);
+	glBindBuffer(GL_ARRAY_BUFFER, m_normals.m_vboHandle);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(2);
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceIndexBuffer);
+	glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, 0, 0);
+	glVertexAttribDivisor(3, 1);
+	glEnableVertexAttribArray(3);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indices.m_vboHandle);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+InstancedScene::~InstancedScene()
+{
+	// vertex and index buffers are deleted by ~Renderable()
+	glDeleteBuffers(1, &m_instanceIndexBuffer);
+	glDeleteBuffers(1, &m_instanceBuffer);
+	glDeleteBuffers(1, &m_commandBuffer);
+	glDeleteVertexArrays(1, &m_vao);
+}
+
+int InstancedScene::addMesh(const std::vector<float>& positions, const std::vector<float>& uvs, const std::vector<float>& normals, const std::vector<unsigned int>& indices)
+{
+	unsigned int numVertices = (unsigned int) positions.size() / 3;
+
+	MeshRange mesh;
+	mesh.firstIndex = (unsigned int) m_indexData.size();
+	mesh.baseVertex = (unsigned int) m_positionData.size() / 3;
+
+	m_positionData.insert(m_positionData.end(), positions.begin(), positions.begin() + numVertices * 3);
+	if ( uvs.size() >= numVertices * 2 )
+	{
+		m_uvData.insert(m_uvData.end(), uvs.begin(), uvs.begin() + numVertices * 2);
+	}
+	else
+	{
+		m_uvData.resize(m_uvData.size() + numVertices * 2, 0.0f);
+	}
+	if ( normals.size() >= numVertices * 3 )
+	{
+		m_normalData.insert(m_normalData.end(), normals.begin(), normals.begin() + numVertices * 3);
+	}
+	else
+	{
+		m_normalData.resize(m_normalData.size() + numVertices * 3, 0.0f);
+	}
+
+	if ( indices.empty() )
+	{
+		for (unsigned int i = 0; i < numVertices; i++)
+		{
+			m_indexData.push_back(i);
+		}
+	}
+	else
+	{
+		m_indexData.insert(m_indexData.end(), indices.begin(), indices.end());
+	}
+	mesh.indexCount = (unsigned int) m_indexData.size() - mesh.firstIndex;
+
+	m_meshes.push_back(mesh);
+	m_geometryDirty = true;
+	m_instancesDirty = true; // draw commands refer to the mesh ranges
+
+	return (int) m_meshes.size() - 1;
+}
+
+/**
+ * @brief read back all values of the buffer bound to a vertex attribute of the currently bound vertex array
+ * @return components per vertex, 0 if the attribute is not in use
+ */
+static int readVertexAttribute(GLuint attribute, std::vector<float>& values)
+{
+	GLint enabled = 0;
+	GLint buffer = 0;
+	GLint components = 0;
+	glGetVertexAttribiv(attribute, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+	glGetVertexAttribiv(attribute, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &buffer);
+	glGetVertexAttribiv(attribute, GL_VERTEX_ATTRIB_ARRAY_SIZE, &components);
+	if ( !enabled || buffer == 0 )
+	{
+		return 0;
+	}
+
+	GLint size = 0;
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
+	values.resize(size / sizeof(float));
+	if ( !values.empty() )
+	{
+		glGetBufferSubData(GL_ARRAY_BUFFER, 0, values.size() * sizeof(float), &values[0]);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return components;
+}
+
+/**
+ * @brief copy the first components of every vertex
+ */
+static std::vector<float> selectComponents(const std::vector<float>& values, int components, int selected, unsigned int numVertices)
+{
+	std::vector<float> result( numVertices * selected, 0.0f );
+	for (unsigned int v = 0; v < numVertices; v++)
+	{
+		for (int c = 0; c < std::min(components, selected); c++)
+		{
+			result[v * selected + c] = values[v * components + c];
+		}
+	}
+	return result;
+}
+
+int InstancedScene::addMesh(Renderable* renderable)
+{
+	if ( renderable->m_mode != GL_TRIANGLES && renderable->m_mode != GL_TRIANGLE_STRIP )
+	{
+		DEBUGLOG_ERROR("InstancedScene: unsupported draw mode of renderable: ", renderable->m_mode);
+		return -1;
+	}
+
+	std::vector<float> positions, uvs, normals;
+	std::vector<unsigned int> indices;
+	int positionComponents, uvComponents, normalComponents;
+	unsigned int numVertices;
+
+	if ( renderable->m_mesh )
+	{
+		// shared geometry of the MeshCache
+		MeshData meshData;
+		MESHCACHE->readMeshData(renderable->m_mesh, meshData);
+		positions.swap(meshData.positions);
+		uvs.swap(meshData.uvs);
+		normals.swap(meshData.normals);
+		indices.swap(meshData.indices);
+		positionComponents = meshData.positionComponents;
+		uvComponents = meshData.uvComponents;
+		normalComponents = meshData.normalComponents;
+		numVertices = renderable->m_mesh->numVertices;
+	}
+	else
+	{
+		// separate, tightly packed buffers per attribute
+		glBindVertexArray(renderable->m_vao);
+
+		positionComponents = readVertexAttribute(0, positions);
+		uvComponents       = readVertexAttribute(1, uvs);
+		normalComponents   = readVertexAttribute(2, normals);
+		if ( positionComponents == 0 )
+		{
+			glBindVertexArray(0);
+			DEBUGLOG_ERROR("InstancedScene: renderable has no positions");
+			return -1;
+		}
+		numVertices = (unsigned int) positions.size() / positionComponents;
+		if ( uvComponents != 0 )     { numVertices = std::min(numVertices, (unsigned int) uvs.size() / uvComponents); }
+		if ( normalComponents != 0 ) { numVertices = std::min(numVertices, (unsigned int) normals.size() / normalComponents); }
+
+		// index buffer, if any, is part of the vertex array state
+		GLint indexBuffer = 0;
+		glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &indexBuffer);
+		if ( indexBuffer != 0 )
+		{
+			GLint size = 0;
+			glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
+			indices.resize(size / sizeof(unsigned int));
+			if ( !indices.empty() )
+			{
+				glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(unsigned int), &indices[0]);
+			}
+		}
+		glBindVertexArray(0);
+	}
+
+	if ( renderable->m_mode == GL_TRIANGLE_STRIP )
+	{
+		if ( indices.empty() )
+		{
+			for (unsigned int i = 0; i < numVertices; i++) { indices.push_back(i); }
+		}
+
+		// strip to list, keeping the winding of every other triangle
+		std::vector<unsigned int> triangles;
+		for (unsigned int i = 2; i < indices.size(); i++)
+		{
+			unsigned int a = indices[i - 2], b = indices[i - 1], c = indices[i];
+			if ( a == b || b == c || a == c ) { continue; } // degenerate
+			if ( i % 2 == 0 ) { triangles.push_back(a); triangles.push_back(b); triangles.push_back(c); }
+			else              { triangles.push_back(b); triangles.push_back(a); triangles.push_back(c); }
+		}
+		indices = triangles;
+	}
+
+	return addMesh(
+		selectComponents(positions, positionComponents, 3, numVertices),
+		uvComponents     != 0 ? selectComponents(uvs,     uvComponents,     2, numVertices) : std::vector<float>(),
+		normalComponents != 0 ? selectComponents(normals, normalComponents, 3, numVertices) : std::vector<float>(),
+		indices);
+}
+
+int InstancedScene::addInstance(int mesh, const glm::mat4& model, const glm::vec4& color, float mixTexture)
+{
+	if ( mesh < 0 || mesh >= (int) m_meshes.size() )
+	{
+		DEBUGLOG_ERROR("InstancedScene: mesh does not exist: ", mesh);
+		return -1;
+	}
+
+	Instance instance;
+	instance.model = model;
+	instance.color = color;
+	instance.material = glm::vec4(mixTexture, 0.0f, 0.0f, 0.0f);
+
+	m_instances.push_back(instance);
+	m_instanceMeshes.push_back(mesh);
+	m_instancesDirty = true;
+
+	return (int) m_instances.size() - 1;
+}
+
+void InstancedScene::setInstance(int instance, const glm::mat4& model, const glm::vec4& color, float mixTexture)
+{
+	m_instances[instance].model = model;
+	m_instances[instance].color = color;
+	m_instances[instance].material.x = mixTexture;
+	m_instanceDataDirty = true;
+}
+
+void InstancedScene::clearInstances()
+{
+	m_instances.clear();
+	m_instanceMeshes.clear();
+	m_instancesDirty = true;
+}
+
+const InstancedScene::Instance& InstancedScene::getInstance(int instance) const
+{
+	return m_instances[instance];
+}
+
+unsigned int InstancedScene::getNumInstances() const
+{
+	return (unsigned int) m_instances.size();
+}
+
+unsigned int InstancedScene::getNumMeshes() const
+{
+	return (unsigned int) m_meshes.size();
+}
+
+unsigned int InstancedScene::getNumDrawCommands() const
+{
+	return m_numCommands;
+}
+
+void InstancedScene::uploadGeometry()
+{
+	m_positions.m_size = (GLuint) m_positionData.size() / 3;
+	m_uvs.m_size       = (GLuint) m_uvData.size() / 2;
+	m_normals.m_size   = (GLuint) m_normalData.size() / 3;
+	m_indices.m_size   = (GLuint) m_indexData.size();
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_positions.m_vboHandle);
+	glBufferData(GL_ARRAY_BUFFER, m_positionData.size() * sizeof(float), m_positionData.empty() ? 0 : &m_positionData[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, m_uvs.m_vboHandle);
+	glBufferData(GL_ARRAY_BUFFER, m_uvData.size() * sizeof(float), m_uvData.empty() ? 0 : &m_uvData[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, m_normals.m_vboHandle);
+	glBufferData(GL_ARRAY_BUFFER, m_normalData.size() * sizeof(float), m_normalData.empty() ? 0 : &m_normalData[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indices.m_vboHandle);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indexData.size() * sizeof(unsigned int), m_indexData.empty() ? 0 : &m_indexData[0], GL_STATIC_DRAW);
+
+	m_geometryDirty = false;
+}
+
+void InstancedScene::uploadInstances()
+{
+	// group instances by mesh: one command per mesh, its instances are consecutive in the instance index buffer
+	std::vector< std::vector<GLuint> > meshInstances( m_meshes.size() );
+	for (unsigned int i = 0; i < m_instances.size(); i++)
+	{
+		meshInstances[ m_instanceMeshes[i] ].push_back(i);
+	}
+
+	std::vector<GLuint> instanceIndices;
+	std::vector<DrawElementsIndirectCommand> commands;
+	for (unsigned int m = 0; m < m_meshes.size(); m++)
+	{
+		if ( meshInstances[m].empty() )
+		{
+			continue;
+		}
+		DrawElementsIndirectCommand command;
+		command.count         = m_meshes[m].indexCount;
+		command.instanceCount = (GLuint) meshInstances[m].size();
+		command.firstIndex    = m_meshes[m].firstIndex;
+		command.baseVertex    = m_meshes[m].baseVertex;
+		command.baseInstance  = (GLuint) instanceIndices.size();
+		commands.push_back(command);
+
+		instanceIndices.insert(instanceIndices.end(), meshInstances[m].begin(), meshInstances[m].end());
+	}
+	m_numCommands = (unsigned int) commands.size();
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceIndexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, instanceIndices.size() * sizeof(GLuint), instanceIndices.empty() ? 0 : &instanceIndices[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.empty() ? 0 : &commands[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_instances.size() * sizeof(Instance), m_instances.empty() ? 0 : &m_instances[0], GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	m_instancesDirty = false;
+	m_instanceDataDirty = false;
+}
+
+void InstancedScene::draw()
+{
+	glBindVertexArray(m_vao);
+
+	if ( m_geometryDirty )
+	{
+		uploadGeometry();
+	}
+	if ( m_instancesDirty )
+	{
+		uploadInstances();
+	}
+	else if ( m_instanceDataDirty && !m_instances.empty() )
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceBuffer);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_instances.size() * sizeof(Instance), &m_instances[0]);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		m_instanceDataDirty = false;
+	}
+
+	if ( m_numCommands != 0 )
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_instanceBuffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0, m_numCommands, 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	glBindVertexArray(0);
+}
@@ -0,0 +1,108 @@
+#ifndef INSTANCEDSCENE_H
+#define INSTANCEDSCENE_H
+
+#include "Rendering/VertexArrayObjects.h"
+
+#include <vector>
+#include <glm/glm.hpp>
+
+/**
+ * @brief batched submission of many objects with few distinct meshes
+ *
+ * The geometry of all meshes is merged into shared vertex and index buffers, the per-instance
+ * transforms and materials are kept contiguously in a shader storage buffer. Instances are grouped
+ * by mesh into one indirect draw command each, so the whole scene is drawn by a single
+ * glMultiDrawElementsIndirect call instead of a uniform update and draw call per object.
+ *
+ * Bindings used by the shaders: SSBO binding 0 (instances), vertex attribute 3 (instance index,
+ * advanced per instance). See GBufferInstanced.vert.
+ */
+class InstancedScene : public Renderable
+{
+public:
+	/** @brief per-instance data, must match Instance in the shaders (std430) */
+	struct Instance
+	{
+		glm::mat4 model;
+		glm::vec4 color;
+		glm::vec4 material; //!< x: mix factor of the texture
+	};
+
+	/** @brief layout defined by glMultiDrawElementsIndirect */
+	struct DrawElementsIndirectCommand
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLuint baseVertex;
+		GLuint baseInstance;
+	};
+
+protected:
+	struct MeshRange
+	{
+		unsigned int firstIndex;
+		unsigned int indexCount;
+		unsigned int baseVertex;
+	};
+
+	std::vector<float> m_positionData;   //!< merged geometry, xyz
+	std::vector<float> m_uvData;         //!< merged geometry, uv
+	std::vector<float> m_normalData;     //!< merged geometry, xyz
+	std::vector<unsigned int> m_indexData; //!< merged triangle lists, relative to the mesh's base vertex
+	std::vector<MeshRange> m_meshes;
+
+	std::vector<Instance> m_instances;
+	std::vector<int> m_instanceMeshes;   //!< mesh of every instance
+
+	GLuint m_instanceIndexBuffer; //!< SSBO index per draw instance, grouped by mesh
+	GLuint m_instanceBuffer;      //!< SSBO of m_instances
+	GLuint m_commandBuffer;       //!< indirect draw commands, one per mesh with instances
+
+	unsigned int m_numCommands;
+
+	bool m_geometryDirty;  //!< meshes were added since the last upload
+	bool m_instancesDirty; //!< instances were added or removed since the last upload
+	bool m_instanceDataDirty; //!< instance data was changed since the last upload
+
+	void uploadGeometry();
+	void uploadInstances();
+
+public:
+	InstancedScene();
+	~InstancedScene();
+
+	/**
+	 * @brief merge a mesh from raw geometry
+	 * @param positions xyz per vertex
+	 * @param uvs uv per vertex, may be empty
+	 * @param normals xyz per vertex, may be empty
+	 * @param indices triangle list; if empty, the vertices are treated as a triangle list
+	 * @return mesh id for addInstance()
+	 */
+	int addMesh(const std::vector<float>& positions, const std::vector<float>& uvs, const std::vector<float>& normals, const std::vector<unsigned int>& indices);
+
+	/**
+	 * @brief merge the geometry of a Renderable, read back from the MeshCache or its vertex array object
+	 *
+	 * Supports GL_TRIANGLES and GL_TRIANGLE_STRIP, indexed or not.
+	 * @return mesh id for addInstance(), -1 if the draw mode is not supported
+	 */
+	int addMesh(Renderable* renderable);
+
+	int addInstance(int mesh, const glm::mat4& model, const glm::vec4& color = glm::vec4(1.0f), float mixTexture = 0.0f); //!< @return instance id
+	void setInstance(int instance, const glm::mat4& model, const glm::vec4& color, float mixTexture = 0.0f);
+	void clearInstances(); //!< removes all instances, keeps the meshes
+
+	const Instance& getInstance(int instance) const;
+	unsigned int getNumInstances() const;
+	unsigned int getNumMeshes() const;
+	unsigned int getNumDrawCommands() const; //!< draw commands issued by the last draw()
+
+	/**
+	 * @brief upload changes, if any, and draw all instances with a single multi draw call
+	 */
+	void draw() override;
+};
+
+#endif
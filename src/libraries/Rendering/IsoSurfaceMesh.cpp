@@ -0,0 +1,120 @@
+#include "IsoSurfaceMesh.h"
+
+#include "Core/DebugLog.h"
+
+IsoSurfaceMesh::IsoSurfaceMesh()
+{
+	m_mode = GL_TRIANGLES;
+	m_vertexCapacity = 0;
+	m_indexCapacity = 0;
+	m_stats.numVertices = 0;
+	m_stats.numTriangles = 0;
+	m_stats.milliseconds = 0.0;
+
+	glGenVertexArrays(1, &m_vao);
+	glBindVertexArray(m_vao);
+
+	glGenBuffers(1, &m_positions.m_vboHandle);
+	glBindBuffer(GL_ARRAY_BUFFER, m_positions.m_vboHandle);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(0);
+
+	glGenBuffers(1, &m_normals.m_vboHandle);
+	glBindBuffer(GL_ARRAY_BUFFER, m_normals.m_vboHandle);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(2);
+
+	glGenBuffers(1, &m_indices.m_vboHandle);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indices.m_vboHandle);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+IsoSurfaceMesh::~IsoSurfaceMesh()
+{
+	glDeleteVertexArrays(1, &m_vao);
+}
+
+void IsoSurfaceMesh::reserve(unsigned int numVertices, unsigned int numIndices)
+{
+	// grow by at least half the capacity, so small iso value changes don't reallocate
+	if ( numVertices > m_vertexCapacity )
+	{
+		m_vertexCapacity = std::max(numVertices, m_vertexCapacity + m_vertexCapacity / 2);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_positions.m_vboHandle);
+		glBufferData(GL_COPY_WRITE_BUFFER, (size_t) m_vertexCapacity * 3 * sizeof(float), 0, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_normals.m_vboHandle);
+		glBufferData(GL_COPY_WRITE_BUFFER, (size_t) m_vertexCapacity * 3 * sizeof(float), 0, GL_DYNAMIC_DRAW);
+	}
+	if ( numIndices > m_indexCapacity )
+	{
+		m_indexCapacity = std::max(numIndices, m_indexCapacity + m_indexCapacity / 2);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_indices.m_vboHandle);
+		glBufferData(GL_COPY_WRITE_BUFFER, (size_t) m_indexCapacity * sizeof(unsigned int), 0, GL_DYNAMIC_DRAW);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+bool IsoSurfaceMesh::extract(const VolumeData<short>& volume, float isoValue, const glm::vec3& proxySize)
+{
+	// GL_COPY_WRITE_BUFFER is used for mapping, since binding GL_ELEMENT_ARRAY_BUFFER would alter the bound VAO
+	std::vector<GLuint> mapped;
+	auto map = [&](GLuint buffer, size_t bytes)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		void* pointer = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if ( pointer ) { mapped.push_back(buffer); }
+		return pointer;
+	};
+
+	bool written = MarchingCubes::extract(volume, isoValue, proxySize, [&](unsigned int numVertices, unsigned int numIndices)
+	{
+		IsoSurfaceBuffers buffers = { 0, 0, 0 };
+		if ( numVertices == 0 || numIndices == 0 )
+		{
+			return buffers;
+		}
+
+		reserve(numVertices, numIndices);
+		buffers.positions = (float*) map( m_positions.m_vboHandle, (size_t) numVertices * 3 * sizeof(float) );
+		buffers.normals   = (float*) map( m_normals.m_vboHandle,   (size_t) numVertices * 3 * sizeof(float) );
+		buffers.indices   = (unsigned int*) map( m_indices.m_vboHandle, (size_t) numIndices * sizeof(unsigned int) );
+		return buffers;
+	}, &m_stats);
+
+	for (unsigned int i = 0; i < mapped.size(); i++)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, mapped[i]);
+		if ( glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_FALSE )
+		{
+			DEBUGLOG->log("IsoSurfaceMesh: buffer contents were lost while mapped");
+			written = false;
+		}
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	if ( !written )
+	{
+		m_stats.numVertices = 0;
+		m_stats.numTriangles = 0;
+	}
+	m_positions.m_size = m_stats.numVertices;
+	m_normals.m_size   = m_stats.numVertices;
+	m_indices.m_size   = m_stats.numTriangles * 3;
+	return written;
+}
+
+const IsoSurfaceStats& IsoSurfaceMesh::getStats() const
+{
+	return m_stats;
+}
+
+void IsoSurfaceMesh::draw()
+{
+	if ( m_indices.m_size == 0 )
+	{
+		return;
+	}
+	Renderable::draw();
+}
@@ -0,0 +1,42 @@
+#ifndef ISOSURFACEMESH_H
+#define ISOSURFACEMESH_H
+
+#include "Rendering/VertexArrayObjects.h"
+
+#include <Processing/MarchingCubes.h>
+
+/**
+ * @brief iso surface of a volume as a Renderable, re-extracted whenever the iso value changes
+ *
+ * Owns its buffers (positions: attribute 0, normals: attribute 2, no uvs) instead of sharing them
+ * through the MeshCache. MarchingCubes writes the mesh directly into the mapped buffers, which are
+ * only reallocated if the surface outgrows them.
+ */
+class IsoSurfaceMesh : public Renderable {
+public:
+	IsoSurfaceMesh();
+	~IsoSurfaceMesh();
+
+	/**
+	 * @brief replace the mesh by the iso surface of volume
+	 *
+	 * @param volume to extract the surface from
+	 * @param isoValue threshold, see MarchingCubes::extract
+	 * @param proxySize half extent of the volume, matching a Volume(proxySize) proxy geometry
+	 * @return whether the surface was extracted; the mesh is empty otherwise
+	 */
+	bool extract(const VolumeData<short>& volume, float isoValue, const glm::vec3& proxySize = glm::vec3(1.0f));
+
+	const IsoSurfaceStats& getStats() const; //!< size and timing of the last extraction
+
+	void draw() override;
+
+private:
+	void reserve(unsigned int numVertices, unsigned int numIndices); //!< grow the buffers if necessary, contents are undefined afterwards
+
+	unsigned int m_vertexCapacity; //!< vertices the buffers can hold
+	unsigned int m_indexCapacity;  //!< indices the buffers can hold
+	IsoSurfaceStats m_stats;
+};
+
+#endif
@@ -0,0 +1,266 @@
+#include "MeshCache.h"
+
+#include <Core/DebugLog.h>
+
+#include <algorithm>
+
+const GLsizeiptr MeshCache::DEFAULT_ARENA_SIZE;
+const GLintptr MeshCache::ALIGNMENT;
+
+MeshCache::MeshCache()
+{
+	m_arenaSize = DEFAULT_ARENA_SIZE;
+}
+
+MeshCache::~MeshCache()
+{
+	for (auto e : m_meshes)
+	{
+		glDeleteVertexArrays(1, &e.second->vao);
+		delete e.second;
+	}
+	for (unsigned int i = 0; i < m_arenas.size(); i++)
+	{
+		glDeleteBuffers(1, &m_arenas[i].buffer);
+	}
+}
+
+bool MeshCache::allocateRange(GLsizeiptr bytes, GLuint& buffer, GLintptr& offset)
+{
+	bytes = ( (bytes + ALIGNMENT - 1) / ALIGNMENT ) * ALIGNMENT;
+
+	// first fit
+	for (unsigned int a = 0; a < m_arenas.size(); a++)
+	{
+		std::vector<Range>& freeRanges = m_arenas[a].freeRanges;
+		for (unsigned int r = 0; r < freeRanges.size(); r++)
+		{
+			if ( freeRanges[r].bytes >= bytes )
+			{
+				buffer = m_arenas[a].buffer;
+				offset = freeRanges[r].offset;
+
+				freeRanges[r].offset += bytes;
+				freeRanges[r].bytes  -= bytes;
+				if ( freeRanges[r].bytes == 0 )
+				{
+					freeRanges.erase(freeRanges.begin() + r);
+				}
+				return true;
+			}
+		}
+	}
+
+	// new arena; vertex arrays keep referring to the old ones, so they are never resized
+	Arena arena;
+	arena.size = std::max(m_arenaSize, bytes);
+	glGenBuffers(1, &arena.buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, arena.buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, arena.size, 0, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	if ( glGetError() == GL_OUT_OF_MEMORY )
+	{
+		DEBUGLOG_ERROR("MeshCache: could not allocate arena, bytes: ", (int) arena.size);
+		glDeleteBuffers(1, &arena.buffer);
+		return false;
+	}
+	DEBUGLOG->log("MeshCache: new arena, MB: ", (float) arena.size / (1024.0f * 1024.0f));
+
+	if ( arena.size > bytes )
+	{
+		Range rest = { bytes, arena.size - bytes };
+		arena.freeRanges.push_back(rest);
+	}
+	m_arenas.push_back(arena);
+
+	buffer = arena.buffer;
+	offset = 0;
+	return true;
+}
+
+void MeshCache::freeRange(GLuint buffer, GLintptr offset, GLsizeiptr bytes)
+{
+	bytes = ( (bytes + ALIGNMENT - 1) / ALIGNMENT ) * ALIGNMENT;
+
+	for (unsigned int a = 0; a < m_arenas.size(); a++)
+	{
+		if ( m_arenas[a].buffer != buffer )
+		{
+			continue;
+		}
+
+		// insert sorted, merge with adjacent free ranges
+		std::vector<Range>& freeRanges = m_arenas[a].freeRanges;
+		unsigned int r = 0;
+		while ( r < freeRanges.size() && freeRanges[r].offset < offset ) { r++; }
+		Range range = { offset, bytes };
+		freeRanges.insert(freeRanges.begin() + r, range);
+
+		if ( r + 1 < freeRanges.size() && freeRanges[r].offset + freeRanges[r].bytes == freeRanges[r + 1].offset )
+		{
+			freeRanges[r].bytes += freeRanges[r + 1].bytes;
+			freeRanges.erase(freeRanges.begin() + r + 1);
+		}
+		if ( r > 0 && freeRanges[r - 1].offset + freeRanges[r - 1].bytes == freeRanges[r].offset )
+		{
+			freeRanges[r - 1].bytes += freeRanges[r].bytes;
+			freeRanges.erase(freeRanges.begin() + r);
+		}
+		return;
+	}
+}
+
+MeshCache::Mesh* MeshCache::acquire(const std::string& key, const std::function<void(MeshData&)>& generate)
+{
+	auto cached = m_meshes.find(key);
+	if ( cached != m_meshes.end() )
+	{
+		cached->second->refCount++;
+		return cached->second;
+	}
+
+	MeshData meshData;
+	generate(meshData);
+
+	Mesh* mesh = new Mesh;
+	mesh->key = key;
+	mesh->numVertices = meshData.getNumVertices();
+	mesh->numIndices = (unsigned int) meshData.indices.size();
+	mesh->positionComponents = meshData.positionComponents;
+	mesh->uvComponents = meshData.uvs.empty() ? 0 : meshData.uvComponents;
+	mesh->normalComponents = meshData.normals.empty() ? 0 : meshData.normalComponents;
+	mesh->refCount = 1;
+
+	// interleave
+	int components = mesh->positionComponents + mesh->uvComponents + mesh->normalComponents;
+	std::vector<float> vertices( (size_t) mesh->numVertices * components );
+	for (unsigned int v = 0; v < mesh->numVertices; v++)
+	{
+		float* vertex = &vertices[ (size_t) v * components ];
+		for (int c = 0; c < mesh->positionComponents; c++) { *vertex++ = meshData.positions[v * mesh->positionComponents + c]; }
+		for (int c = 0; c < mesh->uvComponents; c++)       { *vertex++ = meshData.uvs[v * mesh->uvComponents + c]; }
+		for (int c = 0; c < mesh->normalComponents; c++)   { *vertex++ = meshData.normals[v * mesh->normalComponents + c]; }
+	}
+
+	GLsizeiptr vertexBytes = (GLsizeiptr) vertices.size() * sizeof(float);
+	GLsizeiptr indexBytes  = (GLsizeiptr) meshData.indices.size() * sizeof(unsigned int);
+	mesh->bytes = vertexBytes + indexBytes;
+	if ( !allocateRange(mesh->bytes, mesh->buffer, mesh->vertexOffset) )
+	{
+		delete mesh;
+		return 0;
+	}
+	mesh->indexOffset = mesh->vertexOffset + vertexBytes;
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, mesh->buffer);
+	if ( vertexBytes != 0 ) { glBufferSubData(GL_COPY_WRITE_BUFFER, mesh->vertexOffset, vertexBytes, &vertices[0]); }
+	if ( indexBytes != 0 )  { glBufferSubData(GL_COPY_WRITE_BUFFER, mesh->indexOffset, indexBytes, &meshData.indices[0]); }
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	// attribute pointers into the range, so draw calls start at vertex 0
+	GLsizei stride = components * sizeof(float);
+	glGenVertexArrays(1, &mesh->vao);
+	glBindVertexArray(mesh->vao);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh->buffer);
+	GLintptr attributeOffset = mesh->vertexOffset;
+	glVertexAttribPointer(0, mesh->positionComponents, GL_FLOAT, GL_FALSE, stride, (void*) attributeOffset);
+	glEnableVertexAttribArray(0);
+	attributeOffset += mesh->positionComponents * sizeof(float);
+	if ( mesh->uvComponents != 0 )
+	{
+		glVertexAttribPointer(1, mesh->uvComponents, GL_FLOAT, GL_FALSE, stride, (void*) attributeOffset);
+		glEnableVertexAttribArray(1);
+		attributeOffset += mesh->uvComponents * sizeof(float);
+	}
+	if ( mesh->normalComponents != 0 )
+	{
+		glVertexAttribPointer(2, mesh->normalComponents, GL_FLOAT, GL_FALSE, stride, (void*) attributeOffset);
+		glEnableVertexAttribArray(2);
+	}
+	if ( mesh->numIndices != 0 )
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->buffer);
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_meshes[key] = mesh;
+	return mesh;
+}
+
+void MeshCache::release(Mesh* mesh)
+{
+	if ( mesh == 0 )
+	{
+		return;
+	}
+	mesh->refCount--;
+	if ( mesh->refCount > 0 )
+	{
+		return;
+	}
+
+	freeRange(mesh->buffer, mesh->vertexOffset, mesh->bytes);
+	glDeleteVertexArrays(1, &mesh->vao);
+	m_meshes.erase(mesh->key);
+	delete mesh;
+}
+
+void MeshCache::readMeshData(const Mesh* mesh, MeshData& meshData)
+{
+	int components = mesh->positionComponents + mesh->uvComponents + mesh->normalComponents;
+	std::vector<float> vertices( (size_t) mesh->numVertices * components );
+
+	meshData.positionComponents = mesh->positionComponents;
+	meshData.uvComponents = mesh->uvComponents;
+	meshData.normalComponents = mesh->normalComponents;
+	meshData.positions.resize( (size_t) mesh->numVertices * mesh->positionComponents );
+	meshData.uvs.resize( (size_t) mesh->numVertices * mesh->uvComponents );
+	meshData.normals.resize( (size_t) mesh->numVertices * mesh->normalComponents );
+	meshData.indices.resize( mesh->numIndices );
+
+	glBindBuffer(GL_COPY_READ_BUFFER, mesh->buffer);
+	if ( !vertices.empty() )
+	{
+		glGetBufferSubData(GL_COPY_READ_BUFFER, mesh->vertexOffset, vertices.size() * sizeof(float), &vertices[0]);
+	}
+	if ( !meshData.indices.empty() )
+	{
+		glGetBufferSubData(GL_COPY_READ_BUFFER, mesh->indexOffset, meshData.indices.size() * sizeof(unsigned int), &meshData.indices[0]);
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	// deinterleave
+	for (unsigned int v = 0; v < mesh->numVertices; v++)
+	{
+		const float* vertex = &vertices[ (size_t) v * components ];
+		for (int c = 0; c < mesh->positionComponents; c++) { meshData.positions[v * mesh->positionComponents + c] = *vertex++; }
+		for (int c = 0; c < mesh->uvComponents; c++)       { meshData.uvs[v * mesh->uvComponents + c] = *vertex++; }
+		for (int c = 0; c < mesh->normalComponents; c++)   { meshData.normals[v * mesh->normalComponents + c] = *vertex++; }
+	}
+}
+
+unsigned int MeshCache::getNumMeshes() const
+{
+	return (unsigned int) m_meshes.size();
+}
+
+size_t MeshCache::getArenaBytes() const
+{
+	size_t bytes = 0;
+	for (unsigned int a = 0; a < m_arenas.size(); a++)
+	{
+		bytes += m_arenas[a].size;
+	}
+	return bytes;
+}
+
+size_t MeshCache::getUsedBytes() const
+{
+	size_t bytes = 0;
+	for (auto e : m_meshes)
+	{
+		bytes += e.second->bytes;
+	}
+	return bytes;
+}
@@ -0,0 +1,118 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <GL/glew.h>
+
+#include <map>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "Core/Singleton.h"
+
+#define MESHCACHE MeshCache::getInstance()
+
+/**
+ * @brief geometry of a mesh on the CPU, one array per attribute
+ */
+struct MeshData
+{
+	std::vector<float> positions;
+	std::vector<float> uvs;
+	std::vector<float> normals;
+	std::vector<unsigned int> indices; //!< may be empty for non-indexed meshes
+
+	int positionComponents; //!< floats per vertex in positions
+	int uvComponents;       //!< floats per vertex in uvs, 0 if there are none
+	int normalComponents;   //!< floats per vertex in normals, 0 if there are none
+
+	MeshData() : positionComponents(3), uvComponents(2), normalComponents(3) {}
+	unsigned int getNumVertices() const { return positionComponents ? (unsigned int) positions.size() / positionComponents : 0; }
+};
+
+/**
+ * @brief shared, interleaved storage of mesh geometry
+ *
+ * Vertices are interleaved (position, uv, normal) and sub-allocated together with the indices
+ * from a few large arena buffers, instead of one buffer object per attribute and mesh.
+ * Meshes are keyed by their generator parameters, e.g. "Sphere(20,40,0.25)": renderables with
+ * identical parameters share the same range and vertex array object, the geometry is only
+ * generated on the first request. Meshes are reference counted and their ranges reused once released.
+ *
+ * Vertex attributes: 0 position, 1 uv, 2 normal.
+ */
+class MeshCache : public Singleton<MeshCache>
+{
+	friend class Singleton< MeshCache >;
+public:
+	struct Mesh
+	{
+		std::string key;
+		GLuint vao;
+		GLuint buffer;             //!< arena buffer holding vertices and indices
+		GLintptr vertexOffset;     //!< in bytes
+		GLintptr indexOffset;      //!< in bytes
+		GLsizeiptr bytes;          //!< size of the allocated range, vertices and indices
+		unsigned int numVertices;
+		unsigned int numIndices;
+		int positionComponents;
+		int uvComponents;
+		int normalComponents;
+		int refCount;
+	};
+
+protected:
+	struct Range
+	{
+		GLintptr offset;
+		GLsizeiptr bytes;
+	};
+
+	struct Arena
+	{
+		GLuint buffer;
+		GLsizeiptr size;
+		std::vector<Range> freeRanges; //!< sorted by offset
+	};
+
+	std::vector<Arena> m_arenas;
+	std::map<std::string, Mesh*> m_meshes;
+
+	GLsizeiptr m_arenaSize; //!< size of new arenas, larger meshes get an arena of their own
+
+	MeshCache();
+
+	bool allocateRange(GLsizeiptr bytes, GLuint& buffer, GLintptr& offset);
+	void freeRange(GLuint buffer, GLintptr offset, GLsizeiptr bytes);
+
+public:
+	static const GLsizeiptr DEFAULT_ARENA_SIZE = 16 * 1024 * 1024;
+	static const GLintptr ALIGNMENT = 16;
+
+	~MeshCache();
+
+	/**
+	 * @brief get a mesh by key, generating and uploading it if it is not cached yet
+	 *
+	 * @param key unique description of the generator and its parameters
+	 * @param generate fills the geometry, only called on a cache miss
+	 * @return the shared mesh, its reference count is incremented
+	 */
+	Mesh* acquire(const std::string& key, const std::function<void(MeshData&)>& generate);
+
+	/**
+	 * @brief decrement the reference count, free the mesh's range and vertex array once unused
+	 */
+	void release(Mesh* mesh);
+
+	/**
+	 * @brief read back the geometry of a mesh from the GPU
+	 */
+	void readMeshData(const Mesh* mesh, MeshData& meshData);
+
+	unsigned int getNumMeshes() const;
+	size_t getArenaBytes() const; //!< GPU memory of all arenas
+	size_t getUsedBytes() const;  //!< bytes allocated by meshes
+};
+
+#endif
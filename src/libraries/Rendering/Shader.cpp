@@ -20,6 +20,9 @@ Shader::Shader(const GLuint &type)
         case GL_GEOMETRY_SHADER:
             m_typeString = "Geometry";
             break;
+        case GL_COMPUTE_SHADER:
+            m_typeString = "Compute";
+            break;
     }
         
     // Create the vertex shader id / handle
@@ -44,29 +47,76 @@ void Shader::loadFromString(const std::string &sourceString)
     glShaderSource(m_id, 1, &sourceChars, NULL);
 }
     
-void Shader::loadFromFile(const std::string &filename)
+/**
+* @brief Reads a shader file and expands its #include "file" lines, relative to the including file
+*
+* #line directives keep compiler messages pointing at the right lines: the source string
+* number identifies the file (0 for the top level file, in order of inclusion after that).
+*/
+static bool readShaderSource(const std::string &filename, std::string &source, int fileIndex, int &numFiles, int depth)
 {
-    std::ifstream file;
-        
-    file.open( filename.c_str() );
-        
+    std::ifstream file( filename.c_str() );
     if (!file.good() )
     {
-		DEBUGLOG->log("Failed to open file: " + filename);
-        exit(-1);
+        DEBUGLOG_ERROR("Failed to open file: " + filename);
+        return false;
     }
-    
-    // Create a string stream
+    if (depth > 16)
+    {
+        DEBUGLOG_ERROR("Shader includes nested too deeply: " + filename);
+        return false;
+    }
+
+    std::string directory;
+    size_t slash = filename.find_last_of("/\\");
+    if (slash != std::string::npos)
+    {
+        directory = filename.substr(0, slash + 1);
+    }
+
     std::stringstream stream;
-    
-    // Dump the contents of the file into it
-    stream << file.rdbuf();
+    std::string line;
+    int lineNumber = 0;
+    while ( std::getline(file, line) )
+    {
+        lineNumber++;
+        size_t begin = line.find_first_not_of(" \t");
+        if (begin == std::string::npos || line.compare(begin, 8, "#include") != 0)
+        {
+            stream << line << "\n";
+            continue;
+        }
 
-    // Close the file
-    file.close();
-        
-    // Convert the StringStream into a string
-    m_source = stream.str();
+        size_t open = line.find('"', begin);
+        size_t close = (open == std::string::npos) ? std::string::npos : line.find('"', open + 1);
+        if (close == std::string::npos)
+        {
+            DEBUGLOG_ERROR("Malformed shader include in " + filename + ": " + line);
+            return false;
+        }
+
+        int includeIndex = ++numFiles;
+        std::string included;
+        if ( !readShaderSource(directory + line.substr(open + 1, close - open - 1), included, includeIndex, numFiles, depth + 1) )
+        {
+            return false;
+        }
+        stream << "#line 1 " << includeIndex << "\n" << included;
+        stream << "#line " << (lineNumber + 1) << " " << fileIndex << "\n";
+    }
+
+    source = stream.str();
+    return true;
+}
+
+void Shader::loadFromFile(const std::string &filename)
+{
+    // Read the file, including the files it refers to
+    int numFiles = 0;
+    if ( !readShaderSource(filename, m_source, 0, numFiles, 0) )
+    {
+        exit(-1);
+    }
     
     // Get the source string as a pointer to an array of characters
     const char *sourceChars = m_source.c_str();
@@ -93,7 +143,7 @@ void Shader::compile()
         GLchar *strInfoLog = new GLchar[infoLogLength + 1];
         glGetShaderInfoLog(m_id, infoLogLength, NULL, strInfoLog);
         
-		DEBUGLOG->log(m_typeString + " shader compilation failed: " + strInfoLog );
+		DEBUGLOG_ERROR(m_typeString + " shader compilation failed: " + strInfoLog );
         delete[] strInfoLog;
         glfwTerminate();
     }
@@ -12,7 +12,7 @@ public:
     /**
     * @brief Constructor
     * 
-    * @param type type of the shader (GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER)
+    * @param type type of the shader (GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER, GL_COMPUTE_SHADER)
     */
     Shader(const GLuint &type);
 
@@ -23,14 +23,17 @@ public:
     ~Shader();
 
     /**
-    * @brief Loads the shader contents from a file
+    * @brief Loads the shader contents from a string
     * 
     * @param sourceString string of the shader source 
     */
     void loadFromString(const std::string &sourceString);
 
     /**
-    * @brief Loads the the shader contents from a string
+    * @brief Loads the the shader contents from a file
+    * 
+    * Lines of the form #include "file" are replaced by the contents of file, relative to the
+    * directory of the including file, e.g. to share functions between shaders.
     * 
     * @param filename filename of the shader
     */
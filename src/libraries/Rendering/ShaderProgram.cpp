@@ -1,16 +1,20 @@
 #include "ShaderProgram.h"
 
 #include "Core/DebugLog.h"
+#include "Core/Timeline.h"
 
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <glm/gtc/type_ptr.hpp>
 
+Timeline* ShaderProgram::s_timeline = 0;
+
 ShaderProgram::ShaderProgram(std::string vertexshader, std::string fragmentshader) 
 {
     // Initially, we have zero shaders attached to the program
 	m_shaderCount = 0;
+	m_isComputeProgram = false;
 
 	// Generate a unique Id / handle for the shader program
 	// Note: We MUST have a valid rendering context before generating
@@ -34,6 +38,7 @@ ShaderProgram::ShaderProgram(std::string vertexshader, std::string fragmentshade
 	attachShader(fragmentShader);
 	link();
 	readUniforms();
+	setTimelineName(vertexshader + "+" + fragmentshader);
 }
 
 
@@ -42,6 +47,7 @@ ShaderProgram::ShaderProgram(std::string vertexshader, std::string fragmentshade
     
     // Initially, we have zero shaders attached to the program
 	m_shaderCount = 0;
+	m_isComputeProgram = false;
 
 	// Generate a unique Id / handle for the shader program
 	// Note: We MUST have a valid rendering context before generating
@@ -69,6 +75,26 @@ ShaderProgram::ShaderProgram(std::string vertexshader, std::string fragmentshade
 	attachShader(geometryShader);
     link();
 	readUniforms();
+	setTimelineName(vertexshader + "+" + fragmentshader + "+" + geometryshader);
+}
+
+ShaderProgram::ShaderProgram(std::string computeshader) 
+{
+	m_shaderCount = 0;
+	m_isComputeProgram = true;
+
+	m_shaderProgramHandle = glCreateProgram();
+
+	// Set up compute shader
+	Shader computeShader(GL_COMPUTE_SHADER);
+	computeShader.loadFromFile(SHADERS_PATH + computeshader);
+	computeShader.compile();
+
+	// Set up shader program
+	attachShader(computeShader);
+	link();
+	readUniforms();
+	setTimelineName(computeshader);
 }
 
 ShaderProgram::~ShaderProgram()
@@ -78,6 +104,40 @@ ShaderProgram::~ShaderProgram()
 	glDeleteProgram(m_shaderProgramHandle);
 }
 
+void ShaderProgram::setTimelineName(const std::string& name)
+{
+	// programs built from the same files are told apart by their order of creation
+	static std::map<std::string, int> s_numPrograms;
+	int number = s_numPrograms[name]++;
+	m_timelineName = (number == 0) ? name : name + "#" + std::to_string(number);
+	m_timelineKeysOf = 0;
+}
+
+int ShaderProgram::timelineKey(const std::string& name)
+{
+	if ( m_timelineKeysOf != s_timeline )
+	{
+		m_timelineKeys.clear();
+		m_timelineKeysOf = s_timeline;
+	}
+	auto key = m_timelineKeys.find(name);
+	if ( key == m_timelineKeys.end() )
+	{
+		key = m_timelineKeys.insert( std::make_pair(name, s_timeline->getKey(m_timelineName + "/" + name)) ).first;
+	}
+	return key->second;
+}
+
+void ShaderProgram::track(const std::string& name, float* values, int count)
+{
+	if ( s_timeline && s_timeline->isActive() ) { s_timeline->track(timelineKey(name), values, count); }
+}
+
+void ShaderProgram::track(const std::string& name, int* values, int count)
+{
+	if ( s_timeline && s_timeline->isActive() ) { s_timeline->track(timelineKey(name), values, count); }
+}
+
 GLint ShaderProgram::getShaderProgramHandle()
 {
 	return m_shaderProgramHandle;
@@ -136,7 +196,7 @@ void ShaderProgram::readOutputs(Shader& fragmentShader)
 	DEBUGLOG->log("Shader outputs: ", m_bufferMap.size()); DEBUGLOG->indent();
 	for (auto entry : m_bufferMap)
 	{
-		DEBUGLOG->log(std::to_string(entry.second) +": " + entry.first);
+		DEBUGLOG_VERBOSE(std::to_string(entry.second) +": " + entry.first);
 	} 
 	DEBUGLOG->outdent();
 
@@ -160,7 +220,7 @@ void ShaderProgram::readUniforms()
 		uniformName[nameLength] = 0;
 		//add uniform variable to map
 		m_uniformMap[uniformName] = glGetUniformLocation(getShaderProgramHandle(), uniformName);
-		DEBUGLOG->log(std::to_string(i) +  " : " + uniformName);
+		DEBUGLOG_VERBOSE(std::to_string(i) +  " : " + uniformName);
 	}
 	DEBUGLOG->outdent();
 }
@@ -177,8 +237,8 @@ void ShaderProgram::attachShader(Shader shader)
 
 void ShaderProgram::link()
 {
-	// If we have at least two shaders (like a vertex shader and a fragment shader)...
-	if (m_shaderCount >= 2)
+	// If we have at least two shaders (like a vertex shader and a fragment shader) or a compute shader...
+	if (m_shaderCount >= 2 || (m_isComputeProgram && m_shaderCount == 1))
 	{
 		// Perform the linking process
 		glLinkProgram(m_shaderProgramHandle);
@@ -187,7 +247,7 @@ void ShaderProgram::link()
 		glGetProgramiv(m_shaderProgramHandle, GL_LINK_STATUS, &linkStatus);
 		if (linkStatus == GL_FALSE)
 		{
-			DEBUGLOG->log("Shader program linking failed.");
+			DEBUGLOG_ERROR("Shader program linking failed.");
 			glfwTerminate();
 		}
 		else
@@ -197,7 +257,7 @@ void ShaderProgram::link()
 	}
 	else
 	{
-		DEBUGLOG->log("Can't link shaders - you need at least 2, but attached shader count is only: " + std::to_string(m_shaderCount));
+		DEBUGLOG_ERROR("Can't link shaders - you need at least 2, but attached shader count is only: " + std::to_string(m_shaderCount));
 		glfwTerminate();
 	}
 }
@@ -208,11 +268,11 @@ int ShaderProgram::addUniform(const std::string &uniformName)
 	// Check to ensure that the shader contains a uniform with this name
 	if (m_uniformMap[uniformName] == -1)
 	{
-		DEBUGLOG->log("Could not add uniform: " + uniformName + " - location returned -1!");
+		DEBUGLOG_WARNING("Could not add uniform: " + uniformName + " - location returned -1!");
 	}
 	else
 	{
-		DEBUGLOG->log("Uniform " + uniformName + " bound to location: " + std::to_string(m_uniformMap[uniformName]));
+		DEBUGLOG_VERBOSE("Uniform " + uniformName + " bound to location: " + std::to_string(m_uniformMap[uniformName]));
 	}
 	
 	return m_uniformMap[uniformName];
@@ -221,7 +281,7 @@ int ShaderProgram::addUniform(const std::string &uniformName)
 int ShaderProgram::addBuffer(const std::string &bufferName)
 {
 	m_bufferMap[bufferName] = static_cast<int>(m_bufferMap.size());
-	DEBUGLOG->log("ADD BUFFER: " + bufferName + " " + std::to_string(m_bufferMap[bufferName]));
+	DEBUGLOG_VERBOSE("ADD BUFFER: " + bufferName + " " + std::to_string(m_bufferMap[bufferName]));
 	return m_bufferMap[bufferName];
 }
 
@@ -246,7 +306,7 @@ GLuint ShaderProgram::uniform(const std::string &uniform)
 	}
 	else
 	{
-		DEBUGLOG->log("Could not find uniform in shader program: " + uniform);
+		DEBUGLOG_VERBOSE("Could not find uniform in shader program: " + uniform); // called per update(), e.g. for uniforms optimized away
 		return 0;
 	}
 }
@@ -267,7 +327,7 @@ GLuint ShaderProgram::buffer(const std::string &buffer)
 	}
 	else
 	{
-		DEBUGLOG->log("Could not find buffer in shader program: " + buffer);
+		DEBUGLOG_VERBOSE("Could not find buffer in shader program: " + buffer);
 		return 0;
 	}
 }
@@ -288,20 +348,23 @@ GLuint ShaderProgram::texture(const std::string &texture)
 	}
 	else
 	{
-		DEBUGLOG->log("Could not find texture in shader program: " +texture);
+		DEBUGLOG_VERBOSE("Could not find texture in shader program: " +texture);
 		return 0;
 	}
 }
 
 ShaderProgram* ShaderProgram::update(std::string name, bool value) 
 {
+	int word = value ? 1 : 0;
+	track(name, &word, 1);
 	glUseProgram(m_shaderProgramHandle);
-	glUniform1i(uniform(name), value);
+	glUniform1i(uniform(name), word);
 	return this;
 }
 
 ShaderProgram* ShaderProgram::update(std::string name, int value) 
 {
+	track(name, &value, 1);
 	glUseProgram(m_shaderProgramHandle);
 	glUniform1i(uniform(name), value);
 	return this;
@@ -309,6 +372,7 @@ ShaderProgram* ShaderProgram::update(std::string name, int value)
 
 ShaderProgram* ShaderProgram::update(std::string name, float value) 
 {
+	track(name, &value, 1);
 	glUseProgram(m_shaderProgramHandle);
 	glUniform1f(uniform(name), value);
 
@@ -317,71 +381,91 @@ ShaderProgram* ShaderProgram::update(std::string name, float value)
 
 ShaderProgram* ShaderProgram::update(std::string name, double value) 
 {
+	float single = (float) value;
+	track(name, &single, 1);
 	glUseProgram(m_shaderProgramHandle);
-	glUniform1f(uniform(name), value);
+	glUniform1f(uniform(name), single);
 	return this;
 }
 
 ShaderProgram* ShaderProgram::update(std::string name, const glm::ivec2& vector) 
 {
+	glm::ivec2 values = vector;
+	track(name, glm::value_ptr(values), 2);
 	glUseProgram(m_shaderProgramHandle);
-	glUniform2iv(uniform(name), 1, glm::value_ptr(vector));
+	glUniform2iv(uniform(name), 1, glm::value_ptr(values));
 	return this;
 }
 
 ShaderProgram* ShaderProgram::update(std::string name, const glm::ivec3& vector) 
 {
+	glm::ivec3 values = vector;
+	track(name, glm::value_ptr(values), 3);
 	glUseProgram(m_shaderProgramHandle);
-	glUniform3iv(uniform(name), 1, glm::value_ptr(vector));
+	glUniform3iv(uniform(name), 1, glm::value_ptr(values));
 	return this;
 }
 
 ShaderProgram* ShaderProgram::update(std::string name,const glm::ivec4& vector) 
 {
+	glm::ivec4 values = vector;
+	track(name, glm::value_ptr(values), 4);
 	glUseProgram(m_shaderProgramHandle);
-	glUniform4iv(uniform(name), 1, glm::value_ptr(vector));
+	glUniform4iv(uniform(name), 1, glm::value_ptr(values));
 	return this;
 }
 
 ShaderProgram* ShaderProgram::update(std::string name, const glm::vec2& vector) 
 {
+	glm::vec2 values = vector;
+	track(name, glm::value_ptr(values), 2);
 	glUseProgram(m_shaderProgramHandle);
-	glUniform2fv(uniform(name), 1, glm::value_ptr(vector));
+	glUniform2fv(uniform(name), 1, glm::value_ptr(values));
 	return this;
 }
 
 ShaderProgram* ShaderProgram::update(std::string name, const glm::vec3& vector) 
 {
+	glm::vec3 values = vector;
+	track(name, glm::value_ptr(values), 3);
 	glUseProgram(m_shaderProgramHandle);
-	glUniform3fv(uniform(name), 1, glm::value_ptr(vector));
+	glUniform3fv(uniform(name), 1, glm::value_ptr(values));
 	return this;
 }
 
 ShaderProgram* ShaderProgram::update(std::string name, const glm::vec4& vector) 
 {
+	glm::vec4 values = vector;
+	track(name, glm::value_ptr(values), 4);
 	glUseProgram(m_shaderProgramHandle);
-	glUniform4fv(uniform(name), 1, glm::value_ptr(vector));
+	glUniform4fv(uniform(name), 1, glm::value_ptr(values));
 	return this;
 }
 
 ShaderProgram* ShaderProgram::update(std::string name, const glm::mat2& matrix) 
 {
+	glm::mat2 values = matrix;
+	track(name, glm::value_ptr(values), 4);
 	glUseProgram(m_shaderProgramHandle);
-	glUniformMatrix2fv(uniform(name), 1, GL_FALSE, glm::value_ptr(matrix));
+	glUniformMatrix2fv(uniform(name), 1, GL_FALSE, glm::value_ptr(values));
 	return this;
 }
 
 ShaderProgram* ShaderProgram::update(std::string name, const glm::mat3& matrix) 
 {
+	glm::mat3 values = matrix;
+	track(name, glm::value_ptr(values), 9);
 	glUseProgram(m_shaderProgramHandle);
-	glUniformMatrix3fv(uniform(name), 1, GL_FALSE, glm::value_ptr(matrix));
+	glUniformMatrix3fv(uniform(name), 1, GL_FALSE, glm::value_ptr(values));
 	return this;
 }
 
 ShaderProgram* ShaderProgram::update(std::string name, const glm::mat4& matrix) 
 {
+	glm::mat4 values = matrix;
+	track(name, glm::value_ptr(values), 16);
 	glUseProgram(m_shaderProgramHandle);
-	glUniformMatrix4fv(uniform(name), 1, GL_FALSE, glm::value_ptr(matrix));
+	glUniformMatrix4fv(uniform(name), 1, GL_FALSE, glm::value_ptr(values));
 	return this;
 }
 
@@ -428,3 +512,8 @@ void ShaderProgram::disable()
 	glUseProgram(0);
 }
 
+void ShaderProgram::dispatch(GLuint numGroupsX, GLuint numGroupsY, GLuint numGroupsZ)
+{
+	use();
+	glDispatchCompute(numGroupsX, numGroupsY, numGroupsZ);
+}
@@ -8,10 +8,17 @@
 #include <string>
 #include <glm/glm.hpp>
 
+class Timeline;
+
 class ShaderProgram
 {
 
 public:
+	/**
+	 * @brief if set, every update() of a single value is tracked by the timeline: recorded, or replaced by the recorded value
+	 * @details Parameters are named <shader files>/<uniform>, see Timeline.
+	 */
+	static Timeline* s_timeline;
 
 	/**
 	 * @brief Constructor
@@ -32,6 +39,14 @@ public:
 	 */
 	ShaderProgram(std::string vertexshader, std::string fragmentshader, std::string geometryshader);
 
+	/**
+	 * @brief Constructor of a compute shader program
+	 * 
+	 * @param computeshader path to the computeshader
+	 * 
+	 */
+	ShaderProgram(std::string computeshader);
+
 	/**
 	 * @brief Destructor
 	 * 
@@ -233,6 +248,17 @@ public:
 	 */
 	void disable();
 
+	/**
+	 * @brief Method to execute a compute shader program
+	 * @details Textures added by addTexture are bound like in use(). Memory barriers are left to the caller.
+	 * 
+	 * @param numGroupsX amount of work groups in x direction
+	 * @param numGroupsY amount of work groups in y direction
+	 * @param numGroupsZ amount of work groups in z direction
+	 * 
+	 */
+	void dispatch(GLuint numGroupsX, GLuint numGroupsY = 1, GLuint numGroupsZ = 1);
+
 
 	inline std::map<std::string,int>* getUniformMap()	{return &m_uniformMap;} //!< returns the Uniformmap
 	inline std::map<std::string,int>* getBufferMap()	{return &m_bufferMap;} //!< returns the Buffermap
@@ -298,6 +324,9 @@ private:
 	// Number of attached shader
 	int m_shaderCount;
 
+	// true if the program consists of a compute shader
+	bool m_isComputeProgram;
+
 	// Map of uniforms and their binding locations
 	std::map<std::string,int> m_uniformMap;
 
@@ -307,6 +336,40 @@ private:
 	// Map of textures and their binding locations
 	std::map<std::string,int> m_textureMap;
 
+	// Prefix of the timeline parameters, unique among all shader programs
+	std::string m_timelineName;
+
+	// Keys of the uniforms in m_timelineKeysOf
+	std::map<std::string,int> m_timelineKeys;
+	Timeline* m_timelineKeysOf;
+
+	/**
+	 * @brief Method to set a unique m_timelineName
+	 * 
+	 * @param name shader file names
+	 * 
+	 */
+	void setTimelineName(const std::string& name);
+
+	/**
+	 * @brief Method to return the key of a uniform in s_timeline
+	 * 
+	 * @param name name of the uniform
+	 * 
+	 */
+	int timelineKey(const std::string& name);
+
+	/**
+	 * @brief Method to record or replay a uniform value by s_timeline
+	 * 
+	 * @param name name of the uniform
+	 * @param values to record, overwritten while replaying
+	 * @param count number of values
+	 * 
+	 */
+	void track(const std::string& name, float* values, int count);
+	void track(const std::string& name, int* values, int count);
+
 };
 
 #endif // SHADER_PROGRAM_H
\ No newline at end of file
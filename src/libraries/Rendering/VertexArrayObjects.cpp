@@ -2,22 +2,55 @@
 
 #include "Core/DebugLog.h"
 
+#include <string>
+
 Renderable::Renderable()
 {
+    m_vao = 0;
+    m_mode = GL_TRIANGLES;
+    m_mesh = 0;
+    m_indices.m_vboHandle = 0;   m_indices.m_size = 0;
+    m_positions.m_vboHandle = 0; m_positions.m_size = 0;
+    m_uvs.m_vboHandle = 0;       m_uvs.m_size = 0;
+    m_normals.m_vboHandle = 0;   m_normals.m_size = 0;
 }
 
 Renderable::~Renderable()
 {
+    if ( m_mesh )
+    {
+        MESHCACHE->release(m_mesh);
+        return;
+    }
+
     std::vector<GLuint> buffers;
-    buffers.push_back(m_indices.m_vboHandle);
-    buffers.push_back(m_positions.m_vboHandle);
-    buffers.push_back(m_normals.m_vboHandle);
-    buffers.push_back(m_uvs.m_vboHandle);
+    if (m_indices.m_vboHandle)   { buffers.push_back(m_indices.m_vboHandle); }
+    if (m_positions.m_vboHandle) { buffers.push_back(m_positions.m_vboHandle); }
+    if (m_normals.m_vboHandle)   { buffers.push_back(m_normals.m_vboHandle); }
+    if (m_uvs.m_vboHandle)       { buffers.push_back(m_uvs.m_vboHandle); }
 
-    glDeleteBuffersARB(buffers.size(), &buffers[0]);
+    if ( !buffers.empty() )
+    {
+        glDeleteBuffers(buffers.size(), &buffers[0]);
+    }
+}
+
+void Renderable::setMesh(MeshCache::Mesh* mesh)
+{
+    m_mesh = mesh;
+    m_vao = mesh->vao;
+    m_positions.m_size = mesh->numVertices;
+    m_uvs.m_size       = mesh->uvComponents     ? mesh->numVertices : 0;
+    m_normals.m_size   = mesh->normalComponents ? mesh->numVertices : 0;
+    m_indices.m_size   = mesh->numIndices;
+}
+
+const void* Renderable::getIndexPointer() const
+{
+    return m_mesh ? (const void*) m_mesh->indexOffset : 0;
 }
 
-GLuint Renderable::createVbo(std::vector<float> content, GLuint dimensions, GLuint vertexAttributePointer)
+GLuint Renderable::createVbo(const std::vector<float>& content, GLuint dimensions, GLuint vertexAttributePointer)
 {
 
     GLuint vbo = 0;
@@ -37,11 +70,11 @@ GLuint Renderable::createVbo(std::vector<float> content, GLuint dimensions, GLui
 void Renderable::draw()
 {
     bind();
-    glDrawElements(m_mode, m_indices.m_size, GL_UNSIGNED_INT, 0);
+    glDrawElements(m_mode, m_indices.m_size, GL_UNSIGNED_INT, getIndexPointer());
     unbind();
 }
 
-GLuint Renderable::createIndexVbo(std::vector<unsigned int> content, GLuint vertexAttributePointer) 
+GLuint Renderable::createIndexVbo(const std::vector<unsigned int>& content, GLuint vertexAttributePointer) 
 {
     
 	GLuint vbo = 0;
@@ -82,17 +115,9 @@ void Volume::generateBuffers(float size_x, float size_y, float size_z)
 {
 	m_mode = GL_TRIANGLES;
 
-    glGenVertexArrays(1, &m_vao);
-    glBindVertexArray(m_vao);
-
-    GLuint vertexBufferHandles[3];
-    glGenBuffers(3, vertexBufferHandles);
-
-	m_positions.m_vboHandle = vertexBufferHandles[0];
-	m_uvs.m_vboHandle = vertexBufferHandles[1];
-	m_normals.m_vboHandle = vertexBufferHandles[2];
-
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferHandles[0]);
+    std::string key = "Volume(" + std::to_string(size_x) + "," + std::to_string(size_y) + "," + std::to_string(size_z) + ")";
+    setMesh( MESHCACHE->acquire(key, [&](MeshData& meshData)
+    {
     float positions[] = {
                 // Front Face
                  size_x, size_y,size_z,
@@ -143,10 +168,8 @@ void Volume::generateBuffers(float size_x, float size_y, float size_z)
                   -size_x,size_y,-size_z,
 		         size_x,size_y,-size_z,
     };
-    glBufferData(GL_ARRAY_BUFFER, sizeof(positions), positions, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(0);
-    m_positions.m_size = sizeof(positions);
+    meshData.positions.assign(positions, positions + sizeof(positions) / sizeof(float));
+    meshData.positionComponents = 3;
 
     GLfloat uvCoordinates[] = {
         // Front face
@@ -198,11 +221,8 @@ void Volume::generateBuffers(float size_x, float size_y, float size_z)
         0,1,1, 
         1,1,1 
     };
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferHandles[1]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(uvCoordinates), uvCoordinates, GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(1);
-    m_uvs.m_size = sizeof(uvCoordinates);
+    meshData.uvs.assign(uvCoordinates, uvCoordinates + sizeof(uvCoordinates) / sizeof(float));
+    meshData.uvComponents = 3; // uvw texture coordinates of the volume
 
 	GLfloat normals[] = {
         // Front face
@@ -255,11 +275,9 @@ void Volume::generateBuffers(float size_x, float size_y, float size_z)
 		0.0f, 1.0f, 0.0f, 
 		0.0f, 1.0f, 0.0f, 
     };
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferHandles[2]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(normals), normals, GL_STATIC_DRAW);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(2);
-    m_normals.m_size = sizeof(normals);
+    meshData.normals.assign(normals, normals + sizeof(normals) / sizeof(float));
+    meshData.normalComponents = 3;
+    }));
 }
 
 Volume::Volume(float size)
@@ -274,12 +292,7 @@ Volume::Volume(float size_x, float size_y, float size_z)
 
 Volume::~Volume()
 {
-	std::vector<GLuint> buffers;
-	buffers.push_back(m_positions.m_vboHandle);
-	buffers.push_back(m_uvs.m_vboHandle);
-	buffers.push_back(m_normals.m_vboHandle);
-
-	glDeleteBuffersARB(3, &buffers[0]);
+	// shared geometry is released by ~Renderable()
 }
 
 void Volume::draw()
@@ -290,45 +303,29 @@ void Volume::draw()
 
 Quad::Quad()
 {
-    glGenVertexArrays(1, &m_vao);
-    glBindVertexArray(m_vao);
-
-    GLuint positionBuffer;
-    glGenBuffers(1, &positionBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
-
-    m_positions.m_vboHandle = positionBuffer;
-
     m_mode = GL_TRIANGLE_STRIP;
-    
-    float positions[] = 
-    {
-        -1.0f, -1.0f,
-        -1.0f, 1.0f,
-        1.0f, -1.0f,
-        1.0f, 1.0f
-    };
 
-    float uv[] = 
+    setMesh( MESHCACHE->acquire("Quad", [](MeshData& meshData)
     {
-        0.0f, 0.0f,
-        0.0f, 1.0f,
-        1.0f, 0.0f,
-        1.0f, 1.0f
-    };
-
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float)*8, positions, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(0);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float)*8, uv, GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(1);
+        // both attributes in [0,1]: fullscreen.vert maps the position to clip space itself
+        float uv[] = 
+        {
+            0.0f, 0.0f,
+            0.0f, 1.0f,
+            1.0f, 0.0f,
+            1.0f, 1.0f
+        };
+
+        meshData.positions.assign(uv, uv + 8);
+        meshData.positionComponents = 2;
+        meshData.uvs.assign(uv, uv + 8);
+        meshData.uvComponents = 2;
+    }));
 }
 
 Quad::~Quad()
 {
-    glDeleteBuffersARB(1, &(m_positions.m_vboHandle));
-    glDeleteBuffersARB(1, &(m_uvs.m_vboHandle));
+    // shared geometry is released by ~Renderable()
 }
 
 void Quad::draw()
@@ -352,29 +349,21 @@ glm::vec3 Sphere::sampleSurface(float u, float v)
 
 Sphere::Sphere(unsigned int hSlices, unsigned int vSlices, float radius)
 {
-    glGenVertexArrays(1, &m_vao);
-    glBindVertexArray(m_vao);
+    m_mode = GL_TRIANGLES;
 
-    GLuint vertexBufferHandles[3];
-    glGenBuffers(3, vertexBufferHandles);
-    
-    m_positions.m_vboHandle = vertexBufferHandles[0];
-    m_uvs.m_vboHandle       = vertexBufferHandles[1];
-    m_normals.m_vboHandle   = vertexBufferHandles[2];
+    std::string key = "Sphere(" + std::to_string(hSlices) + "," + std::to_string(vSlices) + "," + std::to_string(radius) + ")";
+    setMesh( MESHCACHE->acquire(key, [&](MeshData& meshData){ generateGeometry(meshData, hSlices, vSlices, radius); }) );
+}
 
-    m_mode = GL_TRIANGLES;
-    
-    std::vector<float> positions;
-    std::vector<float> uv;
-    std::vector<float> normals;
+void Sphere::generateGeometry(MeshData& meshData, unsigned int hSlices, unsigned int vSlices, float radius)
+{
+    std::vector<float>& positions = meshData.positions;
+    std::vector<float>& uv = meshData.uvs;
+    std::vector<float>& normals = meshData.normals;
     positions.resize(hSlices * vSlices * 3 * 3 * 2);
     uv.resize(hSlices * vSlices * 3 * 2 * 2);
     normals.resize(hSlices * vSlices * 3 * 3 * 2);
 
-    m_positions.m_size = positions.size() / 3;
-    m_uvs.m_size = uv.size() / 2;
-    m_normals.m_size = normals.size() / 3;
-
 
     float d_u = (2.0f * glm::pi<float>()) / ((float) vSlices);
     float d_v = glm::pi<float>() / ((float) hSlices);
@@ -460,28 +449,11 @@ Sphere::Sphere(unsigned int hSlices, unsigned int vSlices, float radius)
             i++;
         }
     }
-
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferHandles[0]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * positions.size(), &positions[0], GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(0);
-
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferHandles[1]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * uv.size(), &uv[0], GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(1);
-
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferHandles[2]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * normals.size(), &normals[0], GL_STATIC_DRAW);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(2);
 }
 
 Sphere::~Sphere()
 {
-    glDeleteBuffersARB(1, &(m_positions.m_vboHandle));
-    glDeleteBuffersARB(1, &(m_uvs.m_vboHandle));
-    glDeleteBuffersARB(1, &(m_normals.m_vboHandle));
+    // shared geometry is released by ~Renderable()
 }
 
 void Sphere::draw()
@@ -492,29 +464,20 @@ void Sphere::draw()
 
 Grid::Grid(unsigned int fieldsX, unsigned  int fieldsY, float sizeX, float sizeY, bool centered)
 {
-    glGenVertexArrays(1, &m_vao);
-    glBindVertexArray(m_vao);
-
-    GLuint positionBuffer;
-    GLuint uvBuffer;
-    GLuint normalBuffer;
-    GLuint indexBuffer;
-    glGenBuffers(1, &positionBuffer);
-    glGenBuffers(1, &uvBuffer);
-    glGenBuffers(1, &normalBuffer);
-    glGenBuffers(1, &indexBuffer);
-
-    m_positions.m_vboHandle = positionBuffer;
-    m_normals.m_vboHandle = normalBuffer;
-    m_uvs.m_vboHandle = uvBuffer;
-    m_indices.m_vboHandle = indexBuffer;
-
     m_mode = GL_TRIANGLE_STRIP;
-    
 
-    std::vector<float> positions( ((fieldsX+1) * (fieldsY+1))*3, 0.0f );
-    std::vector<float> normals( ((fieldsX+1) * (fieldsY+1))*3, 0.0f );
-    std::vector<float> uv( ((fieldsX+1) * (fieldsY+1))*2, 0.0f );
+    std::string key = "Grid(" + std::to_string(fieldsX) + "," + std::to_string(fieldsY) + "," + std::to_string(sizeX) + "," + std::to_string(sizeY) + "," + std::to_string(centered) + ")";
+    setMesh( MESHCACHE->acquire(key, [&](MeshData& meshData){ generateGeometry(meshData, fieldsX, fieldsY, sizeX, sizeY, centered); }) );
+}
+
+void Grid::generateGeometry(MeshData& meshData, unsigned int fieldsX, unsigned  int fieldsY, float sizeX, float sizeY, bool centered)
+{
+    std::vector<float>& positions = meshData.positions;
+    std::vector<float>& normals = meshData.normals;
+    std::vector<float>& uv = meshData.uvs;
+    positions.assign( ((fieldsX+1) * (fieldsY+1))*3, 0.0f );
+    normals.assign( ((fieldsX+1) * (fieldsY+1))*3, 0.0f );
+    uv.assign( ((fieldsX+1) * (fieldsY+1))*2, 0.0f );
 
     int posIdx = 0;
     int uvIdx = 0;
@@ -569,27 +532,9 @@ Grid::Grid(unsigned int fieldsX, unsigned  int fieldsY, float sizeX, float sizeY
         y += dy;
     }
 
-    m_positions.m_size = positions.size() / 3;
-    m_uvs.m_size = uv.size() / 2;
-    m_normals.m_size = normals.size() / 3;
-
-    glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float)*positions.size(), &positions[0], GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(0);
-
-    glBindBuffer(GL_ARRAY_BUFFER, uvBuffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * uv.size(), &uv[0], GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(1);
-
-    glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float)*normals.size(), &normals[0], GL_STATIC_DRAW);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(2);
-
     // Index Buffer / Element Array Buffer
-    std::vector<unsigned int> indices(((fieldsX+1)*2)*(fieldsY),0);
+    std::vector<unsigned int>& indices = meshData.indices;
+    indices.assign(((fieldsX+1)*2)*(fieldsY),0);
 
     int top = 0;
     int bottom = fieldsX+1;
@@ -614,22 +559,16 @@ Grid::Grid(unsigned int fieldsX, unsigned  int fieldsY, float sizeX, float sizeY
     }
     // DEBUGLOG->log("indices: ", indices.size());
 
-    m_indices.m_size = indices.size();
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int)*indices.size(), &indices[0], GL_STATIC_DRAW);
 }
 
 Grid::~Grid()
 {
-    glDeleteBuffersARB(1, &(m_positions.m_vboHandle));
-    glDeleteBuffersARB(1, &(m_uvs.m_vboHandle));
-    glDeleteBuffersARB(1, &(m_normals.m_vboHandle));
+    // shared geometry is released by ~Renderable()
 }
 
 void Grid::draw()
 {
     glBindVertexArray(m_vao);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indices.m_vboHandle);
-    glDrawElements(GL_TRIANGLE_STRIP, m_indices.m_size, GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLE_STRIP, m_indices.m_size, GL_UNSIGNED_INT, getIndexPointer());
     // glDrawArrays(GL_POINTS,  0, m_positions.m_size);
 }
\ No newline at end of file
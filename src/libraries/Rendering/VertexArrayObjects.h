@@ -6,6 +6,8 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+#include "Rendering/MeshCache.h"
+
 struct VertexBufferObject
 {
     GLuint m_vboHandle; //!< A VertexBufferObject handle
@@ -30,10 +32,15 @@ public:
 
     void setDrawMode(GLenum type); //!< sets the mode the Renderable will be drawn with (e.g. GL_TRIANLGES)
 
+protected:
+
+    void setMesh(MeshCache::Mesh* mesh); //!< use shared geometry of the MeshCache, released on destruction
+    const void* getIndexPointer() const; //!< offset of the indices in the element array buffer, for glDrawElements
+
 private:
 
-    GLuint createVbo(std::vector<float> content, GLuint dimensions, GLuint vertexAttributePointer);
-	GLuint createIndexVbo(std::vector<unsigned int> content, GLuint vertexAttributePointer);
+    GLuint createVbo(const std::vector<float>& content, GLuint dimensions, GLuint vertexAttributePointer);
+	GLuint createIndexVbo(const std::vector<unsigned int>& content, GLuint vertexAttributePointer);
 
 public:
 
@@ -43,6 +50,7 @@ public:
     VertexBufferObject m_normals; //!< normal buffer
 
     GLuint m_vao; //!< VertexArrayObject handle
+    MeshCache::Mesh* m_mesh; //!< shared geometry, 0 if the buffers are owned by this Renderable
     GLenum m_mode; //!< the mode the Renderable will be drawn with (e.g. GL_TRIANGLES)
 };
 
@@ -84,6 +92,7 @@ public:
 
 protected:
     glm::vec3 sampleSurface(float u, float v);
+    void generateGeometry(MeshData& meshData, unsigned int hSlices, unsigned int vSlices, float radius);
 };
 
 class Grid : public Renderable {
@@ -101,6 +110,7 @@ public:
     void draw() override; //!< draws the sphere
 
 protected:
+    void generateGeometry(MeshData& meshData, unsigned int fieldsX, unsigned int fieldsY, float sizeX, float sizeY, bool centered);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,359 @@
+#include "VolumeStreamer.h"
+
+#include <Core/ThreadPool.h>
+#include <Core/DebugLog.h>
+
+#include <chrono>
+#include <climits>
+#include <cmath>
+
+VolumeStreamer::VolumeStreamer(const VolumeTimeSeries& series, int numTextures, int numDecodeSlots)
+	: m_series(series)
+{
+	m_currentTimePoint = -1;
+	m_nextTimePoint = -1;
+	m_mix = 0.0f;
+	m_interpolate = true;
+	m_loop = true;
+	m_maxUploadsPerUpdate = 1;
+	m_numUploads = 0;
+	m_numStalls = 0;
+	m_uploadMilliseconds = 0.0;
+	m_decodeMilliseconds = 0.0;
+
+	DEBUGLOG->log("VolumeStreamer: allocating 3D textures, amount: ", numTextures);
+
+	GLint previousTexture;
+	glGetIntegerv(GL_TEXTURE_BINDING_3D, &previousTexture);
+
+	m_textureSlots.resize( std::max(2, numTextures) );
+	for (size_t i = 0; i < m_textureSlots.size(); i++)
+	{
+		glGenTextures(1, &m_textureSlots[i].texture);
+		glBindTexture(GL_TEXTURE_3D, m_textureSlots[i].texture);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); // integer textures can not be filtered
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		glTexStorage3D(GL_TEXTURE_3D, 1, GL_R16I, m_series.size_x, m_series.size_y, m_series.size_z);
+		m_textureSlots[i].timePoint = -1;
+	}
+	glBindTexture(GL_TEXTURE_3D, previousTexture);
+
+	m_decodeSlots.resize( std::max(1, numDecodeSlots) );
+	for (size_t i = 0; i < m_decodeSlots.size(); i++)
+	{
+		m_decodeSlots[i].timePoint = -1;
+		m_decodeSlots[i].milliseconds = 0.0;
+	}
+}
+
+VolumeStreamer::~VolumeStreamer()
+{
+	for (size_t i = 0; i < m_decodeSlots.size(); i++)
+	{
+		if ( m_decodeSlots[i].done.valid() )
+		{
+			m_decodeSlots[i].done.wait();
+		}
+	}
+	for (size_t i = 0; i < m_textureSlots.size(); i++)
+	{
+		glDeleteTextures(1, &m_textureSlots[i].texture);
+	}
+}
+
+int VolumeStreamer::wrap(int timePoint) const
+{
+	int n = (int) m_series.numTimePoints;
+	return ( (timePoint % n) + n ) % n;
+}
+
+int VolumeStreamer::distanceAhead(int timePoint, int from) const
+{
+	int n = (int) m_series.numTimePoints;
+	if (m_loop)
+	{
+		return wrap(timePoint - from);
+	}
+	return (timePoint >= from) ? timePoint - from : n + (from - timePoint); // already played: farthest away
+}
+
+int VolumeStreamer::findTextureSlot(int timePoint) const
+{
+	for (size_t i = 0; i < m_textureSlots.size(); i++)
+	{
+		if (timePoint >= 0 && m_textureSlots[i].timePoint == timePoint)
+		{
+			return (int) i;
+		}
+	}
+	return -1;
+}
+
+int VolumeStreamer::findDecodeSlot(int timePoint) const
+{
+	for (size_t i = 0; i < m_decodeSlots.size(); i++)
+	{
+		if (timePoint >= 0 && m_decodeSlots[i].timePoint == timePoint)
+		{
+			return (int) i;
+		}
+	}
+	return -1;
+}
+
+void VolumeStreamer::requestDecode(int timePoint)
+{
+	int freeSlot = -1;
+	for (size_t i = 0; i < m_decodeSlots.size() && freeSlot < 0; i++)
+	{
+		if (m_decodeSlots[i].timePoint < 0) { freeSlot = (int) i; }
+	}
+	if (freeSlot < 0)
+	{
+		return; // all staging volumes in use
+	}
+
+	DecodeSlot* slot = &m_decodeSlots[freeSlot];
+	const VolumeTimeSeries* series = &m_series;
+	slot->timePoint = timePoint;
+	slot->done = THREADPOOL->enqueue([slot, series, timePoint]()
+	{
+		std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+		series->decodeTimePoint( (unsigned int) timePoint, slot->volume );
+		slot->milliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - startTime ).count();
+	});
+}
+
+bool VolumeStreamer::upload(int decodeSlot, int wantedTimePoint)
+{
+	DecodeSlot& slot = m_decodeSlots[decodeSlot];
+	int incomingDistance = distanceAhead(slot.timePoint, wantedTimePoint);
+
+	// recycle the texture whose time point is displayed last; the displayed one only for the wanted time point
+	int victim = -1;
+	int victimDistance = -1;
+	for (size_t i = 0; i < m_textureSlots.size(); i++)
+	{
+		int timePoint = m_textureSlots[i].timePoint;
+		if ( timePoint >= 0 && timePoint == m_currentTimePoint && slot.timePoint != wantedTimePoint )
+		{
+			continue;
+		}
+		int distance = (timePoint < 0) ? INT_MAX : distanceAhead(timePoint, wantedTimePoint);
+		if (distance > victimDistance)
+		{
+			victim = (int) i;
+			victimDistance = distance;
+		}
+	}
+	if (victim < 0 || victimDistance <= incomingDistance)
+	{
+		return false; // every resident time point is needed earlier
+	}
+
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+
+	GLint previousTexture;
+	glGetIntegerv(GL_TEXTURE_BINDING_3D, &previousTexture);
+	glBindTexture(GL_TEXTURE_3D, m_textureSlots[victim].texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+	glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, m_series.size_x, m_series.size_y, m_series.size_z, GL_RED_INTEGER, GL_SHORT, &slot.volume.data[0]);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_3D, previousTexture);
+
+	m_uploadMilliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - startTime ).count();
+	m_decodeMilliseconds = slot.milliseconds;
+	m_numUploads++;
+
+	m_textureSlots[victim].timePoint = slot.timePoint;
+	slot.timePoint = -1; // staging volume keeps its memory for the next decode
+	return true;
+}
+
+void VolumeStreamer::update(float time)
+{
+	int n = (int) m_series.numTimePoints;
+	if (n <= 0)
+	{
+		return;
+	}
+
+	float t = m_loop ? std::fmod(time, (float) n) : std::max(0.0f, std::min(time, (float) (n - 1)));
+	if (t < 0.0f) { t += (float) n; }
+	int wanted = std::min( (int) std::floor(t), n - 1 );
+	float fraction = t - (float) wanted;
+	int lookAhead = (int) m_textureSlots.size();
+
+	// 1) drop decoded time points which are not needed anymore, e.g. after seeking
+	for (size_t i = 0; i < m_decodeSlots.size(); i++)
+	{
+		DecodeSlot& slot = m_decodeSlots[i];
+		if ( slot.timePoint >= 0 && distanceAhead(slot.timePoint, wanted) >= lookAhead
+			&& slot.done.wait_for(std::chrono::seconds(0)) == std::future_status::ready )
+		{
+			slot.timePoint = -1;
+		}
+	}
+
+	// 2) decode upcoming time points, nearest first
+	for (int d = 0; d < lookAhead; d++)
+	{
+		int timePoint = wanted + d;
+		if (m_loop) { timePoint = wrap(timePoint); }
+		else if (timePoint >= n) { break; }
+
+		if ( findTextureSlot(timePoint) < 0 && findDecodeSlot(timePoint) < 0 )
+		{
+			requestDecode(timePoint);
+		}
+	}
+
+	// 3) nothing to display at all (first frame): wait for the wanted time point
+	if ( findTextureSlot(m_currentTimePoint) < 0 && findTextureSlot(wanted) < 0 )
+	{
+		int slot = findDecodeSlot(wanted);
+		if (slot < 0)
+		{
+			// staging volumes are occupied by other time points: recycle the first one
+			m_decodeSlots[0].done.wait();
+			m_decodeSlots[0].timePoint = -1;
+			requestDecode(wanted);
+			slot = findDecodeSlot(wanted);
+		}
+		m_decodeSlots[slot].done.wait();
+		upload(slot, wanted);
+		m_numStalls++;
+	}
+
+	// 4) upload finished time points, nearest first
+	for (int u = 0; u < m_maxUploadsPerUpdate; u++)
+	{
+		int nearest = -1;
+		int nearestDistance = INT_MAX;
+		for (size_t i = 0; i < m_decodeSlots.size(); i++)
+		{
+			DecodeSlot& slot = m_decodeSlots[i];
+			if ( slot.timePoint < 0 || slot.done.wait_for(std::chrono::seconds(0)) != std::future_status::ready )
+			{
+				continue;
+			}
+			int distance = distanceAhead(slot.timePoint, wanted);
+			if (distance < nearestDistance)
+			{
+				nearest = (int) i;
+				nearestDistance = distance;
+			}
+		}
+		if ( nearest < 0 || !upload(nearest, wanted) )
+		{
+			break;
+		}
+	}
+
+	// 5) display the wanted time point if resident, otherwise keep the last one
+	if ( findTextureSlot(wanted) >= 0 )
+	{
+		m_currentTimePoint = wanted;
+	}
+	else
+	{
+		m_numStalls++;
+	}
+
+	m_nextTimePoint = m_currentTimePoint;
+	m_mix = 0.0f;
+	if ( m_interpolate && m_currentTimePoint == wanted )
+	{
+		int next = m_loop ? wrap(wanted + 1) : std::min(wanted + 1, n - 1);
+		if ( next != wanted && findTextureSlot(next) >= 0 )
+		{
+			m_nextTimePoint = next;
+			m_mix = fraction;
+		}
+	}
+}
+
+GLuint VolumeStreamer::getCurrentTexture() const
+{
+	int slot = findTextureSlot(m_currentTimePoint);
+	return (slot >= 0) ? m_textureSlots[slot].texture : 0;
+}
+
+GLuint VolumeStreamer::getNextTexture() const
+{
+	int slot = findTextureSlot(m_nextTimePoint);
+	return (slot >= 0) ? m_textureSlots[slot].texture : getCurrentTexture();
+}
+
+float VolumeStreamer::getMix() const
+{
+	return m_mix;
+}
+
+int VolumeStreamer::getCurrentTimePoint() const
+{
+	return m_currentTimePoint;
+}
+
+void VolumeStreamer::setInterpolation(bool interpolate)
+{
+	m_interpolate = interpolate;
+}
+
+bool VolumeStreamer::getInterpolation() const
+{
+	return m_interpolate;
+}
+
+void VolumeStreamer::setLooping(bool loop)
+{
+	m_loop = loop;
+}
+
+void VolumeStreamer::setMaxUploadsPerUpdate(int maxUploads)
+{
+	m_maxUploadsPerUpdate = std::max(1, maxUploads);
+}
+
+const VolumeTimeSeries& VolumeStreamer::getSeries() const
+{
+	return m_series;
+}
+
+int VolumeStreamer::getNumTextures() const
+{
+	return (int) m_textureSlots.size();
+}
+
+int VolumeStreamer::getNumResident() const
+{
+	int numResident = 0;
+	for (size_t i = 0; i < m_textureSlots.size(); i++)
+	{
+		if (m_textureSlots[i].timePoint >= 0) { numResident++; }
+	}
+	return numResident;
+}
+
+int VolumeStreamer::getNumUploads() const
+{
+	return m_numUploads;
+}
+
+int VolumeStreamer::getNumStalls() const
+{
+	return m_numStalls;
+}
+
+double VolumeStreamer::getUploadMilliseconds() const
+{
+	return m_uploadMilliseconds;
+}
+
+double VolumeStreamer::getDecodeMilliseconds() const
+{
+	return m_decodeMilliseconds;
+}
@@ -0,0 +1,98 @@
+#ifndef VOLUMESTREAMER_H
+#define VOLUMESTREAMER_H
+
+#include <Importing/TimeSeries.h>
+
+#include <GL/glew.h>
+#include <future>
+#include <vector>
+
+/**
+ * @brief cine playback of a VolumeTimeSeries through a small ring of 3D textures
+ *
+ * Upcoming time points are decoded ahead of display by tasks on the ThreadPool into a few
+ * CPU staging volumes. update() runs on the thread owning the GL context: it uploads finished
+ * time points into the ring and recycles the textures of time points which will not be
+ * displayed soon. Only numTextures volumes are ever resident in VRAM.
+ *
+ * If the displayed time point is not resident yet, the last displayed one is kept on screen
+ * (counted as a stall), so playback never blocks except for the very first frame.
+ */
+class VolumeStreamer
+{
+protected:
+	struct TextureSlot
+	{
+		GLuint texture;
+		int timePoint; //!< resident time point, -1 if unused
+	};
+
+	struct DecodeSlot
+	{
+		VolumeData<short> volume;
+		int timePoint;          //!< time point being decoded or ready for upload, -1 if unused
+		std::future<void> done; //!< ready once volume holds timePoint
+		double milliseconds;    //!< decode time, written by the decoding task
+	};
+
+	VolumeTimeSeries m_series;
+
+	std::vector<TextureSlot> m_textureSlots;
+	std::vector<DecodeSlot> m_decodeSlots;
+
+	int m_currentTimePoint; //!< displayed time point
+	int m_nextTimePoint;    //!< time point to interpolate towards
+	float m_mix;            //!< interpolation weight of m_nextTimePoint
+	bool m_interpolate;
+	bool m_loop;
+	int m_maxUploadsPerUpdate;
+
+	int m_numUploads;
+	int m_numStalls;
+	double m_uploadMilliseconds; //!< time of the last upload
+	double m_decodeMilliseconds; //!< decode time of the last uploaded time point
+
+	int wrap(int timePoint) const;
+	int distanceAhead(int timePoint, int from) const; //!< amount of time points from 'from' until timePoint is displayed
+	int findTextureSlot(int timePoint) const;
+	int findDecodeSlot(int timePoint) const;
+
+	void requestDecode(int timePoint);
+	bool upload(int decodeSlot, int wantedTimePoint); //!< false if no texture slot could be freed for it
+
+public:
+	/**
+	 * @param series to be played back, decoding is delegated to series.decodeTimePoint
+	 * @param numTextures amount of 3D textures in the ring, i.e. time points resident in VRAM
+	 * @param numDecodeSlots amount of time points decoded ahead in parallel
+	 */
+	VolumeStreamer(const VolumeTimeSeries& series, int numTextures = 4, int numDecodeSlots = 2);
+	~VolumeStreamer(); //!< waits for running decode tasks
+
+	/**
+	 * @brief advance playback, issue decodes for upcoming time points and upload finished ones
+	 *
+	 * @param time playback position in time points, e.g. seconds * timePointsPerSecond
+	 */
+	void update(float time);
+
+	GLuint getCurrentTexture() const; //!< texture of the displayed time point
+	GLuint getNextTexture() const;    //!< texture to interpolate towards, equal to getCurrentTexture() if not interpolating
+	float getMix() const;             //!< interpolation weight of getNextTexture()
+	int getCurrentTimePoint() const;
+
+	void setInterpolation(bool interpolate); //!< interpolate between consecutive time points in the shader
+	bool getInterpolation() const;
+	void setLooping(bool loop);
+	void setMaxUploadsPerUpdate(int maxUploads); //!< bounds the upload cost of a single frame
+
+	const VolumeTimeSeries& getSeries() const;
+	int getNumTextures() const;
+	int getNumResident() const;
+	int getNumUploads() const;
+	int getNumStalls() const; //!< updates at which the requested time point was not resident
+	double getUploadMilliseconds() const;
+	double getDecodeMilliseconds() const;
+};
+
+#endif
@@ -0,0 +1,72 @@
+#include "VoxelPicker.h"
+
+#include <cstring>
+
+VoxelPicker::VoxelPicker()
+{
+	m_numRequests = 0;
+	m_numPolls = 0;
+}
+
+VoxelPicker::~VoxelPicker()
+{
+}
+
+void VoxelPicker::request(GLuint framebuffer, GLenum attachment, int x, int y)
+{
+	m_readback.readPixels(framebuffer, attachment, x, y, 1, 1, GL_RGBA, GL_FLOAT, 4 * sizeof(float));
+	m_numRequests++;
+}
+
+bool VoxelPicker::poll(const glm::ivec3& volumeSize, VoxelPick& pick)
+{
+	if ( !m_readback.isPending() )
+	{
+		return false;
+	}
+	m_numPolls++;
+
+	if ( !m_readback.poll() )
+	{
+		return false;
+	}
+
+	glm::vec4 texel(-1.0f);
+	const void* mapped = m_readback.map();
+	if ( mapped )
+	{
+		std::memcpy(&texel[0], mapped, 4 * sizeof(float));
+		m_readback.unmap();
+	}
+
+	pick = decode(texel, volumeSize);
+	return true;
+}
+
+bool VoxelPicker::isPending() const
+{
+	return m_readback.isPending();
+}
+
+int VoxelPicker::getNumRequests() const
+{
+	return m_numRequests;
+}
+
+int VoxelPicker::getNumPolls() const
+{
+	return m_numPolls;
+}
+
+VoxelPick VoxelPicker::decode(const glm::vec4& texel, const glm::ivec3& volumeSize)
+{
+	VoxelPick pick;
+	if ( texel.r < 0.0f )
+	{
+		return pick;
+	}
+	pick.hit = true;
+	pick.setPosition( glm::vec3(texel) * glm::vec3(volumeSize) - 0.5f, volumeSize ); // texel centers lie at (i + 0.5) / size
+	pick.value = texel.a;
+	return pick;
+}
@@ -0,0 +1,58 @@
+#ifndef VOXELPICKER_H
+#define VOXELPICKER_H
+
+#include <GL/glew.h>
+
+#include <Processing/CPURendering.h>
+#include <Rendering/AsyncReadback.h>
+
+/**
+ * @brief asynchronous readback of the pick attachment of volume.frag
+ *
+ * request() starts the AsyncReadback of a single texel; poll() maps the buffer only once it is
+ * complete, so neither call waits for the GPU. A newer request supersedes a pending one.
+ *
+ * The texel holds the uvw coordinates of the selected sample in rgb and its value in a;
+ * r < 0 marks pixels without a sample (the traversal clear value is used for that).
+ */
+class VoxelPicker
+{
+protected:
+	AsyncReadback m_readback;
+	int m_numRequests;
+	int m_numPolls;        //!< calls to poll() while a request was pending, i.e. frames spent waiting
+
+public:
+	VoxelPicker();
+	~VoxelPicker();
+
+	/**
+	 * @brief issue the readback of one texel
+	 *
+	 * @param framebuffer containing the pick attachment
+	 * @param attachment e.g. GL_COLOR_ATTACHMENT3
+	 * @param x pixel coordinate, origin in the lower left corner
+	 * @param y pixel coordinate, origin in the lower left corner
+	 */
+	void request(GLuint framebuffer, GLenum attachment, int x, int y);
+
+	/**
+	 * @brief fetch the result of the pending request if the GPU is done with it
+	 *
+	 * @param volumeSize voxel resolution of the picked volume, to convert uvw to voxel coordinates
+	 * @param pick filled if true is returned
+	 * @return true once, when the result of the last request became available
+	 */
+	bool poll(const glm::ivec3& volumeSize, VoxelPick& pick);
+
+	bool isPending() const; //!< whether a request is in flight
+	int getNumRequests() const;
+	int getNumPolls() const;
+
+	/**
+	 * @brief decode a texel of the pick attachment
+	 */
+	static VoxelPick decode(const glm::vec4& texel, const glm::ivec3& volumeSize);
+};
+
+#endif
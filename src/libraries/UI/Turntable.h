@@ -15,6 +15,7 @@ public:
 	virtual ~Turntable();
 
 	inline glm::mat4 getRotationMatrix(){ return m_rotation; }
+	inline void setRotationMatrix(const glm::mat4& rotation){ m_rotation = rotation; }
 	inline void setDragActive(bool drag){m_dragActive = drag;}
 	inline bool getDragActive(){return m_dragActive;}
 	inline void setSensitivity(float sensitivity){m_sensitivity = sensitivity;}
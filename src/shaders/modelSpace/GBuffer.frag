@@ -15,11 +15,22 @@ uniform vec4  color;
 uniform float mixTexture;
 uniform sampler2D tex;
 
-//writable textures for deferred screen space calculations
+//writable textures for deferred screen space calculations, compact layout:
+//view space position is reconstructed from the depth buffer
 layout(location = 0) out vec4 fragColor;
-layout(location = 1) out vec4 fragNormal;
-layout(location = 2) out vec4 fragPosition;
-layout(location = 3) out vec4 fragUVCoord;
+layout(location = 1) out vec2 fragNormal;
+layout(location = 2) out vec2 fragUVCoord;
+
+/**
+ * @brief octahedral encoding of a unit vector to [0,1]^2, see FrameBufferObject::getCompactGBufferFormats()
+ */
+vec2 encodeNormal(vec3 n)
+{
+	n /= ( abs(n.x) + abs(n.y) + abs(n.z) );
+	vec2 signs = vec2( n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0 );
+	vec2 e = (n.z >= 0.0) ? n.xy : (1.0 - abs(n.yx)) * signs;
+	return e * 0.5 + 0.5;
+}
  
 void main(){
 	fragColor = color;
@@ -28,12 +39,7 @@ void main(){
 		fragColor = mix(color, texture(tex, passUVCoord), mixTexture );
 	}
 
-    // fragPosition = vec4(passPosition,1);
-    // fragUVCoord = vec4(passUVCoord,0,0);
-    // fragNormal = vec4(passNormal,0);
-
-    fragPosition = vec4(VertexOut.position,1);
-    fragUVCoord = vec4(VertexOut.texCoord,0,0);
-    fragNormal = vec4(VertexOut.normal,0);
+    fragUVCoord = VertexOut.texCoord;
+    fragNormal = encodeNormal( normalize(VertexOut.normal) );
 
 }
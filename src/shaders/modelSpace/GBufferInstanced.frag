@@ -0,0 +1,45 @@
+#version 430
+
+/*
+* GBuffer.frag for InstancedScene: color and texture mix factor come from the instance instead of uniforms.
+*/
+
+in vec2 passUVCoord;
+flat in vec4 passColor;
+flat in float passMixTexture;
+
+in VertexData {
+	vec2 texCoord;
+	vec3 position;
+	vec3 normal;
+} VertexOut;
+
+uniform sampler2D tex;
+
+//writable textures for deferred screen space calculations, compact layout:
+//view space position is reconstructed from the depth buffer
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragNormal;
+layout(location = 2) out vec2 fragUVCoord;
+
+/**
+ * @brief octahedral encoding of a unit vector to [0,1]^2, see FrameBufferObject::getCompactGBufferFormats()
+ */
+vec2 encodeNormal(vec3 n)
+{
+	n /= ( abs(n.x) + abs(n.y) + abs(n.z) );
+	vec2 signs = vec2( n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0 );
+	vec2 e = (n.z >= 0.0) ? n.xy : (1.0 - abs(n.yx)) * signs;
+	return e * 0.5 + 0.5;
+}
+
+void main(){
+	fragColor = passColor;
+	if ( passMixTexture != 0.0)
+	{
+		fragColor = mix(passColor, texture(tex, passUVCoord), passMixTexture );
+	}
+
+	fragUVCoord = VertexOut.texCoord;
+	fragNormal = encodeNormal( normalize(VertexOut.normal) );
+}
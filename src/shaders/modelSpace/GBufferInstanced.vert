@@ -0,0 +1,53 @@
+#version 430
+
+/*
+* GBuffer.vert for InstancedScene: the model matrix of every instance is read from a shader storage buffer.
+* The uniform model matrix is applied on top, to transform the whole scene.
+*/
+
+layout(location = 0) in vec4 positionAttribute;
+layout(location = 1) in vec2 uvCoordAttribute;
+layout(location = 2) in vec4 normalAttribute;
+layout(location = 3) in uint instanceAttribute; // index into instances, advanced per instance
+
+struct Instance
+{
+	mat4 model;
+	vec4 color;
+	vec4 material; // x: mix factor of the texture
+};
+
+layout(std430, binding = 0) readonly buffer Instances
+{
+	Instance instances[];
+};
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec2 passUVCoord;
+flat out vec4 passColor;
+flat out float passMixTexture;
+
+out VertexData {
+	vec2 texCoord;
+	vec3 position;
+	vec3 normal;
+} VertexOut;
+
+void main(){
+	Instance instance = instances[instanceAttribute];
+	mat4 modelView = view * model * instance.model;
+
+	vec4 position = modelView * vec4(positionAttribute.xyz, 1.0);
+	gl_Position = projection * position;
+
+	passUVCoord = uvCoordAttribute;
+	passColor = instance.color;
+	passMixTexture = instance.material.x;
+
+	VertexOut.texCoord = uvCoordAttribute;
+	VertexOut.position = position.xyz;
+	VertexOut.normal = normalize( ( transpose( inverse( modelView ) ) * vec4(normalAttribute.xyz, 0.0) ).xyz );
+}
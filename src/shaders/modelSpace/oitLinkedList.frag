@@ -0,0 +1,56 @@
+#version 430
+
+/*
+* Appends every fragment to the linked list of its pixel instead of writing a G-Buffer layer,
+* see FragmentListBuffers. Render with depth test disabled, so no fragment is rejected.
+*/
+
+in VertexData {
+	vec2 texCoord;
+	vec3 position;
+	vec3 normal;
+} VertexOut;
+
+uniform vec4  color;
+uniform float mixTexture;
+uniform sampler2D tex;
+
+const uint END_OF_LIST = 0xFFFFFFFFu;
+
+struct FragmentNode
+{
+	vec3 position; // view space position
+	uint color;    // packed rgba8
+	vec3 normal;   // view space normal
+	uint next;     // index of the next node, END_OF_LIST at the end of the list
+};
+
+layout(binding = 0, r32ui) uniform coherent uimage2D head_pointers;
+layout(binding = 0, offset = 0) uniform atomic_uint node_counter;
+layout(std430, binding = 0) buffer FragmentNodes
+{
+	FragmentNode nodes[];
+};
+
+void main(){
+
+	vec4 fragColor = color;
+	if ( mixTexture != 0.0)
+	{
+		fragColor = mix(color, texture(tex, VertexOut.texCoord), mixTexture );
+	}
+
+	uint nodeIndex = atomicCounterIncrement(node_counter);
+	if ( nodeIndex >= uint(nodes.length()) )
+	{
+		return; // buffer full: fragment is dropped, the buffer grows for the next frame
+	}
+
+	// insert at the head of the list of this pixel
+	uint next = imageAtomicExchange(head_pointers, ivec2(gl_FragCoord.xy), nodeIndex);
+
+	nodes[nodeIndex].position = VertexOut.position;
+	nodes[nodeIndex].color    = packUnorm4x8( clamp(fragColor, 0.0, 1.0) );
+	nodes[nodeIndex].normal   = VertexOut.normal;
+	nodes[nodeIndex].next     = next;
+}
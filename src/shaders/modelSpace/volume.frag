@@ -1,5 +1,17 @@
 #version 430
 
+/*
+* Ray traversal of the MIP. Instead of a color, the traversal result is written, so color mapping
+* (windowing, depth effects) can be applied by a cheap fullscreen pass, see mipRecolor.frag.
+* Optionally, minimum, sum and sample count are accumulated in the same traversal, so MinIP and
+* average intensity projection are available without another traversal.
+* For shading, the gradient at the maximum is either derived on the fly (six extra fetches) or
+* fetched from a precomputed gradient volume (one fetch), see Processing/Gradients.h.
+* In isosurface mode, the ray ends at the first crossing of the iso value instead, refined by
+* bisection. Bricks whose value range excludes the iso value are skipped, see Processing/Bricks.h.
+* The uvw coordinates and value of the selected sample are written for picking, see Rendering/VoxelPicker.h.
+*/
+
 // in-variables
 in vec2 passImageCoord;
 
@@ -7,13 +19,11 @@ in vec2 passImageCoord;
 uniform sampler2D  back_uvw_map;   // uvw coordinates map of back  faces
 uniform sampler2D front_uvw_map;   // uvw coordinates map of front faces
 uniform isampler3D volume_texture; // volume 3D integer texture sampler
+uniform isampler3D volume_texture_next; // 4D series: volume of the next time point
+uniform sampler3D gradient_texture; // precomputed gradients, packed RGB10A2
+uniform isampler3D brick_texture;   // value range per brick: minimum in r, maximum in g
 
 ////////////////////////////////     UNIFORMS      ////////////////////////////////
-// color mapping related uniforms 
-uniform float uWindowingRange;  // windowing value range
-uniform float uWindowingMinVal; // windowing lower bound
-uniform float uWindowingMaxVal; // windowing upper bound
-
 // ray traversal related uniforms
 uniform float uRayParamStart;  // constrained sampling parameter intervall start
 uniform float uRayParamEnd;	// constrained sampling parameter intervall end
@@ -22,24 +32,34 @@ uniform float uStepSize;		// ray sampling step size
 // LMIP parameter
 uniform float uThresholdLMIP;	// LMIP value threshold to be exceeded to trigger
 
-// depth effect parameters
-uniform float uColorEffectInfl;    // color    effect: influence parameter [0,1]
-uniform float uContrastEffectInfl; // contrast effect: influence parameter [0,1]
-uniform vec4  uMaxDistColor; // color effect: color at max distance
-uniform vec4  uMinDistColor; // color effect: color at min distance
-uniform int   uMixMode; 	 // color effect: color mixing mode (0 multiply, 1 add, 2 subtract [experimental]) 
+// multi projection parameter
+uniform int uMultiProjection; // 1: accumulate min, sum and count too (disables LMIP), 0: MIP only
+
+// time series parameter
+uniform float uTimeMix; // interpolation weight of volume_texture_next; 0 for static volumes
+
+// render mode parameters
+uniform int   uRenderMode;         // 0 projections (MIP, MinIP, average), 1 first hit isosurface
+uniform float uIsoValue;           // value of the isosurface
+uniform int   uIsoRefinementSteps; // bisection steps refining a hit
+uniform int   uBrickSize;          // edge length of a brick in voxels, 0 if there are no brick value ranges
+
+// shading parameters
+uniform int   uShading;              // gradient of the maximum: 0 none, 1 central differences on the fly, 2 precomputed
+uniform float uGradientMaxMagnitude; // magnitude encoded by a unit length rgb vector of gradient_texture
 
 /********************    EXPERIMENTAL PARAMETERS      ***********************/ 
 uniform int  uMinStepsLMIP;    // parameter for LMIP 'smoothing'
 uniform int  uMinValThreshold; // minimal value threshold for sample to be considered; deceeding values will be ignored  
 uniform int  uMaxValThreshold; // maximal value threshold for sample to be considered; exceeding values will be ignored
-uniform float uMinDepthRange; // lower bound of constrained depth intervall; depth is mapped to this interval
-uniform float uMaxDepthRange; // upper bound of constrained depth intervall; depth is mapped to this interval 
 /****************************************************************************/
 ///////////////////////////////////////////////////////////////////////////////////
 
 // out-variables
-layout(location = 0) out vec4 fragColor;
+layout(location = 0) out vec4 traversalResult;  // maximum value (iso value if hit), front depth, back depth, relative distance of maximum (hit) to ray start
+layout(location = 1) out vec4 projectionResult; // minimum value, sum of values, amount of samples, relative distance of minimum to ray start
+layout(location = 2) out vec4 shadingResult;    // headlight diffuse term at the maximum (hit), gradient magnitude
+layout(location = 3) out vec4 pickResult;       // uvw coordinates of the maximum (hit), its value; r < 0 if there is none
 
 /**
  * @brief Struct of a volume sample point
@@ -50,6 +70,125 @@ struct VolumeSample
 	vec3 uvw;  // uvw coordinates
 };
 
+/**
+ * @brief sample the volume, interpolated between two time points of a 4D series if uTimeMix > 0
+ * 
+ * @param uvw coordinates of sample
+ * 
+ * @return scalar intensity
+ */
+int sampleVolume(vec3 uvw)
+{
+	int value = texture(volume_texture, uvw).r;
+	if (uTimeMix > 0.0)
+	{
+		value = int( mix( float(value), float( texture(volume_texture_next, uvw).r ), uTimeMix ) );
+	}
+	return value;
+}
+
+/**
+ * @brief trilinear interpolation of the 8 voxels around a point; integer textures are only nearest filtered
+ * 
+ * @param volume to be sampled
+ * @param uvw coordinates of sample, voxel centers at (i + 0.5) / size like the CPU ray caster
+ * 
+ * @return interpolated intensity
+ */
+float fetchTrilinear(isampler3D volume, vec3 uvw)
+{
+	ivec3 size = textureSize(volume, 0);
+	vec3 p = clamp( uvw * vec3(size) - 0.5, vec3(0.0), vec3(size - 1) );
+	ivec3 p0 = clamp( ivec3(p), ivec3(0), max(size - 2, ivec3(0)) ); // lower corner of the cell, inside the volume
+	ivec3 p1 = min( p0 + 1, size - 1 );
+	vec3 f = p - vec3(p0);
+
+	float c000 = float( texelFetch(volume, ivec3(p0.x, p0.y, p0.z), 0).r );
+	float c100 = float( texelFetch(volume, ivec3(p1.x, p0.y, p0.z), 0).r );
+	float c010 = float( texelFetch(volume, ivec3(p0.x, p1.y, p0.z), 0).r );
+	float c110 = float( texelFetch(volume, ivec3(p1.x, p1.y, p0.z), 0).r );
+	float c001 = float( texelFetch(volume, ivec3(p0.x, p0.y, p1.z), 0).r );
+	float c101 = float( texelFetch(volume, ivec3(p1.x, p0.y, p1.z), 0).r );
+	float c011 = float( texelFetch(volume, ivec3(p0.x, p1.y, p1.z), 0).r );
+	float c111 = float( texelFetch(volume, ivec3(p1.x, p1.y, p1.z), 0).r );
+
+	float c00 = mix(c000, c100, f.x);
+	float c10 = mix(c010, c110, f.x);
+	float c01 = mix(c001, c101, f.x);
+	float c11 = mix(c011, c111, f.x);
+	return mix( mix(c00, c10, f.y), mix(c01, c11, f.y), f.z );
+}
+
+/**
+ * @brief trilinearly interpolated sample, between two time points of a 4D series if uTimeMix > 0
+ * 
+ * @param uvw coordinates of sample
+ * 
+ * @return scalar intensity
+ */
+float sampleVolumeTrilinear(vec3 uvw)
+{
+	float value = fetchTrilinear(volume_texture, uvw);
+	if (uTimeMix > 0.0)
+	{
+		value = mix( value, fetchTrilinear(volume_texture_next, uvw), uTimeMix );
+	}
+	return value;
+}
+
+/**
+ * @brief gradient of the volume, in values per voxel
+ * 
+ * @param uvw coordinates of sample
+ * 
+ * @return gradient; decoded from gradient_texture if uShading == 2, central differences otherwise
+ */
+vec3 sampleGradient(vec3 uvw)
+{
+	if (uShading == 2)
+	{
+		// direction scaled by the square root of the relative magnitude
+		vec3 e = texture(gradient_texture, uvw).rgb * 2.0 - 1.0;
+		return e * ( length(e) * uGradientMaxMagnitude );
+	}
+
+	vec3 voxel = 1.0 / vec3( textureSize(volume_texture, 0) );
+	return 0.5 * vec3(
+		float( sampleVolume(uvw + vec3(voxel.x, 0.0, 0.0)) - sampleVolume(uvw - vec3(voxel.x, 0.0, 0.0)) ),
+		float( sampleVolume(uvw + vec3(0.0, voxel.y, 0.0)) - sampleVolume(uvw - vec3(0.0, voxel.y, 0.0)) ),
+		float( sampleVolume(uvw + vec3(0.0, 0.0, voxel.z)) - sampleVolume(uvw - vec3(0.0, 0.0, voxel.z)) )
+		);
+}
+
+/**
+ * @brief two sided headlight, in voxel space
+ * 
+ * @param gradient at the shaded point
+ * @param startUVW start uvw coordinates of the ray
+ * @param endUVW end uvw coordinates of the ray
+ * 
+ * @return diffuse term, 1 if the gradient vanishes
+ */
+float headlight(vec3 gradient, vec3 startUVW, vec3 endUVW)
+{
+	vec3 rayDirection = (endUVW - startUVW) * vec3( textureSize(volume_texture, 0) );
+	if ( length(gradient) == 0.0 || length(rayDirection) == 0.0 )
+	{
+		return 1.0;
+	}
+	return abs( dot( normalize(gradient), normalize(rayDirection) ) );
+}
+
+/**
+ * @brief accumulated values of all considered samples along a ray
+ */
+struct RayStatistics
+{
+	VolumeSample minSample; // sample of minimum intensity
+	float sum;              // sum of values
+	float count;            // amount of considered samples
+};
+
 /**
  * @brief retrieve value for a maximum intensity projection	
  * 
@@ -60,10 +199,12 @@ struct VolumeSample
  * @param minStepsLMIP since last local maximum before LMIP breaks traversal (experimental parameter)
  * @param minValueThreshold to ignore values when deceeded (experimental parameter)
  * @param maxValueThreshold to ignore values when exceeded (experimental parameter)
+ * @param accumulate whether to fill stats; LMIP is disabled then, since all samples are needed
+ * @param stats minimum, sum and count of the considered samples, if accumulate is set
  * 
  * @return sample point in volume, holding value and uvw coordinates
  */
-VolumeSample mip(vec3 startUVW, vec3 endUVW, float stepSize, int thresholdLMIP, int minStepsLMIP, int minValueThreshold, int maxValueThreshold)
+VolumeSample mip(vec3 startUVW, vec3 endUVW, float stepSize, int thresholdLMIP, int minStepsLMIP, int minValueThreshold, int maxValueThreshold, bool accumulate, out RayStatistics stats)
 {
 	float parameterStepSize = stepSize / length(endUVW - startUVW); // necessary parametric steps to get from start to end
 
@@ -73,6 +214,11 @@ VolumeSample mip(vec3 startUVW, vec3 endUVW, float stepSize, int thresholdLMIP,
 
 	int stepsSinceLM = 0; 	 // used in conjunction with experimental minStepsLMIP parameter
 
+	stats.minSample.value = 32767; // initialized to arbitrary value out of CT/MRT range
+	stats.minSample.uvw   = startUVW;
+	stats.sum   = 0.0;
+	stats.count = 0.0;
+
 	// traversa ray, perform mip
 	for (float t = 0.0; t < 1.0 + (0.5 * parameterStepSize); t += parameterStepSize)
 	{
@@ -80,7 +226,7 @@ VolumeSample mip(vec3 startUVW, vec3 endUVW, float stepSize, int thresholdLMIP,
 		
 		// retrieve current sample
 		VolumeSample curSample;
-		curSample.value = texture(volume_texture, curUVW).r;
+		curSample.value = sampleVolume(curUVW);
 		curSample.uvw   = curUVW;
 
 		/// experimental: ignore values exceeding or deceeding some thresholds
@@ -89,6 +235,21 @@ VolumeSample mip(vec3 startUVW, vec3 endUVW, float stepSize, int thresholdLMIP,
 			continue;
 		}
 
+		if (accumulate)
+		{
+			if ( curSample.value < stats.minSample.value )
+			{
+				stats.minSample = curSample;
+			}
+			stats.sum   += float(curSample.value);
+			stats.count += 1.0;
+			if ( curSample.value > curMax.value )
+			{
+				curMax = curSample;
+			}
+			continue; // no early ray termination
+		}
+
 		// found new maximum
 		if ( curSample.value > curMax.value)
 		{
@@ -118,58 +279,80 @@ VolumeSample mip(vec3 startUVW, vec3 endUVW, float stepSize, int thresholdLMIP,
 
 
 /**
- * @brief shifts the relative value closer to 0.5, based on provided distance
- * @param relVal the arbitrary, relative value in [0,1] to be mapped
- * @param dist distance to be used as mixing parameter
- * 
- * @return mapped value with decreased contrast
- */
-float contrastAttenuationLinear(float relVal, float dist)
-{	
-	return  mix(relVal, 0.5, dist);
-}
-
-/**
- * @brief shifts the relative value closer to 0.5, based on provided distance. Alternative to above.
- * @param relVal the arbitrary, relative value in [0,1] to be mapped
- * @param dist distance to be used as mixing parameter, squared
+ * @brief find the first crossing of an iso value along a ray
  * 
- * @return mapped value with decreased contrast
- */
-float contrastAttenuationSquared(float relVal, float dist)
-{	
-	float squaredDist = dist*dist;
-	return  mix(relVal, 0.5, squaredDist);
-}
-
-/**
- * @brief 'transfer-function' applied to value at a given distance to Camera. 
- * shifts towards one color or the other
- * @param value to be mapped to a color
- * @param depth parameter to shift towards front or back color
+ * @param startUVW start uvw coordinates
+ * @param endUVW end uvw coordinates
+ * @param stepSize of ray traversal
+ * @param isoValue of the surface
+ * @param refinementSteps bisection steps between the samples enclosing the crossing
  * 
- * @return mapped color corresponding to value at provided depth
+ * @return ray parameter of the hit in [0,1], 0 if the ray starts inside, -1 if the ray misses the surface
  */
-vec4 transferFunction( int value, float depth)
+float firstHit(vec3 startUVW, vec3 endUVW, float stepSize, float isoValue, int refinementSteps)
 {
-	// linear mapping to grayscale color [0,1]
-	vec4 color = vec4( (float( value ) - uWindowingMinVal) / uWindowingRange );
+	// interpolated like the CPU ray caster, so the refinement converges to the surface instead of voxel faces
+	bool inside = sampleVolumeTrilinear(startUVW) >= isoValue;
+	if ( inside )
+	{
+		return 0.0;
+	}
 
-	// linear mapping to [uMinDistColor, uMaxDistColor] (rgb colors)
-	switch (uMixMode)
+	float rayLength = length(endUVW - startUVW);
+	if ( rayLength == 0.0 )
 	{
-	case 0: // multiply 
-		color = color * ( mix( uMinDistColor, uMaxDistColor, depth ) );
-		break;
-	case 1: // add
-		color = color + ( mix( uMinDistColor, uMaxDistColor, depth ) );
-		break;
-	case 2: /// experimental: subtract
-		color = color - ( vec4(1.0) -  mix( uMinDistColor, uMaxDistColor, depth ) );
-		break;
+		return -1.0;
 	}
-	
-	return color; 
+	float parameterStepSize = stepSize / rayLength;
+
+	// ray in voxel coordinates, for brick lookups
+	vec3 voxels = vec3( textureSize(volume_texture, 0) );
+	vec3 originVoxel = startUVW * voxels - 0.5;
+	vec3 directionVoxel = (endUVW - startUVW) * voxels;
+	directionVoxel = mix( directionVoxel, vec3(1e-6), lessThan( abs(directionVoxel), vec3(1e-6) ) ); // no division by 0
+	ivec3 numBricks = textureSize(brick_texture, 0);
+
+	float t = 0.0;
+	while ( t < 1.0 )
+	{
+		float tNext = t + parameterStepSize;
+		if ( uBrickSize > 0 )
+		{
+			vec3 p = originVoxel + t * directionVoxel;
+			ivec3 brick = clamp( ivec3( max(p, vec3(0.0)) / float(uBrickSize) ), ivec3(0), numBricks - 1 );
+			ivec2 range = texelFetch(brick_texture, brick, 0).rg;
+			if ( isoValue < float(range.x) || isoValue > float(range.y) )
+			{
+				// the segment inside this brick can't cross the iso value: continue on the sampling grid behind it
+				vec3 brickMin = vec3(brick * uBrickSize);
+				vec3 exitPlane = mix( brickMin, brickMin + float(uBrickSize), step(0.0, directionVoxel) );
+				vec3 tExits = (exitPlane - originVoxel) / directionVoxel;
+				float tExit = min( tExits.x, min(tExits.y, tExits.z) );
+				tNext = max( tNext, ceil(tExit / parameterStepSize) * parameterStepSize );
+			}
+		}
+		if ( tNext > 1.0 + 0.5 * parameterStepSize )
+		{
+			break;
+		}
+		tNext = min(tNext, 1.0);
+
+		if ( ( sampleVolumeTrilinear( mix(startUVW, endUVW, tNext) ) >= isoValue ) != inside )
+		{
+			// refine the crossing in [t, tNext]
+			float lo = t;
+			float hi = tNext;
+			for (int i = 0; i < refinementSteps; i++)
+			{
+				float mid = 0.5 * (lo + hi);
+				if ( ( sampleVolumeTrilinear( mix(startUVW, endUVW, mid) ) >= isoValue ) == inside ) { lo = mid; }
+				else { hi = mid; }
+			}
+			return 0.5 * (lo + hi);
+		}
+		t = tNext;
+	}
+	return -1.0;
 }
 
 void main()
@@ -182,7 +365,30 @@ void main()
 	uvwStart.rgb = mix (uvwStart.rgb, uvwEnd.rgb, uRayParamStart);
 	uvwEnd.rgb   = mix( uvwStart.rgb, uvwEnd.rgb, uRayParamEnd);
 
+	if ( uRenderMode == 1 )
+	{
+		float tHit = firstHit( uvwStart.rgb, uvwEnd.rgb, uStepSize, uIsoValue, uIsoRefinementSteps );
+		if ( tHit < 0.0 )
+		{
+			// every target is written, as by a MIP ray without samples: unwritten outputs are undefined
+			traversalResult  = vec4(-1.0e38, uvwStart.a, uvwEnd.a, 0.0); // background, like the clear value
+			projectionResult = vec4(32767.0, 0.0, 0.0, 0.0);              // initial minimum, no samples
+			shadingResult    = vec4(1.0, 0.0, 0.0, 0.0);                  // unshaded
+			pickResult       = vec4(-1.0e38, 0.0, 0.0, 0.0);
+			return;
+		}
+		vec3 hitUVW = mix( uvwStart.rgb, uvwEnd.rgb, tHit );
+		vec3 gradient = sampleGradient(hitUVW);
+
+		traversalResult  = vec4(uIsoValue, uvwStart.a, uvwEnd.a, tHit);
+		projectionResult = vec4(uIsoValue, uIsoValue, 1.0, tHit);
+		shadingResult    = vec4( headlight(gradient, uvwStart.rgb, uvwEnd.rgb), length(gradient), 0.0, 0.0 );
+		pickResult       = vec4( hitUVW, float(sampleVolume(hitUVW)) );
+		return;
+	}
+
 	// find sampleof maximum intensity
+	RayStatistics stats;
 	VolumeSample maxSample = mip( 
 		uvwStart.rgb, 			// ray start
 		uvwEnd.rgb,   			// ray end
@@ -190,39 +396,33 @@ void main()
 		int(uThresholdLMIP),	// LMIP threshold
 		uMinStepsLMIP,			// LMIP steps
 		uMinValThreshold,	 // min value threshold 
-		uMaxValThreshold);   // max value threshold
+		uMaxValThreshold,    // max value threshold
+		uMultiProjection != 0, // accumulate statistics
+		stats);
 
-	// distance to camera 
-	// for approximate (faster) distance: remove sqrt and pow( ,2) --> (linear interpolation)
-	float depth = pow( mix(
-		sqrt( uvwStart.a ), // front depth 
-		sqrt( uvwEnd.a ),   // back depth
+	// everything the color mapping depends on
+	traversalResult = vec4(
+		float(maxSample.value),
+		uvwStart.a, // front depth
+		uvwEnd.a,   // back depth
 		min( 1.0, length(maxSample.uvw - uvwStart.rgb) ) // relative distance
-		), 2);
-
-	/// experimental: map depth to constrained depth interval
-	depth = pow(max(0.0, min(1.0, (sqrt(depth) - uMinDepthRange)/(uMaxDepthRange - uMinDepthRange) )), 2);
-	
-	// distance color effect: decreasing contrast 
-	float relativeIntensity = max(0.0, min(1.0, (float(maxSample.value) - uWindowingMinVal)/ uWindowingRange)); //
-	float mappedIntensity   = mix( 
-		relativeIntensity,
-		contrastAttenuationLinear(relativeIntensity, depth),
-		// contrastAttenuationSquared(relativeIntensity, depth), /// experimental: for a more dramatic effect
-		uContrastEffectInfl);
-
-	// value mapped according to windowing configuration
-	int mappedValue = int( mix(
-		uWindowingMinVal,
-		uWindowingMaxVal,
-		mappedIntensity));
-	
-	// distance color effect: red/blue color mapping
-	vec4 mappedColor = mix( 
-		vec4(mappedIntensity),
-		transferFunction(mappedValue, depth),
-		uColorEffectInfl);
-
-	// final color
-	fragColor = mappedColor;
+		);
+
+	projectionResult = vec4(
+		float(stats.minSample.value),
+		stats.sum,
+		stats.count,
+		min( 1.0, length(stats.minSample.uvw - uvwStart.rgb) ) // relative distance
+		);
+
+	// no sample passed the value thresholds
+	pickResult = ( maxSample.value == -10000 ) ? vec4(-1.0e38, 0.0, 0.0, 0.0) : vec4( maxSample.uvw, float(maxSample.value) );
+
+	// shading of the maximum
+	shadingResult = vec4(1.0, 0.0, 0.0, 0.0);
+	if ( uShading != 0 )
+	{
+		vec3 gradient = sampleGradient(maxSample.uvw);
+		shadingResult = vec4( headlight(gradient, uvwStart.rgb, uvwEnd.rgb), length(gradient), 0.0, 0.0 );
+	}
 }
@@ -0,0 +1,119 @@
+#version 430
+
+// in-variables
+in vec2 passImageCoord;
+
+// textures
+uniform sampler2D  back_uvw_map;   // uvw coordinates map of back  faces
+uniform sampler2D front_uvw_map;   // uvw coordinates map of front faces
+uniform isampler3D volume_a;       // reference volume, e.g. CT
+uniform isampler3D volume_b;       // registered volume, e.g. MRT
+uniform isampler3D packed_volumes; // both volumes on the grid of volume_a: a in r, b in g
+
+////////////////////////////////     UNIFORMS      ////////////////////////////////
+// fusion related uniforms, suffix A: volume a, suffix B: volume b
+uniform int   uPacked;           // 1: fetch both values from packed_volumes, 0: fetch from volume_a and volume_b
+uniform mat4  uRegistrationA;    // fused uvw to volume uvw; for packed volumes only uRegistrationA is applied
+uniform mat4  uRegistrationB;
+uniform float uWindowingMinValA; // windowing lower bound
+uniform float uWindowingMinValB;
+uniform float uWindowingRangeA;  // windowing value range
+uniform float uWindowingRangeB;
+uniform float uWeightA;          // blend weight
+uniform float uWeightB;
+uniform vec4  uColorA;           // color of the maximum intensity
+uniform vec4  uColorB;
+
+// ray traversal related uniforms
+uniform float uRayParamStart;  // constrained sampling parameter intervall start
+uniform float uRayParamEnd;	// constrained sampling parameter intervall end
+uniform float uStepSize;		// ray sampling step size
+///////////////////////////////////////////////////////////////////////////////////
+
+// out-variables
+layout(location = 0) out vec4 fragColor;
+
+const int NO_SAMPLE = -32768; // below the range of both data sets
+
+/**
+ * @brief whether uvw coordinates lie within the volume
+ */
+bool isInside(vec3 uvw)
+{
+	return all( greaterThanEqual(uvw, vec3(0.0)) ) && all( lessThanEqual(uvw, vec3(1.0)) );
+}
+
+/**
+ * @brief maximum intensity of both volumes along the ray, in a single traversal
+ *
+ * @param startUVW start uvw coordinates in fused space
+ * @param endUVW end uvw coordinates in fused space
+ * @param stepSize of ray traversal
+ *
+ * @return maximum of volume a in x, of volume b in y; NO_SAMPLE if the ray missed the volume
+ */
+ivec2 fusedMip(vec3 startUVW, vec3 endUVW, float stepSize)
+{
+	float parameterStepSize = stepSize / length(endUVW - startUVW); // necessary parametric steps to get from start to end
+
+	ivec2 curMax = ivec2(NO_SAMPLE);
+	for (float t = 0.0; t < 1.0 + (0.5 * parameterStepSize); t += parameterStepSize)
+	{
+		vec3 curUVW = mix( startUVW, endUVW, t);
+		vec3 uvwA = ( uRegistrationA * vec4(curUVW, 1.0) ).xyz;
+
+		if (uPacked != 0)
+		{
+			// co-registered: one fetch returns both values
+			if ( isInside(uvwA) )
+			{
+				curMax = max( curMax, texture(packed_volumes, uvwA).rg );
+			}
+		}
+		else
+		{
+			vec3 uvwB = ( uRegistrationB * vec4(curUVW, 1.0) ).xyz;
+			if ( isInside(uvwA) )
+			{
+				curMax.x = max( curMax.x, texture(volume_a, uvwA).r );
+			}
+			if ( isInside(uvwB) )
+			{
+				curMax.y = max( curMax.y, texture(volume_b, uvwB).r );
+			}
+		}
+	}
+
+	return curMax;
+}
+
+/**
+ * @brief windowed and weighted color of one volume's maximum
+ */
+vec4 mapValue(int value, float windowingMinVal, float windowingRange, float weight, vec4 color)
+{
+	if (value == NO_SAMPLE)
+	{
+		return vec4(0.0);
+	}
+	float relativeIntensity = clamp( (float(value) - windowingMinVal) / windowingRange, 0.0, 1.0 );
+	return weight * relativeIntensity * color;
+}
+
+void main()
+{
+	// define ray start and end points in volume
+	vec4 uvwStart = texture( front_uvw_map, passImageCoord );
+	vec4 uvwEnd   = texture( back_uvw_map,  passImageCoord );
+
+	// apply offsets to start and end of ray
+	uvwStart.rgb = mix (uvwStart.rgb, uvwEnd.rgb, uRayParamStart);
+	uvwEnd.rgb   = mix( uvwStart.rgb, uvwEnd.rgb, uRayParamEnd);
+
+	ivec2 maxValues = fusedMip(uvwStart.rgb, uvwEnd.rgb, uStepSize);
+
+	// blend both volumes
+	vec4 colorA = mapValue(maxValues.x, uWindowingMinValA, uWindowingRangeA, uWeightA, uColorA);
+	vec4 colorB = mapValue(maxValues.y, uWindowingMinValB, uWindowingRangeB, uWeightB, uColorB);
+	fragColor = clamp( colorA + colorB, vec4(0.0), vec4(1.0) );
+}
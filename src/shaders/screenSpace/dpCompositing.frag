@@ -3,26 +3,55 @@
 in vec2 passUV;
 
 uniform sampler2D colorMap;
-uniform sampler2D normalMap;
-uniform sampler2D positionMap;
+uniform sampler2D normalMap; // octahedral encoded
+uniform sampler2D depthMap;
 
+uniform mat4 inverseProjection;
 uniform vec4 vLightPos;
 
 uniform float strength;
 uniform float transparency;
+uniform bool  premultiplyAlpha; // output rgb * a, for front to back accumulation
 
 out vec4 fragmentColor;
 
+#include "gBufferDecoding.glsl"
+
+/**
+ * @brief view space position reconstructed from the depth buffer, vec4(0.0) where the layer is empty
+ */
+vec4 positionAt(vec2 uv)
+{
+    float depth = texture(depthMap, uv).r;
+    if (depth == 1.0)
+    {
+        return vec4(0.0);
+    }
+    return vec4(reconstructPosition(uv, depth), 1.0);
+}
+
+/**
+ * @brief decoded view space normal, vec4(0.0) where the layer is empty
+ */
+vec4 normalAt(vec2 uv)
+{
+    if (texture(depthMap, uv).r == 1.0)
+    {
+        return vec4(0.0);
+    }
+    return vec4(decodeNormal(texture(normalMap, uv).xy), 0.0);
+}
+
 void main() {
 
-    vec4 position = texture(positionMap, passUV);
+    vec4 position = positionAt(passUV);
     
     // if (position.a != 1.0)
     // {
     //     discard;
     // }
     
-    vec4 normal =   texture(normalMap, passUV);
+    vec4 normal =   normalAt(passUV);
     vec4 color =    texture(colorMap, passUV);
     
         vec3 eye = normalize(-position.xyz);
@@ -39,20 +68,20 @@ void main() {
         // silhouette
         vec2 texStep = vec2(1.0 / 800.0, 1.0 / 600.0);
         float normalDiffX = length( 
-              texture(normalMap, passUV + vec2(texStep.x,0.0)) 
+              normalAt(passUV + vec2(texStep.x,0.0)) 
             - normal 
             );
         float normalDiffY = length( 
-              texture(normalMap, passUV + vec2(0.0,texStep.y)) 
+              normalAt(passUV + vec2(0.0,texStep.y)) 
             - normal 
         );
 
         float posDiffX = length( 
-              texture(positionMap, passUV + vec2(texStep.x,0.0)) 
+              positionAt(passUV + vec2(texStep.x,0.0)) 
             - position 
             );
         float posDiffY = length( 
-              texture(positionMap, passUV + vec2(0.0,texStep.y)) 
+              positionAt(passUV + vec2(0.0,texStep.y)) 
             - position 
         );
 
@@ -90,4 +119,10 @@ void main() {
         
         // use strength as transparency value
         fragmentColor.a = (1.0 - transparency) * fragmentColor.a;
+
+        if (premultiplyAlpha)
+        {
+            fragmentColor = clamp(fragmentColor, 0.0, 1.0); // as a fixed point target would
+            fragmentColor.rgb *= fragmentColor.a;
+        }
 }
\ No newline at end of file
@@ -4,16 +4,20 @@ in vec2 passUV;
 
 uniform sampler2D colorMap;
 uniform sampler2D normalMap;
-uniform sampler2D positionMap;
+uniform sampler2D depthMap;
 
+uniform mat4 inverseProjection;
 uniform vec4 vLightPos;
 
 out vec4 fragmentColor;
 
+#include "gBufferDecoding.glsl"
+
 void main() {
-    vec4 position = texture(positionMap, passUV);
-    if (position.a == 0.0) { discard; }
-    vec4 normal =   texture(normalMap, passUV);
+    float depth = texture(depthMap, passUV).r;
+    if (depth == 1.0) { discard; }
+    vec4 position = vec4( reconstructPosition(passUV, depth), 1.0 );
+    vec4 normal =   vec4( decodeNormal( texture(normalMap, passUV).xy ), 0.0 );
     vec4 color =    texture(colorMap, passUV);
     
     //calculate lighting with given position, normal and lightposition
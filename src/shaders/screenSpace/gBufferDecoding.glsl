@@ -0,0 +1,27 @@
+/*
+* Decoding of the compact G-Buffer (see FrameBufferObject::getCompactGBufferFormats), shared by the
+* screen space passes via #include "gBufferDecoding.glsl".
+* The including shader declares uniform mat4 inverseProjection before the include.
+*/
+
+/**
+ * @brief inverse of the octahedral normal encoding of GBuffer.frag
+ */
+vec3 decodeNormal(vec2 e)
+{
+	e = e * 2.0 - 1.0;
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += (n.x >= 0.0) ? -t : t;
+	n.y += (n.y >= 0.0) ? -t : t;
+	return normalize(n);
+}
+
+/**
+ * @brief view space position from screen uv and depth buffer value
+ */
+vec3 reconstructPosition(vec2 uv, float depth)
+{
+	vec4 position = inverseProjection * vec4( vec3(uv, depth) * 2.0 - 1.0, 1.0 );
+	return position.xyz / position.w;
+}
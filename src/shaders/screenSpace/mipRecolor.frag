@@ -0,0 +1,184 @@
+#version 330
+
+/*
+* Deferred color mapping of a MIP: applies windowing, the depth based contrast attenuation and the
+* depth based color shift to the traversal result written by volume.frag. Changing any of these
+* parameters only needs this pass, not a new ray traversal.
+* The displayed projection (MIP, MinIP, average) is selected here as well, if volume.frag accumulated them.
+* Pixels not covered by the volume keep the clear value (below -1e30) and are discarded.
+* The MIP can be shaded with the diffuse term of the gradient at the maximum.
+* Isosurface hits are shaded with a constant surface color; the depth based color shift still applies.
+*/
+
+//!< in-variables
+in vec2 passUV;
+
+//!< textures
+uniform sampler2D traversal_map;  // maximum value, front depth, back depth, relative distance of maximum
+uniform sampler2D projection_map; // minimum value, sum of values, amount of samples, relative distance of minimum
+uniform sampler2D shading_map;    // diffuse term at the maximum, gradient magnitude
+
+////////////////////////////////     UNIFORMS      ////////////////////////////////
+// projection to display: 0 MIP, 1 MinIP, 2 average intensity projection
+uniform int uProjection;
+
+// color mapping related uniforms 
+uniform float uWindowingRange;  // windowing value range
+uniform float uWindowingMinVal; // windowing lower bound
+uniform float uWindowingMaxVal; // windowing upper bound
+
+// depth effect parameters
+uniform float uColorEffectInfl;    // color    effect: influence parameter [0,1]
+uniform float uContrastEffectInfl; // contrast effect: influence parameter [0,1]
+uniform vec4  uMaxDistColor; // color effect: color at max distance
+uniform vec4  uMinDistColor; // color effect: color at min distance
+uniform int   uMixMode; 	 // color effect: color mixing mode (0 multiply, 1 add, 2 subtract [experimental]) 
+
+// shading parameter
+uniform float uShadingInfl; // influence of the diffuse term on the MIP [0,1]
+
+// isosurface parameters
+uniform int   uRenderMode; // 0 projections, 1 first hit isosurface
+uniform vec4  uIsoColor;   // surface color
+
+/********************    EXPERIMENTAL PARAMETERS      ***********************/ 
+uniform float uMinDepthRange; // lower bound of constrained depth intervall; depth is mapped to this interval
+uniform float uMaxDepthRange; // upper bound of constrained depth intervall; depth is mapped to this interval 
+/****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////////
+
+//!< out-variables
+layout(location = 0) out vec4 fragColor;
+
+/**
+ * @brief shifts the relative value closer to 0.5, based on provided distance
+ * @param relVal the arbitrary, relative value in [0,1] to be mapped
+ * @param dist distance to be used as mixing parameter
+ * 
+ * @return mapped value with decreased contrast
+ */
+float contrastAttenuationLinear(float relVal, float dist)
+{	
+	return  mix(relVal, 0.5, dist);
+}
+
+/**
+ * @brief shifts the relative value closer to 0.5, based on provided distance. Alternative to above.
+ * @param relVal the arbitrary, relative value in [0,1] to be mapped
+ * @param dist distance to be used as mixing parameter, squared
+ * 
+ * @return mapped value with decreased contrast
+ */
+float contrastAttenuationSquared(float relVal, float dist)
+{	
+	float squaredDist = dist*dist;
+	return  mix(relVal, 0.5, squaredDist);
+}
+
+/**
+ * @brief 'transfer-function' applied to value at a given distance to Camera. 
+ * shifts towards one color or the other
+ * @param value to be mapped to a color
+ * @param depth parameter to shift towards front or back color
+ * 
+ * @return mapped color corresponding to value at provided depth
+ */
+vec4 transferFunction( int value, float depth)
+{
+	// linear mapping to grayscale color [0,1]
+	vec4 color = vec4( (float( value ) - uWindowingMinVal) / uWindowingRange );
+
+	// linear mapping to [uMinDistColor, uMaxDistColor] (rgb colors)
+	switch (uMixMode)
+	{
+	case 0: // multiply 
+		color = color * ( mix( uMinDistColor, uMaxDistColor, depth ) );
+		break;
+	case 1: // add
+		color = color + ( mix( uMinDistColor, uMaxDistColor, depth ) );
+		break;
+	case 2: /// experimental: subtract
+		color = color - ( vec4(1.0) -  mix( uMinDistColor, uMaxDistColor, depth ) );
+		break;
+	}
+	
+	return color; 
+}
+
+void main()
+{
+	vec4 traversal = texture( traversal_map, passUV );
+	if ( traversal.r < -1e30 )
+	{
+		discard;
+	}
+
+	// value and its relative distance to ray start of the selected projection
+	float value = traversal.r;
+	float relativeDistance = traversal.a;
+	if ( uProjection != 0 && uRenderMode == 0 )
+	{
+		vec4 projection = texture( projection_map, passUV );
+		if ( uProjection == 1 )
+		{
+			value = projection.r;
+			relativeDistance = projection.a;
+		}
+		else
+		{
+			value = projection.g / max( projection.b, 1.0 );
+			relativeDistance = 0.5; // no distinguished sample: center of ray
+		}
+	}
+
+	// distance to camera 
+	// for approximate (faster) distance: remove sqrt and pow( ,2) --> (linear interpolation)
+	float depth = pow( mix(
+		sqrt( traversal.g ), // front depth 
+		sqrt( traversal.b ), // back depth
+		relativeDistance
+		), 2);
+
+	/// experimental: map depth to constrained depth interval
+	depth = pow(max(0.0, min(1.0, (sqrt(depth) - uMinDepthRange)/(uMaxDepthRange - uMinDepthRange) )), 2);
+
+	// isosurface: ambient and diffuse term, depth color shift
+	if ( uRenderMode == 1 )
+	{
+		float diffuse = texture( shading_map, passUV ).r;
+		vec4 surfaceColor = uIsoColor * (0.2 + 0.8 * diffuse);
+		fragColor = mix( surfaceColor, surfaceColor * mix( uMinDistColor, uMaxDistColor, depth ), uColorEffectInfl );
+		fragColor.a = 1.0;
+		return;
+	}
+	
+	// distance color effect: decreasing contrast 
+	float relativeIntensity = max(0.0, min(1.0, (value - uWindowingMinVal)/ uWindowingRange)); //
+	float mappedIntensity   = mix( 
+		relativeIntensity,
+		contrastAttenuationLinear(relativeIntensity, depth),
+		// contrastAttenuationSquared(relativeIntensity, depth), /// experimental: for a more dramatic effect
+		uContrastEffectInfl);
+
+	// value mapped according to windowing configuration
+	int mappedValue = int( mix(
+		uWindowingMinVal,
+		uWindowingMaxVal,
+		mappedIntensity));
+	
+	// distance color effect: red/blue color mapping
+	vec4 mappedColor = mix( 
+		vec4(mappedIntensity),
+		transferFunction(mappedValue, depth),
+		uColorEffectInfl);
+
+	// shading of the maximum
+	if ( uProjection == 0 && uShadingInfl > 0.0 )
+	{
+		float diffuse = texture( shading_map, passUV ).r;
+		mappedColor.rgb *= mix( 1.0, diffuse, uShadingInfl );
+	}
+
+	// final color
+	fragColor = mappedColor;
+}
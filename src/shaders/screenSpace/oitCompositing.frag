@@ -0,0 +1,164 @@
+#version 430
+
+/*
+* Resolves the per-pixel fragment lists written by oitLinkedList.frag in a single pass:
+* the list is sorted front to back, every layer is shaded like dpCompositing.frag shades a
+* depth peeling layer (silhouettes compare with the same layer of the neighbour pixels)
+* and the layers are blended back to front.
+*/
+
+in vec2 passUV;
+
+uniform vec4 vLightPos;
+
+uniform float strength;
+uniform float transparency;
+
+uniform int  maxLayers;      // amount of front-most layers to be composited, at most MAX_FRAGMENTS
+uniform vec4 backgroundColor;
+
+out vec4 fragmentColor;
+
+const uint END_OF_LIST = 0xFFFFFFFFu;
+const int MAX_FRAGMENTS = 16; // nearest fragments per pixel considered, farther fragments are ignored
+
+struct FragmentNode
+{
+	vec3 position; // view space position
+	uint color;    // packed rgba8
+	vec3 normal;   // view space normal
+	uint next;     // index of the next node, END_OF_LIST at the end of the list
+};
+
+layout(binding = 0, r32ui) uniform readonly uimage2D head_pointers;
+layout(std430, binding = 0) readonly buffer FragmentNodes
+{
+	FragmentNode nodes[];
+};
+
+/**
+ * @brief collect the node indices of the MAX_FRAGMENTS nearest fragments of a pixel's list, sorted front to back
+ *
+ * The list is in reverse insertion order, so all of it is walked: once the array is full,
+ * a closer fragment replaces the farthest entry.
+ * @return amount of collected nodes
+ */
+int loadSortedList(ivec2 pixel, out uint sorted[MAX_FRAGMENTS])
+{
+	pixel = clamp(pixel, ivec2(0), imageSize(head_pointers) - 1);
+
+	int count = 0;
+	uint current = imageLoad(head_pointers, pixel).r;
+	while ( current != END_OF_LIST )
+	{
+		// insertion sort: view space z is negative, closer fragments have greater z
+		float z = nodes[current].position.z;
+		if ( count < MAX_FRAGMENTS || nodes[ sorted[MAX_FRAGMENTS-1] ].position.z < z )
+		{
+			int i = min(count, MAX_FRAGMENTS - 1); // if full, the farthest entry is overwritten
+			while ( i > 0 && nodes[ sorted[i-1] ].position.z < z )
+			{
+				sorted[i] = sorted[i-1];
+				i--;
+			}
+			sorted[i] = current;
+			count = min(count + 1, MAX_FRAGMENTS);
+		}
+
+		current = nodes[current].next;
+	}
+	return count;
+}
+
+vec4 layerPosition(uint sorted[MAX_FRAGMENTS], int count, int layer)
+{
+	return (layer < count) ? vec4( nodes[ sorted[layer] ].position, 1.0 ) : vec4(0.0);
+}
+
+vec4 layerNormal(uint sorted[MAX_FRAGMENTS], int count, int layer)
+{
+	return (layer < count) ? vec4( nodes[ sorted[layer] ].normal, 0.0 ) : vec4(0.0);
+}
+
+/**
+ * @brief lighting and silhouettes of a single layer, as in dpCompositing.frag
+ */
+vec4 shade(vec4 position, vec4 normal, vec4 color, vec4 positionX, vec4 normalX, vec4 positionY, vec4 normalY)
+{
+	vec3 eye = normalize(-position.xyz);
+
+	//calculate lighting with given position, normal and lightposition
+	vec3 nPosToLight = normalize( vLightPos.xyz - position.xyz );
+
+	vec3 nReflection = reflect( -eye, normal.xyz );
+
+	float ambient = 0.1;
+	float diffuse = max( dot(normal.xyz, nPosToLight), 0);
+	float specular = pow( max( dot( nReflection, nPosToLight ), 0),15);
+
+	// silhouette
+	float normalDiffX = length( normalX - normal );
+	float normalDiffY = length( normalY - normal );
+
+	float posDiffX = length( positionX - position );
+	float posDiffY = length( positionY - position );
+
+	float silhouetteOuter = 0.0;
+	if (  (posDiffX+posDiffY)/2.0 > strength
+		|| (posDiffX > strength)
+		|| (posDiffX > strength) )
+	{
+		silhouetteOuter = 1.0;
+	}
+
+	float silhouetteInner = 0.0;
+	if (  (normalDiffX+normalDiffY)/2.0 > strength
+		|| (normalDiffX > strength)
+		|| (normalDiffY > strength) )
+	{
+		silhouetteInner = 1.0;
+	}
+
+	// rim light strength
+	float rim = pow( 1.0 - abs(dot(normal.xyz, eye)) , 5);
+
+	vec4 shaded = vec4(
+	  color.rgb * ambient
+	+ color.rgb * diffuse
+	+ vec3(1,1,1) * specular
+	+ vec3(1,1,1) * rim
+	- vec3(1,1,1) * silhouetteInner
+	- vec3(1,1,1) * silhouetteOuter
+	, color.a)
+	;
+
+	// use strength as transparency value
+	shaded.a = (1.0 - transparency) * shaded.a;
+	return shaded;
+}
+
+void main() {
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+
+	uint sorted[MAX_FRAGMENTS];
+	uint sortedX[MAX_FRAGMENTS];
+	uint sortedY[MAX_FRAGMENTS];
+	int count  = loadSortedList(pixel, sorted);
+	int countX = loadSortedList(pixel + ivec2(1,0), sortedX);
+	int countY = loadSortedList(pixel + ivec2(0,1), sortedY);
+
+	// blend back to front, like glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA) over the background
+	vec4 result = backgroundColor;
+	for (int layer = min(count, maxLayers) - 1; layer >= 0; layer--)
+	{
+		vec4 color = unpackUnorm4x8( nodes[ sorted[layer] ].color );
+		vec4 shaded = shade(
+			layerPosition(sorted, count, layer),  layerNormal(sorted, count, layer), color,
+			layerPosition(sortedX, countX, layer), layerNormal(sortedX, countX, layer),
+			layerPosition(sortedY, countY, layer), layerNormal(sortedY, countY, layer));
+
+		result = shaded.a * shaded + (1.0 - shaded.a) * result;
+	}
+
+	fragmentColor = result;
+}
@@ -3,10 +3,11 @@
 in vec2 passUV;
 
 uniform sampler2D normalMap;
-uniform sampler2D positionMap;
+uniform sampler2D depthMap;
 uniform sampler2D uvMap;
 
 uniform mat4 view;
+uniform mat4 inverseProjection;
 
 uniform mat4 bbModel;
 uniform sampler2D bbTex;
@@ -19,6 +20,8 @@ uniform float strength;
 
 out vec4 fragmentColor;
 
+#include "gBufferDecoding.glsl"
+
 vec3 intersectPlane( vec3 p, vec3 d, vec3 v1, vec3 v2, vec3 v3)
 {
    mat3 m = inverse(mat3(d, v2 - v1, v3 - v1));
@@ -29,11 +32,12 @@ vec3 intersectPlane( vec3 p, vec3 d, vec3 v1, vec3 v2, vec3 v3)
 }
 
 void main() {
-    vec4 position = texture(positionMap, passUV);
-    vec4 normal =   texture(normalMap, passUV);
+    float depth = texture(depthMap, passUV).r;
+    vec4 position = vec4( reconstructPosition(passUV, depth), 1.0 );
+    vec4 normal =   vec4( decodeNormal( texture(normalMap, passUV).xy ), 0.0 );
     vec2 uvCoords =       texture(uvMap, passUV).xy;
     
-    if (position.a != 0.0)
+    if (depth != 1.0)
     {
         vec3 eye = normalize(-position.xyz);
 
@@ -0,0 +1,158 @@
+#version 430
+
+/*
+* Screen space reflections against arbitrary geometry: reflection rays are traced in screen space
+* through the hierarchical min-depth pyramid built by hiZ.comp. Cells whose closest depth lies behind
+* the ray are skipped at the coarsest possible level, so a ray needs O(log n) steps instead of one per pixel.
+* May be rendered at a lower resolution than the G-Buffer; ssrResolve.frag upsamples and fetches the colors.
+*
+* Output: hit uv, confidence in [0,1], 1.0; vec4(0.0) if no hit was found.
+*/
+
+in vec2 passUV;
+
+uniform sampler2D normalMap; // octahedral encoded
+uniform sampler2D hi_z; // min-depth pyramid, level 0 holds the depth buffer of the G-Buffer
+
+uniform mat4  projection;
+uniform mat4  inverseProjection;
+uniform int   uMaxLevel;      // coarsest level of hi_z
+uniform int   uMaxIterations; // ray budget: traversal steps per ray
+uniform float uMaxDistance;   // maximum reflection ray length in view space
+uniform float uThickness;     // assumed thickness of surfaces in view space; rays passing farther behind do not hit
+
+out vec4 fragmentColor;
+
+#include "gBufferDecoding.glsl"
+
+/**
+ * @brief view space position to (uv, depth) in [0,1]
+ */
+vec3 projectToScreen(vec3 position)
+{
+	vec4 clip = projection * vec4(position, 1.0);
+	return clip.xyz / clip.w * 0.5 + 0.5;
+}
+
+/**
+ * @brief depth buffer value to (negative) view space z
+ */
+float linearizeDepth(float depth)
+{
+	return -projection[3][2] / ( (depth * 2.0 - 1.0) + projection[2][2] );
+}
+
+/**
+ * @brief ray parameter at which the ray leaves the given cell, slightly inside the next cell
+ */
+float cellExitParameter(vec3 origin, vec3 direction, ivec2 cell, vec2 cellCount, float epsilon)
+{
+	vec2 boundary = ( vec2(cell) + step(vec2(0.0), direction.xy) ) / cellCount;
+	vec2 safeDirection = mix( vec2(1e-7), direction.xy, greaterThan(abs(direction.xy), vec2(1e-7)) );
+	vec2 t = (boundary - origin.xy) / safeDirection;
+	return min(t.x, t.y) + epsilon;
+}
+
+void main() {
+	fragmentColor = vec4(0.0);
+
+	float depth = textureLod(hi_z, passUV, 0.0).r;
+	if (depth == 1.0)
+	{
+		return; // background
+	}
+	vec4 position = vec4( reconstructPosition(passUV, depth), 1.0 );
+	vec3 normal = decodeNormal( texture(normalMap, passUV).xy );
+	vec3 reflection = normalize( reflect( normalize(position.xyz), normal ) );
+
+	// clip ray to the near plane
+	float near = -linearizeDepth(0.0);
+	float rayLength = uMaxDistance;
+	if ( position.z + reflection.z * rayLength > -near )
+	{
+		rayLength = 0.99 * (-near - position.z) / reflection.z;
+	}
+
+	// screen space ray: origin + t * direction, t in [0,1]
+	vec3 origin    = projectToScreen(position.xyz);
+	vec3 direction = projectToScreen(position.xyz + reflection * rayLength) - origin;
+
+	vec2 resolution = vec2( textureSize(hi_z, 0) );
+	float epsilon = 0.1 / max( max( abs(direction.x) * resolution.x, abs(direction.y) * resolution.y ), 1e-5 ); // a tenth of a pixel
+
+	// leave the pixel of origin to avoid self intersection
+	float t = cellExitParameter(origin, direction, ivec2( floor(origin.xy * resolution) ), resolution, epsilon);
+
+	int level = 0;
+	int iteration = 0;
+	bool hit = false;
+	while ( level >= 0 && iteration < uMaxIterations )
+	{
+		vec3 ray = origin + direction * t;
+		if ( t > 1.0 || any( lessThan(ray.xy, vec2(0.0)) ) || any( greaterThanEqual(ray.xy, vec2(1.0)) ) )
+		{
+			break; // left the screen or exceeded ray length
+		}
+
+		vec2 cellCount = vec2( textureSize(hi_z, level) );
+		ivec2 cell = ivec2( floor(ray.xy * cellCount) );
+		float minDepth = texelFetch(hi_z, cell, level).r;
+		float tExit = cellExitParameter(origin, direction, cell, cellCount, epsilon);
+
+		if ( ray.z < minDepth )
+		{
+			// ray is in front of everything in this cell: it may only hit if it reaches the closest depth in the cell
+			float tPlane = (direction.z > 0.0) ? t + (minDepth - ray.z) / direction.z : 1e30;
+			if ( tPlane < tExit )
+			{
+				t = tPlane;
+				level--; // refine
+			}
+			else
+			{
+				t = tExit;
+				level = min(level + 1, uMaxLevel); // skip the cell, continue coarser
+			}
+		}
+		else if ( level > 0 )
+		{
+			level--; // ray is behind the closest depth: refine
+		}
+		else
+		{
+			// ray is behind the depth of this pixel: hit, unless it passes behind the surface
+			if ( linearizeDepth(minDepth) - linearizeDepth(ray.z) > uThickness )
+			{
+				t = tExit;
+			}
+			else
+			{
+				level--;
+			}
+		}
+		iteration++;
+	}
+	hit = (level < 0);
+
+	if ( !hit )
+	{
+		return;
+	}
+
+	vec2 hitUV = (origin + direction * t).xy;
+
+	// back faces of other objects are not visible in the reflection
+	vec3 hitNormal = decodeNormal( texture(normalMap, hitUV).xy );
+	if ( dot(hitNormal, reflection) > 0.0 )
+	{
+		return;
+	}
+
+	// fade out where screen space information runs out
+	vec2 edge = abs(hitUV * 2.0 - 1.0);
+	float confidence = 1.0 - smoothstep( 0.8, 1.0, max(edge.x, edge.y) ); // screen border
+	confidence *= 1.0 - t * t;                                            // ray length
+	confidence *= 1.0 - clamp( reflection.z, 0.0, 1.0 );                 // towards the camera
+
+	fragmentColor = vec4(hitUV, confidence, 1.0);
+}
@@ -0,0 +1,86 @@
+#version 430
+
+/*
+* Resolves the (possibly lower resolution) ray hits of ssrHiZ.frag into reflection colors:
+* 1) bilateral upsampling: the nearest trace texels are weighted by bilinear weights and depth similarity
+* 2) temporal accumulation: blended with the reprojected result of the last frame, which is clamped
+*    to the range of the current samples to limit ghosting
+*
+* Output: reflected color, confidence as alpha.
+*/
+
+in vec2 passUV;
+
+uniform sampler2D traceMap;    // hit uv, confidence
+uniform sampler2D sceneMap;    // lit scene
+uniform sampler2D historyMap;  // output of the last frame
+uniform sampler2D hi_z;        // min-depth pyramid
+
+uniform mat4  projection;
+uniform mat4  inverseProjection;
+uniform mat4  uReprojection;   // view space of this frame to clip space of the last frame
+uniform int   uTraceLevel;     // level of hi_z matching the resolution of traceMap
+uniform int   uHistoryValid;   // 0 if historyMap does not hold a previous result
+uniform float uTemporalWeight; // weight of the history
+
+out vec4 fragmentColor;
+
+#include "gBufferDecoding.glsl"
+
+float linearizeDepth(float depth)
+{
+	return -projection[3][2] / ( (depth * 2.0 - 1.0) + projection[2][2] );
+}
+
+void main() {
+	fragmentColor = vec4(0.0);
+
+	float depthValue = texelFetch(hi_z, ivec2(gl_FragCoord.xy), 0).r;
+	if (depthValue == 1.0)
+	{
+		return; // background
+	}
+	vec3 position = reconstructPosition(passUV, depthValue);
+
+	// bilateral upsampling of the trace result
+	ivec2 traceSize = textureSize(traceMap, 0);
+	vec2 coord = passUV * vec2(traceSize) - 0.5;
+	ivec2 base = ivec2( floor(coord) );
+	vec2 f = fract(coord);
+
+	float depth = linearizeDepth(depthValue);
+
+	vec4 reflection = vec4(0.0);
+	float weightSum = 0.0;
+	vec4 minColor = vec4(1e30);
+	vec4 maxColor = vec4(-1e30);
+	for (int i = 0; i < 4; i++)
+	{
+		ivec2 offset = ivec2(i & 1, i >> 1);
+		ivec2 texel = clamp( base + offset, ivec2(0), traceSize - 1 );
+
+		float bilinear = (offset.x == 1 ? f.x : 1.0 - f.x) * (offset.y == 1 ? f.y : 1.0 - f.y);
+		float tapDepth = linearizeDepth( texelFetch(hi_z, texel, uTraceLevel).r );
+		float weight = bilinear / (1e-3 + abs(depth - tapDepth));
+
+		vec4 trace = texelFetch(traceMap, texel, 0);
+		vec4 color = (trace.z > 0.0) ? vec4( texture(sceneMap, trace.xy).rgb, trace.z ) : vec4(0.0);
+
+		reflection += weight * color;
+		weightSum  += weight;
+		minColor = min(minColor, color);
+		maxColor = max(maxColor, color);
+	}
+	reflection /= max(weightSum, 1e-6);
+
+	// temporal accumulation
+	vec4 previous = uReprojection * vec4(position, 1.0);
+	vec2 previousUV = previous.xy / previous.w * 0.5 + 0.5;
+	if ( uHistoryValid != 0 && all( greaterThanEqual(previousUV, vec2(0.0)) ) && all( lessThanEqual(previousUV, vec2(1.0)) ) )
+	{
+		vec4 history = clamp( texture(historyMap, previousUV), minColor, maxColor );
+		reflection = mix(reflection, history, uTemporalWeight);
+	}
+
+	fragmentColor = reflection;
+}
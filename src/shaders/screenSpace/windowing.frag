@@ -0,0 +1,29 @@
+#version 330
+
+/*
+* Maps a single channel float texture (e.g. a CPU rendered MIP) to grayscale using a linear window.
+* Texels without a value (below -1e30) are discarded.
+*/
+
+//!< in-variables
+in vec2 passUV;
+
+//!< uniforms
+uniform sampler2D tex;
+uniform float uWindowingMinVal; // windowing lower bound
+uniform float uWindowingRange;  // windowing value range
+
+//!< out-variables
+layout(location = 0) out vec4 fragColor;
+
+void main() 
+{
+	float value = texture(tex, passUV).r;
+	if ( value < -1e30 )
+	{
+		discard;
+	}
+
+	float relativeIntensity = clamp( (value - uWindowingMinVal) / uWindowingRange, 0.0, 1.0 );
+	fragColor = vec4( vec3(relativeIntensity), 1.0 );
+}